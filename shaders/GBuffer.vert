@@ -13,9 +13,13 @@ layout(location = 3) out vec3 frag_pos_world;
 layout(push_constant) uniform PushConstantObject
 {
 	mat4 model;
-	mat4 mvp;
 } push_constants;
 
+layout(set = 0 , binding = 5) uniform CameraUbo
+{
+	mat4 projView;
+} camera;
+
 out gl_PerVertex
 {
 	vec4 gl_Position;
@@ -24,10 +28,11 @@ out gl_PerVertex
 void main()
 {
 	mat4 invtransmodel = transpose(inverse(push_constants.model));
-	gl_Position = push_constants.mvp * vec4( in_position , 1.0f ) ;
+	vec4 world = push_constants.model * vec4( in_position , 1.0f );
+	gl_Position = camera.projView * world ;
 	frag_color = in_color;
 	frag_tex_coord = in_tex_coord;
 	frag_normal = ( invtransmodel * ( vec4( in_normal , 1.0f ) ) ).xyz;
-	frag_pos_world = vec3( push_constants.model * vec4(in_position , 1.0f));
+	frag_pos_world = vec3( world );
 	frag_pos_world.y = -frag_pos_world.y;
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#version 450
+
+// compiled to GBufferIndirectVert.spv , the world matrix comes from the object data instead of the push constants .
+
+struct ObjectData
+{
+	mat4 model;
+	vec4 boundsCenter;
+	vec4 boundsExtent;
+	uint indexCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint batch;
+};
+
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_color;
+layout(location = 2) in vec2 in_tex_coord;
+layout(location = 3) in vec3 in_normal;
+
+layout(location = 0) out vec3 frag_color;
+layout(location = 1) out vec2 frag_tex_coord;
+layout(location = 2) out vec3 frag_normal;
+layout(location = 3) out vec3 frag_pos_world;
+
+layout(set = 0 , binding = 5) uniform CameraUbo
+{
+	mat4 projView;
+} camera;
+
+layout(std430 , set = 1 , binding = 0) readonly buffer Objects
+{
+	ObjectData objects[];
+};
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main()
+{
+	mat4 model = objects[gl_InstanceIndex].model;
+	mat4 invtransmodel = transpose(inverse(model));
+	vec4 world = model * vec4( in_position , 1.0f );
+	gl_Position = camera.projView * world ;
+	frag_color = in_color;
+	frag_tex_coord = in_tex_coord;
+	frag_normal = ( invtransmodel * ( vec4( in_normal , 1.0f ) ) ).xyz;
+	frag_pos_world = vec3( world );
+	frag_pos_world.y = -frag_pos_world.y;
+}
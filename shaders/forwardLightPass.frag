@@ -23,10 +23,7 @@ layout(push_constant) uniform PushConstantObject
 {
 	ivec2 tileNum;
 	ivec2 viewportOffset;
-	mat4 projection;
 	mat4 model;
-	mat4 view;
-	vec3 camPos;
 } push_constants;
 
 layout( location = 0 ) in vec3 frag_color;
@@ -39,6 +36,7 @@ layout( location = 0 ) out vec4 out_color;
 layout( set = 0 , binding = 0 ) uniform MatUbo
 {
 	vec3 cameraPos;
+	mat4 projView;
 }transform;
 
 layout( set = 1 , binding = 0 ) uniform sampler2D albedo_sampler;
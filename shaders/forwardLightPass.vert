@@ -6,9 +6,15 @@ layout(push_constant) uniform PushConstantObject
 	ivec2 tileNum;
 	ivec2 viewportOffset;
 	mat4 model;
-	mat4 mvp;
 } push_constants;
 
+// written once per frame by the pipeline , the secondaries bind it with a dynamic offset .
+layout( set = 0 , binding = 0 ) uniform MatUbo
+{
+	vec3 cameraPos;
+	mat4 projView;
+} transform;
+
 
 layout(location = 0) in vec3 in_position;
 layout(location = 1) in vec3 in_color;
@@ -27,11 +33,10 @@ out gl_PerVertex
 
 void main()
 {
-	mat4 invtransmodel = transpose(inverse(push_constants.model));
-	
-	gl_Position = push_constants.mvp * vec4( in_position , 1.0f ) ;
+	vec4 world = push_constants.model * vec4( in_position , 1.0f );
+	gl_Position = transform.projView * world ;
 	frag_color = in_color;
 	frag_tex_coord = in_tex_coord;
 	frag_normal = in_normal;
-	frag_pos_world = vec3( push_constants.model * vec4(in_position , 1.0f));
+	frag_pos_world = vec3( world );
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable 
+
+// compiled to forwardLightPassIndirectVert.spv , the world matrix comes from the object data instead of the push constants .
+
+struct ObjectData
+{
+	mat4 model;
+	vec4 boundsCenter;
+	vec4 boundsExtent;
+	uint indexCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint batch;
+};
+
+// written once per frame by the pipeline , the materials bind it with a dynamic offset .
+layout( set = 0 , binding = 0 ) uniform MatUbo
+{
+	vec3 cameraPos;
+	mat4 projView;
+} transform;
+
+layout(std430 , set = 3 , binding = 0) readonly buffer Objects
+{
+	ObjectData objects[];
+};
+
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_color;
+layout(location = 2) in vec2 in_tex_coord;
+layout(location = 3) in vec3 in_normal;
+
+layout(location = 0) out vec3 frag_color;
+layout(location = 1) out vec2 frag_tex_coord;
+layout(location = 2) out vec3 frag_normal;
+layout(location = 3) out vec3 frag_pos_world;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main()
+{
+	vec4 world = objects[gl_InstanceIndex].model * vec4( in_position , 1.0f );
+	gl_Position = transform.projView * world ;
+	frag_color = in_color;
+	frag_tex_coord = in_tex_coord;
+	frag_normal = in_normal;
+	frag_pos_world = vec3( world );
+}
@@ -5,19 +5,13 @@ layout (location = 1) in vec3 inNormal;
 layout (location = 2) in vec2 inUV;
 layout (location = 3) in vec3 inViewPos;
 
-layout(push_constant) uniform PushConsts {
-	mat4 projection;
-	mat4 model;
-	mat4 view;
-	vec3 camPos;
-	float padding;
-	vec3 lightDir;
-} push_constants;
-
 layout ( set = 0 , binding = 0) uniform UBOParams {
 	vec4 lights[4];
 	float exposure;
 	float gamma;
+	vec3 camPos;
+	mat4 view;
+	mat4 projection;
 } uboParams;
 
 layout ( set = 0 , binding = 1) uniform samplerCube samplerIrradiance;
@@ -157,7 +151,7 @@ vec3 perturbNormal()
 void main()
 {		
 	vec3 N = perturbNormal();
-	vec3 V = normalize(push_constants.camPos - inWorldPos);
+	vec3 V = normalize(uboParams.camPos - inWorldPos);
 	vec3 R = reflect(-V, N); 
 	float metallic = texture(metallicMap, inUV).r;
 	float roughness = texture(roughnessMap, inUV).r;
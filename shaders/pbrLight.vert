@@ -9,14 +9,18 @@ layout (location = 2) out vec2 outUV;
 layout (location = 3) out vec3 outViewPos;
 
 layout(push_constant) uniform PushConsts {
-	mat4 projection;
 	mat4 model;
-	mat4 view;
-	vec3 camPos;
-	float padding;
-	vec3 lightDir;
 } push_constants;
 
+layout ( set = 0 , binding = 0) uniform UBOParams {
+	vec4 lights[4];
+	float exposure;
+	float gamma;
+	vec3 camPos;
+	mat4 view;
+	mat4 projection;
+} uboParams;
+
 out gl_PerVertex 
 {
 	vec4 gl_Position;
@@ -24,12 +28,11 @@ out gl_PerVertex
 
 void main() 
 {
-	mat4 inverseViewMat = inverse(push_constants.view);
 	vec3 locPos = vec3(push_constants.model * vec4(inPos, 1.0));
 	outWorldPos = locPos;
 	outNormal = ( transpose( inverse( push_constants.model ) )   * vec4( inNormal , 0.0f ) ).xyz ;
 	outUV = inUV;
 	outUV.t = 1.0 - inUV.t;
-	outViewPos = vec3(push_constants.view * vec4( outWorldPos , 1.0f )); 
-	gl_Position =  push_constants.projection * push_constants.view * vec4(outWorldPos, 1.0);
+	outViewPos = vec3(uboParams.view * vec4( outWorldPos , 1.0f )); 
+	gl_Position =  uboParams.projection * uboParams.view * vec4(outWorldPos, 1.0);
 }
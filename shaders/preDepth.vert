@@ -0,0 +1,26 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// compiled to preDepth.spv .
+
+layout(set = 0 , binding = 0) uniform CameraUbo
+{
+	mat4 projView;
+} camera;
+
+layout(push_constant) uniform PushConstantObject
+{
+	mat4 model;
+} push_constants;
+
+layout(location = 0) in vec3 in_position;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main()
+{
+	gl_Position = camera.projView * push_constants.model * vec4( in_position , 1.0f );
+}
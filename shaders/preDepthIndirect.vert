@@ -0,0 +1,37 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable 
+
+// compiled to preDepthIndirect.spv .
+
+struct ObjectData
+{
+	mat4 model;
+	vec4 boundsCenter;
+	vec4 boundsExtent;
+	uint indexCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint batch;
+};
+
+layout(push_constant) uniform PushConstantObject
+{
+	mat4 projView;
+} push_constants;
+
+layout(std430 , set = 0 , binding = 0) readonly buffer Objects
+{
+	ObjectData objects[];
+};
+
+layout(location = 0) in vec3 in_position;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main()
+{
+	gl_Position = push_constants.projView * objects[gl_InstanceIndex].model * vec4(in_position, 1.0f);
+}
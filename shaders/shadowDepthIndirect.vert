@@ -0,0 +1,41 @@
+#version 450
+
+// compiled to shadowDepthIndirect.spv .
+
+#define SHADOW_MAP_CASCADE_COUNT 4
+
+struct ObjectData
+{
+	mat4 model;
+	vec4 boundsCenter;
+	vec4 boundsExtent;
+	uint indexCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint batch;
+};
+
+layout(push_constant) uniform PushConsts {
+	uint cascadeIndex;
+} pushConsts;
+
+// ShadowDepthPipeline::UniformBufferStruct , the split depths follow the matrices and are not read here .
+layout (set = 0 , binding = 0) uniform UBO {
+	mat4[SHADOW_MAP_CASCADE_COUNT] cascadeViewProjMat;
+} ubo;
+
+layout(std430 , set = 1 , binding = 0) readonly buffer Objects
+{
+	ObjectData objects[];
+};
+
+layout (location = 0) in vec3 inPos;
+
+out gl_PerVertex {
+	vec4 gl_Position;   
+};
+
+void main()
+{
+	gl_Position = ubo.cascadeViewProjMat[pushConsts.cascadeIndex] * objects[gl_InstanceIndex].model * vec4(inPos, 1.0);
+}
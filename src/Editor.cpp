@@ -1,3 +1,5 @@
+// stand alone editor test , it only has a win32 entry point .
+#if defined(_WIN32)
 #include <Windows.h>
 #include "VulkanBase.h"
 #include "VulkanEditor.h"
@@ -48,4 +50,5 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLin
 	base->Init();
 	base->Loop();
 	return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -6,14 +6,39 @@
 class GBufferPipeline : public IRenderingPipeline
 {
 public:
-	GBufferPipeline(int renderWidth, int renderHeight, VulkanDevice * device_) :
-		render_width_(renderWidth), render_height_(renderHeight), device_(device_)
+	struct RenderTargets
 	{
+		VulkanImage * albedo;
+		VulkanImage * position;
+		VulkanImage * normal;
+		VulkanImage * pbr;
+		VulkanImage * depth;
+	};
+
+	// the render targets are owned by the caller , the pipeline creates its own when none are given .
+	GBufferPipeline(int renderWidth, int renderHeight, VulkanDevice * device_, VulkanCamera * camera, VulkanUniformRing * uniformRing, const RenderTargets * targets = NULL) :
+		render_width_(renderWidth), render_height_(renderHeight), device_(device_), camera_(camera), uniform_ring_(uniformRing)
+	{
+		if (targets != NULL)
+		{
+			albedo_image_ = targets->albedo;
+			position_image_ = targets->position;
+			normal_image_ = targets->normal;
+			pbr_image_ = targets->pbr;
+			pre_depth_image_ = targets->depth;
+		}
 		PrepareResources();
 	}
 
 public:
 	VkPipeline CreateGraphicsPipeline()
+	{
+		pipeline_ = CreatePipeline(pipeline_layout_, "shaders/GBufferVert.spv");
+		return pipeline_;
+	}
+
+	// the indirect variant only differs in its layout and vertex shader .
+	VkPipeline CreatePipeline(VkPipelineLayout pipelineLayout, const std::string & vertexShader)
 	{
 		VkVertexInputBindingDescription binding = VulkanInitializer::InitVertexInputBindingDescription(0, VK_VERTEX_INPUT_RATE_VERTEX, sizeof(Vertex));
 
@@ -41,50 +66,89 @@ public:
 		VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = VulkanInitializer::GetDefaultDynamicState();
 		std::vector<VkPipelineShaderStageCreateInfo> pipelineShaderStageCreateInfo =
 		{
-			VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT , GetAssetPath() + "shaders/GBufferVert.spv" , device_),
+			VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT , GetAssetPath() + vertexShader , device_),
 			VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT , GetAssetPath() + "shaders/GBufferFrag.spv" , device_)
 		};
 
 		VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo =
-			VulkanInitializer::InitGraphicsPipelineCreateInfo(pipeline_layout_, render_pass_,
+			VulkanInitializer::InitGraphicsPipelineCreateInfo(pipelineLayout, render_pass_,
 				&vertexInputStateCreateInfo, &inputAssemblyStateCreateInfo, &rasterizationStateCreateInfo, &colorBlendStateCreateInfo, &multisampleStateCreateInfo, &viewportStateCreateInfo,
 				&depthStencilStateCreateInfo, &dynamicStateCreateInfo, pipelineShaderStageCreateInfo, 0);
 
-		VULKAN_SUCCESS(vkCreateGraphicsPipelines(device_->GetDevice(), VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, NULL, &pipeline_));
+		VkPipeline pipeline;
+		VULKAN_SUCCESS(vkCreateGraphicsPipelines(device_->GetDevice(), VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, NULL, &pipeline));
 
-		return pipeline_;
+		return pipeline;
 	}
 
-	void SetupCommandBuffer(VkCommandBuffer & commandBuffer, bool startRenderPass, bool endRenderPass)
+	// the material set and the push constant range stay those of pipeline_layout_ , so the set the materials bind
+	// with it is compatible , the object set comes after it .
+	void CreateIndirectPipeline()
 	{
-		VkClearValue depthClearValue;
-		depthClearValue.depthStencil = { 1 , 0 };
-		VkClearValue colorClearValue;
-		colorClearValue.color = { 0 };
-		std::vector<VkClearValue> clearValues = { colorClearValue , colorClearValue , colorClearValue , colorClearValue , depthClearValue  };
-		VkBuffer vertBuffer = mesh_->GetMeshEntry().vertexBuffer->GetDesc().buffer;
-		VkBuffer indexBuffer = mesh_->GetMeshEntry().indexBuffer->GetDesc().buffer;
-		size_t vertsCount = mesh_->GetMeshEntry().vertCount;
-		size_t indicesCount = mesh_->GetMeshEntry().indicesCount;
+		if (!VulkanIndirectDrawList::IsSupported(device_) || !AssetExists("shaders/GBufferIndirectVert.spv")) return;
 
-		VkDeviceSize offset = 0;
+		VkPushConstantRange constRange = VulkanInitializer::InitVkPushConstantRange(0, sizeof(PushConstantData), VK_SHADER_STAGE_VERTEX_BIT);
+		VkDescriptorSetLayout setLayouts[2] = { desc_set_layout_ , VulkanIndirectDrawList::GetObjectSetLayout(device_) };
+		VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(1, &constRange, 2, setLayouts);
+		indirect_pipeline_layout_ = device_->GetPipelineLayout(pipelineLayout);
+		indirect_pipeline_ = CreatePipeline(indirect_pipeline_layout_, "shaders/GBufferIndirectVert.spv");
+	}
+
+	// false when the device or the shaders do not support indirect draws .
+	bool HasIndirect() const
+	{
+		return indirect_pipeline_ != VK_NULL_HANDLE;
+	}
 
+	void SetupCommandBuffer(VkCommandBuffer & commandBuffer, bool startRenderPass, bool endRenderPass)
+	{
 		if (startRenderPass)
 		{
-			VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_, clearValues, render_width_, render_height_);
-			vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			BeginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
 		}
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertBuffer, &offset);
-		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, offset, VK_INDEX_TYPE_UINT32);
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
-		vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstantData), &PushConstantData);
-		vkCmdDrawIndexed(commandBuffer, indicesCount, 1, 0, 0, 0);
+		mesh_->BindGeometry(commandBuffer);
+		DrawMesh(commandBuffer, mesh_, PushConstantData.model);
 		if (endRenderPass)
 		{
 			vkCmdEndRenderPass(commandBuffer);
 		}
 	}
 
+	void BeginRenderPass(VkCommandBuffer & commandBuffer, VkSubpassContents subpassContents)
+	{
+		VkClearValue depthClearValue;
+		depthClearValue.depthStencil = { 1 , 0 };
+		VkClearValue colorClearValue;
+		colorClearValue.color = { 0 };
+		VkClearValue clearValues[] = { colorClearValue , colorClearValue , colorClearValue , colorClearValue , depthClearValue  };
+		VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_, clearValues, render_width_, render_height_);
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, subpassContents);
+	}
+
+	VkCommandBufferInheritanceInfo GetInheritanceInfo() const
+	{
+		return VulkanInitializer::InitCommandBufferInheritanceInfo(render_pass_, 0, frame_buffer_);
+	}
+
+	// the view projection matrix is read from the camera uniform , only the world matrix is pushed .
+	void DrawMesh(VkCommandBuffer & commandBuffer, VulkanMesh * mesh, const glm::mat4 & model)
+	{
+		auto pushConstantData = PushConstantData;
+		pushConstantData.model = model;
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+		vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstantData), &pushConstantData);
+		mesh->Draw(commandBuffer);
+	}
+
+	// draws every object of drawList , the world matrices come from its object data and bindMaterial binds the
+	// material of every batch .
+	void DrawIndirect(VkCommandBuffer & commandBuffer, const VulkanIndirectDrawList * drawList, VulkanIndirectDrawList::BindMaterial bindMaterial)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, indirect_pipeline_);
+		drawList->Draw(commandBuffer, indirect_pipeline_layout_, 1, bindMaterial);
+	}
+
 	VkRenderPass CreateRenderPass()
 	{
 		std::vector<VkPushConstantRange> constRange = {
@@ -92,7 +156,7 @@ public:
 		};
 
 		VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(constRange.size(), constRange.data(), 1 ,&desc_set_layout_);
-		VULKAN_SUCCESS(vkCreatePipelineLayout(device_->GetDevice(), &pipelineLayout, NULL, &pipeline_layout_));
+		pipeline_layout_ = device_->GetPipelineLayout(pipelineLayout);
 
 		VkImageView attachments[5] = {
 			albedo_image_->image_view_,
@@ -140,15 +204,20 @@ public:
 
 	void PrepareResources()
 	{
-		pre_depth_image_ = new VulkanImage(device_, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED, render_width_, render_height_, VK_IMAGE_ASPECT_DEPTH_BIT, 1 , 1 , true );
-		albedo_image_ = new VulkanImage(device_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED , render_width_ , render_height_ , VK_IMAGE_ASPECT_COLOR_BIT,  1, 1, true);
-		normal_image_ = new VulkanImage(device_, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED , render_width_ , render_height_ , VK_IMAGE_ASPECT_COLOR_BIT,  1, 1, true);
-		position_image_ = new VulkanImage(device_, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED , render_width_ , render_height_ , VK_IMAGE_ASPECT_COLOR_BIT,  1, 1, true);
-		pbr_image_ = new VulkanImage(device_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED , render_width_ , render_height_ , VK_IMAGE_ASPECT_COLOR_BIT,  1, 1, true);
+		if (pre_depth_image_ == NULL)
+		{
+			pre_depth_image_ = new VulkanImage(device_, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED, render_width_, render_height_, VK_IMAGE_ASPECT_DEPTH_BIT, 1 , 1 , true );
+			albedo_image_ = new VulkanImage(device_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED , render_width_ , render_height_ , VK_IMAGE_ASPECT_COLOR_BIT,  1, 1, true);
+			normal_image_ = new VulkanImage(device_, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED , render_width_ , render_height_ , VK_IMAGE_ASPECT_COLOR_BIT,  1, 1, true);
+			position_image_ = new VulkanImage(device_, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED , render_width_ , render_height_ , VK_IMAGE_ASPECT_COLOR_BIT,  1, 1, true);
+			pbr_image_ = new VulkanImage(device_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED , render_width_ , render_height_ , VK_IMAGE_ASPECT_COLOR_BIT,  1, 1, true);
+		}
 
+		camera_uniform_info_ = uniform_ring_->GetDescriptorInfo(sizeof(CameraUniformBuffer));
 		InitDesc();
 		CreateRenderPass();
 		CreateGraphicsPipeline();
+		CreateIndirectPipeline();
 	}
 
 	VertexLayout GetVertexLayout(std::string & layoutName)
@@ -175,31 +244,40 @@ public:
 		mesh_ = mesh;
 	}
 
-	void SetPushConstantData(glm::mat4 model , glm::mat4 mvp )
+	void SetPushConstantData(glm::mat4 model )
 	{
 		PushConstantData.model = model;
-		PushConstantData.mvp = mvp;
 	}
 
 	void UpdateData()
 	{
+		CameraUniformBuffer.projView = camera_->matrices.perspective * camera_->matrices.view;
+		camera_uniform_offset_ = uniform_ring_->Write(&CameraUniformBuffer, sizeof(CameraUniformBuffer));
+	}
+
+	static const uint32_t DYNAMIC_OFFSET_COUNT = 1;
 
+	// the camera uniform at binding 5 is the only dynamic binding .
+	void GetDynamicOffsets(uint32_t (&offsets)[DYNAMIC_OFFSET_COUNT]) const
+	{
+		offsets[0] = camera_uniform_offset_;
 	}
 
 	void InitDesc()
 	{
-		VkDescriptorSetLayoutBinding bindings[5] = {
+		VkDescriptorSetLayoutBinding bindings[6] = {
 			VulkanInitializer::InitBinding(0 , 1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , VK_SHADER_STAGE_FRAGMENT_BIT),
 			VulkanInitializer::InitBinding(1 , 1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , VK_SHADER_STAGE_FRAGMENT_BIT),
 			VulkanInitializer::InitBinding(2 , 1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , VK_SHADER_STAGE_FRAGMENT_BIT),
 			VulkanInitializer::InitBinding(3 , 1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(4 , 1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , VK_SHADER_STAGE_FRAGMENT_BIT)
+			VulkanInitializer::InitBinding(4 , 1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , VK_SHADER_STAGE_FRAGMENT_BIT),
+			VulkanInitializer::InitBinding(5 , 1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , VK_SHADER_STAGE_VERTEX_BIT)
 		};
 
 		std::vector<VkDescriptorSetLayoutCreateInfo> descSetLayout = {
-				VulkanInitializer::InitDescSetLayoutCreateInfo(5 , bindings)
+				VulkanInitializer::InitDescSetLayoutCreateInfo(6 , bindings)
 		};
-		VULKAN_SUCCESS(vkCreateDescriptorSetLayout(device_->GetDevice(), descSetLayout.data(), NULL, &desc_set_layout_));
+		desc_set_layout_ = device_->GetDescriptorSetLayout(descSetLayout[0]);
 	}
 	VulkanImage* GetAlbedoImage() const { return albedo_image_; };
 	VulkanImage* GetNormalImage() const { return normal_image_; };
@@ -209,6 +287,8 @@ public:
 private:
 	VkPipeline pipeline_;
 	VkPipelineLayout pipeline_layout_;
+	VkPipeline indirect_pipeline_ = VK_NULL_HANDLE;
+	VkPipelineLayout indirect_pipeline_layout_ = VK_NULL_HANDLE;
 	VkDescriptorSetLayout desc_set_layout_;
 	VulkanMesh * mesh_;
 	VkRenderPass render_pass_;
@@ -216,15 +296,19 @@ private:
 
 private:
 	VulkanDevice * device_;
+	VulkanCamera * camera_;
+	VulkanUniformRing * uniform_ring_;
+	VkDescriptorBufferInfo camera_uniform_info_;
+	uint32_t camera_uniform_offset_ = 0;
 	int render_width_;
 	int render_height_;
 	
 private:
-	VulkanImage * pre_depth_image_;
-	VulkanImage * albedo_image_;
-	VulkanImage * normal_image_;
-	VulkanImage * position_image_;
-	VulkanImage * pbr_image_;
+	VulkanImage * pre_depth_image_ = NULL;
+	VulkanImage * albedo_image_ = NULL;
+	VulkanImage * normal_image_ = NULL;
+	VulkanImage * position_image_ = NULL;
+	VulkanImage * pbr_image_ = NULL;
 
 private:
 	struct Vertex
@@ -237,9 +321,13 @@ private:
 
 	struct {
 		glm::mat4 model;
-		glm::mat4 mvp;
 	}PushConstantData;
 
+	struct CameraData
+	{
+		glm::mat4 projView;
+	}CameraUniformBuffer;
+
 	friend class TBDRMaterial;
 };
 
@@ -7,9 +7,10 @@ class PBRLightPipeline : public IRenderingPipeline
 {
 public:
 	PBRLightPipeline(VulkanDevice* device, VulkanSwapChain * swapChain, VulkanCamera * camera ,  uint32_t sWidth, uint32_t sHeight , VkImageView depthStencilImage,
-		VulkanBuffer * cascadeTransformBuffer, VulkanImage * shadowMapImage)
+		VkDescriptorBufferInfo cascadeTransform, VulkanImage * shadowMapImage, VulkanUniformRing * uniformRing)
 	{
 		device_ = device;
+		uniform_ring_ = uniformRing;
 		swap_chain_ = swapChain;
 		camera_ = camera;
 		screen_width_ = sWidth;
@@ -17,7 +18,7 @@ public:
 		depth_buffer_ = depthStencilImage;
 		PrepareResources();
 
-		cascade_transform_buffer_ = cascadeTransformBuffer;
+		cascade_transform_info_ = cascadeTransform;
 		shadow_map_image_ = shadowMapImage;
 	};
 	~PBRLightPipeline() {};
@@ -63,39 +64,50 @@ public:
 
 	void SetupCommandBuffer(VkCommandBuffer & commandBuffer, bool startRenderPass, bool endRenderPass)
 	{
-		VkClearValue colorClearValue = {};
-		VkClearValue depthClearValue = {};
-		depthClearValue.depthStencil.depth = 1;
-		std::vector<VkClearValue> clearValues = { colorClearValue , depthClearValue };
-		VkBuffer vertBuffer = mesh_->GetMeshEntry().vertexBuffer->GetDesc().buffer;
-		VkBuffer indexBuffer = mesh_->GetMeshEntry().indexBuffer->GetDesc().buffer;
-		size_t vertsCount = mesh_->GetMeshEntry().vertCount;
-		size_t indicesCount = mesh_->GetMeshEntry().indicesCount;
-		VkDeviceSize offset = 0;
 		if (startRenderPass)
 		{
-			VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_vec_[frame_index_], clearValues, screen_width_, screen_height_);
-			vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			BeginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
 		}
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertBuffer, &offset);
-		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, offset, VK_INDEX_TYPE_UINT32);
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
-		vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData), &PushConstantData);
-		vkCmdDrawIndexed(commandBuffer, indicesCount, 1, 0, 0, 0);
+		mesh_->BindGeometry(commandBuffer);
+		DrawMesh(commandBuffer, mesh_, PushConstantData.model);
 		if (endRenderPass)
 		{
 			vkCmdEndRenderPass(commandBuffer);
 		}
 	}
 
+	void BeginRenderPass(VkCommandBuffer & commandBuffer, VkSubpassContents subpassContents)
+	{
+		VkClearValue colorClearValue = {};
+		VkClearValue depthClearValue = {};
+		depthClearValue.depthStencil.depth = 1;
+		VkClearValue clearValues[] = { colorClearValue , depthClearValue };
+		VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_vec_[frame_index_], clearValues, screen_width_, screen_height_);
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, subpassContents);
+	}
+
+	VkCommandBufferInheritanceInfo GetInheritanceInfo() const
+	{
+		// the swap chain framebuffer is left unknown , so recorded draws can be executed for any image .
+		return VulkanInitializer::InitCommandBufferInheritanceInfo(render_pass_, 0, VK_NULL_HANDLE);
+	}
+
+	// the camera is read from the uniform block , only the world matrix is pushed .
+	void DrawMesh(VkCommandBuffer & commandBuffer, VulkanMesh * mesh, const glm::mat4 & model)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+		vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &model);
+		mesh->Draw(commandBuffer);
+	}
+
 	VkRenderPass CreateRenderPass()
 	{
 		// Layout 
 		std::vector<VkPushConstantRange> constRange = {
-				VulkanInitializer::InitVkPushConstantRange(0 , sizeof(PushConstantData) , VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT )
+				VulkanInitializer::InitVkPushConstantRange(0 , sizeof(PushConstantData) , VK_SHADER_STAGE_VERTEX_BIT )
 		};
 		VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(constRange.size(), constRange.data(), desc_set_layout_vec_.size(), desc_set_layout_vec_.data());
-		VULKAN_SUCCESS(vkCreatePipelineLayout(device_->GetDevice(), &pipelineLayout, NULL, &pipeline_layout_));
+		pipeline_layout_ = device_->GetPipelineLayout(pipelineLayout);
 
 		//Render Pass
 		std::vector<VkAttachmentDescription> attachmentsDesc =
@@ -138,7 +150,7 @@ public:
 
 	void PrepareResources()
 	{
-		uniform_buffer_ = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, sizeof(UniformBufferData));
+		uniform_info_ = uniform_ring_->GetDescriptorInfo(sizeof(UniformBufferData));
 		InitDesc();
 		CreateRenderPass();
 		CreateGraphicsPipeline();
@@ -157,36 +169,48 @@ public:
 	};
 	void SetMesh(VulkanMesh * mesh) { mesh_ = mesh; };
 
-	void SetPushConstantData(glm::mat4 model, glm::mat4 view, glm::mat4 proj , glm::vec3 camera , glm::vec3 lightPos  )
+	void SetPushConstantData(glm::mat4 model)
 	{
 		PushConstantData.model = model;
-		PushConstantData.view = view;
-		PushConstantData.projection = proj;
-		PushConstantData.camerapos = camera;
-		PushConstantData.lightDir = glm::normalize(lightPos);
 	}
 
 	void SetFrameBufferIndex(int ind) { frame_index_ = ind; };
 
 	void UpdateData() 
 	{
-		uniform_buffer_->Map();
-		UniformBufferStruct * uniformBuffer = (UniformBufferStruct*)uniform_buffer_->GetMappedMemory();
-		uniformBuffer->gamma = 2.2f;
-		uniformBuffer->exposure = 4.5f;
+		UniformBufferData.gamma = 2.2f;
+		UniformBufferData.exposure = 4.5f;
 		const float p = 15.0f;
-		uniformBuffer->lightPos[0] = glm::vec4(-p, -p * 0.5f, -p, 1.0f);
-		uniformBuffer->lightPos[1] = glm::vec4(-p, -p * 0.5f, p, 1.0f);
-		uniformBuffer->lightPos[2] = glm::vec4(p, -p * 0.5f, p, 1.0f);
-		uniformBuffer->lightPos[3] = glm::vec4(p, -p * 0.5f, -p, 1.0f);
-		uniform_buffer_->Unmap();
+		UniformBufferData.lightPos[0] = glm::vec4(-p, -p * 0.5f, -p, 1.0f);
+		UniformBufferData.lightPos[1] = glm::vec4(-p, -p * 0.5f, p, 1.0f);
+		UniformBufferData.lightPos[2] = glm::vec4(p, -p * 0.5f, p, 1.0f);
+		UniformBufferData.lightPos[3] = glm::vec4(p, -p * 0.5f, -p, 1.0f);
+		UniformBufferData.cameraPos = camera_->position;
+		UniformBufferData.view = camera_->matrices.view;
+		UniformBufferData.projection = camera_->matrices.perspective;
+		uniform_offset_ = uniform_ring_->Write(&UniformBufferData, sizeof(UniformBufferData));
 	};
 
+	// the cascade matrices are written to the ring by the shadow depth pipeline .
+	void SetCascadeTransformOffset(uint32_t offset)
+	{
+		cascade_transform_offset_ = offset;
+	}
+
+	static const uint32_t DYNAMIC_OFFSET_COUNT = 2;
+
+	// dynamic offsets in the order of the dynamic bindings , set 0 binding 0 then set 1 binding 1 .
+	void GetDynamicOffsets(uint32_t (&offsets)[DYNAMIC_OFFSET_COUNT]) const
+	{
+		offsets[0] = uniform_offset_;
+		offsets[1] = cascade_transform_offset_;
+	}
+
 	void InitDesc()
 	{
 		VkDescriptorSetLayoutBinding binding[9] =
 		{
-			VulkanInitializer::InitBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT),
+			VulkanInitializer::InitBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT),
 			VulkanInitializer::InitBinding(1, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
 			VulkanInitializer::InitBinding(2, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
 			VulkanInitializer::InitBinding(3, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
@@ -200,7 +224,7 @@ public:
 		VkDescriptorSetLayoutBinding shadowBinding[2] =
 		{
 			VulkanInitializer::InitBinding(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(1, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			VulkanInitializer::InitBinding(1, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT)
 		};
 
 
@@ -211,26 +235,27 @@ public:
 		desc_set_layout_vec_.resize(descSetLayoutCreateInfo.size());
 		for (int i = 0; i < descSetLayoutCreateInfo.size(); i++)
 		{
-			VULKAN_SUCCESS(vkCreateDescriptorSetLayout(device_->GetDevice(), &descSetLayoutCreateInfo[i], NULL, &desc_set_layout_vec_[i]));
+			desc_set_layout_vec_[i] = device_->GetDescriptorSetLayout(descSetLayoutCreateInfo[i]);
 		}
 	}
 
 private:
 	struct
 	{
-		glm::mat4 projection;
 		glm::mat4 model;
-		glm::mat4 view;
-		glm::vec3 camerapos;
-		float padding;
-		glm::vec3 lightDir;
 	}PushConstantData;
 
+	// the camera lives here so recorded draws only push their world matrix .
 	struct UniformBufferStruct 
 	{
 		glm::vec4 lightPos[4];
 		float exposure;
 		float gamma;
+		float padding[2];
+		glm::vec3 cameraPos;
+		float cameraPadding;
+		glm::mat4 view;
+		glm::mat4 projection;
 	}UniformBufferData;
 
 	struct Vertex
@@ -250,11 +275,14 @@ private:
 	uint32_t screen_height_;
 	uint32_t frame_index_;
 	VulkanMesh * mesh_;
-	VulkanBuffer * uniform_buffer_;
+	VulkanUniformRing * uniform_ring_;
+	VkDescriptorBufferInfo uniform_info_;
+	uint32_t uniform_offset_ = 0;
 	VulkanCamera * camera_;
 	VkImageView depth_buffer_;
 
-	VulkanBuffer * cascade_transform_buffer_;
+	VkDescriptorBufferInfo cascade_transform_info_;
+	uint32_t cascade_transform_offset_ = 0;
 	VulkanImage * shadow_map_image_;
 private:
 	std::vector<VkFramebuffer> frame_buffer_vec_;
@@ -66,11 +66,6 @@ public:
 			glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f)),
 			glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
 		};
-		VkBuffer vertBuffer = mesh_->GetMeshEntry().vertexBuffer->GetDesc().buffer;
-		VkBuffer indexBuffer = mesh_->GetMeshEntry().indexBuffer->GetDesc().buffer;
-		size_t vertsCount = mesh_->GetMeshEntry().vertCount;
-		size_t indicesCount = mesh_->GetMeshEntry().indicesCount;
-		VkDeviceSize offset = 0;
 		std::vector<VkClearValue> clearValues;
 		VkClearValue value;
 		value.color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
@@ -91,13 +86,12 @@ public:
 			for (int arrayLayer = 0; arrayLayer < 6; arrayLayer++)
 			{
 				vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertBuffer, &offset);
-				vkCmdBindIndexBuffer(commandBuffer, indexBuffer, offset, VK_INDEX_TYPE_UINT32);
+				mesh_->BindGeometry(commandBuffer);
 				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
 				SetPushConstantData(glm::perspective((float)(PI / 2.0), 1.0f, 0.1f, 512.0f) * matrices[arrayLayer], roughness , 32);
 				vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantDataUniform), &PushConstantDataUniform);
 				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, desc_set_vec_.data(), 0, NULL);
-				vkCmdDrawIndexed(commandBuffer, indicesCount, 1, 0, 0, 0);
+				mesh_->Draw(commandBuffer);
 				vkCmdEndRenderPass(commandBuffer);
 				prefilter_envir_map_image_->CopyImageToImage(queue_, offscreen_tmp_image_, prefilter_envir_map_image_, viewport.width, viewport.height, 0, 1, 0, 1, arrayLayer, 1, mipLevel, mip_levels_, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, commandBuffer);
 			}
@@ -115,7 +109,7 @@ public:
 				VulkanInitializer::InitVkPushConstantRange(0 , sizeof(PushConstantDataUniform) , VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
 		};
 		VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(constRange.size(), constRange.data(), 1, desc_set_layout_vec_.data());
-		VULKAN_SUCCESS(vkCreatePipelineLayout(device_->GetDevice(), &pipelineLayout, NULL, &pipeline_layout_));
+		pipeline_layout_ = device_->GetPipelineLayout(pipelineLayout);
 
 		//Render Pass
 		std::vector<VkAttachmentDescription> attachmentsDesc =
@@ -147,9 +141,9 @@ public:
 	{
 		dim_ = 512;
 		mip_levels_ = static_cast<uint32_t>(floor(log2(dim_))) + 1;
-		offscreen_tmp_image_ = new VulkanImage(device_, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_LAYOUT_UNDEFINED, dim_, dim_, VK_IMAGE_ASPECT_COLOR_BIT, 1, 1, false);
+		offscreen_tmp_image_ = new VulkanImage(device_, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_LAYOUT_UNDEFINED, dim_, dim_, VK_IMAGE_ASPECT_COLOR_BIT, 1, 1, false, MEMORY_CATEGORY_IBL);
 		offscreen_tmp_image_->TranslateImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, queue_);
-		prefilter_envir_map_image_ = new VulkanImage(device_, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_LAYOUT_UNDEFINED, dim_, dim_, VK_IMAGE_ASPECT_COLOR_BIT, 6, mip_levels_, true);
+		prefilter_envir_map_image_ = new VulkanImage(device_, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_LAYOUT_UNDEFINED, dim_, dim_, VK_IMAGE_ASPECT_COLOR_BIT, 6, mip_levels_, true, MEMORY_CATEGORY_IBL);
 		prefilter_envir_map_image_->TranslateImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, queue_, VK_NULL_HANDLE, 6, mip_levels_);
 		InitDesc();
 		CreateRenderPass();
@@ -185,7 +179,7 @@ public:
 		desc_set_vec_.resize(descSetLayoutCreateInfo.size());
 		for (int i = 0; i < descSetLayoutCreateInfo.size(); i++)
 		{
-			VULKAN_SUCCESS(vkCreateDescriptorSetLayout(device_->GetDevice(), &descSetLayoutCreateInfo[i], NULL, &desc_set_layout_vec_[i]));
+			desc_set_layout_vec_[i] = device_->GetDescriptorSetLayout(descSetLayoutCreateInfo[i]);
 		}
 
 		std::vector<VkDescriptorType> descTypeVec =
@@ -210,6 +204,15 @@ public:
 	}
 	VulkanImage* GetPrefilterEnvirMapImage() const { return prefilter_envir_map_image_; }
 
+	// the offscreen target is only needed while the map is rendered , free it once the commands have completed .
+	void ReleaseOffscreenResources()
+	{
+		vkDestroyFramebuffer(device_->GetDevice(), frame_buffer_, NULL);
+		frame_buffer_ = VK_NULL_HANDLE;
+		delete offscreen_tmp_image_;
+		offscreen_tmp_image_ = NULL;
+	}
+
 private:
 	struct
 	{
@@ -6,8 +6,8 @@
 class ShadowDepthPipeline : public IRenderingPipeline
 {
 public:
-	ShadowDepthPipeline(VulkanDevice * device, VulkanCamera * camera, glm::vec3 lightPos ) :
-		device_(device) , camera_(camera) ,light_pos_(lightPos)
+	ShadowDepthPipeline(VulkanDevice * device, VulkanCamera * camera, glm::vec3 lightPos , VulkanUniformRing * uniformRing ) :
+		device_(device) , camera_(camera) ,light_pos_(lightPos) , uniform_ring_(uniformRing)
 	{
 		light_pos_ = glm::normalize(lightPos);
 		PrepareResources();
@@ -20,6 +20,13 @@ public:
 
 public:
 	VkPipeline CreateGraphicsPipeline()
+	{
+		pipeline_ = CreatePipeline(pipeline_layout_, "shaders/ShadowDepthVert.spv");
+		return pipeline_;
+	}
+
+	// the indirect variant only differs in its layout and vertex shader .
+	VkPipeline CreatePipeline(VkPipelineLayout pipelineLayout, const std::string & vertexShader)
 	{
 		VkVertexInputBindingDescription binding = VulkanInitializer::InitVertexInputBindingDescription(0, VK_VERTEX_INPUT_RATE_VERTEX, sizeof(Vertex));
 
@@ -44,46 +51,91 @@ public:
 		VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = VulkanInitializer::GetDefaultDynamicState();
 		std::vector<VkPipelineShaderStageCreateInfo> pipelineShaderStageCreateInfo =
 		{
-			VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT , GetAssetPath() + "shaders/shadowDepthVert.spv" , device_)
+			VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT , GetAssetPath() + vertexShader , device_)
 		};
 
 		VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo =
-			VulkanInitializer::InitGraphicsPipelineCreateInfo(pipeline_layout_, render_pass_,
+			VulkanInitializer::InitGraphicsPipelineCreateInfo(pipelineLayout, render_pass_,
 				&vertexInputStateCreateInfo, &inputAssemblyStateCreateInfo, &rasterizationStateCreateInfo, &colorBlendStateCreateInfo, &multisampleStateCreateInfo, &viewportStateCreateInfo,
 				&depthStencilStateCreateInfo, &dynamicStateCreateInfo, pipelineShaderStageCreateInfo, 0);
 
-		VULKAN_SUCCESS(vkCreateGraphicsPipelines(device_->GetDevice(), VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, NULL, &pipeline_));
+		VkPipeline pipeline;
+		VULKAN_SUCCESS(vkCreateGraphicsPipelines(device_->GetDevice(), VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, NULL, &pipeline));
 
-		return pipeline_;
+		return pipeline;
 	}
-	void SetupCommandBuffer(VkCommandBuffer & commandBuffer, bool startRenderPass, bool endRenderPass)
+
+	// the cascade matrices stay in set 0 , the object data of the draw list is set 1 .
+	void CreateIndirectPipeline()
 	{
-		VkClearValue depthClearValue = {};
-		depthClearValue.depthStencil = { 1 , 0 };
-		std::vector<VkClearValue> clearValues = { depthClearValue };
-		VkBuffer vertBuffer = mesh_->GetMeshEntry().vertexBuffer->GetDesc().buffer;
-		VkBuffer indexBuffer = mesh_->GetMeshEntry().indexBuffer->GetDesc().buffer;
-		size_t vertsCount = mesh_->GetMeshEntry().vertCount;
-		size_t indicesCount = mesh_->GetMeshEntry().indicesCount;
+		if (!VulkanIndirectDrawList::IsSupported(device_) || !AssetExists("shaders/shadowDepthIndirect.spv")) return;
 
-		VkDeviceSize offset = 0;
+		VkPushConstantRange constRange = VulkanInitializer::InitVkPushConstantRange(0, sizeof(uint32_t), VK_SHADER_STAGE_VERTEX_BIT);
+		VkDescriptorSetLayout setLayouts[2] = { desc_set_layout_vec_[0] , VulkanIndirectDrawList::GetObjectSetLayout(device_) };
+		VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(1, &constRange, 2, setLayouts);
+		indirect_pipeline_layout_ = device_->GetPipelineLayout(pipelineLayout);
+		indirect_pipeline_ = CreatePipeline(indirect_pipeline_layout_, "shaders/shadowDepthIndirect.spv");
+	}
 
+	// false when the device or the shaders do not support indirect draws .
+	bool HasIndirect() const
+	{
+		return indirect_pipeline_ != VK_NULL_HANDLE;
+	}
+	void SetupCommandBuffer(VkCommandBuffer & commandBuffer, bool startRenderPass, bool endRenderPass)
+	{
 		if (startRenderPass)
 		{
-			VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_[PushConstantData.cascadeIndex], clearValues, 4096 , 4096);
-			vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			BeginRenderPass(commandBuffer, PushConstantData.cascadeIndex, VK_SUBPASS_CONTENTS_INLINE);
 		}
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, desc_set_vec_.data(), 0, NULL);
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertBuffer, &offset);
-		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, offset, VK_INDEX_TYPE_UINT32);
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
-		vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstantData) , &PushConstantData);
-		vkCmdDrawIndexed(commandBuffer, indicesCount, 1, 0, 0, 0);
+		mesh_->BindGeometry(commandBuffer);
+		BindPipeline(commandBuffer);
+		DrawMesh(commandBuffer, mesh_, PushConstantData.model, PushConstantData.cascadeIndex);
 		if (endRenderPass)
 		{
 			vkCmdEndRenderPass(commandBuffer);
 		}
 	}
+
+	void BeginRenderPass(VkCommandBuffer & commandBuffer, uint32_t cascadeIndex, VkSubpassContents subpassContents)
+	{
+		VkClearValue depthClearValue = {};
+		depthClearValue.depthStencil = { 1 , 0 };
+		VkClearValue clearValues[] = { depthClearValue };
+		VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_[cascadeIndex], clearValues, 4096, 4096);
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, subpassContents);
+	}
+
+	VkCommandBufferInheritanceInfo GetInheritanceInfo(uint32_t cascadeIndex) const
+	{
+		return VulkanInitializer::InitCommandBufferInheritanceInfo(render_pass_, 0, frame_buffer_[cascadeIndex]);
+	}
+
+	// binds the pipeline and the cascade matrix set , once per command buffer before the DrawMesh calls .
+	void BindPipeline(VkCommandBuffer & commandBuffer)
+	{
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, desc_set_vec_.data(), 1, &cascade_matrix_offset_);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+	}
+
+	void DrawMesh(VkCommandBuffer & commandBuffer, VulkanMesh * mesh, const glm::mat4 & model, uint32_t cascadeIndex)
+	{
+		auto pushConstantData = PushConstantData;
+		pushConstantData.model = model;
+		pushConstantData.cascadeIndex = cascadeIndex;
+
+		vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstantData) , &pushConstantData);
+		mesh->Draw(commandBuffer);
+	}
+
+	// draws every object of drawList into the cascade , the world matrices come from its object data .
+	void DrawIndirect(VkCommandBuffer & commandBuffer, const VulkanIndirectDrawList * drawList, uint32_t cascadeIndex)
+	{
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, indirect_pipeline_layout_, 0, 1, desc_set_vec_.data(), 1, &cascade_matrix_offset_);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, indirect_pipeline_);
+		vkCmdPushConstants(commandBuffer, indirect_pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &cascadeIndex);
+		drawList->Draw(commandBuffer, indirect_pipeline_layout_, 1);
+	}
 	VkRenderPass CreateRenderPass()
 	{
 		std::vector<VkPushConstantRange> constRange = {
@@ -91,7 +143,7 @@ public:
 		};
 
 		VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(constRange.size(), constRange.data(), desc_set_vec_.size() , desc_set_layout_vec_.data() );
-		VULKAN_SUCCESS(vkCreatePipelineLayout(device_->GetDevice(), &pipelineLayout, NULL, &pipeline_layout_));
+		pipeline_layout_ = device_->GetPipelineLayout(pipelineLayout);
 
 		std::vector<VkAttachmentDescription> attachmentsDesc =
 		{
@@ -123,8 +175,8 @@ public:
 	}
 	void PrepareResources()
 	{
-		cascade_matrix_buffer_ = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, sizeof(UniformBufferData));
-		shadow_map_image_ = new VulkanImage(device_, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 4096, 4096, VK_IMAGE_ASPECT_DEPTH_BIT, 4, 1, true);
+		cascade_matrix_info_ = uniform_ring_->GetDescriptorInfo(sizeof(UniformBufferData));
+		shadow_map_image_ = new VulkanImage(device_, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 4096, 4096, VK_IMAGE_ASPECT_DEPTH_BIT, 4, 1, true, MEMORY_CATEGORY_SHADOW);
 		for (int i = 0; i < 4; i++)
 		{
 			VkImageViewCreateInfo imageViewCreateInfo = VulkanInitializer::InitImageViewCreateInfo(VK_FORMAT_D32_SFLOAT_S8_UINT, shadow_map_image_->image_, VK_IMAGE_ASPECT_DEPTH_BIT, i, 1, 0, 1, VK_IMAGE_VIEW_TYPE_2D);
@@ -133,6 +185,7 @@ public:
 		InitDesc();
 		CreateRenderPass();
 		CreateGraphicsPipeline();
+		CreateIndirectPipeline();
 	}
 
 	VertexLayout GetVertexLayout(std::string & layoutName)
@@ -151,7 +204,7 @@ public:
 	void InitDesc()
 	{
 		VkDescriptorSetLayoutBinding bufferBinding[1] = {
-			VulkanInitializer::InitBinding(0 , 1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , VK_SHADER_STAGE_VERTEX_BIT)
+			VulkanInitializer::InitBinding(0 , 1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , VK_SHADER_STAGE_VERTEX_BIT)
 		};
 
 
@@ -163,12 +216,12 @@ public:
 		desc_set_vec_.resize(descSetLayoutCreateInfo.size());
 		for (int i = 0; i < descSetLayoutCreateInfo.size(); i++)
 		{
-			VULKAN_SUCCESS(vkCreateDescriptorSetLayout(device_->GetDevice(), &descSetLayoutCreateInfo[i], NULL, &desc_set_layout_vec_[i]));
+			desc_set_layout_vec_[i] = device_->GetDescriptorSetLayout(descSetLayoutCreateInfo[i]);
 		}
 
 		std::vector<VkDescriptorType> descTypeVec =
 		{
-			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
 		};
 
 		std::vector<VkDescriptorPoolSize> descPoolSize = VulkanInitializer::InitDescriptorPoolSizeVec(descTypeVec);
@@ -182,7 +235,7 @@ public:
 		}
 
 		VkWriteDescriptorSet writeDescs[1] = {
-			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , 0 ,desc_set_vec_[0] , &cascade_matrix_buffer_->GetDesc()),
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , 0 ,desc_set_vec_[0] , &cascade_matrix_info_),
 		};
 
 		vkUpdateDescriptorSets(device_->GetDevice(), 1, writeDescs, 0, NULL);
@@ -192,8 +245,15 @@ public:
 	{
 		return shadow_map_image_;
 	}
-	VulkanBuffer * GetCascadeTransform() const {
-		return cascade_matrix_buffer_;
+	VkDescriptorBufferInfo GetCascadeTransform() const {
+		return cascade_matrix_info_;
+	}
+	uint32_t GetCascadeTransformOffset() const {
+		return cascade_matrix_offset_;
+	}
+	// the matrix UpdateData wrote for the cascade , the cpu culls the shadow draws with it .
+	const glm::mat4 & GetCascadeViewProj(uint32_t cascadeIndex) const {
+		return cascades_[cascadeIndex].viewProjMatrix;
 	}
 	void SetMesh(VulkanMesh * mesh)
 	{
@@ -305,21 +365,22 @@ public:
 			UniformBufferData.cascadeTransform[i] = cascades_[i].viewProjMatrix;
 		}
 
-		cascade_matrix_buffer_->Map();
-		UniformBufferStruct* data = (UniformBufferStruct*)cascade_matrix_buffer_->GetMappedMemory();
-		memcpy(data, &UniformBufferData, sizeof(UniformBufferData));
-		cascade_matrix_buffer_->Unmap();
+		cascade_matrix_offset_ = uniform_ring_->Write(&UniformBufferData, sizeof(UniformBufferData));
 	}
 
 private:
 	VkPipeline pipeline_;
 	VkPipelineLayout pipeline_layout_;
+	VkPipeline indirect_pipeline_ = VK_NULL_HANDLE;
+	VkPipelineLayout indirect_pipeline_layout_ = VK_NULL_HANDLE;
 	VulkanMesh * mesh_;
 	VkRenderPass render_pass_;
 	VkFramebuffer frame_buffer_[4];
 	Cascade cascades_[4];
 	VulkanImage * shadow_map_image_;
-	VulkanBuffer * cascade_matrix_buffer_;
+	VulkanUniformRing * uniform_ring_;
+	VkDescriptorBufferInfo cascade_matrix_info_;
+	uint32_t cascade_matrix_offset_ = 0;
 	VkImageView image_views_[4];
 	VkDescriptorPool desc_pool_;
 	std::vector<VkDescriptorSet> desc_set_vec_;
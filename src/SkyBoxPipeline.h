@@ -63,23 +63,17 @@ public:
 		VkClearValue colorClearValue = {};
 		VkClearValue depthClearValue = {};
 		depthClearValue.depthStencil.depth = 1;
-		std::vector<VkClearValue> clearValues = { colorClearValue , depthClearValue };
-		VkBuffer vertBuffer = mesh_->GetMeshEntry().vertexBuffer->GetDesc().buffer;
-		VkBuffer indexBuffer = mesh_->GetMeshEntry().indexBuffer->GetDesc().buffer;
-		size_t vertsCount = mesh_->GetMeshEntry().vertCount;
-		size_t indicesCount = mesh_->GetMeshEntry().indicesCount;
-		VkDeviceSize offset = 0;
+		VkClearValue clearValues[] = { colorClearValue , depthClearValue };
 		if (startRenderPass)
 		{
 			VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_vec_[frame_index_], clearValues, screen_width_, screen_height_);
 			vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 		}
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertBuffer, &offset);
-		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, offset, VK_INDEX_TYPE_UINT32);
+		mesh_->BindGeometry(commandBuffer);
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
 		vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT , 0, sizeof(PushConstantData), &PushConstantData);
 		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, desc_set_vec_.data(), 0, NULL);
-		vkCmdDrawIndexed(commandBuffer, indicesCount, 1, 0, 0, 0);
+		mesh_->Draw(commandBuffer);
 		if (endRenderPass)
 		{
 			vkCmdEndRenderPass(commandBuffer);
@@ -93,7 +87,7 @@ public:
 				VulkanInitializer::InitVkPushConstantRange(0 , sizeof(PushConstantData) , VK_SHADER_STAGE_VERTEX_BIT)
 		};
 		VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(constRange.size(), constRange.data(), 1, desc_set_layout_vec_.data());
-		VULKAN_SUCCESS(vkCreatePipelineLayout(device_->GetDevice(), &pipelineLayout, NULL, &pipeline_layout_));
+		pipeline_layout_ = device_->GetPipelineLayout(pipelineLayout);
 
 		//Render Pass
 		std::vector<VkAttachmentDescription> attachmentsDesc =
@@ -165,7 +159,7 @@ public:
 		desc_set_vec_.resize(descSetLayoutCreateInfo.size());
 		for (int i = 0; i < descSetLayoutCreateInfo.size(); i++)
 		{
-			VULKAN_SUCCESS(vkCreateDescriptorSetLayout(device_->GetDevice(), &descSetLayoutCreateInfo[i], NULL, &desc_set_layout_vec_[i]));
+			desc_set_layout_vec_[i] = device_->GetDescriptorSetLayout(descSetLayoutCreateInfo[i]);
 		}
 
 		std::vector<VkDescriptorType> descTypeVec =
@@ -8,7 +8,7 @@ class TBDRLightPipeline : public IRenderingPipeline
 public:
 	TBDRLightPipeline(
 		VulkanBuffer * tileLightVisibleBuffer,
-		VulkanBuffer * lightUniformBuffer,
+		VkDescriptorBufferInfo lightUniform,
 		VkImageView depthBuffer,
 		VulkanImage * albedoImage,
 		VulkanImage * positionImage,
@@ -24,7 +24,7 @@ public:
 	)
 	{
 		tile_light_visible_buffer_ = tileLightVisibleBuffer;
-		light_uniform_buffer_ = lightUniformBuffer;
+		light_uniform_info_ = lightUniform;
 		depth_buffer_ = depthBuffer;
 		albedo_image_ = albedoImage;
 		position_image_ = positionImage;
@@ -79,16 +79,15 @@ public:
 
 	void SetupCommandBuffer(VkCommandBuffer & commandBuffer, bool startRenderPass, bool endRenderPass)
 	{
-		std::vector<VkClearValue> clearValues = { };
 		VkDeviceSize offset = 0;
 		if (startRenderPass)
 		{
-			VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_vec_[frame_index_], clearValues, screen_width_, screen_height_);
+			VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_vec_[frame_index_], NULL, 0, screen_width_, screen_height_);
 			vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 		}
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
 		vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData), &PushConstantData);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 2 , desc_set_vec_.data(), 0, NULL);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 2 , desc_set_vec_.data(), 1, &light_uniform_offset_);
 		vkCmdDraw(commandBuffer,3,1,0,0);
 		if (endRenderPass)
 		{
@@ -103,7 +102,7 @@ public:
 				VulkanInitializer::InitVkPushConstantRange(0 , sizeof(PushConstantData) , VK_SHADER_STAGE_FRAGMENT_BIT)
 		};
 		VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(constRange.size(), constRange.data(), desc_set_layout_vec_.size(), desc_set_layout_vec_.data());
-		VULKAN_SUCCESS(vkCreatePipelineLayout(device_->GetDevice(), &pipelineLayout, NULL, &pipeline_layout_));
+		pipeline_layout_ = device_->GetPipelineLayout(pipelineLayout);
 
 		//Render Pass
 		std::vector<VkAttachmentDescription> attachmentsDesc =
@@ -174,7 +173,7 @@ public:
 		};
 		VkDescriptorSetLayoutBinding lightBuffer[2] = {
 				VulkanInitializer::InitBinding(0 , 1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , VK_SHADER_STAGE_FRAGMENT_BIT),
-				VulkanInitializer::InitBinding(1 , 1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , VK_SHADER_STAGE_FRAGMENT_BIT)
+				VulkanInitializer::InitBinding(1 , 1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , VK_SHADER_STAGE_FRAGMENT_BIT)
 		};
 
 		std::vector<VkDescriptorSetLayoutCreateInfo> descSetLayoutCreateInfo = {
@@ -186,7 +185,7 @@ public:
 		desc_set_vec_.resize(descSetLayoutCreateInfo.size());
 		for (int i = 0; i < descSetLayoutCreateInfo.size(); i++)
 		{
-			VULKAN_SUCCESS(vkCreateDescriptorSetLayout(device_->GetDevice(), &descSetLayoutCreateInfo[i], NULL, &desc_set_layout_vec_[i]));
+			desc_set_layout_vec_[i] = device_->GetDescriptorSetLayout(descSetLayoutCreateInfo[i]);
 		}
 
 		std::vector<VkDescriptorType> descTypeVec =
@@ -199,7 +198,7 @@ public:
 			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ,
-			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
 		};
 
 		std::vector<VkDescriptorPoolSize> descPoolSize = VulkanInitializer::InitDescriptorPoolSizeVec(descTypeVec);
@@ -235,6 +234,12 @@ public:
 	{
 	}
 
+	// the light data is written to the uniform ring by the light culling pipeline .
+	void SetLightUniformOffset(uint32_t offset)
+	{
+		light_uniform_offset_ = offset;
+	}
+
 	void UpdateDescriptorSet()
 	{
 		VkWriteDescriptorSet writeDescs[9] = {
@@ -246,7 +251,7 @@ public:
 			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 5 , desc_set_vec_[0] , &brdflut_texture_->image_info_),
 			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 6 , desc_set_vec_[0] , &prefiltered_image_->GetDescriptorImageInfo(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)),
 			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 0 , desc_set_vec_[1] , &tile_light_visible_buffer_->GetDesc()),
-			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , 1 , desc_set_vec_[1] , &light_uniform_buffer_->GetDesc())
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , 1 , desc_set_vec_[1] , &light_uniform_info_)
 		};
 
 		vkUpdateDescriptorSets(device_->GetDevice(), 9, writeDescs, 0, NULL);
@@ -254,7 +259,8 @@ public:
 
 private:
 	VulkanBuffer * tile_light_visible_buffer_;
-	VulkanBuffer * light_uniform_buffer_;
+	VkDescriptorBufferInfo light_uniform_info_;
+	uint32_t light_uniform_offset_ = 0;
 	VkImageView depth_buffer_;
 	VulkanImage * albedo_image_;
 	VulkanImage * position_image_;
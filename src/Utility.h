@@ -5,9 +5,16 @@
 
 #include <string>
 #include <glm/glm.hpp>
+#if defined(_WIN32)
 #include <Windows.h>
+#else
+#include <cstdint>
+// key codes are forwarded as the win32 message parameter .
+typedef uintptr_t WPARAM;
+#endif
 #include <string>
 #include <chrono>
+#include <fstream>
 #include "VulkanInitializer.hpp"
 #include <vulkan/vulkan.h>
 
@@ -37,6 +44,13 @@ static std::string GetAssetPath()
 	return path;
 }
 
+// assets that are only built on some setups , the features using them are off when they are missing .
+static bool AssetExists(const std::string & file)
+{
+	std::ifstream stream(GetAssetPath() + file, std::ios::binary);
+	return stream.good();
+}
+
 enum Type
 {
 	TYPE_INT,
@@ -90,8 +104,32 @@ struct RenderGlobalState
 	glm::vec3 cameraPosition;
 	float cameraYaw;
 	float cameraPitch;
+	int framesInFlight = 2;
+	int recordThreadCount = 0;
+	// bytes of evictable textures kept resident , 0 keeps every texture .
+	VkDeviceSize textureBudget = 0;
 };
 
+#define MAX_FRAMES_IN_FLIGHT 3
+#define MIN_RECORD_CHUNK_SIZE 32
+#define SHADOW_CASCADE_COUNT 4
+#define UNIFORM_RING_FRAME_SIZE (64 * 1024)
+#define UPLOAD_STAGING_RING_SIZE (64 * 1024 * 1024)
+#define STREAM_STAGING_RING_SIZE (64 * 1024 * 1024)
+#define GEOMETRY_ARENA_VERTEX_COUNT (1024 * 1024)
+#define GEOMETRY_ARENA_INDEX_COUNT (2 * 1024 * 1024)
+#define MATERIAL_MAX_TEXTURES 8
+#define TEXTURE_RELOADS_PER_FRAME 2
+#define TEXTURE_EVICTION_MIN_UNUSED_FRAMES 60
+#define TEXTURE_EVICTION_LOW_WATER_PERCENT 90
+#define INDIRECT_DRAW_MAX_BATCHES 256
+#define INDIRECT_DRAW_INITIAL_CAPACITY 256
+#define INDIRECT_DRAW_GROUP_SIZE 64
+#define INDIRECT_DRAW_MAX_FRUSTUMS SHADOW_CASCADE_COUNT
+#define HIZ_BUILD_GROUP_SIZE 8
+#define OCCLUSION_CULL_GROUP_SIZE 64
+#define FRUSTUM_CULL_UNBOUNDED_EXTENT 1.0e30f
+
 #define PI 3.1415926535f
 
 #endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include <cstdlib>
+#include <new>
+#include "VulkanAllocationCounter.h"
+
+std::atomic<uint64_t> VulkanAllocationCounter::count_(0);
+std::atomic<uint64_t> VulkanAllocationCounter::bytes_(0);
+
+void * operator new(size_t size)
+{
+	VulkanAllocationCounter::OnAllocate(size);
+	void * ptr = malloc(size != 0 ? size : 1);
+	if (ptr == NULL) throw std::bad_alloc();
+	return ptr;
+}
+
+void * operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void * operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	VulkanAllocationCounter::OnAllocate(size);
+	return malloc(size != 0 ? size : 1);
+}
+
+void * operator new[](size_t size, const std::nothrow_t & tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void * ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void * ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void * ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void * ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void * ptr, const std::nothrow_t &) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void * ptr, const std::nothrow_t &) noexcept
+{
+	free(ptr);
+}
@@ -0,0 +1,36 @@
+#ifndef _VULKAN_ALLOCATION_COUNTER_H_
+#define _VULKAN_ALLOCATION_COUNTER_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+// Counts the heap allocations of every thread of the process , the global operator new and delete are replaced
+// in VulkanAllocationCounter.cpp . malloc calls , imgui and the driver included , are not seen , neither are
+// over aligned allocations .
+// The totals only grow , a frame is measured by the difference of two reads .
+class VulkanAllocationCounter
+{
+public:
+	static uint64_t GetCount()
+	{
+		return count_.load(std::memory_order_relaxed);
+	}
+
+	static uint64_t GetBytes()
+	{
+		return bytes_.load(std::memory_order_relaxed);
+	}
+
+	static void OnAllocate(size_t size)
+	{
+		count_.fetch_add(1, std::memory_order_relaxed);
+		bytes_.fetch_add(size, std::memory_order_relaxed);
+	}
+
+private:
+	static std::atomic<uint64_t> count_;
+	static std::atomic<uint64_t> bytes_;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include "VulkanMesh.h"
 #include "VulkanObject.h"
 #define DEBUG_LAYER 
+#if defined(_WIN32)
 void VulkanBase::SetupWindow(HINSTANCE hinstance, WNDPROC wndproc, int width, int height)
 {
 	width_ = width;
@@ -108,14 +109,45 @@ void VulkanBase::Loop()
 
 	}
 }
+#endif
+
+void VulkanBase::SetupHeadless(int width, int height)
+{
+	width_ = width;
+	height_ = height;
+	headless_ = true;
+	app_name_ = "Vulkan Render";
+}
+
+void VulkanBase::SetPhysicalDeviceIndex(int index)
+{
+	physical_device_index_ = index;
+}
+
+void VulkanBase::SetTextureBudget(VkDeviceSize budget)
+{
+	texture_budget_ = budget;
+}
+
+void VulkanBase::RenderFrame()
+{
+	Render();
+	Update();
+}
+
+void VulkanBase::WaitIdle()
+{
+	vkDeviceWaitIdle(vulkan_device_->GetDevice());
+}
 
 void VulkanBase::Init()
 {
 	global_state_ = SetGlobalRenderState();
+	if (texture_budget_ != 0) global_state_.textureBudget = texture_budget_;
+	VulkanCpuTracer::Get().SetThreadName("main");
 	CreateInstance();
 	CreateDevice();
 	CreateBaseResource();
-	SetImguiDrawCommandBuffer();
 
 }
 
@@ -139,19 +171,7 @@ void VulkanBase::CreateDepthStencil()
 		throw " create image fault . ";
 	}
 
-	VkMemoryRequirements memory_require = {};
-	vkGetImageMemoryRequirements(vulkan_device_->GetDevice(), DepthStencil.image, &memory_require);
-
-	VkMemoryAllocateInfo alloc_info = {};
-	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	alloc_info.allocationSize = memory_require.size;
-	alloc_info.memoryTypeIndex = vulkan_device_->GetMemoryType(memory_require.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	res = vkAllocateMemory(vulkan_device_->GetDevice(), &alloc_info, NULL, &DepthStencil.memory);
-	if (res != VK_SUCCESS)
-	{
-		throw " allocate memory fault . ";
-	}
-	vkBindImageMemory(vulkan_device_->GetDevice(), DepthStencil.image, DepthStencil.memory, 0);
+	DepthStencil.memory = vulkan_device_->AllocateImageMemory(DepthStencil.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_CATEGORY_RENDER_TARGET);
 
 	VkImageViewCreateInfo image_view_create_info = {};
 	image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -174,24 +194,30 @@ void VulkanBase::CreateSyncPrimitives()
 {
 	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
 	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	VkResult res = vkCreateSemaphore(vulkan_device_->GetDevice(), &semaphoreCreateInfo, nullptr, &DrawSyncs.render_semaphore);
-	if (res != VK_SUCCESS) throw " create semaphore fault .";
-	res = vkCreateSemaphore(vulkan_device_->GetDevice(), &semaphoreCreateInfo, nullptr, &DrawSyncs.present_semaphore);
-	if (res != VK_SUCCESS) throw " create semaphore fault .";
-
-	DrawSyncs.fences.resize(swap_chain_->GetImageCount());
-	for (int i = 0; i < DrawSyncs.fences.size(); i++)
+	VkFenceCreateInfo fenceCreateInfo = {};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	DrawSyncs.present_semaphores.resize(frames_in_flight_);
+	DrawSyncs.render_semaphores.resize(frames_in_flight_);
+	DrawSyncs.fences.resize(frames_in_flight_);
+	for (int i = 0; i < frames_in_flight_; i++)
 	{
-		VkFenceCreateInfo fenceCreateInfo = {};
-		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+		VkResult res = vkCreateSemaphore(vulkan_device_->GetDevice(), &semaphoreCreateInfo, nullptr, &DrawSyncs.render_semaphores[i]);
+		if (res != VK_SUCCESS) throw " create semaphore fault .";
+		res = vkCreateSemaphore(vulkan_device_->GetDevice(), &semaphoreCreateInfo, nullptr, &DrawSyncs.present_semaphores[i]);
+		if (res != VK_SUCCESS) throw " create semaphore fault .";
 		res = vkCreateFence(vulkan_device_->GetDevice(), &fenceCreateInfo, NULL, &DrawSyncs.fences[i]);
 		if (res != VK_SUCCESS) throw " create fence fault .";
 	}
+
+	// the fence of the frame that last rendered into each swap chain image .
+	DrawSyncs.image_fences.resize(swap_chain_->GetImageCount(), VK_NULL_HANDLE);
 }
 
 void VulkanBase::UpdateImgui()
 {
+	CPU_TRACE_SCOPE("UpdateImgui");
 	ImGuiIO& io = ImGui::GetIO();
 
 	io.DisplaySize = ImVec2((float)width_, (float)height_);
@@ -214,6 +240,12 @@ void VulkanBase::UpdateImgui()
 	ImGui::PushItemWidth(110.0f);
 
 	editor_->OnUpdateImgui();
+	ImGui::Text("%.1f fps", fps_);
+	gpu_profiler_->OnUpdateImgui();
+	if (ImGui::Button("Dump CPU Trace"))
+	{
+		VulkanCpuTracer::Get().DumpChromeTrace("cpu_trace.json");
+	}
 	OnUpdateImgui();
 
 	ImGui::PopItemWidth();
@@ -225,10 +257,9 @@ void VulkanBase::UpdateImgui()
 	ImGui::PopStyleVar();
 	ImGui::Render();
 
-	if (imgui_->update() || imgui_->updated) {
-		SetImguiDrawCommandBuffer();
-		imgui_->updated = false;
-	}
+	// the imgui command buffer is recorded every frame in RenderImgui , only the geometry is uploaded here .
+	imgui_->update();
+	imgui_->updated = false;
 
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
 	if (mouseButtons.left) {
@@ -239,25 +270,51 @@ void VulkanBase::UpdateImgui()
 
 void VulkanBase::CreateBaseResource()
 {
-	swap_chain_ = new VulkanSwapChain(instance_, vulkan_device_->GetPhysicalDevice(), vulkan_device_->GetDevice(), window_instance_, window_hwnd_, (uint32_t * )&width_, (uint32_t *)&height_);
-	imgui_command_buffer_.resize(swap_chain_->GetImageCount());
+	frames_in_flight_ = (std::max)(1, (std::min)(global_state_.framesInFlight, MAX_FRAMES_IN_FLIGHT));
+	global_state_.framesInFlight = frames_in_flight_;
+	current_frame_ = 0;
+
+	if (headless_)
+	{
+		swap_chain_ = new VulkanOffscreenSwapChain(vulkan_device_, queue_, width_, height_);
+	}
+	else
+	{
+#if defined(_WIN32)
+		swap_chain_ = new VulkanSurfaceSwapChain(instance_, vulkan_device_->GetPhysicalDevice(), vulkan_device_->GetDevice(), window_instance_, window_hwnd_, (uint32_t * )&width_, (uint32_t *)&height_);
+#else
+		throw " windowed rendering is only supported on win32 , use the headless backend . ";
+#endif
+	}
+	imgui_command_buffer_.resize(frames_in_flight_);
 	vulkan_device_->CreateCommandBuffer(imgui_command_buffer_.size(), VK_COMMAND_BUFFER_LEVEL_PRIMARY, imgui_command_buffer_.data());
 	CreateDepthStencil();
 	CreateSyncPrimitives();
 	PrepareImguiPass();
 	imgui_ = new VulkanImgui(vulkan_device_, queue_);
+	imgui_->setFrameCount(frames_in_flight_);
 	imgui_->prepareResources();
 	imgui_->preparePipeline(VK_NULL_HANDLE, imgui_render_pass_);
 
-	render_scene_ = new VulkanRenderScene(vulkan_device_, queue_, swap_chain_, DepthStencil.image_view, width_ - 320, height_, 320, 0, width_, height_, global_state_ );
+	gpu_profiler_ = new VulkanGpuProfiler(vulkan_device_, frames_in_flight_);
+	imgui_scope_ = gpu_profiler_->RegisterScope("imgui");
+	descriptor_allocator_ = new VulkanDescriptorAllocator(vulkan_device_, frames_in_flight_);
+	vulkan_device_->SetDescriptorAllocator(descriptor_allocator_);
+	deletion_queue_ = new VulkanDeletionQueue(vulkan_device_, frames_in_flight_);
+	vulkan_device_->SetDeletionQueue(deletion_queue_);
+
+	render_scene_ = new VulkanRenderScene(vulkan_device_, queue_, stream_upload_manager_, swap_chain_, DepthStencil.image_view, width_ - 320, height_, 320, 0, width_, height_, global_state_ );
+	render_scene_->SetGpuProfiler(gpu_profiler_);
 
 	editor_ = new VulkanEditor(vulkan_device_, width_ - 320 , height_, 320, 0, width_ , height_ , queue_, swap_chain_, render_scene_->objects_);
+	editor_->SetGpuProfiler(gpu_profiler_);
 	
 }
 
 void VulkanBase::Update()
 {
-	render_scene_->Update(frame_timer);
+	CPU_TRACE_SCOPE("VulkanBase::Update");
+	render_scene_->Update(frame_timer, current_frame_);
 	UpdateMouseEvent();
 	UpdateImgui();
 }
@@ -271,7 +328,7 @@ void VulkanBase::PrepareImguiPass()
 	attachment_desc[0].flags = 0;
 	attachment_desc[0].format = swap_chain_->GetColorFormat();
 	attachment_desc[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	attachment_desc[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	attachment_desc[0].finalLayout = swap_chain_->GetPresentLayout();
 	attachment_desc[0].samples = VK_SAMPLE_COUNT_1_BIT;
 	attachment_desc[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
 	attachment_desc[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
@@ -359,86 +416,129 @@ void VulkanBase::PrepareImguiPass()
 	}
 }
 
-void VulkanBase::SetImguiDrawCommandBuffer()
+void VulkanBase::SetImguiDrawCommandBuffer(uint32_t image_index)
 {
-	VkCommandBufferBeginInfo commandBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo( 0 , NULL);
-	for (int i = 0; i < swap_chain_->GetImageCount(); i++)
-	{
-		vkBeginCommandBuffer(imgui_command_buffer_[i], &commandBeginInfo);
-
-		std::vector<VkClearValue> clearValues = { {} , {} };
-		clearValues[0].color = { { 0.0f , 0.0f , 0.0f , 0.0f } };
-		clearValues[1].depthStencil = { 1 , 0 };
-		VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(imgui_render_pass_, imgui_frame_buffer_[i], clearValues, width_, height_);
-		vkCmdBeginRenderPass(imgui_command_buffer_[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-		VkViewport viewport = VulkanInitializer::InitViewport( 0 , 0 , width_ , height_ , 0.0f , 1.0f );
-		vkCmdSetViewport(imgui_command_buffer_[i] , 0 , 1 , &viewport);
-		VkRect2D scissor = { width_ , height_ ,  0 , 0 };
-		vkCmdSetScissor(imgui_command_buffer_[i], 0, 1, &scissor);
-		imgui_->draw(imgui_command_buffer_[i], width_ , height_ );
-		vkCmdEndRenderPass(imgui_command_buffer_[i]);
-
-		vkEndCommandBuffer(imgui_command_buffer_[i]);
-	}
-
+	VkCommandBuffer commandBuffer = imgui_command_buffer_[current_frame_];
+	VkCommandBufferBeginInfo commandBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, NULL);
+	vkBeginCommandBuffer(commandBuffer, &commandBeginInfo);
+
+	VkClearValue clearValues[2] = {};
+	clearValues[0].color = { { 0.0f , 0.0f , 0.0f , 0.0f } };
+	clearValues[1].depthStencil = { 1 , 0 };
+	VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(imgui_render_pass_, imgui_frame_buffer_[image_index], clearValues, width_, height_);
+	int scope = gpu_profiler_->BeginScope(commandBuffer, imgui_scope_);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	VkViewport viewport = VulkanInitializer::InitViewport( 0 , 0 , width_ , height_ , 0.0f , 1.0f );
+	vkCmdSetViewport(commandBuffer, 0 , 1 , &viewport);
+	VkRect2D scissor = { width_ , height_ ,  0 , 0 };
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	imgui_->draw(commandBuffer, width_ , height_ );
+	vkCmdEndRenderPass(commandBuffer);
+	gpu_profiler_->EndScope(commandBuffer, scope);
+
+	vkEndCommandBuffer(commandBuffer);
 }
 
 void VulkanBase::RenderImgui(uint32_t image_index)
 {
-	VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 	editor_->UpdateEditAxis(image_index);
+	SetImguiDrawCommandBuffer(image_index);
 
-	VkCommandBuffer commandBuffers[2] = {
-		imgui_command_buffer_[image_index],
-		editor_->GetCommandBuffer(image_index)
-	};
-
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.pWaitDstStageMask = &waitStageMask;
-	submit_info.waitSemaphoreCount = 0;
-	submit_info.pWaitSemaphores = NULL;
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = &DrawSyncs.render_semaphore;
-	submit_info.commandBufferCount = 2;
-	submit_info.pCommandBuffers = commandBuffers;
-	vkQueueSubmit(queue_, 1, &submit_info, DrawSyncs.fences[image_index]);
-	swap_chain_->queuePresent(queue_, image_index, DrawSyncs.render_semaphore);
-	vkQueueWaitIdle(queue_);
+	// the render graph always leaves a graphics submit at the end .
+	frame_submits_.Back().command_buffers.push_back(imgui_command_buffer_[current_frame_]);
+	frame_submits_.Back().command_buffers.push_back(editor_->GetCommandBuffer(image_index));
 }
 
 void VulkanBase::RenderScene(uint32_t image_index)
 {
-	std::vector<VkCommandBuffer> commandBuffers;
-	render_scene_->SetupCommandBuffers(commandBuffers , image_index);
-	if (commandBuffers.size() == 0)return;
-	VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.pWaitDstStageMask = &waitStageMask;
-	submit_info.waitSemaphoreCount = 1;
-	submit_info.pWaitSemaphores = &DrawSyncs.present_semaphore;
-	submit_info.signalSemaphoreCount = 0;
-	submit_info.pSignalSemaphores = NULL;
-	submit_info.commandBufferCount = commandBuffers.size();
-	submit_info.pCommandBuffers = commandBuffers.data();
-
-	vkQueueSubmit(queue_, 1, &submit_info, VK_NULL_HANDLE);
-	vkQueueWaitIdle(queue_);
+	// the submit list keeps its capacity from the frames before .
+	frame_submits_.Clear();
+	// the query reset has to reach the queue before any timestamp of the frame .
+	frame_submits_.Add(RENDER_GRAPH_QUEUE_GRAPHICS).command_buffers.push_back(gpu_profiler_->BeginFrame(current_frame_));
+	render_scene_->SetupCommandBuffers(frame_submits_, image_index, current_frame_);
+}
+
+void VulkanBase::SubmitFrame(uint32_t image_index)
+{
+	// the first submit is a graphics submit , it waits for the swap chain image , the last one signals the frame .
+	RenderGraphSubmit & first = frame_submits_.Front();
+	first.wait_semaphores.push_back(DrawSyncs.present_semaphores[current_frame_]);
+	first.wait_stages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	frame_submits_.Back().signal_semaphores.push_back(DrawSyncs.render_semaphores[current_frame_]);
+
+	// uploads recorded since the last frame have to reach the queue before the frame that reads them .
+	// streamed uploads are only handed over once the transfer queue finished them , the frame never waits on them .
+	upload_manager_->Flush();
+	stream_upload_manager_->Flush();
+
+	frame_submit_infos_.resize(frame_submits_.Size());
+	for (size_t i = 0; i < frame_submits_.Size(); i++)
+	{
+		RenderGraphSubmit & submit = frame_submits_[i];
+		VkSubmitInfo & submit_info = frame_submit_infos_[i];
+		submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.waitSemaphoreCount = submit.wait_semaphores.size();
+		submit_info.pWaitSemaphores = submit.wait_semaphores.data();
+		submit_info.pWaitDstStageMask = submit.wait_stages.data();
+		submit_info.signalSemaphoreCount = submit.signal_semaphores.size();
+		submit_info.pSignalSemaphores = submit.signal_semaphores.data();
+		submit_info.commandBufferCount = submit.command_buffers.size();
+		submit_info.pCommandBuffers = submit.command_buffers.data();
+	}
 
+	VULKAN_SUCCESS(vkResetFences(vulkan_device_->GetDevice(), 1, &DrawSyncs.fences[current_frame_]));
+	{
+		CPU_TRACE_SCOPE("vkQueueSubmit");
+		// consecutive submits of one queue go in one call , the fence goes with the last call .
+		size_t begin = 0;
+		while (begin < frame_submits_.Size())
+		{
+			size_t end = begin + 1;
+			while (end < frame_submits_.Size() && frame_submits_[end].queue == frame_submits_[begin].queue) end++;
+			VkQueue queue = frame_submits_[begin].queue == RENDER_GRAPH_QUEUE_COMPUTE ? compute_queue_ : queue_;
+			VkFence fence = end == frame_submits_.Size() ? DrawSyncs.fences[current_frame_] : VK_NULL_HANDLE;
+			VULKAN_SUCCESS(vulkan_device_->QueueSubmit(queue, end - begin, &frame_submit_infos_[begin], fence));
+			begin = end;
+		}
+	}
+	{
+		CPU_TRACE_SCOPE("queuePresent");
+		std::lock_guard<std::mutex> lock(vulkan_device_->GetQueueMutex(queue_));
+		swap_chain_->queuePresent(queue_, image_index, DrawSyncs.render_semaphores[current_frame_]);
+	}
 }
 
 void VulkanBase::Render()
 {
+	CPU_TRACE_SCOPE("VulkanBase::Render");
 	uint32_t image_index;
-	swap_chain_->acquireNextImage(DrawSyncs.present_semaphore, &image_index);
-	vkWaitForFences(vulkan_device_->GetDevice(), 1, &DrawSyncs.fences[image_index], VK_TRUE, UINT64_MAX);
-	vkResetFences(vulkan_device_->GetDevice(), 1, &DrawSyncs.fences[image_index]);
+	swap_chain_->acquireNextImage(DrawSyncs.present_semaphores[current_frame_], &image_index);
+
+	// the editor command buffers are indexed by swap chain image , wait for the frame still using this image .
+	if (DrawSyncs.image_fences[image_index] != VK_NULL_HANDLE)
+	{
+		vkWaitForFences(vulkan_device_->GetDevice(), 1, &DrawSyncs.image_fences[image_index], VK_TRUE, UINT64_MAX);
+	}
+	DrawSyncs.image_fences[image_index] = DrawSyncs.fences[current_frame_];
 
 	auto tStart = std::chrono::high_resolution_clock::now();
 
 	RenderScene(image_index);
 	RenderImgui(image_index);
+	SubmitFrame(image_index);
+
+	// move to the next frame slot , Update() writes into its host visible resources so it must be idle .
+	current_frame_ = (current_frame_ + 1) % frames_in_flight_;
+	{
+		CPU_TRACE_SCOPE("WaitFrameFence");
+		vkWaitForFences(vulkan_device_->GetDevice(), 1, &DrawSyncs.fences[current_frame_], VK_TRUE, UINT64_MAX);
+	}
+	// the command buffers recorded for this slot are done , recycle them in one go .
+	vulkan_device_->ResetFrameCommandPools(current_frame_);
+	descriptor_allocator_->BeginFrame(current_frame_);
+	deletion_queue_->BeginFrame();
+	imgui_->setFrameIndex(current_frame_);
 
 	auto tEnd = std::chrono::high_resolution_clock::now();
 	auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart);
@@ -452,7 +552,7 @@ void VulkanBase::Render()
 	frame_count++;
 	if (tDiffToLastTime > 1000.0f)
 	{
-		float fps = frame_count * 1000.0f / tDiffToLastTime;
+		fps_ = frame_count * 1000.0f / tDiffToLastTime;
 		frame_count = 0;
 		last_time = tEnd;
 	}
@@ -461,17 +561,47 @@ void VulkanBase::Render()
 
 void VulkanBase::CreateInstance()
 {
-	VkApplicationInfo appInfo;
+	VkApplicationInfo appInfo = {};
 	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-	appInfo.apiVersion = VK_VERSION_1_0;
+	appInfo.apiVersion = VK_API_VERSION_1_0;
 	appInfo.pEngineName = app_name_.c_str();
 	appInfo.pApplicationName = app_name_.c_str();
 
-	std::vector<const char*> instanceExtensions = { VK_KHR_SURFACE_EXTENSION_NAME , VK_KHR_WIN32_SURFACE_EXTENSION_NAME , VK_EXT_DEBUG_REPORT_EXTENSION_NAME };
+	// benchmark runs on build servers go without validation , the layers are rarely installed there and would skew the timings .
+#ifdef DEBUG_LAYER
+	bool validation = !headless_;
+#else
+	bool validation = false;
+#endif
+	std::vector<const char*> instanceExtensions;
+	if (!headless_)
+	{
+		instanceExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+#if defined(_WIN32)
+		instanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#endif
+	}
+	if (validation)
+	{
+		instanceExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+	}
 	for (auto iter : instance_extensions_name_)
 	{
 		instanceExtensions.push_back(iter);
 	}
+	// the memory budget of VK_EXT_memory_budget is read through vkGetPhysicalDeviceMemoryProperties2KHR .
+	uint32_t extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, NULL);
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, extensions.data());
+	for (auto & extension : extensions)
+	{
+		if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+		{
+			instanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+			physical_device_properties2_ = true;
+		}
+	}
 
 	VkInstanceCreateInfo instanceInfo = {};
 	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -479,20 +609,22 @@ void VulkanBase::CreateInstance()
 	instanceInfo.enabledExtensionCount = instanceExtensions.size();
 	instanceInfo.ppEnabledExtensionNames = instanceExtensions.data();
 
-#ifdef DEBUG_LAYER
-	instanceInfo.enabledLayerCount = VulkanDebug::validation_layer_count;
-	instanceInfo.ppEnabledLayerNames = VulkanDebug::validation_layer_names;
-#endif
+	if (validation)
+	{
+		instanceInfo.enabledLayerCount = VulkanDebug::validation_layer_count;
+		instanceInfo.ppEnabledLayerNames = VulkanDebug::validation_layer_names;
+	}
 
 	VkResult res = vkCreateInstance(&instanceInfo, NULL, &instance_);
 	if (res != VK_SUCCESS)
 	{
 		throw " create instance fault . ";
 	}
-#ifdef DEBUG_LAYER 
-	VkDebugReportFlagsEXT debugReportFlags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
-	VulkanDebug::Instance()->setupDebugging(instance_, debugReportFlags, VK_NULL_HANDLE);
-#endif
+	if (validation)
+	{
+		VkDebugReportFlagsEXT debugReportFlags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
+		VulkanDebug::Instance()->setupDebugging(instance_, debugReportFlags, VK_NULL_HANDLE);
+	}
 
 }
 
@@ -503,14 +635,57 @@ void VulkanBase::CreateDevice()
 	std::vector<VkPhysicalDevice> physical_devices(gpu_count);
 	vkEnumeratePhysicalDevices(instance_, &gpu_count, physical_devices.data());
 
-	uint32_t selectedDevice = 0;
+	if (gpu_count == 0)
+	{
+		throw " no vulkan physical device . ";
+	}
+	uint32_t selectedDevice = (std::min)((uint32_t)(std::max)(physical_device_index_, 0), gpu_count - 1);
 	vulkan_device_ = new VulkanDevice(physical_devices[selectedDevice]);
 
 	device_enabled_features_ = {};
-	device_extensions_name_.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
-	queue_flag_ = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+	// the scene draws its depth passes with indirect draws when the device has these , see VulkanIndirectDrawList .
+	device_enabled_features_.multiDrawIndirect = vulkan_device_->GetFeatures().multiDrawIndirect;
+	device_enabled_features_.drawIndirectFirstInstance = vulkan_device_->GetFeatures().drawIndirectFirstInstance;
+	if (!headless_)
+	{
+		device_extensions_name_.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	}
+	bool memoryBudget = physical_device_properties2_ && vulkan_device_->SupportExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	if (memoryBudget)
+	{
+		device_extensions_name_.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+	bool drawIndirectCount = vulkan_device_->SupportExtension(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	if (drawIndirectCount)
+	{
+		device_extensions_name_.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	}
+	queue_flag_ = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
 	vulkan_device_->CreateLogicalDevice(device_enabled_features_, device_extensions_name_, queue_flag_);
+	if (memoryBudget)
+	{
+		vulkan_device_->EnableMemoryBudget((PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(instance_, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+	}
+	if (drawIndirectCount)
+	{
+		vulkan_device_->EnableDrawIndirectCount((PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(vulkan_device_->GetDevice(), "vkCmdDrawIndexedIndirectCountKHR"));
+	}
 
 	vkGetDeviceQueue(vulkan_device_->GetDevice(), vulkan_device_->GetGraphicsQueue(), 0, &queue_);
+	compute_queue_ = queue_;
+	if (vulkan_device_->GetComputeQueue() != vulkan_device_->GetGraphicsQueue())
+	{
+		vkGetDeviceQueue(vulkan_device_->GetDevice(), vulkan_device_->GetComputeQueue(), 0, &compute_queue_);
+	}
+	transfer_queue_ = queue_;
+	if (vulkan_device_->GetTransferQueue() != vulkan_device_->GetGraphicsQueue())
+	{
+		vkGetDeviceQueue(vulkan_device_->GetDevice(), vulkan_device_->GetTransferQueue(), 0, &transfer_queue_);
+	}
+
+	// uploads recorded while rendering are read by the next frame , they stay on the graphics queue .
+	upload_manager_ = new VulkanUploadManager(vulkan_device_, queue_, vulkan_device_->GetGraphicsQueue(), queue_, vulkan_device_->GetGraphicsQueue(), UPLOAD_STAGING_RING_SIZE);
+	vulkan_device_->SetUploadManager(upload_manager_);
+	stream_upload_manager_ = new VulkanUploadManager(vulkan_device_, transfer_queue_, vulkan_device_->GetTransferQueue(), queue_, vulkan_device_->GetGraphicsQueue(), STREAM_STAGING_RING_SIZE);
 
 }
@@ -2,11 +2,17 @@
 #define _VULKAN_BASE_H_
 
 #include "VulkanDevice.hpp"
+#include "VulkanUploadManager.h"
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanDeletionQueue.h"
 #include "VulkanImgui.h"
 #include "VulkanSwapChain.hpp"
+#include "VulkanOffscreenSwapChain.hpp"
 #include "VulkanEditor.h"
 #include "Utility.h"
 #include "VulkanRenderScene.h"
+#include "VulkanGpuProfiler.h"
+#include "VulkanCpuTracer.h"
 
 class VulkanBase
 {
@@ -21,11 +27,30 @@ public:
 	}
 
 public:
+#if defined(_WIN32)
 	void SetupWindow(HINSTANCE hinstance, WNDPROC wndproc, int width, int height);
 	void HandleMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 	void Loop();
+#endif
+	// renders into an offscreen image ring instead of a window , no surface or swap chain extension is needed .
+	void SetupHeadless(int width, int height);
+	void SetPhysicalDeviceIndex(int index);
+	// overrides the texture budget of the render state , 0 keeps the one of the render state .
+	void SetTextureBudget(VkDeviceSize budget);
+	void RenderFrame();
+	void WaitIdle();
 	virtual void Init();
 
+	VulkanGpuProfiler * GetGpuProfiler() const
+	{
+		return gpu_profiler_;
+	}
+
+	bool IsSceneStreaming() const
+	{
+		return render_scene_->IsSceneStreaming();
+	}
+
 	void CreateInstance();
 	void CreateDevice();
 	void CreateDepthStencil();
@@ -44,14 +69,19 @@ private:
 	std::vector<VkFramebuffer> imgui_frame_buffer_;
 	std::vector<VkCommandBuffer> imgui_command_buffer_;
 	void PrepareImguiPass();
-	void SetImguiDrawCommandBuffer();
+	void SetImguiDrawCommandBuffer(uint32_t image_index);
 	void RenderImgui(uint32_t image_index);
 	void RenderScene(uint32_t image_index);
+	void SubmitFrame(uint32_t image_index);
 	void Render();
 
 protected:
+#if defined(_WIN32)
 	HINSTANCE window_instance_;
 	HWND window_hwnd_;
+#endif
+	bool headless_ = false;
+	int physical_device_index_ = 0;
 	std::string app_name_;
 	int width_;
 	int height_;
@@ -62,35 +92,56 @@ protected:
 	VulkanSwapChain * swap_chain_;
 	RenderGlobalState global_state_;
 	VkQueue queue_;
+	// the graphics queue when the device has no separate compute family .
+	VkQueue compute_queue_;
+	// the graphics queue when the device has no separate transfer family .
+	VkQueue transfer_queue_;
+	VulkanUploadManager * upload_manager_;
+	// uploads of the loader thread , they go through the transfer queue and are handed over to the graphics queue .
+	VulkanUploadManager * stream_upload_manager_;
+	VulkanDescriptorAllocator * descriptor_allocator_;
+	VulkanDeletionQueue * deletion_queue_;
 	VkPhysicalDeviceFeatures device_enabled_features_;
 	std::vector<const char*> device_extensions_name_;
 	VkQueueFlags queue_flag_;
 	std::vector<const char*> instance_extensions_name_;
+	// VK_KHR_get_physical_device_properties2 was enabled on the instance .
+	bool physical_device_properties2_ = false;
 
 
 private:
 	struct
 	{
 		VkImage image;
-		VkDeviceMemory memory;
+		VulkanAllocation memory;
 		VkImageView image_view;
 	}DepthStencil;
 
 	struct
 	{
-		VkSemaphore present_semaphore;
-		VkSemaphore render_semaphore;
+		std::vector<VkSemaphore> present_semaphores;
+		std::vector<VkSemaphore> render_semaphores;
 		std::vector<VkFence> fences;
+		std::vector<VkFence> image_fences;
 	}DrawSyncs;
 
+	int frames_in_flight_ = 2;
+	VkDeviceSize texture_budget_ = 0;
+	uint32_t current_frame_ = 0;
+	RenderGraphSubmitList frame_submits_;
+	std::vector<VkSubmitInfo> frame_submit_infos_;
+
 private:
 	int frame_count = 0;
 	std::chrono::time_point<std::chrono::high_resolution_clock> last_time;
 	float frame_timer = 0;
+	float fps_ = 0;
 
 protected:
 	VulkanEditor * editor_;
 	VulkanRenderScene * render_scene_;
+	VulkanGpuProfiler * gpu_profiler_;
+	int imgui_scope_ = -1;
 	MouseStateType MouseState;
 
 };
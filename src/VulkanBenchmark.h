@@ -0,0 +1,215 @@
+#ifndef _VULKAN_BENCHMARK_H_
+#define _VULKAN_BENCHMARK_H_
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+#include "VulkanBase.h"
+#include "VulkanAllocationCounter.h"
+#include "VulkanFrustumCulling.h"
+
+struct BenchmarkOptions
+{
+	int warmupFrames = 60;
+	int frames = 600;
+	std::string csvFile;
+	// the run fails when a measured frame makes more heap allocations , the steady state frame makes none .
+	// negative disables the check .
+	int maxFrameAllocations = 0;
+};
+
+// Renders a fixed number of frames and reports frame time statistics .
+// The warm up frames are excluded , they absorb the first pass recordings and the pipeline creation done by the driver .
+// Measuring also waits for the scene to finish streaming , so every measured frame renders the same scene .
+// Frame time is the cpu time of one trip through the frame loop , with frames in flight it converges to the slower of cpu and gpu .
+// The heap allocations of every frame are counted as well , the steady state frame is expected to make none .
+class VulkanBenchmark
+{
+public:
+	VulkanBenchmark(VulkanBase * base, const BenchmarkOptions & options) : base_(base), options_(options)
+	{
+	}
+
+public:
+	void Run()
+	{
+		for (int i = 0; i < options_.warmupFrames || base_->IsSceneStreaming(); i++)
+		{
+			base_->RenderFrame();
+		}
+
+		VulkanGpuProfiler * profiler = base_->GetGpuProfiler();
+		frame_times_.clear();
+		frame_times_.reserve(options_.frames);
+		frame_allocations_.clear();
+		frame_allocations_.reserve(options_.frames);
+		gpu_times_.clear();
+		for (int i = 0; i < options_.frames; i++)
+		{
+			uint64_t allocationStart = VulkanAllocationCounter::GetCount();
+			auto tStart = std::chrono::high_resolution_clock::now();
+			base_->RenderFrame();
+			auto tEnd = std::chrono::high_resolution_clock::now();
+			frame_allocations_.push_back(VulkanAllocationCounter::GetCount() - allocationStart);
+			frame_times_.push_back((float)std::chrono::duration<double, std::milli>(tEnd - tStart).count());
+
+			const std::vector<std::string> & names = profiler->GetScopeNames();
+			gpu_times_.resize(names.size(), 0.0);
+			for (size_t s = 0; s < names.size(); s++)
+			{
+				gpu_times_[s] += profiler->GetLastDuration(s);
+			}
+		}
+		base_->WaitIdle();
+	}
+
+	void PrintReport(FILE * out = stdout) const
+	{
+		if (frame_times_.size() == 0) return;
+
+		std::vector<float> sorted = frame_times_;
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0.0;
+		for (float t : sorted) total += t;
+		double average = total / sorted.size();
+
+		fprintf(out, "frames      %d\n", (int)sorted.size());
+		fprintf(out, "average     %.3f ms ( %.1f fps )\n", average, 1000.0 / average);
+		fprintf(out, "min         %.3f ms\n", sorted.front());
+		fprintf(out, "median      %.3f ms\n", Percentile(sorted, 0.5f));
+		fprintf(out, "p95         %.3f ms\n", Percentile(sorted, 0.95f));
+		fprintf(out, "p99         %.3f ms\n", Percentile(sorted, 0.99f));
+		fprintf(out, "max         %.3f ms\n", sorted.back());
+
+		uint64_t totalAllocations = 0;
+		for (uint64_t count : frame_allocations_) totalAllocations += count;
+		fprintf(out, "allocations %.2f per frame , max %llu\n", (double)totalAllocations / frame_allocations_.size(), (unsigned long long)GetMaxFrameAllocations());
+
+		const std::vector<std::string> & names = base_->GetGpuProfiler()->GetScopeNames();
+		for (size_t s = 0; s < gpu_times_.size(); s++)
+		{
+			fprintf(out, "gpu %-20s %.3f ms\n", names[s].c_str(), gpu_times_[s] / frame_times_.size());
+		}
+	}
+
+	// one row per measured frame .
+	bool WriteCSV(const std::string & file) const
+	{
+		std::ofstream csv(file);
+		if (!csv.is_open()) return false;
+		csv << "frame,ms,allocations\n";
+		for (size_t i = 0; i < frame_times_.size(); i++)
+		{
+			csv << i << "," << frame_times_[i] << "," << frame_allocations_[i] << "\n";
+		}
+		return true;
+	}
+
+	uint64_t GetMaxFrameAllocations() const
+	{
+		uint64_t maxCount = 0;
+		for (uint64_t count : frame_allocations_) maxCount = (std::max)(maxCount, count);
+		return maxCount;
+	}
+
+	bool IsAllocationBudgetMet() const
+	{
+		return options_.maxFrameAllocations < 0 || GetMaxFrameAllocations() <= (uint64_t)options_.maxFrameAllocations;
+	}
+
+private:
+	static float Percentile(const std::vector<float> & sorted, float p)
+	{
+		size_t ind = (size_t)(p * (sorted.size() - 1) + 0.5f);
+		return sorted[(std::min)(ind, sorted.size() - 1)];
+	}
+
+private:
+	VulkanBase * base_;
+	BenchmarkOptions options_;
+	std::vector<float> frame_times_;
+	std::vector<uint64_t> frame_allocations_;
+	std::vector<double> gpu_times_;
+};
+
+// Times the batched frustum test of VulkanCullBounds alone , on random boxes spread around a camera , no device is needed .
+// The boxes are tested against the camera frustum and against four cascade frustums at once , like the shadow draws .
+class FrustumCullBenchmark
+{
+public:
+	FrustumCullBenchmark(int objectCount, int iterations) : object_count_(objectCount), iterations_(iterations)
+	{
+	}
+
+public:
+	void Run()
+	{
+		// a fixed seed , every run tests the same boxes .
+		uint32_t seed = 1;
+		auto random = [&seed](float minValue, float maxValue)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return minValue + (maxValue - minValue) * ((seed >> 8) / 16777216.0f);
+		};
+		bounds_.Clear();
+		for (int i = 0; i < object_count_; i++)
+		{
+			Model::Dimension box;
+			box.min = glm::vec3(random(-0.5f, 0.5f), random(-0.5f, 0.5f), random(-0.5f, 0.5f));
+			box.max = box.min + glm::vec3(random(0.1f, 1.0f), random(0.1f, 1.0f), random(0.1f, 1.0f));
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(random(-100.0f, 100.0f), random(-20.0f, 20.0f), random(-100.0f, 100.0f)));
+			bounds_.Add(box, model);
+		}
+
+		glm::mat4 view = glm::lookAtLH(glm::vec3(0.0f, 2.0f, -10.0f), glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 proj = glm::perspectiveLH(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 256.0f);
+		VulkanFrustum camera = VulkanFrustum::FromMatrix(proj * view);
+		VulkanFrustum cascades[SHADOW_CASCADE_COUNT];
+		for (int j = 0; j < SHADOW_CASCADE_COUNT; j++)
+		{
+			float radius = 8.0f * (j + 1);
+			glm::mat4 lightView = glm::lookAtLH(glm::vec3(0.0f, 50.0f, radius), glm::vec3(0.0f, 0.0f, radius), glm::vec3(0.0f, 0.0f, 1.0f));
+			cascades[j] = VulkanFrustum::FromMatrix(glm::orthoLH(-radius, radius, -radius, radius, 0.0f, 100.0f) * lightView);
+		}
+
+		camera_us_ = Time(&camera, 1, camera_visible_);
+		cascade_us_ = Time(cascades, SHADOW_CASCADE_COUNT, cascade_visible_);
+	}
+
+	void PrintReport(FILE * out = stdout) const
+	{
+		double tested = (double)object_count_ * iterations_;
+		fprintf(out, "cull simd   %s , %d lanes\n", FRUSTUM_CULL_SIMD_NAME, FRUSTUM_CULL_LANES);
+		fprintf(out, "cull boxes  %d , %d iterations\n", object_count_, iterations_);
+		fprintf(out, "camera      %.1f objects/us , %d visible\n", tested / camera_us_, (int)camera_visible_.size());
+		fprintf(out, "cascades    %.1f objects/us , %d visible to any of %d\n", tested / cascade_us_, (int)cascade_visible_.size(), SHADOW_CASCADE_COUNT);
+	}
+
+private:
+	// micro seconds of all iterations .
+	double Time(const VulkanFrustum * frustums, uint32_t frustumCount, std::vector<uint32_t> & visible) const
+	{
+		bounds_.Cull(frustums, frustumCount, visible);
+		auto tStart = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations_; i++)
+		{
+			bounds_.Cull(frustums, frustumCount, visible);
+		}
+		auto tEnd = std::chrono::high_resolution_clock::now();
+		return (std::max)(std::chrono::duration<double, std::micro>(tEnd - tStart).count(), 1e-3);
+	}
+
+private:
+	int object_count_;
+	int iterations_;
+	VulkanCullBounds bounds_;
+	std::vector<uint32_t> camera_visible_;
+	std::vector<uint32_t> cascade_visible_;
+	double camera_us_ = 0.0;
+	double cascade_us_ = 0.0;
+};
+
+#endif
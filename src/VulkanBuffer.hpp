@@ -2,17 +2,24 @@
 #define _VULKAN_BUFFER_HPP_H_
 
 #include <vulkan/vulkan.h>
+#include "VulkanMemoryAllocator.h"
 
+// The memory of a buffer is a range of a block of VulkanMemoryAllocator , host visible blocks stay mapped so Map only
+// hands out the pointer to the range and Unmap forgets it .
 class VulkanBuffer
 {
 public:
 	VulkanBuffer(
 		VkBuffer buffer,
-		VkDeviceMemory device_memory,
-		VkDevice logical_device
+		const VulkanAllocation & allocation,
+		VulkanMemoryAllocator * allocator,
+		VkDevice logical_device,
+		bool concurrent = false
 	) : buffer_(buffer),
-		buffer_memory_(device_memory),
-		logical_device_(logical_device)
+		allocation_(allocation),
+		allocator_(allocator),
+		logical_device_(logical_device),
+		concurrent_(concurrent)
 
 	{
 		mapped_memory_ = NULL;
@@ -29,11 +36,11 @@ public:
 public:
 	void Map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0)
 	{
-		VkResult res = vkMapMemory(logical_device_, buffer_memory_, offset, size, 0, &mapped_memory_);
-		if (res != VK_SUCCESS)
+		if (allocation_.mapped == NULL)
 		{
 			throw " map memory fault . ";
 		}
+		mapped_memory_ = (char*)allocation_.mapped + offset;
 	}
 
 	void Unmap()
@@ -42,7 +49,6 @@ public:
 		{
 			throw " the memory has not been mapped . ";
 		}
-		vkUnmapMemory(logical_device_, buffer_memory_);
 		mapped_memory_ = nullptr;
 	}
 
@@ -55,30 +61,12 @@ public:
 
 	void FlushMemory(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0)
 	{
-		VkMappedMemoryRange memoryRange = {};
-		memoryRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		memoryRange.memory = buffer_memory_;
-		memoryRange.size = size;
-		memoryRange.offset = offset;
-		VkResult res = vkFlushMappedMemoryRanges(logical_device_, 1, &memoryRange);
-		if (res != VK_SUCCESS)
-		{
-			throw " flush memory fault . ";
-		}
+		allocator_->Flush(allocation_, offset, size);
 	}
 
 	void InvalidateMemory(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0)
 	{
-		VkMappedMemoryRange memoryRange = {};
-		memoryRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		memoryRange.memory = buffer_memory_;
-		memoryRange.size = size;
-		memoryRange.offset = offset;
-		VkResult res = vkInvalidateMappedMemoryRanges(logical_device_, 1, &memoryRange);
-		if (res != VK_SUCCESS)
-		{
-			throw " invalidate memory fault . ";
-		}
+		allocator_->Invalidate(allocation_, offset, size);
 	}
 
 	void Destroy()
@@ -86,12 +74,10 @@ public:
 		if (buffer_)
 		{
 			vkDestroyBuffer(logical_device_, buffer_, NULL);
+			buffer_ = VK_NULL_HANDLE;
 		}
-
-		if (buffer_memory_)
-		{
-			vkFreeMemory(logical_device_, buffer_memory_, NULL);
-		}
+		allocator_->Free(allocation_);
+		mapped_memory_ = NULL;
 	}
 
 	VkDescriptorBufferInfo& GetDesc() 
@@ -106,15 +92,29 @@ public:
 
 	VkDeviceMemory GetBufferMemory() const
 	{
-		return buffer_memory_;
+		return allocation_.memory;
+	}
+
+	// offset of the buffer inside GetBufferMemory .
+	VkDeviceSize GetMemoryOffset() const
+	{
+		return allocation_.offset;
+	}
+
+	// shared by the queue families without ownership transfers .
+	bool IsConcurrent() const
+	{
+		return concurrent_;
 	}
 
 private:
 	VkDevice logical_device_;
 	VkBuffer buffer_;
-	VkDeviceMemory buffer_memory_;
+	VulkanAllocation allocation_;
+	VulkanMemoryAllocator * allocator_;
 	void* mapped_memory_;
 	VkDescriptorBufferInfo desc_info_;
+	bool concurrent_;
 
 };
 
@@ -0,0 +1,175 @@
+#ifndef _VULKAN_CPU_TRACER_H_
+#define _VULKAN_CPU_TRACER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define CPU_TRACE_RING_SIZE 16384
+
+// Scoped cpu markers .
+// Every thread writes into its own ring buffer , so recording a scope is two clock reads and one release store ,
+// the mutex is only taken the first time a thread records and when the rings are dumped .
+// Old events are overwritten , the rings always hold the latest CPU_TRACE_RING_SIZE scopes of every thread .
+// Scope names are not copied and must outlive the tracer , string literals are expected .
+class VulkanCpuTracer
+{
+public:
+	struct TraceEvent
+	{
+		const char * name;
+		int64_t begin;
+		int64_t end;
+	};
+
+	static VulkanCpuTracer & Get()
+	{
+		static VulkanCpuTracer tracer;
+		return tracer;
+	}
+
+	int64_t Now() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch_).count();
+	}
+
+	bool IsEnabled() const
+	{
+		return enabled_.load(std::memory_order_relaxed);
+	}
+
+	void SetEnabled(bool enabled)
+	{
+		enabled_.store(enabled, std::memory_order_relaxed);
+	}
+
+	void Record(const char * name, int64_t begin, int64_t end)
+	{
+		ThreadRing * ring = GetThreadRing();
+		uint64_t head = ring->head.load(std::memory_order_relaxed);
+		TraceEvent & e = ring->events[head & (CPU_TRACE_RING_SIZE - 1)];
+		e.name = name;
+		e.begin = begin;
+		e.end = end;
+		ring->head.store(head + 1, std::memory_order_release);
+	}
+
+	void SetThreadName(const char * name)
+	{
+		ThreadRing * ring = GetThreadRing();
+		std::lock_guard<std::mutex> lock(mutex_);
+		ring->name = name;
+	}
+
+	// writes the rings as chrome trace json , load it in chrome://tracing or ui.perfetto.dev .
+	bool DumpChromeTrace(const std::string & file)
+	{
+		std::ofstream json(file);
+		if (!json.is_open()) return false;
+		// ts and dur are micro seconds , the default precision loses the fraction after a second of run time .
+		json << std::fixed << std::setprecision(3);
+
+		std::vector<TraceEvent> events;
+		std::lock_guard<std::mutex> lock(mutex_);
+		json << "{\"traceEvents\":[";
+		bool first = true;
+		for (size_t t = 0; t < rings_.size(); t++)
+		{
+			ThreadRing * ring = rings_[t].get();
+			if (ring->name.size() != 0)
+			{
+				json << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << t << ",\"args\":{\"name\":\"" << ring->name << "\"}}";
+				first = false;
+			}
+
+			// the owner keeps writing while we copy , drop everything it may have overwritten meanwhile .
+			uint64_t head = ring->head.load(std::memory_order_acquire);
+			uint64_t tail = head > CPU_TRACE_RING_SIZE ? head - CPU_TRACE_RING_SIZE : 0;
+			events.clear();
+			for (uint64_t i = tail; i < head; i++)
+			{
+				events.push_back(ring->events[i & (CPU_TRACE_RING_SIZE - 1)]);
+			}
+			uint64_t newHead = ring->head.load(std::memory_order_acquire);
+			uint64_t valid = newHead > CPU_TRACE_RING_SIZE ? newHead - CPU_TRACE_RING_SIZE : 0;
+
+			for (uint64_t i = (std::max)(tail, valid); i < head; i++)
+			{
+				const TraceEvent & e = events[i - tail];
+				json << (first ? "" : ",") << "\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << t
+					<< ",\"ts\":" << e.begin / 1000.0 << ",\"dur\":" << (e.end - e.begin) / 1000.0 << "}";
+				first = false;
+			}
+		}
+		json << "\n]}\n";
+		return true;
+	}
+
+private:
+	struct ThreadRing
+	{
+		std::atomic<uint64_t> head;
+		std::string name;
+		TraceEvent events[CPU_TRACE_RING_SIZE];
+	};
+
+	VulkanCpuTracer() : epoch_(std::chrono::steady_clock::now()), enabled_(true)
+	{
+	}
+
+	ThreadRing * GetThreadRing()
+	{
+		static thread_local ThreadRing * ring = NULL;
+		if (ring == NULL)
+		{
+			std::unique_ptr<ThreadRing> newRing(new ThreadRing());
+			newRing->head.store(0, std::memory_order_relaxed);
+			ring = newRing.get();
+			std::lock_guard<std::mutex> lock(mutex_);
+			rings_.push_back(std::move(newRing));
+		}
+		return ring;
+	}
+
+private:
+	std::chrono::steady_clock::time_point epoch_;
+	std::atomic<bool> enabled_;
+	std::mutex mutex_;
+	std::vector<std::unique_ptr<ThreadRing>> rings_;
+};
+
+class CpuTraceScope
+{
+public:
+	CpuTraceScope(const char * name) : name_(name), begin_(-1)
+	{
+		if (VulkanCpuTracer::Get().IsEnabled()) begin_ = VulkanCpuTracer::Get().Now();
+	}
+
+	~CpuTraceScope()
+	{
+		if (begin_ >= 0) VulkanCpuTracer::Get().Record(name_, begin_, VulkanCpuTracer::Get().Now());
+	}
+
+private:
+	const char * name_;
+	int64_t begin_;
+};
+
+#define CPU_TRACE_CONCAT_INNER(a, b) a##b
+#define CPU_TRACE_CONCAT(a, b) CPU_TRACE_CONCAT_INNER(a, b)
+
+#ifdef VULKAN_DISABLE_CPU_TRACE
+#define CPU_TRACE_SCOPE(name)
+#else
+#define CPU_TRACE_SCOPE(name) CpuTraceScope CPU_TRACE_CONCAT(cpu_trace_scope_, __LINE__)(name)
+#endif
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef _VULKAN_DEBUG_H_
 #define _VULKAN_DEBUG_H_
 
+#if defined(_WIN32)
 #include <Windows.h>
+#endif
 #include <vulkan/vulkan.h>
 
 VKAPI_ATTR VkBool32 VKAPI_CALL messageCallback(
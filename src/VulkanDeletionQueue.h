@@ -0,0 +1,169 @@
+#ifndef _VULKAN_DELETION_QUEUE_H_
+#define _VULKAN_DELETION_QUEUE_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+#include "Utility.h"
+#include "VulkanDevice.hpp"
+
+// Resources that command buffers of frames in flight may still reference , released once those frames are done .
+// An entry queued during frame n is released by the BeginFrame that follows the fence wait of frame n , that is
+// frames in flight frames later , so replacing a resource never waits for the device .
+// Objects are deleted with their destructor , raw handles are destroyed with the device and memory goes back to
+// the allocator . Entries are released in the order they were queued .
+// Thread safe , a released object may queue further entries , they wait for the next frames .
+class VulkanDeletionQueue
+{
+	struct Entry
+	{
+		uint64_t handle;
+		void (*release)(VulkanDevice * device, uint64_t handle);
+		uint64_t frame;
+	};
+
+public:
+	VulkanDeletionQueue(VulkanDevice * device, int framesInFlight) : device_(device), frames_in_flight_(framesInFlight)
+	{
+	}
+
+	~VulkanDeletionQueue()
+	{
+		Flush();
+	}
+
+public:
+	// called once the fence of the oldest frame in flight was waited on .
+	void BeginFrame()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			frame_count_++;
+			size_t kept = 0;
+			for (size_t i = 0; i < entries_.size(); i++)
+			{
+				if (entries_[i].frame + frames_in_flight_ <= frame_count_)
+				{
+					releasing_.push_back(entries_[i]);
+				}
+				else
+				{
+					entries_[kept++] = entries_[i];
+				}
+			}
+			entries_.resize(kept);
+		}
+		Release();
+	}
+
+	// releases everything at once , the device has to be idle .
+	void Flush()
+	{
+		while (true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (entries_.size() == 0) break;
+				releasing_.swap(entries_);
+			}
+			Release();
+		}
+	}
+
+	template <class T>
+	void Delete(T * object)
+	{
+		if (object == NULL) return;
+		Push((uint64_t)(uintptr_t)object, &DeleteObject<T>);
+	}
+
+	void Destroy(VkBuffer buffer)
+	{
+		if (buffer == VK_NULL_HANDLE) return;
+		Push((uint64_t)buffer, [](VulkanDevice * device, uint64_t handle) { vkDestroyBuffer(device->GetDevice(), (VkBuffer)handle, NULL); });
+	}
+
+	void Destroy(VkImage image)
+	{
+		if (image == VK_NULL_HANDLE) return;
+		Push((uint64_t)image, [](VulkanDevice * device, uint64_t handle) { vkDestroyImage(device->GetDevice(), (VkImage)handle, NULL); });
+	}
+
+	void Destroy(VkImageView imageView)
+	{
+		if (imageView == VK_NULL_HANDLE) return;
+		Push((uint64_t)imageView, [](VulkanDevice * device, uint64_t handle) { vkDestroyImageView(device->GetDevice(), (VkImageView)handle, NULL); });
+	}
+
+	// samplers of the object cache are owned by the device and never go through the queue .
+	void Destroy(VkSampler sampler)
+	{
+		if (sampler == VK_NULL_HANDLE) return;
+		Push((uint64_t)sampler, [](VulkanDevice * device, uint64_t handle) { vkDestroySampler(device->GetDevice(), (VkSampler)handle, NULL); });
+	}
+
+	void Destroy(VkDescriptorPool pool)
+	{
+		if (pool == VK_NULL_HANDLE) return;
+		Push((uint64_t)pool, [](VulkanDevice * device, uint64_t handle) { vkDestroyDescriptorPool(device->GetDevice(), (VkDescriptorPool)handle, NULL); });
+	}
+
+	void Destroy(VkPipeline pipeline)
+	{
+		if (pipeline == VK_NULL_HANDLE) return;
+		Push((uint64_t)pipeline, [](VulkanDevice * device, uint64_t handle) { vkDestroyPipeline(device->GetDevice(), (VkPipeline)handle, NULL); });
+	}
+
+	void Destroy(VkFramebuffer frameBuffer)
+	{
+		if (frameBuffer == VK_NULL_HANDLE) return;
+		Push((uint64_t)frameBuffer, [](VulkanDevice * device, uint64_t handle) { vkDestroyFramebuffer(device->GetDevice(), (VkFramebuffer)handle, NULL); });
+	}
+
+	// the range goes back to its block , the allocation is copied into the queue .
+	void Free(const VulkanAllocation & allocation)
+	{
+		if (allocation.memory == VK_NULL_HANDLE) return;
+		Push((uint64_t)(uintptr_t)new VulkanAllocation(allocation), [](VulkanDevice * device, uint64_t handle)
+		{
+			VulkanAllocation * allocation = (VulkanAllocation*)(uintptr_t)handle;
+			device->FreeMemory(*allocation);
+			delete allocation;
+		});
+	}
+
+	size_t GetPendingCount() const
+	{
+		return entries_.size();
+	}
+
+private:
+	template <class T>
+	static void DeleteObject(VulkanDevice * device, uint64_t handle)
+	{
+		delete (T*)(uintptr_t)handle;
+	}
+
+	void Push(uint64_t handle, void (*release)(VulkanDevice * device, uint64_t handle))
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		entries_.push_back({ handle , release , frame_count_ });
+	}
+
+	// runs without the lock , releasing_ is only touched by the frame loop .
+	void Release()
+	{
+		for (auto & entry : releasing_) entry.release(device_, entry.handle);
+		releasing_.clear();
+	}
+
+private:
+	VulkanDevice * device_;
+	int frames_in_flight_;
+	uint64_t frame_count_ = 0;
+	std::vector<Entry> entries_;
+	std::vector<Entry> releasing_;
+	std::mutex mutex_;
+};
+
+#endif
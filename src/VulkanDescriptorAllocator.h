@@ -0,0 +1,163 @@
+#ifndef _VULKAN_DESCRIPTOR_ALLOCATOR_H_
+#define _VULKAN_DESCRIPTOR_ALLOCATOR_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include "Utility.h"
+#include "VulkanDevice.hpp"
+
+#define DESCRIPTOR_POOL_MAX_SETS 256
+
+// Descriptor sets of materials and passes , allocated from shared pools instead of a pool per owner .
+// Persistent sets come from a list of pools that grows by one pool whenever the last one is exhausted . A freed set
+// is kept per layout and handed out again once the frames in flight that may still bind it are done , the new owner
+// writes every binding . Transient sets come from one pool per frame in flight that BeginFrame resets as a whole .
+// Every pool has room for any set layout of the renderer , the sizes are per set on average .
+// Thread safe , materials may be created while workers record .
+class VulkanDescriptorAllocator
+{
+	struct RetiredSet
+	{
+		VkDescriptorSet set;
+		VkDescriptorSetLayout layout;
+		uint64_t frame;
+	};
+
+public:
+	VulkanDescriptorAllocator(VulkanDevice * device, int framesInFlight) : device_(device), frames_in_flight_(framesInFlight)
+	{
+		transient_pools_.resize(framesInFlight);
+		for (auto & pools : transient_pools_) pools.push_back(CreatePool());
+	}
+
+	~VulkanDescriptorAllocator()
+	{
+		for (auto pool : pools_) vkDestroyDescriptorPool(device_->GetDevice(), pool, NULL);
+		for (auto & pools : transient_pools_)
+		{
+			for (auto pool : pools) vkDestroyDescriptorPool(device_->GetDevice(), pool, NULL);
+		}
+	}
+
+public:
+	// called once the fence of frameIndex was waited on , the transient sets of the slot are gone afterwards .
+	void BeginFrame(int frameIndex)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		frame_index_ = frameIndex;
+		frame_count_++;
+		std::vector<VkDescriptorPool> & pools = transient_pools_[frameIndex];
+		for (auto pool : pools) VULKAN_SUCCESS(vkResetDescriptorPool(device_->GetDevice(), pool, 0));
+		transient_used_[frameIndex] = 0;
+
+		size_t kept = 0;
+		for (size_t i = 0; i < retired_.size(); i++)
+		{
+			if (retired_[i].frame + frames_in_flight_ <= frame_count_)
+			{
+				free_sets_[retired_[i].layout].push_back(retired_[i].set);
+			}
+			else
+			{
+				retired_[kept++] = retired_[i];
+			}
+		}
+		retired_.resize(kept);
+	}
+
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::vector<VkDescriptorSet> & freeSets = free_sets_[layout];
+		if (freeSets.size() != 0)
+		{
+			VkDescriptorSet set = freeSets.back();
+			freeSets.pop_back();
+			return set;
+		}
+		VkDescriptorSet set;
+		if (pools_.size() != 0 && TryAllocate(pools_.back(), layout, set)) return set;
+		pools_.push_back(CreatePool());
+		if (!TryAllocate(pools_.back(), layout, set))
+		{
+			throw " descriptor set does not fit into an empty pool . ";
+		}
+		return set;
+	}
+
+	// the set may still be bound by frames in flight , it is only reused once they are done .
+	void Free(VkDescriptorSet set, VkDescriptorSetLayout layout)
+	{
+		if (set == VK_NULL_HANDLE) return;
+		std::lock_guard<std::mutex> lock(mutex_);
+		retired_.push_back({ set , layout , frame_count_ });
+	}
+
+	// valid until the frame slot comes around again .
+	VkDescriptorSet AllocateTransient(VkDescriptorSetLayout layout)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::vector<VkDescriptorPool> & pools = transient_pools_[frame_index_];
+		size_t & used = transient_used_[frame_index_];
+		VkDescriptorSet set;
+		while (!TryAllocate(pools[used], layout, set))
+		{
+			if (++used == pools.size()) pools.push_back(CreatePool());
+		}
+		return set;
+	}
+
+	size_t GetPoolCount() const
+	{
+		return pools_.size();
+	}
+
+private:
+	VkDescriptorPool CreatePool()
+	{
+		VkDescriptorPoolSize poolSizes[] =
+		{
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , DESCRIPTOR_POOL_MAX_SETS * 4 },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , DESCRIPTOR_POOL_MAX_SETS },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , DESCRIPTOR_POOL_MAX_SETS },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , DESCRIPTOR_POOL_MAX_SETS },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE , DESCRIPTOR_POOL_MAX_SETS / 4 },
+		};
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.maxSets = DESCRIPTOR_POOL_MAX_SETS;
+		poolCreateInfo.poolSizeCount = sizeof(poolSizes) / sizeof(poolSizes[0]);
+		poolCreateInfo.pPoolSizes = poolSizes;
+		VkDescriptorPool pool;
+		VULKAN_SUCCESS(vkCreateDescriptorPool(device_->GetDevice(), &poolCreateInfo, NULL, &pool));
+		return pool;
+	}
+
+	// an exhausted pool reports VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL , drivers without
+	// maintenance1 may report an out of memory error instead , every failure moves on to a new pool .
+	bool TryAllocate(VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet & set)
+	{
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.descriptorPool = pool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &layout;
+		return vkAllocateDescriptorSets(device_->GetDevice(), &allocateInfo, &set) == VK_SUCCESS;
+	}
+
+private:
+	VulkanDevice * device_;
+	int frames_in_flight_;
+	int frame_index_ = 0;
+	uint64_t frame_count_ = 0;
+	std::vector<VkDescriptorPool> pools_;
+	std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> free_sets_;
+	std::vector<RetiredSet> retired_;
+	std::vector<std::vector<VkDescriptorPool>> transient_pools_;
+	size_t transient_used_[MAX_FRAMES_IN_FLIGHT] = {};
+	std::mutex mutex_;
+};
+
+#endif
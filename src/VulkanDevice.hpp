@@ -5,9 +5,32 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>
 
 #include "VulkanBuffer.hpp"
-
+#include "VulkanObjectCache.h"
+
+class VulkanUploadManager;
+class VulkanDescriptorAllocator;
+class VulkanDeletionQueue;
+
+// Command pools are owned by threads , CreateCommandBuffer allocates from a pool of the calling thread which is created
+// the first time the thread asks for one , so loading and recording threads never share a pool .
+// A command buffer has to be recorded on the thread that created it . It may be destroyed on any thread , it goes back to
+// the pool that allocated it : right away on the owning thread , otherwise the owner frees it on its next allocation .
+// Frame command buffers come from per thread pools of one frame in flight , they are recycled as a whole by
+// ResetFrameCommandPools once the fence of that frame has been waited on .
+// Device memory is sub allocated by VulkanMemoryAllocator , buffers and images take ranges of shared blocks .
+// Every allocation names a MemoryCategory , GetHeapStats adds the VK_EXT_memory_budget numbers when enabled .
+// Queues are externally synchronized , every submit goes through QueueSubmit which takes the lock of that queue only ,
+// so submits to different queues do not wait for each other .
+// Resource uploads are batched by the VulkanUploadManager registered with SetUploadManager , a loader thread can bind
+// a manager of its own with BindThreadUploadManager to stream through the transfer queue .
+// Samplers , descriptor set layouts and pipeline layouts come from the object cache and are owned by the device .
 class VulkanDevice
 {
 public:
@@ -28,12 +51,62 @@ private:
 
 	std::vector<VkQueueFamilyProperties> queue_family_properties_;
 	std::vector<std::string> supported_extensions_name_;
-	VkCommandPool command_pool_;
+
+	struct FrameCommandPool
+	{
+		uint32_t queue_family;
+		int frame_index;
+		VkCommandPool pool;
+		// primary and secondary .
+		std::vector<VkCommandBuffer> command_buffers[2];
+		size_t used[2];
+	};
+
+	struct ThreadCommandPools
+	{
+		VkCommandPool pool;
+		std::vector<FrameCommandPool> frame_pools;
+		// command buffers of pool destroyed by other threads , freed by the owner .
+		std::mutex pending_free_mutex;
+		std::vector<VkCommandBuffer> pending_frees;
+	};
+
+	struct QueueLock
+	{
+		VkQueue queue;
+		std::mutex mutex;
+	};
+
+	// a thread only touches its own entry , the mutex guards the list and new frame pools .
+	std::vector<std::unique_ptr<ThreadCommandPools>> thread_pools_;
+	std::mutex thread_pools_mutex_;
+	// the pools of the command buffers allocated by CreateCommandBuffer .
+	std::unordered_map<VkCommandBuffer, ThreadCommandPools*> command_buffer_owners_;
+	std::mutex command_buffer_owners_mutex_;
+	// one per created queue , filled when the device is created and not changed afterwards .
+	std::vector<std::unique_ptr<QueueLock>> queue_locks_;
+	uint64_t device_id_;
+
+	VulkanMemoryAllocator * memory_allocator_ = NULL;
+	VulkanObjectCache * object_cache_ = NULL;
+	VulkanUploadManager * upload_manager_ = NULL;
+	VulkanDescriptorAllocator * descriptor_allocator_ = NULL;
+	VulkanDeletionQueue * deletion_queue_ = NULL;
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR get_memory_properties2_ = NULL;
+	PFN_vkCmdDrawIndexedIndirectCountKHR draw_indexed_indirect_count_ = NULL;
+
+	struct ThreadUploadBinding
+	{
+		uint64_t device_id;
+		VulkanUploadManager * upload_manager;
+	};
 
 public:
 	VulkanDevice(const VkPhysicalDevice physical_device)
 	{
 		this->physical_device_ = physical_device;
+		static std::atomic<uint64_t> deviceCount(0);
+		device_id_ = ++deviceCount;
 
 		vkGetPhysicalDeviceProperties(physical_device_, &device_properties_);
 		vkGetPhysicalDeviceFeatures(physical_device_, &device_features_);
@@ -65,6 +138,18 @@ public:
 
 	int GetQueueFamilyIndex(VkQueueFlagBits queue_flag)
 	{
+		// a family doing nothing but copies runs on the dma engines , next to the graphics and the compute work .
+		if ((queue_flag & VK_QUEUE_TRANSFER_BIT) == VK_QUEUE_TRANSFER_BIT)
+		{
+			for (int i = 0; i < queue_family_properties_.size(); i++)
+			{
+				if ((queue_family_properties_[i].queueFlags & queue_flag) && (queue_family_properties_[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0)
+				{
+					return i;
+				}
+			}
+		}
+
 		if ((queue_flag & VK_QUEUE_COMPUTE_BIT) == VK_QUEUE_COMPUTE_BIT ||
 			(queue_flag & VK_QUEUE_TRANSFER_BIT) == VK_QUEUE_TRANSFER_BIT)
 		{
@@ -153,12 +238,16 @@ public:
 			throw "create device error . ";
 		}
 
+		for (auto & queueCreateInfo : device_queue_create_infos)
+		{
+			std::unique_ptr<QueueLock> queueLock(new QueueLock());
+			vkGetDeviceQueue(logical_device_, queueCreateInfo.queueFamilyIndex, 0, &queueLock->queue);
+			queue_locks_.push_back(std::move(queueLock));
+		}
+
 		device_enabled_features = physical_device_features;
-		VkCommandPoolCreateInfo command_pool_create_info = {};
-		command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		command_pool_create_info.queueFamilyIndex = QueueFamilyIndices.graphics;
-		command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-		vkCreateCommandPool(logical_device_, &command_pool_create_info, NULL, &command_pool_);
+		memory_allocator_ = new VulkanMemoryAllocator(logical_device_, device_memory_properties_, device_properties_.limits);
+		object_cache_ = new VulkanObjectCache(logical_device_);
 	}
 
 	bool SupportExtension(std::string extension_name)
@@ -176,13 +265,36 @@ public:
 		return logical_device_;
 	}
 
+	const VkPhysicalDeviceFeatures & GetFeatures() const
+	{
+		return device_features_;
+	}
+
+	const VkPhysicalDeviceFeatures & GetEnabledFeatures() const
+	{
+		return device_enabled_features;
+	}
+
+	const VkPhysicalDeviceProperties & GetProperties() const
+	{
+		return device_properties_;
+	}
+
+	const VkQueueFamilyProperties & GetQueueFamilyProperties(uint32_t queue_family_index) const
+	{
+		return queue_family_properties_[queue_family_index];
+	}
+
 	void CreateCommandBuffer(int size, VkCommandBufferLevel command_buffer_level, VkCommandBuffer * dst)
 	{
+		ThreadCommandPools * pools = GetThreadCommandPools();
+		FreePendingCommandBuffers(pools);
+
 		VkCommandBufferAllocateInfo alloc_info;
 		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		alloc_info.pNext = NULL;
 		alloc_info.level = command_buffer_level;
-		alloc_info.commandPool = command_pool_;
+		alloc_info.commandPool = pools->pool;
 		alloc_info.commandBufferCount = size;
 
 		VkResult res = vkAllocateCommandBuffers(logical_device_, &alloc_info, dst);
@@ -190,12 +302,148 @@ public:
 		{
 			throw " allocate command buffer fault . ";
 		}
+		std::lock_guard<std::mutex> lock(command_buffer_owners_mutex_);
+		for (int i = 0; i < size; i++) command_buffer_owners_[dst[i]] = pools;
+	}
+
+	VkCommandPool CreateCommandPool(uint32_t queue_family_index, VkCommandPoolCreateFlags flags)
+	{
+		VkCommandPoolCreateInfo command_pool_create_info = {};
+		command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		command_pool_create_info.queueFamilyIndex = queue_family_index;
+		command_pool_create_info.flags = flags;
+
+		VkCommandPool command_pool;
+		VkResult res = vkCreateCommandPool(logical_device_, &command_pool_create_info, NULL, &command_pool);
+		if (res != VK_SUCCESS)
+		{
+			throw " create command pool fault . ";
+		}
+		return command_pool;
 	}
 
+	void CreateCommandBuffer(VkCommandPool command_pool, int size, VkCommandBufferLevel command_buffer_level, VkCommandBuffer * dst)
+	{
+		VkCommandBufferAllocateInfo alloc_info;
+		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		alloc_info.pNext = NULL;
+		alloc_info.level = command_buffer_level;
+		alloc_info.commandPool = command_pool;
+		alloc_info.commandBufferCount = size;
+
+		VkResult res = vkAllocateCommandBuffers(logical_device_, &alloc_info, dst);
+		if (res != VK_SUCCESS)
+		{
+			throw " allocate command buffer fault . ";
+		}
+	}
+
+	// command buffers of CreateCommandBuffer , they must not be pending on a queue any more .
 	void DestroyCommandBuffer(VkCommandBuffer *commandBuffer, int size)
 	{
-		vkFreeCommandBuffers(logical_device_, command_pool_, size, commandBuffer
-		);
+		ThreadCommandPools * pools = GetThreadCommandPools();
+		for (int i = 0; i < size; i++)
+		{
+			if (commandBuffer[i] == VK_NULL_HANDLE) continue;
+			ThreadCommandPools * owner;
+			{
+				std::lock_guard<std::mutex> lock(command_buffer_owners_mutex_);
+				auto it = command_buffer_owners_.find(commandBuffer[i]);
+				if (it == command_buffer_owners_.end())
+				{
+					throw " the command buffer was not created by CreateCommandBuffer . ";
+				}
+				owner = it->second;
+				command_buffer_owners_.erase(it);
+			}
+			if (owner == pools)
+			{
+				vkFreeCommandBuffers(logical_device_, owner->pool, 1, &commandBuffer[i]);
+			}
+			else
+			{
+				// the pool of another thread may be recording right now , its owner frees the buffer .
+				std::lock_guard<std::mutex> lock(owner->pending_free_mutex);
+				owner->pending_frees.push_back(commandBuffer[i]);
+			}
+		}
+		FreePendingCommandBuffers(pools);
+	}
+
+	// valid until ResetFrameCommandPools is called with the same frame index , begin it as a one time submit .
+	VkCommandBuffer AllocateFrameCommandBuffer(uint32_t queue_family_index, int frame_index, VkCommandBufferLevel command_buffer_level = VK_COMMAND_BUFFER_LEVEL_PRIMARY)
+	{
+		ThreadCommandPools * pools = GetThreadCommandPools();
+		FrameCommandPool * frame_pool = NULL;
+		for (auto & pool : pools->frame_pools)
+		{
+			if (pool.queue_family == queue_family_index && pool.frame_index == frame_index)
+			{
+				frame_pool = &pool;
+				break;
+			}
+		}
+		if (frame_pool == NULL)
+		{
+			FrameCommandPool pool = {};
+			pool.queue_family = queue_family_index;
+			pool.frame_index = frame_index;
+			pool.pool = CreateCommandPool(queue_family_index, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+			std::lock_guard<std::mutex> lock(thread_pools_mutex_);
+			pools->frame_pools.push_back(pool);
+			frame_pool = &pools->frame_pools.back();
+		}
+
+		int level = command_buffer_level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? 0 : 1;
+		std::vector<VkCommandBuffer> & command_buffers = frame_pool->command_buffers[level];
+		if (frame_pool->used[level] == command_buffers.size())
+		{
+			VkCommandBuffer command_buffer;
+			CreateCommandBuffer(frame_pool->pool, 1, command_buffer_level, &command_buffer);
+			command_buffers.push_back(command_buffer);
+		}
+		return command_buffers[frame_pool->used[level]++];
+	}
+
+	// no thread may allocate or record frame command buffers of this frame index meanwhile .
+	void ResetFrameCommandPools(int frame_index)
+	{
+		std::lock_guard<std::mutex> lock(thread_pools_mutex_);
+		for (auto & pools : thread_pools_)
+		{
+			for (auto & pool : pools->frame_pools)
+			{
+				if (pool.frame_index != frame_index) continue;
+				VkResult res = vkResetCommandPool(logical_device_, pool.pool, 0);
+				if (res != VK_SUCCESS)
+				{
+					throw " reset command pool fault . ";
+				}
+				pool.used[0] = pool.used[1] = 0;
+			}
+		}
+	}
+
+	VkResult QueueSubmit(VkQueue queue, uint32_t submit_count, const VkSubmitInfo * submits, VkFence fence)
+	{
+		std::lock_guard<std::mutex> lock(GetQueueMutex(queue));
+		return vkQueueSubmit(queue, submit_count, submits, fence);
+	}
+
+	VkResult QueueWaitIdle(VkQueue queue)
+	{
+		std::lock_guard<std::mutex> lock(GetQueueMutex(queue));
+		return vkQueueWaitIdle(queue);
+	}
+
+	// held around operations on queue that do not go through QueueSubmit , like presenting .
+	std::mutex & GetQueueMutex(VkQueue queue)
+	{
+		for (auto & queueLock : queue_locks_)
+		{
+			if (queueLock->queue == queue) return queueLock->mutex;
+		}
+		throw " the queue was not created by this device . ";
 	}
 
 	uint32_t GetMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, VkBool32 *memTypeFound = nullptr)
@@ -227,16 +475,32 @@ public:
 		}
 	}
 
-	VulkanBuffer* CreateVulkanBuffer(VkBufferUsageFlags usage_bits, VkMemoryPropertyFlags memory_property, uint32_t buffer_size, void * data = NULL)
+	// concurrent buffers are shared by the graphics , compute and transfer families without ownership transfers .
+	VulkanBuffer* CreateVulkanBuffer(VkBufferUsageFlags usage_bits, VkMemoryPropertyFlags memory_property, uint32_t buffer_size, MemoryCategory category, void * data = NULL, bool concurrent = false)
 	{
+		uint32_t queue_family_indices[3] = { GetGraphicsQueue() };
+		uint32_t queue_family_count = 1;
+		uint32_t other_families[] = { GetComputeQueue() , GetTransferQueue() };
+		for (uint32_t family : other_families)
+		{
+			if (std::find(queue_family_indices, queue_family_indices + queue_family_count, family) == queue_family_indices + queue_family_count)
+			{
+				queue_family_indices[queue_family_count++] = family;
+			}
+		}
 		VkBufferCreateInfo buffer_create_info = {};
 		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		buffer_create_info.size = buffer_size;
 		buffer_create_info.usage = usage_bits;
+		if (concurrent && queue_family_count > 1)
+		{
+			buffer_create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			buffer_create_info.queueFamilyIndexCount = queue_family_count;
+			buffer_create_info.pQueueFamilyIndices = queue_family_indices;
+		}
 
 		VkBuffer buffer;
-		VkDeviceMemory memory;
 		VkResult res;
 		res = vkCreateBuffer(logical_device_, &buffer_create_info, NULL, &buffer);
 		if (res != VK_SUCCESS)
@@ -246,44 +510,182 @@ public:
 
 		VkMemoryRequirements memory_require;
 		vkGetBufferMemoryRequirements(logical_device_, buffer, &memory_require);
-		VkMemoryAllocateInfo memory_alloc_info = {};
-		memory_alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memory_alloc_info.allocationSize = memory_require.size;
-		memory_alloc_info.memoryTypeIndex = GetMemoryType(memory_require.memoryTypeBits, memory_property);
-		res = vkAllocateMemory(logical_device_, &memory_alloc_info, NULL, &memory);
+		VulkanAllocation allocation = AllocateMemory(memory_require, memory_property, false, category);
+		res = vkBindBufferMemory(logical_device_, buffer, allocation.memory, allocation.offset);
 		if (res != VK_SUCCESS)
 		{
-			throw " allocate memory fault . ";
+			throw " bind buffer memory fault . ";
 		}
 
 		if (data != nullptr)
 		{
-			void * mapped_memory;
-			vkMapMemory(logical_device_, memory, 0, buffer_size, 0, &mapped_memory);
-			memcpy(mapped_memory, data, buffer_size);
-
-			if ((memory_property & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT == 0))
+			if (allocation.mapped == NULL)
 			{
-				VkMappedMemoryRange memoryRange = {};
-				memoryRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-				memoryRange.size = buffer_size;
-				memoryRange.offset = 0;
-				memoryRange.memory = memory;
-				vkFlushMappedMemoryRanges(logical_device_, 1, &memoryRange);
+				throw " the memory of the buffer is not host visible . ";
 			}
-
-			vkUnmapMemory(logical_device_, memory);
+			memcpy(allocation.mapped, data, buffer_size);
+			memory_allocator_->Flush(allocation, 0, buffer_size);
 		}
 
-		res = vkBindBufferMemory(logical_device_, buffer, memory, 0);
+		VulkanBuffer * vulkan_buffer = new VulkanBuffer(buffer, allocation, memory_allocator_, logical_device_, buffer_create_info.sharingMode == VK_SHARING_MODE_CONCURRENT);
+
+		return vulkan_buffer;
+	}
+
+	// optimal is true for images with optimal tiling , they are kept apart from buffers and linear images .
+	VulkanAllocation AllocateMemory(const VkMemoryRequirements & memory_require, VkMemoryPropertyFlags memory_property, bool optimal, MemoryCategory category)
+	{
+		uint32_t memory_type = GetMemoryType(memory_require.memoryTypeBits, memory_property);
+		return memory_allocator_->Allocate(memory_type, memory_require, optimal, category);
+	}
+
+	void FreeMemory(VulkanAllocation & allocation)
+	{
+		memory_allocator_->Free(allocation);
+	}
+
+	VulkanAllocation AllocateImageMemory(VkImage image, VkMemoryPropertyFlags memory_property, MemoryCategory category)
+	{
+		VkMemoryRequirements memory_require;
+		vkGetImageMemoryRequirements(logical_device_, image, &memory_require);
+		VulkanAllocation allocation = AllocateMemory(memory_require, memory_property, true, category);
+		VkResult res = vkBindImageMemory(logical_device_, image, allocation.memory, allocation.offset);
 		if (res != VK_SUCCESS)
 		{
-			throw " bind buffer memory fault . ";
+			throw " bind image memory fault . ";
 		}
+		return allocation;
+	}
 
-		VulkanBuffer * vulkan_buffer = new VulkanBuffer(buffer, memory, logical_device_);
+	VulkanMemoryAllocator * GetMemoryAllocator() const
+	{
+		return memory_allocator_;
+	}
 
-		return vulkan_buffer;
+	VkSampler GetSampler(const VkSamplerCreateInfo & create_info)
+	{
+		return object_cache_->GetSampler(create_info);
+	}
+
+	VkDescriptorSetLayout GetDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo & create_info)
+	{
+		return object_cache_->GetDescriptorSetLayout(create_info);
+	}
+
+	VkPipelineLayout GetPipelineLayout(const VkPipelineLayoutCreateInfo & create_info)
+	{
+		return object_cache_->GetPipelineLayout(create_info);
+	}
+
+	VulkanObjectCache * GetObjectCache() const
+	{
+		return object_cache_;
+	}
+
+	// needs VK_EXT_memory_budget enabled on the device , the entry point comes from the instance .
+	void EnableMemoryBudget(PFN_vkGetPhysicalDeviceMemoryProperties2KHR get_memory_properties2)
+	{
+		get_memory_properties2_ = get_memory_properties2;
+	}
+
+	bool HasMemoryBudget() const
+	{
+		return get_memory_properties2_ != NULL;
+	}
+
+	// needs VK_KHR_draw_indirect_count enabled on the device .
+	void EnableDrawIndirectCount(PFN_vkCmdDrawIndexedIndirectCountKHR draw_indexed_indirect_count)
+	{
+		draw_indexed_indirect_count_ = draw_indexed_indirect_count;
+	}
+
+	bool HasDrawIndirectCount() const
+	{
+		return draw_indexed_indirect_count_ != NULL;
+	}
+
+	void CmdDrawIndexedIndirectCount(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer count_buffer, VkDeviceSize count_offset, uint32_t max_draw_count, uint32_t stride) const
+	{
+		draw_indexed_indirect_count_(command_buffer, buffer, offset, count_buffer, count_offset, max_draw_count, stride);
+	}
+
+	// the budget is queried every call , it changes with the other processes using the device .
+	void GetHeapStats(std::vector<VulkanHeapStats> & heap_stats)
+	{
+		heap_stats.resize(memory_allocator_->GetMemoryHeapCount());
+		for (uint32_t i = 0; i < heap_stats.size(); i++)
+		{
+			heap_stats[i] = memory_allocator_->GetHeapStats(i);
+		}
+		if (get_memory_properties2_ == NULL) return;
+
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = {};
+		budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+		VkPhysicalDeviceMemoryProperties2KHR memory_properties2 = {};
+		memory_properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+		memory_properties2.pNext = &budget_properties;
+		get_memory_properties2_(physical_device_, &memory_properties2);
+		for (uint32_t i = 0; i < heap_stats.size(); i++)
+		{
+			heap_stats[i].budget_usage_bytes = budget_properties.heapUsage[i];
+			heap_stats[i].budget_bytes = budget_properties.heapBudget[i];
+		}
+	}
+
+	// the manager needs a queue , it is created by the owner of the queues and not owned by the device .
+	void SetUploadManager(VulkanUploadManager * upload_manager)
+	{
+		upload_manager_ = upload_manager;
+	}
+
+	// shared descriptor pools of materials , created by the owner of the frame loop which advances its frames .
+	void SetDescriptorAllocator(VulkanDescriptorAllocator * descriptor_allocator)
+	{
+		descriptor_allocator_ = descriptor_allocator;
+	}
+
+	VulkanDescriptorAllocator * GetDescriptorAllocator() const
+	{
+		if (descriptor_allocator_ == NULL)
+		{
+			throw " no descriptor allocator registered . ";
+		}
+		return descriptor_allocator_;
+	}
+
+	// resources that frames in flight may still use are released through it , advanced by the frame loop as well .
+	void SetDeletionQueue(VulkanDeletionQueue * deletion_queue)
+	{
+		deletion_queue_ = deletion_queue;
+	}
+
+	VulkanDeletionQueue * GetDeletionQueue() const
+	{
+		if (deletion_queue_ == NULL)
+		{
+			throw " no deletion queue registered . ";
+		}
+		return deletion_queue_;
+	}
+
+	// uploads recorded on the calling thread go through upload_manager from now on , NULL restores the registered one .
+	void BindThreadUploadManager(VulkanUploadManager * upload_manager)
+	{
+		GetThreadUploadBinding() = { device_id_ , upload_manager };
+	}
+
+	VulkanUploadManager * GetUploadManager() const
+	{
+		const ThreadUploadBinding & binding = GetThreadUploadBinding();
+		if (binding.device_id == device_id_ && binding.upload_manager != NULL)
+		{
+			return binding.upload_manager;
+		}
+		if (upload_manager_ == NULL)
+		{
+			throw " no upload manager registered . ";
+		}
+		return upload_manager_;
 	}
 
 	VkShaderModule LoadShader(std::string file_name)
@@ -319,10 +721,69 @@ public:
 		return shader_module;
 	}
 
+	~VulkanDevice()
+	{
+		for (auto & pools : thread_pools_)
+		{
+			vkDestroyCommandPool(logical_device_, pools->pool, NULL);
+			for (auto & pool : pools->frame_pools)
+			{
+				vkDestroyCommandPool(logical_device_, pool.pool, NULL);
+			}
+		}
+		delete object_cache_;
+		delete memory_allocator_;
+	}
+
 	uint32_t GetGraphicsQueue() const
 	{
 		return QueueFamilyIndices.graphics;
 	}
+
+	// the graphics family when the compute family was not requested .
+	uint32_t GetComputeQueue() const
+	{
+		return QueueFamilyIndices.compute != (uint32_t)-1 ? QueueFamilyIndices.compute : QueueFamilyIndices.graphics;
+	}
+
+	// the graphics family when the transfer family was not requested .
+	uint32_t GetTransferQueue() const
+	{
+		return QueueFamilyIndices.transfer != (uint32_t)-1 ? QueueFamilyIndices.transfer : QueueFamilyIndices.graphics;
+	}
+
+private:
+	// called by the owning thread only , nothing else records into its pool meanwhile .
+	void FreePendingCommandBuffers(ThreadCommandPools * pools)
+	{
+		std::lock_guard<std::mutex> lock(pools->pending_free_mutex);
+		if (pools->pending_frees.size() == 0) return;
+		vkFreeCommandBuffers(logical_device_, pools->pool, pools->pending_frees.size(), pools->pending_frees.data());
+		pools->pending_frees.clear();
+	}
+
+	static ThreadUploadBinding & GetThreadUploadBinding()
+	{
+		static thread_local ThreadUploadBinding binding = { 0 , NULL };
+		return binding;
+	}
+
+	// the lookup is a thread local compare , the mutex is only taken the first time a thread allocates .
+	ThreadCommandPools * GetThreadCommandPools()
+	{
+		static thread_local uint64_t owner_id = 0;
+		static thread_local ThreadCommandPools * owner_pools = NULL;
+		if (owner_id != device_id_)
+		{
+			std::unique_ptr<ThreadCommandPools> pools(new ThreadCommandPools());
+			pools->pool = CreateCommandPool(QueueFamilyIndices.graphics, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+			owner_pools = pools.get();
+			owner_id = device_id_;
+			std::lock_guard<std::mutex> lock(thread_pools_mutex_);
+			thread_pools_.push_back(std::move(pools));
+		}
+		return owner_pools;
+	}
 };
 
 #endif 
\ No newline at end of file
@@ -8,16 +8,17 @@ void VulkanEditor::OnUpdateImgui( )
 	{
 		for (int i = 0; i < object_count; i++)
 		{
-			std::string name = std::to_string(objects_[i]->object_entry_.ind) + " " + objects_[i]->object_entry_.name;
-			if (ImGui::TreeNode(name.c_str()))
+			char name[128];
+			snprintf(name, sizeof(name), "%d %s", objects_[i]->object_entry_.ind, objects_[i]->object_entry_.name.c_str());
+			if (ImGui::TreeNode(name))
 			{
 				float position[3] = { objects_[i]->object_entry_.position.x , objects_[i]->object_entry_.position.y , objects_[i]->object_entry_.position.z };
 				float rotation[3] = { objects_[i]->object_entry_.rotation.x , objects_[i]->object_entry_.rotation.y , objects_[i]->object_entry_.rotation.z };
 				float scale[3] = { objects_[i]->object_entry_.scale.x , objects_[i]->object_entry_.scale.y , objects_[i]->object_entry_.scale.z };
 
-				ImGui::DragFloat3("position", position , 0.01f);
-				ImGui::DragFloat3("rotation", rotation , 0.01f );
-				ImGui::DragFloat3("scale", scale , 0.01f);
+				bool changed = ImGui::DragFloat3("position", position , 0.01f);
+				changed |= ImGui::DragFloat3("rotation", rotation , 0.01f );
+				changed |= ImGui::DragFloat3("scale", scale , 0.01f);
 
 				objects_[i]->object_entry_.position.x = position[0]; objects_[i]->object_entry_.position.y = position[1]; objects_[i]->object_entry_.position.z = position[2];
 				objects_[i]->object_entry_.rotation.x = rotation[0]; objects_[i]->object_entry_.rotation.y = rotation[1]; objects_[i]->object_entry_.rotation.z = rotation[2];
@@ -37,6 +38,7 @@ void VulkanEditor::OnUpdateImgui( )
 					}
 					ImGui::EndCombo();
 				}
+				changed |= objects_[i]->object_entry_.meshIndex != mesh_item_current - mesh_items;
 				objects_[i]->object_entry_.meshIndex = mesh_item_current - mesh_items;
 
 				const char* pipeline_items[] = { "No Pipeline" , "Forward Plus Pipeline" , "PBR Forward Pipeline" };
@@ -53,7 +55,9 @@ void VulkanEditor::OnUpdateImgui( )
 					}
 					ImGui::EndCombo();
 				}
+				changed |= objects_[i]->object_entry_.pipelineType != pipeline_item_current - pipeline_items;
 				objects_[i]->object_entry_.pipelineType = (PipelineType)(pipeline_item_current - pipeline_items);
+				if (changed) objects_[i]->MarkDirty();
 				objects_[i]->UpdateImguI();
 				ImGui::Button("Locate Object");
 				ImGui::TreePop();
@@ -65,6 +69,61 @@ void VulkanEditor::OnUpdateImgui( )
 	{
 		AddNewEmptyObject();
 	}
+	UpdateMemoryImgui();
+}
+
+// live totals of the allocator , a category over its budget is drawn red .
+void VulkanEditor::UpdateMemoryImgui()
+{
+	if (!ImGui::CollapsingHeader("GPU Memory")) return;
+	const float mb = 1.0f / (1024.0f * 1024.0f);
+	VulkanMemoryAllocator * allocator = RenderResource.vulkanDevice->GetMemoryAllocator();
+	for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+	{
+		MemoryCategory category = (MemoryCategory)i;
+		VulkanCategoryStats stats = allocator->GetCategoryStats(category);
+		ImVec4 color = allocator->IsOverBudget(category) ? ImVec4(1.0f, 0.3f, 0.3f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+		if (stats.budget_bytes != 0)
+		{
+			ImGui::TextColored(color, "%-14s %8.1f / %.1f MB  %u", GetMemoryCategoryName(category), stats.used_bytes * mb, stats.budget_bytes * mb, stats.allocation_count);
+		}
+		else
+		{
+			ImGui::TextColored(color, "%-14s %8.1f MB  %u", GetMemoryCategoryName(category), stats.used_bytes * mb, stats.allocation_count);
+		}
+	}
+
+	// the budgets in MB , 0 disables the one of the category .
+	if (ImGui::TreeNode("budgets"))
+	{
+		for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+		{
+			MemoryCategory category = (MemoryCategory)i;
+			float budgetMB = allocator->GetCategoryStats(category).budget_bytes * mb;
+			if (ImGui::DragFloat(GetMemoryCategoryName(category), &budgetMB, 1.0f, 0.0f, 65536.0f, "%.0f MB"))
+			{
+				allocator->SetCategoryBudget(category, (VkDeviceSize)((double)budgetMB * 1024.0 * 1024.0));
+			}
+		}
+		ImGui::TreePop();
+	}
+
+	ImGui::Separator();
+	RenderResource.vulkanDevice->GetHeapStats(heap_stats_);
+	for (size_t i = 0; i < heap_stats_.size(); i++)
+	{
+		const VulkanHeapStats & heap = heap_stats_[i];
+		ImGui::Text("heap %d %s  used %.1f  allocated %.1f  size %.1f MB", (int)i, heap.device_local ? "device" : "host",
+			heap.used_bytes * mb, heap.allocated_bytes * mb, heap.heap_size * mb);
+		if (RenderResource.vulkanDevice->HasMemoryBudget())
+		{
+			ImGui::Text("  process usage %.1f  budget %.1f MB", heap.budget_usage_bytes * mb, heap.budget_bytes * mb);
+		}
+	}
+	if (!RenderResource.vulkanDevice->HasMemoryBudget())
+	{
+		ImGui::TextUnformatted("VK_EXT_memory_budget is not supported .");
+	}
 }
 
 void VulkanEditor::MouseEvent(const MouseStateType & mouseState)
@@ -76,7 +135,7 @@ void VulkanEditor::MouseEvent(const MouseStateType & mouseState)
 
 		if (PushConstantData.axisIndex == 0)
 		{
-			VulkanBuffer *stagingBuffer = RenderResource.vulkanDevice->CreateVulkanBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, RenderResource.axisIndexAttachmentImage->image_size_);
+			VulkanBuffer *stagingBuffer = RenderResource.vulkanDevice->CreateVulkanBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, RenderResource.axisIndexAttachmentImage->image_size_, MEMORY_CATEGORY_STAGING);
 			RenderResource.axisIndexAttachmentImage->MapMemory(RenderResource.commandQueue, stagingBuffer);
 			stagingBuffer->Map();
 			int * axisIndexData = (int*)stagingBuffer->GetMappedMemory();
@@ -127,11 +186,9 @@ void VulkanEditor::AddNewEmptyObject()
 
 void VulkanEditor::UpdateEditAxis( int commandBufferInd )
 {
-	std::vector<VkClearValue> clearValues;
 	VkClearValue clear;
 	clear.color = { 0 , 0 , 0 , 0 };
-	clearValues.push_back(clear);
-	clearValues.push_back(clear);
+	VkClearValue clearValues[] = { clear , clear };
 	VkBuffer vertBuffer = RenderResource.vertexBuffer->GetDesc().buffer;
 	VkDeviceSize offset = 0;
 	RenderResource.axisRenderCommandBufferVec.resize(RenderResource.swapChain->GetImageCount());
@@ -141,6 +198,7 @@ void VulkanEditor::UpdateEditAxis( int commandBufferInd )
 	vkBeginCommandBuffer(RenderResource.axisRenderCommandBufferVec[commandBufferInd], &commandBufferBeginInfo);
 	vkCmdPushConstants(RenderResource.axisRenderCommandBufferVec[commandBufferInd], RenderResource.axisRenderPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstantData), &PushConstantData);
 	vkCmdPushConstants(RenderResource.axisRenderCommandBufferVec[commandBufferInd], RenderResource.axisRenderPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData), &PushConstantData);
+	int scope = gpu_profiler_ ? gpu_profiler_->BeginScope(RenderResource.axisRenderCommandBufferVec[commandBufferInd], axis_scope_) : -1;
 	vkCmdBeginRenderPass(RenderResource.axisRenderCommandBufferVec[commandBufferInd], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 	VkViewport viewport = VulkanInitializer::InitViewport(editor_x_, editor_y_, editor_width_, editor_height_, 0.0f, 1.0f);
@@ -154,6 +212,7 @@ void VulkanEditor::UpdateEditAxis( int commandBufferInd )
 	vkCmdBindPipeline(RenderResource.axisRenderCommandBufferVec[commandBufferInd], VK_PIPELINE_BIND_POINT_GRAPHICS, RenderResource.axisRenderPipeline);
 	vkCmdDrawIndexed(RenderResource.axisRenderCommandBufferVec[commandBufferInd], 6, 1, 0, 0, 0);
 	vkCmdEndRenderPass(RenderResource.axisRenderCommandBufferVec[commandBufferInd]);
+	if (gpu_profiler_) gpu_profiler_->EndScope(RenderResource.axisRenderCommandBufferVec[commandBufferInd], scope);
 	vkEndCommandBuffer(RenderResource.axisRenderCommandBufferVec[commandBufferInd]);
 
 
@@ -176,10 +235,10 @@ void VulkanEditor::PrepareEditUIPass(   )
 		descriptorBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
 		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = VulkanInitializer::InitDescSetLayoutCreateInfo(1, &descriptorBinding);
-		VULKAN_SUCCESS(vkCreateDescriptorSetLayout(RenderResource.vulkanDevice->GetDevice(), &descriptorSetLayoutCreateInfo, NULL, &RenderResource.axisRenderDescriptorSetLayout));
+		RenderResource.axisRenderDescriptorSetLayout = RenderResource.vulkanDevice->GetDescriptorSetLayout(descriptorSetLayoutCreateInfo);
 
 		VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(constRange.size() , constRange.data(), 1, &RenderResource.axisRenderDescriptorSetLayout);
-		VULKAN_SUCCESS(vkCreatePipelineLayout(RenderResource.vulkanDevice->GetDevice(), &pipelineLayout, NULL, &RenderResource.axisRenderPipelineLayout));
+		RenderResource.axisRenderPipelineLayout = RenderResource.vulkanDevice->GetPipelineLayout(pipelineLayout);
 
 		RenderResource.axisIndexAttachmentImage = new VulkanImage(
 			RenderResource.vulkanDevice,
@@ -188,7 +247,11 @@ void VulkanEditor::PrepareEditUIPass(   )
 			VK_IMAGE_LAYOUT_UNDEFINED ,
 			screen_width_,
 			screen_height_,
-			VK_IMAGE_ASPECT_COLOR_BIT
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			1,
+			1,
+			false,
+			MEMORY_CATEGORY_UI
 		);
 
 		RenderResource.axisImage = new Texture2D(
@@ -197,7 +260,7 @@ void VulkanEditor::PrepareEditUIPass(   )
 		VkImageView attachments[2] = { {} , RenderResource.axisIndexAttachmentImage->image_view_ };
 
 		std::vector<VkAttachmentDescription> attachmentsDesc;
-		attachmentsDesc.push_back(VulkanInitializer::InitAttachmentDescription(RenderResource.swapChain->GetColorFormat(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_ATTACHMENT_LOAD_OP_LOAD , VK_ATTACHMENT_STORE_OP_STORE));
+		attachmentsDesc.push_back(VulkanInitializer::InitAttachmentDescription(RenderResource.swapChain->GetColorFormat(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, RenderResource.swapChain->GetPresentLayout(), VK_ATTACHMENT_LOAD_OP_LOAD , VK_ATTACHMENT_STORE_OP_STORE));
 		attachmentsDesc.push_back(VulkanInitializer::InitAttachmentDescription(RenderResource.axisIndexAttachmentImage->image_format_, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE));
 
 		std::vector<VkAttachmentReference> attachmentReference;
@@ -281,11 +344,11 @@ void VulkanEditor::PrepareEditUIPass(   )
 
 		RenderResource.vertexBuffer = RenderResource.vulkanDevice->CreateVulkanBuffer( 
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT , sizeof(verts) , verts ) ;
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT , sizeof(verts) , MEMORY_CATEGORY_UI , verts ) ;
 
 		RenderResource.indexBuffer = RenderResource.vulkanDevice->CreateVulkanBuffer(
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, sizeof(indices), indices);
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, sizeof(indices), MEMORY_CATEGORY_UI, indices);
 	};
 
 	auto buildCommandBuffer = [&]() -> void
@@ -9,6 +9,7 @@
 #include "VulkanSwapChain.hpp"
 #include "VulkanMaterial.h"
 #include "VulkanObject.h"
+#include "VulkanGpuProfiler.h"
 
 
 
@@ -37,6 +38,7 @@ public:
 
 public:
 	void OnUpdateImgui();
+	void UpdateMemoryImgui();
 	void MouseEvent( const MouseStateType & mouseState );
 
 	void AddNewEmptyObject();	
@@ -45,8 +47,18 @@ public:
 
 	VkCommandBuffer GetCommandBuffer(int index) const;
 
+	void SetGpuProfiler(VulkanGpuProfiler * profiler)
+	{
+		gpu_profiler_ = profiler;
+		axis_scope_ = profiler ? profiler->RegisterScope("editor axis") : -1;
+	}
+
 private:
 	std::vector<VulkanObject*> & objects_;
+	VulkanGpuProfiler * gpu_profiler_ = NULL;
+	int axis_scope_ = -1;
+	// filled by the memory panel every frame .
+	std::vector<VulkanHeapStats> heap_stats_;
 
 	struct
 	{
@@ -0,0 +1,79 @@
+#ifndef _VULKAN_FRAME_ARENA_H_
+#define _VULKAN_FRAME_ARENA_H_
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <algorithm>
+
+// Linear allocator for data that lives until the end of a frame , Reset hands everything back at once .
+// Memory comes in blocks that are kept across Reset , once the arena has grown to what a frame needs it stops
+// allocating . Destructors are not run by the arena , objects with one have to be destroyed by their user .
+// Not thread safe .
+class VulkanFrameArena
+{
+	struct Block
+	{
+		char * data;
+		size_t size;
+	};
+
+public:
+	VulkanFrameArena(size_t blockSize) : block_size_(blockSize)
+	{
+	}
+
+	~VulkanFrameArena()
+	{
+		for (auto & block : blocks_) delete[] block.data;
+	}
+
+public:
+	// alignment has to be a power of two no larger than the alignment of operator new .
+	void * Allocate(size_t size, size_t alignment)
+	{
+		while (current_ < blocks_.size())
+		{
+			Block & block = blocks_[current_];
+			size_t begin = (head_ + alignment - 1) & ~(alignment - 1);
+			if (begin + size <= block.size)
+			{
+				head_ = begin + size;
+				return block.data + begin;
+			}
+			current_++;
+			head_ = 0;
+		}
+		size_t blockSize = (std::max)(size, block_size_);
+		blocks_.push_back({ new char[blockSize] , blockSize });
+		head_ = size;
+		return blocks_.back().data;
+	}
+
+	template <class T, class... Args>
+	T * New(Args &&... args)
+	{
+		return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	void Reset()
+	{
+		current_ = 0;
+		head_ = 0;
+	}
+
+	size_t GetCapacity() const
+	{
+		size_t capacity = 0;
+		for (auto & block : blocks_) capacity += block.size;
+		return capacity;
+	}
+
+private:
+	std::vector<Block> blocks_;
+	size_t block_size_;
+	size_t current_ = 0;
+	size_t head_ = 0;
+};
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef _VULKAN_FRUSTUM_CULLING_H_
+#define _VULKAN_FRUSTUM_CULLING_H_
+
+#include <vector>
+#include "Utility.h"
+#include "VulkanMesh.h"
+
+// the widest instruction set the compiler targets , a batch tests FRUSTUM_CULL_LANES boxes against one frustum .
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULL_AVX
+#define FRUSTUM_CULL_LANES 8
+#define FRUSTUM_CULL_SIMD_NAME "avx"
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULL_SSE
+#define FRUSTUM_CULL_LANES 4
+#define FRUSTUM_CULL_SIMD_NAME "sse2"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FRUSTUM_CULL_NEON
+#define FRUSTUM_CULL_LANES 4
+#define FRUSTUM_CULL_SIMD_NAME "neon"
+#else
+#define FRUSTUM_CULL_LANES 4
+#define FRUSTUM_CULL_SIMD_NAME "scalar"
+#endif
+
+// the six planes of a view projection matrix , a point p is inside when dot(plane.xyz , p) + plane.w >= 0 for all of them .
+// the planes are not normalized , the sign of the test does not need it .
+struct VulkanFrustum
+{
+	glm::vec4 planes[6];
+	// abs of the plane normals , the distance of a box corner furthest along the normal is dot(absNormal , extent) .
+	glm::vec3 absNormals[6];
+
+	// clip space of the renderer , -w <= x , y <= w and 0 <= z <= w .
+	static VulkanFrustum FromMatrix(const glm::mat4 & projView)
+	{
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+		{
+			rows[i] = glm::vec4(projView[0][i], projView[1][i], projView[2][i], projView[3][i]);
+		}
+		VulkanFrustum frustum;
+		frustum.planes[0] = rows[3] + rows[0];
+		frustum.planes[1] = rows[3] - rows[0];
+		frustum.planes[2] = rows[3] + rows[1];
+		frustum.planes[3] = rows[3] - rows[1];
+		frustum.planes[4] = rows[2];
+		frustum.planes[5] = rows[3] - rows[2];
+		for (int i = 0; i < 6; i++)
+		{
+			frustum.absNormals[i] = glm::abs(glm::vec3(frustum.planes[i]));
+		}
+		return frustum;
+	}
+};
+
+// World space bounds of the draws of a pass , stored as structure of arrays of box centers and half extents so a batch
+// of boxes is tested against a plane with a few vector instructions . A box is outside the frustum when its corner
+// furthest along a plane normal is behind the plane , dot(n , center) + dot(abs(n) , extent) + w < 0 .
+// The arrays are padded to a multiple of FRUSTUM_CULL_LANES and keep their storage on Clear , a frame that adds no
+// more boxes than the last one does not allocate .
+class VulkanCullBounds
+{
+public:
+	void Clear()
+	{
+		count_ = 0;
+	}
+
+	// meshes without bounds are never culled .
+	void Add(const Model::Dimension & bounds, const glm::mat4 & model)
+	{
+		if (count_ == center_x_.size()) Grow();
+		if (bounds.min.x > bounds.max.x)
+		{
+			SetBox(count_, glm::vec3(0.0f), glm::vec3(FRUSTUM_CULL_UNBOUNDED_EXTENT));
+		}
+		else
+		{
+			Model::Dimension worldBounds = bounds.Transform(model);
+			SetBox(count_, (worldBounds.min + worldBounds.max) * 0.5f, (worldBounds.max - worldBounds.min) * 0.5f);
+		}
+		count_++;
+	}
+
+	// writes the indices of the boxes intersecting at least one of the frustums , in increasing order .
+	void Cull(const VulkanFrustum * frustums, uint32_t frustumCount, std::vector<uint32_t> & visible) const
+	{
+		visible.clear();
+		for (size_t first = 0; first < count_; first += FRUSTUM_CULL_LANES)
+		{
+			uint32_t mask = 0;
+			for (uint32_t f = 0; f < frustumCount; f++)
+			{
+				mask |= TestBatch(frustums[f], first);
+			}
+			// the padding after the last box is not tested .
+			size_t remaining = count_ - first;
+			if (remaining < FRUSTUM_CULL_LANES) mask &= (1u << remaining) - 1;
+			for (uint32_t lane = 0; mask != 0; lane++, mask >>= 1)
+			{
+				if (mask & 1) visible.push_back((uint32_t)(first + lane));
+			}
+		}
+	}
+
+	size_t GetCount() const { return count_; }
+
+private:
+	void Grow()
+	{
+		size_t size = center_x_.size() + FRUSTUM_CULL_LANES;
+		center_x_.resize(size, 0.0f);
+		center_y_.resize(size, 0.0f);
+		center_z_.resize(size, 0.0f);
+		extent_x_.resize(size, 0.0f);
+		extent_y_.resize(size, 0.0f);
+		extent_z_.resize(size, 0.0f);
+	}
+
+	void SetBox(size_t index, const glm::vec3 & center, const glm::vec3 & extent)
+	{
+		center_x_[index] = center.x;
+		center_y_[index] = center.y;
+		center_z_[index] = center.z;
+		extent_x_[index] = extent.x;
+		extent_y_[index] = extent.y;
+		extent_z_[index] = extent.z;
+	}
+
+	// bit i is set when box first + i intersects the frustum .
+	uint32_t TestBatch(const VulkanFrustum & frustum, size_t first) const
+	{
+#if defined(FRUSTUM_CULL_AVX)
+		__m256 cx = _mm256_loadu_ps(&center_x_[first]);
+		__m256 cy = _mm256_loadu_ps(&center_y_[first]);
+		__m256 cz = _mm256_loadu_ps(&center_z_[first]);
+		__m256 ex = _mm256_loadu_ps(&extent_x_[first]);
+		__m256 ey = _mm256_loadu_ps(&extent_y_[first]);
+		__m256 ez = _mm256_loadu_ps(&extent_z_[first]);
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			const glm::vec4 & plane = frustum.planes[p];
+			const glm::vec3 & absNormal = frustum.absNormals[p];
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)), _mm256_set1_ps(plane.w));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(cy, _mm256_set1_ps(plane.y)));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(cz, _mm256_set1_ps(plane.z)));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(ex, _mm256_set1_ps(absNormal.x)));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(ey, _mm256_set1_ps(absNormal.y)));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(ez, _mm256_set1_ps(absNormal.z)));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		return (uint32_t)_mm256_movemask_ps(inside);
+#elif defined(FRUSTUM_CULL_SSE)
+		__m128 cx = _mm_loadu_ps(&center_x_[first]);
+		__m128 cy = _mm_loadu_ps(&center_y_[first]);
+		__m128 cz = _mm_loadu_ps(&center_z_[first]);
+		__m128 ex = _mm_loadu_ps(&extent_x_[first]);
+		__m128 ey = _mm_loadu_ps(&extent_y_[first]);
+		__m128 ez = _mm_loadu_ps(&extent_z_[first]);
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			const glm::vec4 & plane = frustum.planes[p];
+			const glm::vec3 & absNormal = frustum.absNormals[p];
+			__m128 distance = _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+			distance = _mm_add_ps(distance, _mm_mul_ps(cy, _mm_set1_ps(plane.y)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(cz, _mm_set1_ps(plane.z)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ex, _mm_set1_ps(absNormal.x)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ey, _mm_set1_ps(absNormal.y)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ez, _mm_set1_ps(absNormal.z)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+		}
+		return (uint32_t)_mm_movemask_ps(inside);
+#elif defined(FRUSTUM_CULL_NEON)
+		float32x4_t cx = vld1q_f32(&center_x_[first]);
+		float32x4_t cy = vld1q_f32(&center_y_[first]);
+		float32x4_t cz = vld1q_f32(&center_z_[first]);
+		float32x4_t ex = vld1q_f32(&extent_x_[first]);
+		float32x4_t ey = vld1q_f32(&extent_y_[first]);
+		float32x4_t ez = vld1q_f32(&extent_z_[first]);
+		uint32x4_t inside = vdupq_n_u32(0xffffffff);
+		for (int p = 0; p < 6; p++)
+		{
+			const glm::vec4 & plane = frustum.planes[p];
+			const glm::vec3 & absNormal = frustum.absNormals[p];
+			float32x4_t distance = vmlaq_n_f32(vdupq_n_f32(plane.w), cx, plane.x);
+			distance = vmlaq_n_f32(distance, cy, plane.y);
+			distance = vmlaq_n_f32(distance, cz, plane.z);
+			distance = vmlaq_n_f32(distance, ex, absNormal.x);
+			distance = vmlaq_n_f32(distance, ey, absNormal.y);
+			distance = vmlaq_n_f32(distance, ez, absNormal.z);
+			inside = vandq_u32(inside, vcgeq_f32(distance, vdupq_n_f32(0.0f)));
+		}
+		// there is no movemask , the lanes keep their bit and are summed .
+		static const uint32_t laneBits[4] = { 1 , 2 , 4 , 8 };
+		uint32x4_t bits = vandq_u32(inside, vld1q_u32(laneBits));
+		uint32x2_t sum = vadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+		return vget_lane_u32(vpadd_u32(sum, sum), 0);
+#else
+		uint32_t mask = 0;
+		for (uint32_t lane = 0; lane < FRUSTUM_CULL_LANES; lane++)
+		{
+			size_t i = first + lane;
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++)
+			{
+				const glm::vec4 & plane = frustum.planes[p];
+				const glm::vec3 & absNormal = frustum.absNormals[p];
+				float distance = plane.x * center_x_[i] + plane.y * center_y_[i] + plane.z * center_z_[i] + plane.w
+					+ absNormal.x * extent_x_[i] + absNormal.y * extent_y_[i] + absNormal.z * extent_z_[i];
+				inside = distance >= 0.0f;
+			}
+			if (inside) mask |= 1u << lane;
+		}
+		return mask;
+#endif
+	}
+
+private:
+	size_t count_ = 0;
+	std::vector<float> center_x_;
+	std::vector<float> center_y_;
+	std::vector<float> center_z_;
+	std::vector<float> extent_x_;
+	std::vector<float> extent_y_;
+	std::vector<float> extent_z_;
+};
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef _VULKAN_GEOMETRY_ARENA_H_
+#define _VULKAN_GEOMETRY_ARENA_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include "VulkanDevice.hpp"
+#include "VulkanUploadManager.h"
+
+class VulkanGeometryArena;
+
+// the part of an arena owned by one mesh , vertex_offset is the base vertex of vkCmdDrawIndexed ,
+// the indices stay relative to the first vertex of the mesh .
+struct GeometryRange
+{
+	VulkanGeometryArena * arena = NULL;
+	uint32_t vertex_offset = 0;
+	uint32_t vertex_count = 0;
+	uint32_t first_index = 0;
+	uint32_t index_count = 0;
+};
+
+// One device local vertex buffer and one 32 bit index buffer shared by every mesh of a vertex layout , a pass binds
+// them once and addresses the meshes by base vertex and first index , which is also what indirect draws need .
+// The buffers have a fixed capacity , they are never reallocated so recorded command buffers stay valid . When they
+// are full the arena chains another one of the same layout and places the range there , range.arena is the arena
+// holding it and the draw lists group their draws by it .
+// Ranges are placed first fit in element units and merged with their neighbours when freed . Allocate and Free
+// are thread safe , the loader threads fill their ranges through the upload manager bound to them .
+// The buffers are concurrent : the streaming thread writes ranges on the transfer queue while the graphics queue draws
+// the other ranges , queue family ownership covers a whole buffer and can not be handed over per range .
+class VulkanGeometryArena
+{
+	struct FreeRange
+	{
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	// first fit over ranges sorted by offset .
+	struct RangeAllocator
+	{
+		std::vector<FreeRange> free_ranges;
+		uint32_t used = 0;
+
+		bool Allocate(uint32_t count, uint32_t & offset)
+		{
+			for (size_t i = 0; i < free_ranges.size(); i++)
+			{
+				if (free_ranges[i].count < count) continue;
+				offset = free_ranges[i].offset;
+				free_ranges[i].offset += count;
+				free_ranges[i].count -= count;
+				if (free_ranges[i].count == 0) free_ranges.erase(free_ranges.begin() + i);
+				used += count;
+				return true;
+			}
+			return false;
+		}
+
+		void Free(uint32_t offset, uint32_t count)
+		{
+			size_t i = 0;
+			while (i < free_ranges.size() && free_ranges[i].offset < offset) i++;
+			free_ranges.insert(free_ranges.begin() + i, { offset , count });
+			used -= count;
+			if (i + 1 < free_ranges.size() && free_ranges[i].offset + free_ranges[i].count == free_ranges[i + 1].offset)
+			{
+				free_ranges[i].count += free_ranges[i + 1].count;
+				free_ranges.erase(free_ranges.begin() + i + 1);
+			}
+			if (i > 0 && free_ranges[i - 1].offset + free_ranges[i - 1].count == free_ranges[i].offset)
+			{
+				free_ranges[i - 1].count += free_ranges[i].count;
+				free_ranges.erase(free_ranges.begin() + i);
+			}
+		}
+	};
+
+public:
+	VulkanGeometryArena(VulkanDevice * device, uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity) :
+		device_(device), vertex_stride_(vertexStride), vertex_capacity_(vertexCapacity), index_capacity_(indexCapacity)
+	{
+		vertex_buffer_ = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexStride * vertexCapacity, MEMORY_CATEGORY_MESH, NULL, true);
+		index_buffer_ = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, sizeof(uint32_t) * indexCapacity, MEMORY_CATEGORY_MESH, NULL, true);
+		vertices_.free_ranges.push_back({ 0 , vertexCapacity });
+		indices_.free_ranges.push_back({ 0 , indexCapacity });
+	}
+
+	~VulkanGeometryArena()
+	{
+		delete next_;
+		delete vertex_buffer_;
+		delete index_buffer_;
+	}
+
+public:
+	// a range larger than the capacity gets a chained arena of its own size .
+	GeometryRange Allocate(uint32_t vertexCount, uint32_t indexCount)
+	{
+		VulkanGeometryArena * next = NULL;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			GeometryRange range;
+			range.arena = this;
+			range.vertex_count = vertexCount;
+			range.index_count = indexCount;
+			if (vertices_.Allocate(vertexCount, range.vertex_offset))
+			{
+				if (indices_.Allocate(indexCount, range.first_index)) return range;
+				vertices_.Free(range.vertex_offset, vertexCount);
+			}
+			if (next_ == NULL)
+			{
+				next_ = new VulkanGeometryArena(device_, vertex_stride_, (std::max)(vertex_capacity_, vertexCount), (std::max)(index_capacity_, indexCount));
+			}
+			next = next_;
+		}
+		return next->Allocate(vertexCount, indexCount);
+	}
+
+	// the caller makes sure the gpu is done with the range .
+	void Free(GeometryRange & range)
+	{
+		if (range.arena != this)
+		{
+			if (range.arena != NULL) range.arena->Free(range);
+			return;
+		}
+		std::lock_guard<std::mutex> lock(mutex_);
+		vertices_.Free(range.vertex_offset, range.vertex_count);
+		indices_.Free(range.first_index, range.index_count);
+		range.arena = NULL;
+	}
+
+	// vertices holds range.vertex_count vertices of the arena stride , the returned ticket covers both copies .
+	UploadTicket Upload(const GeometryRange & range, const void * vertices, const uint32_t * indices)
+	{
+		if (range.arena != this) return range.arena->Upload(range, vertices, indices);
+		VulkanUploadManager * uploadManager = device_->GetUploadManager();
+		uploadManager->UploadBuffer(vertex_buffer_, vertices, (VkDeviceSize)range.vertex_count * vertex_stride_, (VkDeviceSize)range.vertex_offset * vertex_stride_,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+		return uploadManager->UploadBuffer(index_buffer_, indices, (VkDeviceSize)range.index_count * sizeof(uint32_t), (VkDeviceSize)range.first_index * sizeof(uint32_t),
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+	}
+
+	void Bind(VkCommandBuffer commandBuffer) const
+	{
+		VkBuffer vertexBuffer = vertex_buffer_->GetDesc().buffer;
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+		vkCmdBindIndexBuffer(commandBuffer, index_buffer_->GetDesc().buffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	VulkanBuffer * GetVertexBuffer() const { return vertex_buffer_; }
+	VulkanBuffer * GetIndexBuffer() const { return index_buffer_; }
+	uint32_t GetVertexStride() const { return vertex_stride_; }
+	uint32_t GetUsedVertexCount() const { return vertices_.used; }
+	uint32_t GetUsedIndexCount() const { return indices_.used; }
+	uint32_t GetVertexCapacity() const { return vertex_capacity_; }
+	uint32_t GetIndexCapacity() const { return index_capacity_; }
+	// the arena chained when this one was full , NULL until then .
+	VulkanGeometryArena * GetNext() const { return next_; }
+
+private:
+	VulkanDevice * device_;
+	VulkanBuffer * vertex_buffer_;
+	VulkanBuffer * index_buffer_;
+	uint32_t vertex_stride_;
+	uint32_t vertex_capacity_;
+	uint32_t index_capacity_;
+	RangeAllocator vertices_;
+	RangeAllocator indices_;
+	VulkanGeometryArena * next_ = NULL;
+	std::mutex mutex_;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef _VULKAN_GPU_PROFILER_H_
+#define _VULKAN_GPU_PROFILER_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include "VulkanDevice.hpp"
+#include "Utility.h"
+#include "imgui.h"
+
+#define GPU_PROFILER_MAX_QUERIES 128
+#define GPU_PROFILER_HISTORY_SIZE 240
+
+// Timestamp queries written around every pass .
+// Every frame in flight owns its own query pool , the results of a slot are read back in BeginFrame once the fence of
+// that slot has been waited on , so reading never stalls the queue . Durations of scopes sharing a name are summed per frame .
+class VulkanGpuProfiler
+{
+public:
+	VulkanGpuProfiler(VulkanDevice * device, int framesInFlight)
+	{
+		device_ = device;
+		timestamp_period_ = device_->GetProperties().limits.timestampPeriod;
+		uint32_t validBits = device_->GetQueueFamilyProperties(device_->GetGraphicsQueue()).timestampValidBits;
+		enabled_ = validBits != 0;
+		valid_bits_ = validBits;
+		timestamp_mask_ = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+		frames_.resize(framesInFlight);
+		VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+		queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCreateInfo.queryCount = GPU_PROFILER_MAX_QUERIES;
+		for (auto & frame : frames_)
+		{
+			VULKAN_SUCCESS(vkCreateQueryPool(device_->GetDevice(), &queryPoolCreateInfo, NULL, &frame.query_pool));
+			device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &frame.reset_command_buffer);
+		}
+	}
+
+	~VulkanGpuProfiler()
+	{
+		for (auto & frame : frames_)
+		{
+			vkDestroyQueryPool(device_->GetDevice(), frame.query_pool, NULL);
+			device_->DestroyCommandBuffer(&frame.reset_command_buffer, 1);
+		}
+	}
+
+public:
+	// reads back the previous use of the frame slot and records the reset of its queries ,
+	// the returned command buffer has to be submitted before any other command buffer of the frame .
+	VkCommandBuffer BeginFrame(int frameIndex)
+	{
+		frame_index_ = frameIndex;
+		FrameData & frame = frames_[frame_index_];
+		if (enabled_ && frame.query_count != 0)
+		{
+			ReadBack(frame);
+		}
+		frame.scopes.clear();
+		frame.query_count = 0;
+
+		VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		vkBeginCommandBuffer(frame.reset_command_buffer, &commandBufferBeginInfo);
+		if (enabled_)
+		{
+			vkCmdResetQueryPool(frame.reset_command_buffer, frame.query_pool, 0, GPU_PROFILER_MAX_QUERIES);
+		}
+		vkEndCommandBuffer(frame.reset_command_buffer);
+		return frame.reset_command_buffer;
+	}
+
+	// scopes are masked to the valid bits of the graphics queue , other families need at least as many .
+	bool IsTimestampSupported(uint32_t queueFamily) const
+	{
+		return enabled_ && device_->GetQueueFamilyProperties(queueFamily).timestampValidBits >= valid_bits_;
+	}
+
+	// scopes are told apart by the contents of their name , so a name built at run time finds the scope of an equal
+	// literal . called once when the owner of a scope is set up , BeginScope only takes the returned id .
+	int RegisterScope(const char * name)
+	{
+		for (size_t i = 0; i < scope_names_.size(); i++)
+		{
+			if (scope_names_[i] == name) return (int)i;
+		}
+
+		int id = scope_names_.size();
+		scope_names_.push_back(name);
+		history_.push_back(std::vector<float>(GPU_PROFILER_HISTORY_SIZE, 0.0f));
+		return id;
+	}
+
+	// must be recorded outside of a render pass or at the same subpass level as the matching EndScope .
+	int BeginScope(VkCommandBuffer commandBuffer, int scopeId)
+	{
+		FrameData & frame = frames_[frame_index_];
+		if (!enabled_ || scopeId < 0 || frame.query_count + 2 > GPU_PROFILER_MAX_QUERIES) return -1;
+
+		ScopeQuery scope;
+		scope.id = scopeId;
+		scope.query = frame.query_count;
+		frame.query_count += 2;
+		frame.scopes.push_back(scope);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.query_pool, scope.query);
+		return frame.scopes.size() - 1;
+	}
+
+	void EndScope(VkCommandBuffer commandBuffer, int scope)
+	{
+		if (scope < 0) return;
+		FrameData & frame = frames_[frame_index_];
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.query_pool, frame.scopes[scope].query + 1);
+	}
+
+	void OnUpdateImgui()
+	{
+		if (!ImGui::CollapsingHeader("GPU Profiler")) return;
+		if (!enabled_)
+		{
+			ImGui::TextUnformatted("timestamps are not supported by the graphics queue .");
+			return;
+		}
+
+		for (size_t i = 0; i < scope_names_.size(); i++)
+		{
+			const std::vector<float> & history = history_[i];
+			float maxValue = 0.0f;
+			for (float value : history) maxValue = (std::max)(maxValue, value);
+			float current = history[(history_offset_ + GPU_PROFILER_HISTORY_SIZE - 1) % GPU_PROFILER_HISTORY_SIZE];
+			char label[128];
+			snprintf(label, sizeof(label), "%s %.3f ms", scope_names_[i].c_str(), current);
+			ImGui::PlotLines(label, history.data(), GPU_PROFILER_HISTORY_SIZE, history_offset_, NULL, 0.0f, maxValue * 1.2f + 0.001f, ImVec2(0, 40));
+		}
+
+		if (ImGui::Button("Export CSV"))
+		{
+			ExportCSV(csv_file_);
+		}
+	}
+
+	// writes the rolling history , one row per frame from the oldest to the newest and one column per scope in milliseconds .
+	bool ExportCSV(const std::string & file) const
+	{
+		std::ofstream csv(file);
+		if (!csv.is_open()) return false;
+
+		csv << "frame";
+		for (auto & name : scope_names_) csv << "," << name;
+		csv << "\n";
+		for (int f = 0; f < GPU_PROFILER_HISTORY_SIZE; f++)
+		{
+			int ind = (history_offset_ + f) % GPU_PROFILER_HISTORY_SIZE;
+			csv << f;
+			for (auto & history : history_) csv << "," << history[ind];
+			csv << "\n";
+		}
+		return true;
+	}
+
+	void SetCSVFile(const std::string & file)
+	{
+		csv_file_ = file;
+	}
+
+	const std::vector<std::string> & GetScopeNames() const
+	{
+		return scope_names_;
+	}
+
+	// the newest resolved duration of a scope in milliseconds .
+	float GetLastDuration(int scopeId) const
+	{
+		return history_[scopeId][(history_offset_ + GPU_PROFILER_HISTORY_SIZE - 1) % GPU_PROFILER_HISTORY_SIZE];
+	}
+
+private:
+	struct ScopeQuery
+	{
+		int id;
+		uint32_t query;
+	};
+
+	struct FrameData
+	{
+		VkQueryPool query_pool;
+		VkCommandBuffer reset_command_buffer;
+		std::vector<ScopeQuery> scopes;
+		uint32_t query_count = 0;
+	};
+
+	// every query is followed by its availability , a query that was never written leaves its scope at zero
+	// instead of failing the whole read back of the frame .
+	void ReadBack(FrameData & frame)
+	{
+		timestamps_.resize(frame.query_count * 2);
+		VkResult res = vkGetQueryPoolResults(device_->GetDevice(), frame.query_pool, 0, frame.query_count,
+			timestamps_.size() * sizeof(uint64_t), timestamps_.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if (res != VK_SUCCESS && res != VK_NOT_READY) return;
+
+		for (auto & history : history_) history[history_offset_] = 0.0f;
+		for (auto & scope : frame.scopes)
+		{
+			const uint64_t * query = &timestamps_[scope.query * 2];
+			if (query[1] == 0 || query[3] == 0) continue;
+			uint64_t begin = query[0] & timestamp_mask_;
+			uint64_t end = query[2] & timestamp_mask_;
+			if (end < begin) continue;
+			history_[scope.id][history_offset_] += (float)((end - begin) * timestamp_period_ / 1000000.0);
+		}
+		history_offset_ = (history_offset_ + 1) % GPU_PROFILER_HISTORY_SIZE;
+	}
+
+private:
+	VulkanDevice * device_;
+	bool enabled_;
+	float timestamp_period_;
+	uint64_t timestamp_mask_;
+	uint32_t valid_bits_;
+	int frame_index_ = 0;
+	std::vector<FrameData> frames_;
+	std::vector<uint64_t> timestamps_;
+
+	std::vector<std::string> scope_names_;
+	std::vector<std::vector<float>> history_;
+	int history_offset_ = 0;
+	std::string csv_file_ = "gpu_profile.csv";
+};
+
+#endif
@@ -19,7 +19,34 @@ Texture2D::Texture2D(
 	bool forceLinear
 )
 {
-	if (ktxTex)
+	device_ = device;
+	load_info_.filename = filename;
+	load_info_.format = format;
+	load_info_.copyQueue = copyQueue;
+	load_info_.formatSize = formatSize;
+	load_info_.generateMipMaps = generateMipMaps;
+	load_info_.ktxTex = ktxTex;
+	load_info_.filter = filter;
+	load_info_.imageUsageFlags = imageUsageFlags;
+	load_info_.imageLayout = imageLayout;
+	load_info_.dstAccessFlag = dstAccessFlag;
+	Load();
+}
+
+// creates the image and records its upload , a texture that was evicted is loaded again the same way .
+void Texture2D::Load()
+{
+	const std::string & filename = load_info_.filename;
+	VkFormat format = load_info_.format;
+	VulkanDevice * device = device_;
+	VkQueue copyQueue = load_info_.copyQueue;
+	uint32_t formatSize = load_info_.formatSize;
+	bool generateMipMaps = load_info_.generateMipMaps;
+	VkFilter filter = load_info_.filter;
+	VkImageUsageFlags imageUsageFlags = load_info_.imageUsageFlags;
+	VkImageLayout imageLayout = load_info_.imageLayout;
+	VkAccessFlags dstAccessFlag = load_info_.dstAccessFlag;
+	if (load_info_.ktxTex)
 	{
 		gli::texture2d tex2D(gli::load(filename));
 		assert(!tex2D.empty());
@@ -28,35 +55,14 @@ Texture2D::Texture2D(
 		this->height_ = tex2D[0].extent().y;
 		this->mip_levels = tex2D.levels();
 
-		VkCommandBuffer copyCmd;
-		device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &copyCmd);
-
-		VkBuffer buffer;
-		VkDeviceMemory device_memory;
-		VkBufferCreateInfo bufferCreateInfo = {};
-		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferCreateInfo.size = tex2D.size();
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		vkCreateBuffer(device_->GetDevice(), &bufferCreateInfo, NULL, &buffer);
-
-		VkMemoryAllocateInfo memAllocInfo = {};
-		VkMemoryRequirements memReqs;
-		vkGetBufferMemoryRequirements(device_->GetDevice(), buffer, &memReqs);
-		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device_->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		vkAllocateMemory(device_->GetDevice(), &memAllocInfo, NULL, &device_memory);
-		vkBindBufferMemory(device_->GetDevice(), buffer, device_memory, 0);
-
-		uint8_t * data;
-		vkMapMemory(device_->GetDevice(), device_memory, 0, memReqs.size, 0, (void**)&data);
-		memcpy(data, tex2D.data(), tex2D.size());
-		vkUnmapMemory(device_->GetDevice(), device_memory);
+		upload_manager_ = device_->GetUploadManager();
+		VulkanUploadManager::UploadContext upload = upload_manager_->BeginUpload(tex2D.size());
+		VkCommandBuffer copyCmd = upload.command_buffer;
+		VkBuffer buffer = upload.staging_buffer;
+		memcpy(upload.staging_data, tex2D.data(), tex2D.size());
 
 		std::vector<VkBufferImageCopy> bufferCopyRegions;
-		uint32_t offset = 0;
+		VkDeviceSize offset = upload.staging_offset;
 
 		for (uint32_t i = 0; i < mip_levels; i++)
 		{
@@ -72,7 +78,7 @@ Texture2D::Texture2D(
 
 			bufferCopyRegions.push_back(bufferCopyRegion);
 
-			offset += static_cast<uint32_t>(tex2D[i].size());
+			offset += tex2D[i].size();
 		}
 		VkImageCreateInfo imageCreateInfo = {};
 		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -92,12 +98,7 @@ Texture2D::Texture2D(
 		}
 
 		vkCreateImage(device->GetDevice(), &imageCreateInfo, nullptr, &image_);
-		vkGetImageMemoryRequirements(device->GetDevice(), image_, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-
-		memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		vkAllocateMemory(device->GetDevice(), &memAllocInfo, nullptr, &memory_);
-		vkBindImageMemory(device->GetDevice(), image_, memory_, 0);
+		memory_ = device->AllocateImageMemory(image_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_CATEGORY_TEXTURE);
 
 		VkImageSubresourceRange subresourceRange = {};
 		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -114,44 +115,17 @@ Texture2D::Texture2D(
 		imageBarrier.image = image_;
 		imageBarrier.subresourceRange = subresourceRange;
 
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		vkBeginCommandBuffer(copyCmd, &beginInfo);
-
 		vkCmdPipelineBarrier(
 			copyCmd,
-			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
 			0, 0, NULL, 0, NULL, 1, &imageBarrier);
 
 		vkCmdCopyBufferToImage(copyCmd, buffer, image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, bufferCopyRegions.size(), bufferCopyRegions.data());
 
 		this->image_layout_ = imageLayout;
-		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		imageBarrier.newLayout = imageLayout;
-		imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		imageBarrier.dstAccessMask = dstAccessFlag;
-		vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, NULL, 0, NULL, 1, &imageBarrier);
-		vkEndCommandBuffer(copyCmd);
-
-		VkSubmitInfo submitInfo = {};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &copyCmd;
-
-		VkFenceCreateInfo fenceCreateInfo = {};
-		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		VkFence fence;
-		vkCreateFence(device->GetDevice(), &fenceCreateInfo, NULL, &fence);
-
-		vkQueueSubmit(copyQueue, 1, &submitInfo, fence);
-		vkWaitForFences(device->GetDevice(), 1, &fence, VK_TRUE, 1e8);
-
-		vkDestroyFence(device->GetDevice(), fence, NULL);
-		device->DestroyCommandBuffer(&copyCmd, 1);
-		vkFreeMemory(device->GetDevice(), device_memory, nullptr);
-		vkDestroyBuffer(device->GetDevice(), buffer, nullptr);
+		upload_manager_->HandOverImage(upload, image_, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout, GetImageLayoutStage(imageLayout), dstAccessFlag);
+		upload_ticket_ = upload_manager_->EndUpload();
 
 		VkSamplerCreateInfo samplerCreateInfo = {};
 		samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -166,7 +140,7 @@ Texture2D::Texture2D(
 		samplerCreateInfo.minLod = 0.0f;
 		samplerCreateInfo.maxLod = 0.0f;
 		samplerCreateInfo.maxAnisotropy = 1.0f;
-		vkCreateSampler(device->GetDevice(), &samplerCreateInfo, nullptr, &sampler_);
+		sampler_ = device->GetSampler(samplerCreateInfo);
 
 		VkImageViewCreateInfo viewCreateInfo = {};
 		viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -195,31 +169,11 @@ Texture2D::Texture2D(
 		this->mip_levels = generateMipMaps ? static_cast<unsigned int>(std::floor(std::log2((std::max)(texWidth, texHeight)))) + 1 : 1;
 		uint32_t image_size = formatSize * texWidth * texHeight;
 
-		VkCommandBuffer copyCmd;
-		device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &copyCmd);
-		VkBuffer buffer;
-		VkDeviceMemory device_memory;
-		VkBufferCreateInfo bufferCreateInfo = {};
-		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferCreateInfo.size = image_size;
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		vkCreateBuffer(device_->GetDevice(), &bufferCreateInfo, NULL, &buffer);
-
-		VkMemoryAllocateInfo memAllocInfo = {};
-		VkMemoryRequirements memReqs;
-		vkGetBufferMemoryRequirements(device_->GetDevice(), buffer, &memReqs);
-		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device_->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		vkAllocateMemory(device_->GetDevice(), &memAllocInfo, NULL, &device_memory);
-		vkBindBufferMemory(device_->GetDevice(), buffer, device_memory, 0);
-
-		uint8_t * data;
-		vkMapMemory(device_->GetDevice(), device_memory, 0, memReqs.size, 0, (void**)&data);
-		memcpy(data, pixels, imageSize);
-		vkUnmapMemory(device_->GetDevice(), device_memory);
+		upload_manager_ = device_->GetUploadManager();
+		VulkanUploadManager::UploadContext upload = upload_manager_->BeginUpload(image_size);
+		VkCommandBuffer copyCmd = upload.command_buffer;
+		VkBuffer buffer = upload.staging_buffer;
+		memcpy(upload.staging_data, pixels, imageSize);
 
 		VkBufferImageCopy bufferCopyRegion = {};
 		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -229,7 +183,7 @@ Texture2D::Texture2D(
 		bufferCopyRegion.imageExtent.width = static_cast<uint32_t>(texWidth);
 		bufferCopyRegion.imageExtent.height = static_cast<uint32_t>(texHeight);
 		bufferCopyRegion.imageExtent.depth = 1;
-		bufferCopyRegion.bufferOffset = 0;
+		bufferCopyRegion.bufferOffset = upload.staging_offset;
 
 		VkImageCreateInfo imageCreateInfo = {};
 		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -254,12 +208,7 @@ Texture2D::Texture2D(
 		}
 
 		vkCreateImage(device->GetDevice(), &imageCreateInfo, nullptr, &image_);
-		vkGetImageMemoryRequirements(device->GetDevice(), image_, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-
-		memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		vkAllocateMemory(device->GetDevice(), &memAllocInfo, nullptr, &memory_);
-		vkBindImageMemory(device->GetDevice(), image_, memory_, 0);
+		memory_ = device->AllocateImageMemory(image_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_CATEGORY_TEXTURE);
 
 		VkImageSubresourceRange subresourceRange = {};
 		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -276,37 +225,17 @@ Texture2D::Texture2D(
 		imageBarrier.image = image_;
 		imageBarrier.subresourceRange = subresourceRange;
 
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		vkBeginCommandBuffer(copyCmd, &beginInfo);
-
 		vkCmdPipelineBarrier(
 			copyCmd,
-			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
 			0, 0, NULL, 0, NULL, 1, &imageBarrier);
 
 		vkCmdCopyBufferToImage(copyCmd, buffer, image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
-		vkEndCommandBuffer(copyCmd);
-
-		VkSubmitInfo submitInfo = {};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &copyCmd;
-
-		VkFenceCreateInfo fenceCreateInfo = {};
-		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		VkFence fence;
-		vkCreateFence(device->GetDevice(), &fenceCreateInfo, NULL, &fence);
-
-		vkQueueSubmit(copyQueue, 1, &submitInfo, fence);
-		vkWaitForFences(device->GetDevice(), 1, &fence, VK_TRUE, 1e8);
-
-		vkDestroyFence(device->GetDevice(), fence, NULL);
-		device->DestroyCommandBuffer(&copyCmd, 1);
-		vkFreeMemory(device->GetDevice(), device_memory, nullptr);
-		vkDestroyBuffer(device->GetDevice(), buffer, nullptr);
+		// the mip chain is blitted on the graphics queue , it keeps the layout of the copy .
+		upload_manager_->HandOverImage(upload, image_, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+		upload_manager_->EndUpload();
 
 		VkSamplerCreateInfo samplerCreateInfo = {};
 		samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -321,7 +250,7 @@ Texture2D::Texture2D(
 		samplerCreateInfo.minLod = 0.0f;
 		samplerCreateInfo.maxLod = 0.0f;
 		samplerCreateInfo.maxAnisotropy = 1.0f;
-		vkCreateSampler(device->GetDevice(), &samplerCreateInfo, nullptr, &sampler_);
+		sampler_ = device->GetSampler(samplerCreateInfo);
 
 		VkImageViewCreateInfo viewCreateInfo = {};
 		viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -339,15 +268,10 @@ Texture2D::Texture2D(
 	}
 }
 
+// recorded into the upload batch after the hand over of the base level , blits need the graphics queue .
 void Texture2D::GenerateMipMaps(uint32_t mipLevels, uint32_t width, uint32_t height, VkFormat imageFormat, VkQueue copyQueue)
 {
-	VkCommandBuffer commandBuffer;
-	device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo = {};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	VkCommandBuffer commandBuffer = upload_manager_->BeginUpload(0).graphics_command_buffer;
 
 	VkImageMemoryBarrier barrier = {};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -422,22 +346,7 @@ void Texture2D::GenerateMipMaps(uint32_t mipLevels, uint32_t width, uint32_t hei
 		0, nullptr,
 		1, &barrier);
 
-
-	vkEndCommandBuffer(commandBuffer);
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	VkFenceCreateInfo fenceCreateInfo = {};
-	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	VkFence fence;
-	vkCreateFence(device_->GetDevice(), &fenceCreateInfo, NULL, &fence);
-	vkQueueSubmit(copyQueue, 1, &submitInfo, fence);
-	vkWaitForFences(device_->GetDevice(), 1, &fence, VK_TRUE, 1e8);
-	vkDestroyFence(device_->GetDevice(), fence, NULL);
-	device_->DestroyCommandBuffer(&commandBuffer, 1);
+	upload_ticket_ = upload_manager_->EndUpload();
 }
 
 TextureCube::TextureCube(
@@ -472,34 +381,18 @@ TextureCube::TextureCube(
 	this->layer_count_ = 6;
 	this->mip_levels = static_cast<unsigned int>(std::floor(std::log2((std::max)(texWidth, texHeight)))) + 1;
 
-	VkBuffer buffer;
-	VkDeviceMemory device_memory;
-	VkBufferCreateInfo bufferCreateInfo = {};
-	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferCreateInfo.size = imageMemorySize;
-	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	vkCreateBuffer(device_->GetDevice(), &bufferCreateInfo, NULL, &buffer);
-
-	VkMemoryAllocateInfo memAllocInfo = {};
-	VkMemoryRequirements memReqs;
-	vkGetBufferMemoryRequirements(device_->GetDevice(), buffer, &memReqs);
-	memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memAllocInfo.allocationSize = memReqs.size;
-	memAllocInfo.memoryTypeIndex = device_->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-	vkAllocateMemory(device_->GetDevice(), &memAllocInfo, NULL, &device_memory);
-	vkBindBufferMemory(device_->GetDevice(), buffer, device_memory, 0);
-
-	uint8_t * data;
-	int offset = 0;
-	vkMapMemory(device_->GetDevice(), device_memory, 0, memReqs.size, 0, (void**)&data);
+	upload_manager_ = device_->GetUploadManager();
+	VulkanUploadManager::UploadContext upload = upload_manager_->BeginUpload(imageMemorySize);
+	VkCommandBuffer copyCmd = upload.command_buffer;
+	VkBuffer buffer = upload.staging_buffer;
+
+	uint8_t * data = (uint8_t*)upload.staging_data;
+	VkDeviceSize offset = 0;
 	for (int i = 0; i < 6; i++)
 	{
 		memcpy(data + offset , pixels[i], texWidth * texHeight * formatSize );
 		offset = offset + texWidth * texHeight * formatSize;
 	}
-	vkUnmapMemory(device_->GetDevice(), device_memory);
 
 	VkImageCreateInfo imageCreateInfo = {};
 	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -521,11 +414,7 @@ TextureCube::TextureCube(
 	imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
 	vkCreateImage(device->GetDevice(), &imageCreateInfo, nullptr, &image_);
-	vkGetImageMemoryRequirements(device->GetDevice(), image_, &memReqs);
-	memAllocInfo.allocationSize = memReqs.size;
-	memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	vkAllocateMemory(device->GetDevice(), &memAllocInfo, nullptr, &memory_);
-	vkBindImageMemory(device->GetDevice(), image_, memory_, 0);
+	memory_ = device->AllocateImageMemory(image_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_CATEGORY_TEXTURE);
 
 	VkImageSubresourceRange subresourceRange = {};
 	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -542,18 +431,10 @@ TextureCube::TextureCube(
 	imageBarrier.image = image_;
 	imageBarrier.subresourceRange = subresourceRange;
 
-	VkCommandBuffer copyCmd;
-	device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &copyCmd);
-
-	VkCommandBufferBeginInfo beginInfo = {};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	vkBeginCommandBuffer(copyCmd, &beginInfo);
-
 	vkCmdPipelineBarrier(
 		copyCmd,
-		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
 		0, 0, NULL, 0, NULL, 1, &imageBarrier);
 
 	VkBufferImageCopy bufferCopyRegion = {};
@@ -564,42 +445,12 @@ TextureCube::TextureCube(
 	bufferCopyRegion.imageExtent.width = static_cast<uint32_t>(texWidth);
 	bufferCopyRegion.imageExtent.height = static_cast<uint32_t>(texHeight);
 	bufferCopyRegion.imageExtent.depth = 1;
-	bufferCopyRegion.bufferOffset = 0;
+	bufferCopyRegion.bufferOffset = upload.staging_offset;
 
 	vkCmdCopyBufferToImage(copyCmd, buffer, image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
-	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	imageBarrier.subresourceRange.baseMipLevel = 0;
-	imageBarrier.subresourceRange.levelCount = mip_levels;
-	imageBarrier.subresourceRange.layerCount = 6;
-	imageBarrier.subresourceRange.baseArrayLayer = 0;
-	vkCmdPipelineBarrier(
-		copyCmd,
-		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-		0, 0, NULL, 0, NULL, 1, &imageBarrier);
-
-	vkEndCommandBuffer(copyCmd);
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &copyCmd;
-
-	VkFenceCreateInfo fenceCreateInfo = {};
-	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	VkFence fence;
-	vkCreateFence(device->GetDevice(), &fenceCreateInfo, NULL, &fence);
-
-	vkQueueSubmit(CopyQueue, 1, &submitInfo, fence);
-	vkWaitForFences(device->GetDevice(), 1, &fence, VK_TRUE, 1e8);
-
-	vkDestroyFence(device->GetDevice(), fence, NULL);
-	device->DestroyCommandBuffer(&copyCmd, 1);
-	vkFreeMemory(device->GetDevice(), device_memory, nullptr);
-	vkDestroyBuffer(device->GetDevice(), buffer, nullptr);
+	upload_manager_->HandOverImage(upload, image_, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+	upload_manager_->EndUpload();
 
 	VkSamplerCreateInfo samplerCreateInfo = {};
 	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -614,7 +465,7 @@ TextureCube::TextureCube(
 	samplerCreateInfo.minLod = 0.0f;
 	samplerCreateInfo.maxLod = 0.0f;
 	samplerCreateInfo.maxAnisotropy = 1.0f;
-	vkCreateSampler(device->GetDevice(), &samplerCreateInfo, nullptr, &sampler_);
+	sampler_ = device->GetSampler(samplerCreateInfo);
 
 	VkImageViewCreateInfo viewCreateInfo = {};
 	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -634,15 +485,11 @@ TextureCube::TextureCube(
 	GenerateMipMaps(mip_levels, width_, height_, format, CopyQueue);
 }
 
+// recorded into the upload batch after the hand over of the base level , blits need the graphics queue .
+// the base level keeps its contents , so every level is transitioned out of the layout it really is in .
 void TextureCube::GenerateMipMaps(uint32_t mipLevels, uint32_t width, uint32_t height, VkFormat imageFormat, VkQueue copyQueue)
 {
-	VkCommandBuffer commandBuffer;
-	device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo = {};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	VkCommandBuffer commandBuffer = upload_manager_->BeginUpload(0).graphics_command_buffer;
 
 	VkImageMemoryBarrier barrier = {};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -654,75 +501,71 @@ void TextureCube::GenerateMipMaps(uint32_t mipLevels, uint32_t width, uint32_t h
 	barrier.subresourceRange.layerCount = 6;
 	barrier.subresourceRange.levelCount = 1;
 
-	for (uint32_t layer = 0; layer < 6; layer++)
-	{
-		int32_t mipWidth = width;
-		int32_t mipHeight = height;
-		for (uint32_t i = 1; i < mipLevels; i++) {
-			barrier.subresourceRange.baseMipLevel = i - 1;
-			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-			vkCmdPipelineBarrier(commandBuffer,
-				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-				0, nullptr,
-				0, nullptr,
-				1, &barrier);
-
-			barrier.subresourceRange.baseMipLevel = i ;
-			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-			vkCmdPipelineBarrier(commandBuffer,
-				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-				0, nullptr,
-				0, nullptr,
-				1, &barrier);
-
-			VkImageBlit blit = {};
-			blit.srcOffsets[0] = { 0, 0, 0 };
-			blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.srcSubresource.mipLevel = i - 1;
-			blit.srcSubresource.baseArrayLayer = layer;
-			blit.srcSubresource.layerCount = 1;
-			blit.dstOffsets[0] = { 0, 0, 0 };
-			blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
-			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.dstSubresource.mipLevel = i;
-			blit.dstSubresource.baseArrayLayer = layer;
-			blit.dstSubresource.layerCount = 1;
-
-			vkCmdBlitImage(commandBuffer,
-				image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1, &blit,
-				VK_FILTER_LINEAR);
-
-			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-			vkCmdPipelineBarrier(commandBuffer,
-				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-				0, nullptr,
-				0, nullptr,
-				1, &barrier);
-
-			if (mipWidth > 1) mipWidth /= 2;
-			if (mipHeight > 1) mipHeight /= 2;
-		}
+	int32_t mipWidth = width;
+	int32_t mipHeight = height;
+	for (uint32_t i = 1; i < mipLevels; i++) {
+		barrier.subresourceRange.baseMipLevel = i - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier);
+
+		barrier.subresourceRange.baseMipLevel = i;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier);
+
+		VkImageBlit blit = {};
+		blit.srcOffsets[0] = { 0, 0, 0 };
+		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = i - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = 6;
+		blit.dstOffsets[0] = { 0, 0, 0 };
+		blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = i;
+		blit.dstSubresource.baseArrayLayer = 0;
+		blit.dstSubresource.layerCount = 6;
+
+		vkCmdBlitImage(commandBuffer,
+			image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit,
+			VK_FILTER_LINEAR);
+
+		barrier.subresourceRange.baseMipLevel = i - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier);
+
+		if (mipWidth > 1) mipWidth /= 2;
+		if (mipHeight > 1) mipHeight /= 2;
 	}
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 6;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = mip_levels;
-	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
@@ -733,20 +576,5 @@ void TextureCube::GenerateMipMaps(uint32_t mipLevels, uint32_t width, uint32_t h
 		0, nullptr,
 		1, &barrier);
 
-
-	vkEndCommandBuffer(commandBuffer);
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	VkFenceCreateInfo fenceCreateInfo = {};
-	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	VkFence fence;
-	vkCreateFence(device_->GetDevice(), &fenceCreateInfo, NULL, &fence);
-	vkQueueSubmit(copyQueue, 1, &submitInfo, fence);
-	vkWaitForFences(device_->GetDevice(), 1, &fence, VK_TRUE, 1e8);
-	vkDestroyFence(device_->GetDevice(), fence, NULL);
-	device_->DestroyCommandBuffer(&commandBuffer, 1);
+	upload_ticket_ = upload_manager_->EndUpload();
 }
@@ -3,6 +3,36 @@
 
 #include "Utility.h"
 #include "VulkanDevice.hpp"
+#include "VulkanUploadManager.h"
+
+// the stages and accesses that use an image in a layout , barriers between layouts wait only for these .
+inline VkPipelineStageFlags GetImageLayoutStage(VkImageLayout layout)
+{
+	switch (layout)
+	{
+	case VK_IMAGE_LAYOUT_UNDEFINED: return VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return VK_PIPELINE_STAGE_TRANSFER_BIT;
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	default: return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	}
+}
+
+inline VkAccessFlags GetImageLayoutAccess(VkImageLayout layout)
+{
+	switch (layout)
+	{
+	case VK_IMAGE_LAYOUT_UNDEFINED: return 0;
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return VK_ACCESS_TRANSFER_READ_BIT;
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return VK_ACCESS_TRANSFER_WRITE_BIT;
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return VK_ACCESS_SHADER_READ_BIT;
+	default: return VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+	}
+}
 
 class Texture
 {
@@ -11,13 +41,24 @@ public:
 	VkImage image_;
 	VkImageLayout image_layout_;
 	VkImageView image_view_;
-	VkDeviceMemory memory_;
+	VulkanAllocation memory_;
 
 	uint32_t width_, height_;
 	uint32_t mip_levels;
 	uint32_t layer_count_;
 	VkDescriptorImageInfo image_info_;
 	VkSampler sampler_;
+	// the batch that uploads the pixels , the image may still be written by it .
+	UploadTicket upload_ticket_ = 0;
+	// the manager of the thread that created the texture , the ticket belongs to it .
+	VulkanUploadManager * upload_manager_ = NULL;
+	// residency , an evicted texture has no image and samples the fallback of VulkanTextureResidency .
+	bool resident_ = true;
+	// reloaded after an eviction , the image exists but samples the fallback until its upload completed .
+	bool loading_ = false;
+	uint64_t last_used_frame_ = 0;
+	// bumped on eviction and reload , descriptor sets written before are stale .
+	uint32_t residency_version_ = 0;
 
 	virtual ~Texture() {};
 
@@ -30,13 +71,14 @@ public:
 
 	void destroy()
 	{
-		vkDestroyImageView(device_->GetDevice(), image_view_, nullptr);
-		vkDestroyImage(device_->GetDevice(), image_, nullptr);
-		if (sampler_)
+		if (!resident_ && !loading_) return;
+		if (upload_manager_ != NULL)
 		{
-			vkDestroySampler(device_->GetDevice(), sampler_, nullptr);
+			upload_manager_->Wait(upload_ticket_);
 		}
-		vkFreeMemory(device_->GetDevice(), memory_, nullptr);
+		vkDestroyImageView(device_->GetDevice(), image_view_, nullptr);
+		vkDestroyImage(device_->GetDevice(), image_, nullptr);
+		device_->FreeMemory(memory_);
 	}
 };
 
@@ -58,6 +100,23 @@ public:
 		bool forceLinear = false
 	);
 	void GenerateMipMaps(uint32_t mipLevels, uint32_t width, uint32_t height, VkFormat imageFormat, VkQueue copyQueue);
+	void Load();
+
+private:
+	// the constructor arguments , kept to load the texture again after an eviction .
+	struct
+	{
+		std::string filename;
+		VkFormat format;
+		VkQueue copyQueue;
+		uint32_t formatSize;
+		bool generateMipMaps;
+		bool ktxTex;
+		VkFilter filter;
+		VkImageUsageFlags imageUsageFlags;
+		VkImageLayout imageLayout;
+		VkAccessFlags dstAccessFlag;
+	} load_info_;
 };
 class TextureCube : public Texture
 {
@@ -85,7 +144,7 @@ public:
 	VkImage image_;
 	VkImageView image_view_;
 	VkFormat image_format_;
-	VkDeviceMemory image_memory_;
+	VulkanAllocation image_memory_;
 	VkDescriptorImageInfo desc_image_info_;
 	VkDeviceSize image_size_;
 	VkImageLayout image_layout_;
@@ -108,7 +167,8 @@ public:
 		VkImageAspectFlags aspectFlag ,
 		int layerCount = 1 ,
 		int mipLevels = 1 ,
-		bool haveSampler = false 
+		bool haveSampler = false ,
+		MemoryCategory category = MEMORY_CATEGORY_RENDER_TARGET
 	)
 	{
 		device_ = device;
@@ -134,57 +194,49 @@ public:
 
 		VULKAN_SUCCESS( vkCreateImage( device_->GetDevice() , &imageCreateInfo , NULL , &image_ ) );
 
-		VkMemoryAllocateInfo memoryAllocateInfo = VulkanInitializer::InitMemoryAllocateInfo(device_, image_);
-		VULKAN_SUCCESS(vkAllocateMemory(device_->GetDevice(), &memoryAllocateInfo, NULL, &image_memory_));
-		vkBindImageMemory(device_->GetDevice(), image_, image_memory_, 0);
-		image_size_ = memoryAllocateInfo.allocationSize;
-
-		VkImageViewType viewType = layerCount == 6 ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D;
-		VkImageViewCreateInfo imageViewCreateInfo = VulkanInitializer::InitImageViewCreateInfo(
-			format,
-			image_,
-			aspectFlag ,
-			0 , layerCount, 0, mip_levels_, viewType
-		);
-
-		VULKAN_SUCCESS( vkCreateImageView( device_->GetDevice() , &imageViewCreateInfo , NULL , &image_view_  ));
-
-		desc_image_info_.imageLayout = imageLayout;
-		desc_image_info_.imageView = image_view_;
-		desc_image_info_.sampler = VK_NULL_HANDLE;
+		image_memory_ = device_->AllocateImageMemory(image_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, category);
+		image_size_ = image_memory_.size;
+		owns_memory_ = true;
 
-		width_ = width;
-		height_ = height;
+		InitView(aspectFlag, width, height);
+	}
 
-		if (haveSampler)
-		{
-			VkSamplerCreateInfo samplerCreateInfo = {};
-			samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-			samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
-			samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
-			samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-			samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-			samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-			samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-			samplerCreateInfo.mipLodBias = 0.0f;
-			samplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
-			samplerCreateInfo.minLod = 0.0f;
-			samplerCreateInfo.maxLod = 0.0f;
-			samplerCreateInfo.maxAnisotropy = 1.0f;
-			vkCreateSampler(device->GetDevice(), &samplerCreateInfo, nullptr, &sampler_);
-		}
+	// wraps an image already bound to memory owned by someone else , e.g. transient images aliasing one allocation .
+	VulkanImage(
+		VulkanDevice * device,
+		VkImage image,
+		VkDeviceSize imageSize,
+		VkFormat format,
+		VkImageLayout imageLayout,
+		int width,
+		int height,
+		VkImageAspectFlags aspectFlag,
+		int layerCount = 1,
+		int mipLevels = 1,
+		bool haveSampler = false
+	)
+	{
+		device_ = device;
+		image_ = image;
+		image_size_ = imageSize;
+		image_format_ = format;
+		image_layout_ = imageLayout;
+		HaveSampler = haveSampler;
+		layer_count_ = layerCount;
+		mip_levels_ = mipLevels;
+		owns_memory_ = false;
 
-		desc_image_info_.imageLayout = image_layout_;
-		desc_image_info_.imageView = image_view_;
-		desc_image_info_.sampler = sampler_;
+		InitView(aspectFlag, width, height);
 	}
 
-
 	~VulkanImage()
 	{
-		vkFreeMemory(device_->GetDevice(), image_memory_, NULL);
-		vkDestroyImage(device_->GetDevice(), image_, NULL);
 		vkDestroyImageView(device_->GetDevice(), image_view_, NULL);
+		vkDestroyImage(device_->GetDevice(), image_, NULL);
+		if (owns_memory_)
+		{
+			device_->FreeMemory(image_memory_);
+		}
 	}
 
 	void MapMemory( VkQueue queue , VulkanBuffer * stagingBuffer  )
@@ -208,9 +260,9 @@ public:
 			translateLayoutBuffer = cmdBuffer;
 		}
 
-		VkImageMemoryBarrier imageMemoryBarrier = VulkanInitializer::InitImageMemoryBarrier( VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT , VK_ACCESS_TRANSFER_READ_BIT , 
+		VkImageMemoryBarrier imageMemoryBarrier = VulkanInitializer::InitImageMemoryBarrier( GetImageLayoutAccess(oldLayout) , GetImageLayoutAccess(newLayout) , 
 			oldLayout , newLayout  , VK_IMAGE_ASPECT_COLOR_BIT , 0 , arrayLayerCount , 0 , mipLevels , image_  );
-		vkCmdPipelineBarrier(translateLayoutBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_DEPENDENCY_BY_REGION_BIT, 0, NULL, 0, NULL, 1, &imageMemoryBarrier);
+		vkCmdPipelineBarrier(translateLayoutBuffer, GetImageLayoutStage(oldLayout), GetImageLayoutStage(newLayout), VK_DEPENDENCY_BY_REGION_BIT, 0, NULL, 0, NULL, 1, &imageMemoryBarrier);
 
 		if (submit)
 		{
@@ -223,7 +275,7 @@ public:
 			fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 			VkFence fence;
 			vkCreateFence(device_->GetDevice(), &fenceCreateInfo, NULL, &fence);
-			vkQueueSubmit(queue, 1, &submitInfo, fence);
+			device_->QueueSubmit(queue, 1, &submitInfo, fence);
 			vkWaitForFences(device_->GetDevice(), 1, &fence, VK_TRUE, 1e8);
 			vkDestroyFence(device_->GetDevice(), fence, NULL);
 			device_->DestroyCommandBuffer(&translateLayoutBuffer, 1);
@@ -260,7 +312,7 @@ public:
 			fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 			VkFence fence;
 			vkCreateFence(device_->GetDevice(), &fenceCreateInfo, NULL, &fence);
-			vkQueueSubmit(queue, 1, &submitInfo, fence);
+			device_->QueueSubmit(queue, 1, &submitInfo, fence);
 			vkWaitForFences(device_->GetDevice(), 1, &fence, VK_TRUE, 1e8);
 			vkDestroyFence(device_->GetDevice(), fence, NULL);
 			device_->DestroyCommandBuffer(&copyImageBuffer, 1);
@@ -329,7 +381,7 @@ public:
 			fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 			VkFence fence;
 			vkCreateFence(device_->GetDevice(), &fenceCreateInfo, NULL, &fence);
-			vkQueueSubmit(queue, 1, &submitInfo, fence);
+			device_->QueueSubmit(queue, 1, &submitInfo, fence);
 			vkWaitForFences(device_->GetDevice(), 1, &fence, VK_TRUE, 1e8);
 			vkDestroyFence(device_->GetDevice(), fence, NULL);
 			device_->DestroyCommandBuffer(&copyImageBuffer, 1);
@@ -347,8 +399,52 @@ public:
 		return image_info_;
 	}
 
+private:
+	void InitView(VkImageAspectFlags aspectFlag, int width, int height)
+	{
+		VkImageViewType viewType = layer_count_ == 6 ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D;
+		VkImageViewCreateInfo imageViewCreateInfo = VulkanInitializer::InitImageViewCreateInfo(
+			image_format_,
+			image_,
+			aspectFlag ,
+			0 , layer_count_, 0, mip_levels_, viewType
+		);
+
+		VULKAN_SUCCESS( vkCreateImageView( device_->GetDevice() , &imageViewCreateInfo , NULL , &image_view_  ));
+
+		desc_image_info_.imageLayout = image_layout_;
+		desc_image_info_.imageView = image_view_;
+		desc_image_info_.sampler = VK_NULL_HANDLE;
+
+		width_ = width;
+		height_ = height;
+
+		if (HaveSampler)
+		{
+			VkSamplerCreateInfo samplerCreateInfo = {};
+			samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+			samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+			samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+			samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+			samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			samplerCreateInfo.mipLodBias = 0.0f;
+			samplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
+			samplerCreateInfo.minLod = 0.0f;
+			samplerCreateInfo.maxLod = 0.0f;
+			samplerCreateInfo.maxAnisotropy = 1.0f;
+			sampler_ = device_->GetSampler(samplerCreateInfo);
+		}
+
+		desc_image_info_.imageLayout = image_layout_;
+		desc_image_info_.imageView = image_view_;
+		desc_image_info_.sampler = sampler_;
+	}
+
 private:
 	VulkanDevice * device_;
+	bool owns_memory_;
 };
 
 #endif
\ No newline at end of file
@@ -24,6 +24,16 @@ public:
 	int32_t vertexCount = 0;
 	int32_t indexCount = 0;
 
+	// Each frame in flight owns its own vertex / index buffers , the active ones are swapped in by setFrameIndex .
+	struct FrameGeometry {
+		VulkanBuffer* vertexBuffer = NULL;
+		VulkanBuffer* indexBuffer = NULL;
+		int32_t vertexCount = 0;
+		int32_t indexCount = 0;
+	};
+	std::vector<FrameGeometry> frameGeometry = std::vector<FrameGeometry>(1);
+	uint32_t frameIndex = 0;
+
 	std::vector<VkPipelineShaderStageCreateInfo> shaders;
 
 	VkDescriptorPool descriptorPool;
@@ -32,7 +42,7 @@ public:
 	VkPipelineLayout pipelineLayout;
 	VkPipeline pipeline;
 
-	VkDeviceMemory fontMemory = VK_NULL_HANDLE;
+	VulkanAllocation fontMemory;
 	VkImage fontImage = VK_NULL_HANDLE;
 	VkImageView fontView = VK_NULL_HANDLE;
 	VkSampler sampler;
@@ -243,14 +253,7 @@ public:
 		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		vkCreateImage(device->GetDevice(), &imageInfo, nullptr, &fontImage);
-		VkMemoryRequirements memReqs;
-		vkGetImageMemoryRequirements(device->GetDevice(), fontImage, &memReqs);
-		VkMemoryAllocateInfo memAllocInfo = {};
-		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		vkAllocateMemory(device->GetDevice(), &memAllocInfo, nullptr, &fontMemory);
-		vkBindImageMemory(device->GetDevice(), fontImage, fontMemory, 0);
+		fontMemory = device->AllocateImageMemory(fontImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_CATEGORY_UI);
 
 		// Image view
 		VkImageViewCreateInfo viewInfo = {};
@@ -269,6 +272,7 @@ public:
 				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 				uploadSize,
+				MEMORY_CATEGORY_STAGING,
 				fontData);
 
 		// Copy buffer data to font image
@@ -350,13 +354,13 @@ public:
 		VkFence fence;
 		vkCreateFence(device->GetDevice(), &fenceCreateInfo, nullptr, &fence);
 
-		res = vkQueueSubmit(queue, 1, &submit_info, fence);
+		res = device->QueueSubmit(queue, 1, &submit_info, fence);
 		if (res != VK_SUCCESS)
 		{
 			throw "submit queue error . ";
 		}
 
-		res = vkQueueWaitIdle(queue);
+		res = device->QueueWaitIdle(queue);
 		if (res != VK_SUCCESS)
 		{
 			throw "vkQueueWaitIdle error . ";
@@ -426,6 +430,21 @@ public:
 
 		vkUpdateDescriptorSets(device->GetDevice(), 1, &writeDescriptorSets, 0, nullptr);
 	}
+	void setFrameCount(uint32_t count)
+	{
+		frameGeometry.resize(count);
+	}
+
+	void setFrameIndex(uint32_t index)
+	{
+		frameGeometry[frameIndex] = { vertexBuffer , indexBuffer , vertexCount , indexCount };
+		frameIndex = index;
+		vertexBuffer = frameGeometry[frameIndex].vertexBuffer;
+		indexBuffer = frameGeometry[frameIndex].indexBuffer;
+		vertexCount = frameGeometry[frameIndex].vertexCount;
+		indexCount = frameGeometry[frameIndex].indexCount;
+	}
+
 	bool update()
 	{
 		ImDrawData* imDrawData = ImGui::GetDrawData();
@@ -449,7 +468,7 @@ public:
 				vertexBuffer->Unmap();
 				delete vertexBuffer;
 			}
-			vertexBuffer = device->CreateVulkanBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, vertexBufferSize);
+			vertexBuffer = device->CreateVulkanBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, vertexBufferSize, MEMORY_CATEGORY_UI);
 			vertexCount = imDrawData->TotalVtxCount;
 			vertexBuffer->Map();
 			updateCmdBuffers = true;
@@ -464,7 +483,7 @@ public:
 				delete indexBuffer;
 
 			}
-			indexBuffer = device->CreateVulkanBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, indexBufferSize);
+			indexBuffer = device->CreateVulkanBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, indexBufferSize, MEMORY_CATEGORY_UI);
 			indexCount = imDrawData->TotalIdxCount;
 			indexBuffer->Map();
 			updateCmdBuffers = true;
@@ -495,7 +514,7 @@ public:
 		int32_t vertexOffset = 0;
 		int32_t indexOffset = 0;
 
-		if ((!imDrawData) || (imDrawData->CmdListsCount == 0)) {
+		if ((!imDrawData) || (imDrawData->CmdListsCount == 0) || (vertexBuffer == NULL) || (indexBuffer == NULL)) {
 			return;
 		}
 
@@ -540,11 +559,15 @@ public:
 	void freeResources()
 	{
 		ImGui::DestroyContext();
-		vertexBuffer->Destroy();
-		indexBuffer->Destroy();
+		setFrameIndex(frameIndex);
+		for (auto & geometry : frameGeometry)
+		{
+			if (geometry.vertexBuffer != NULL) geometry.vertexBuffer->Destroy();
+			if (geometry.indexBuffer != NULL) geometry.indexBuffer->Destroy();
+		}
 		vkDestroyImageView(device->GetDevice(), fontView, nullptr);
 		vkDestroyImage(device->GetDevice(), fontImage, nullptr);
-		vkFreeMemory(device->GetDevice(), fontMemory, nullptr);
+		device->FreeMemory(fontMemory);
 		vkDestroySampler(device->GetDevice(), sampler, nullptr);
 		vkDestroyDescriptorSetLayout(device->GetDevice(), descriptorSetLayout, nullptr);
 		vkDestroyDescriptorPool(device->GetDevice(), descriptorPool, nullptr);
@@ -0,0 +1,282 @@
+#ifndef _VULKAN_INDIRECT_DRAWS_H_
+#define _VULKAN_INDIRECT_DRAWS_H_
+
+#include <vector>
+#include <cstring>
+#include "Utility.h"
+#include "VulkanDevice.hpp"
+#include "VulkanBuffer.hpp"
+#include "VulkanMesh.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanFrustumCulling.h"
+
+class IMaterial;
+
+// per object data of an indirect draw list , std430 layout of ObjectData in the shaders .
+struct IndirectObjectData
+{
+	glm::mat4 model;
+	// world space box , meshes without bounds get an extent no plane can cull and w != 0 .
+	glm::vec4 boundsCenter;
+	glm::vec4 boundsExtent;
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t batch;
+};
+
+// the frustums the objects are tested against , std430 layout of Frustums in BuildDrawCommands.comp .
+struct IndirectFrustumData
+{
+	uint32_t frustumCount;
+	uint32_t padding[3];
+	glm::vec4 planes[INDIRECT_DRAW_MAX_FRUSTUMS * 6];
+};
+
+// The draws of a pass as data instead of commands . The cpu writes one IndirectObjectData per object into a buffer of
+// the frame slot , a compute pass turns them into VkDrawIndexedIndirectCommand and the pass draws them with one
+// indirect draw per batch of objects sharing a geometry arena and a material , so the recorded commands do not depend
+// on the number of objects .
+// The command of an object uses the object index as first instance , the vertex shaders read the object data with
+// gl_InstanceIndex . The compute pass tests the world bounds of every object against the frustums of SetFrustums ,
+// an object is visible when it intersects one of them , or against the hi-z pyramid with OcclusionCullPipeline .
+// With VK_KHR_draw_indirect_count it compacts the visible commands of every batch and counts them , otherwise every
+// object keeps its command and invisible ones draw no instance .
+// Begin , Add and End run on the frame loop after the fence of the frame slot was waited on .
+class VulkanIndirectDrawList
+{
+public:
+	// the objects added between two arena or material changes , drawn with a single indirect draw .
+	struct Batch
+	{
+		VulkanGeometryArena * arena;
+		IMaterial * material;
+		uint32_t firstCommand;
+		uint32_t commandCount;
+	};
+
+	// binds the descriptor sets of a material , with the layout of the pass the material belongs to .
+	typedef void(*BindMaterial)(VkCommandBuffer & commandBuffer, IMaterial * material);
+
+	VulkanIndirectDrawList(VulkanDevice * device, int framesInFlight) : device_(device)
+	{
+		object_buffers_.resize(framesInFlight, NULL);
+		frustum_buffers_.resize(framesInFlight, NULL);
+		for (auto & buffer : frustum_buffers_)
+		{
+			buffer = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				sizeof(IndirectFrustumData), MEMORY_CATEGORY_OTHER);
+			buffer->Map();
+		}
+		batch_buffers_.resize(framesInFlight, NULL);
+		for (auto & buffer : batch_buffers_)
+		{
+			buffer = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				INDIRECT_DRAW_MAX_BATCHES * sizeof(uint32_t), MEMORY_CATEGORY_OTHER);
+			buffer->Map();
+		}
+		count_buffer_ = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, INDIRECT_DRAW_MAX_BATCHES * sizeof(uint32_t), MEMORY_CATEGORY_OTHER);
+		Reserve(INDIRECT_DRAW_INITIAL_CAPACITY);
+	}
+
+	~VulkanIndirectDrawList()
+	{
+		for (auto buffer : object_buffers_) delete buffer;
+		for (auto buffer : frustum_buffers_) delete buffer;
+		for (auto buffer : batch_buffers_) delete buffer;
+		delete command_buffer_;
+		delete count_buffer_;
+	}
+
+	// needs multiDrawIndirect and drawIndirectFirstInstance enabled on the device and the spir-v of the compute pass .
+	static bool IsSupported(VulkanDevice * device)
+	{
+		const VkPhysicalDeviceFeatures & features = device->GetEnabledFeatures();
+		return features.multiDrawIndirect == VK_TRUE && features.drawIndirectFirstInstance == VK_TRUE && AssetExists("shaders/BuildDrawCommands.spv");
+	}
+
+	// set of the vertex shaders , the object data at binding 0 .
+	static VkDescriptorSetLayout GetObjectSetLayout(VulkanDevice * device)
+	{
+		VkDescriptorSetLayoutBinding binding = VulkanInitializer::InitBinding(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
+		return device->GetDescriptorSetLayout(VulkanInitializer::InitDescSetLayoutCreateInfo(1, &binding));
+	}
+
+	// set of the compute pass , object data , draw commands , batch counts , frustums and the first command of every batch .
+	static VkDescriptorSetLayout GetBuildSetLayout(VulkanDevice * device)
+	{
+		VkDescriptorSetLayoutBinding bindings[5] = {
+			VulkanInitializer::InitBinding(0 , 1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , VK_SHADER_STAGE_COMPUTE_BIT),
+			VulkanInitializer::InitBinding(1 , 1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , VK_SHADER_STAGE_COMPUTE_BIT),
+			VulkanInitializer::InitBinding(2 , 1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , VK_SHADER_STAGE_COMPUTE_BIT),
+			VulkanInitializer::InitBinding(3 , 1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , VK_SHADER_STAGE_COMPUTE_BIT),
+			VulkanInitializer::InitBinding(4 , 1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , VK_SHADER_STAGE_COMPUTE_BIT)
+		};
+		return device->GetDescriptorSetLayout(VulkanInitializer::InitDescSetLayoutCreateInfo(5, bindings));
+	}
+
+public:
+	void Begin(int frameIndex)
+	{
+		frame_index_ = frameIndex;
+		objects_.clear();
+		batches_.clear();
+		frustums_.frustumCount = 0;
+	}
+
+	// the frustums of the pass , without any every object is visible .
+	void SetFrustums(const VulkanFrustum * frustums, uint32_t frustumCount)
+	{
+		if (frustumCount > INDIRECT_DRAW_MAX_FRUSTUMS)
+		{
+			throw " too many frustums for an indirect draw list . ";
+		}
+		frustums_.frustumCount = frustumCount;
+		for (uint32_t f = 0; f < frustumCount; f++)
+		{
+			for (uint32_t p = 0; p < 6; p++) frustums_.planes[f * 6 + p] = frustums[f].planes[p];
+		}
+	}
+
+	// objects of the same arena and material have to be added one after the other .
+	void Add(const VulkanMesh * mesh, const glm::mat4 & model, IMaterial * material = NULL)
+	{
+		const GeometryRange & geometry = mesh->GetGeometry();
+		if (batches_.size() == 0 || batches_.back().arena != geometry.arena || batches_.back().material != material)
+		{
+			if (batches_.size() == INDIRECT_DRAW_MAX_BATCHES)
+			{
+				throw " too many batches in an indirect draw list . ";
+			}
+			batches_.push_back({ geometry.arena , material , (uint32_t)objects_.size() , 0 });
+		}
+		const Model::Dimension & bounds = mesh->GetBounds();
+		IndirectObjectData object;
+		object.model = model;
+		if (bounds.min.x > bounds.max.x)
+		{
+			object.boundsCenter = glm::vec4(0.0f);
+			object.boundsExtent = glm::vec4(FRUSTUM_CULL_UNBOUNDED_EXTENT);
+		}
+		else
+		{
+			Model::Dimension worldBounds = bounds.Transform(model);
+			object.boundsCenter = glm::vec4((worldBounds.min + worldBounds.max) * 0.5f, 1.0f);
+			object.boundsExtent = glm::vec4((worldBounds.max - worldBounds.min) * 0.5f, 0.0f);
+		}
+		object.indexCount = geometry.index_count;
+		object.firstIndex = geometry.first_index;
+		object.vertexOffset = (int32_t)geometry.vertex_offset;
+		object.batch = (uint32_t)batches_.size() - 1;
+		objects_.push_back(object);
+		batches_.back().commandCount++;
+	}
+
+	// writes the object data , the frustums and the batches of the frame slot and the descriptor sets the frame binds .
+	void End()
+	{
+		if (objects_.size() > capacity_) Reserve((std::max)((uint32_t)objects_.size(), capacity_ * 2));
+		VulkanBuffer * objectBuffer = object_buffers_[frame_index_];
+		if (objects_.size() != 0) memcpy(objectBuffer->GetMappedMemory(), objects_.data(), objects_.size() * sizeof(IndirectObjectData));
+		VulkanBuffer * frustumBuffer = frustum_buffers_[frame_index_];
+		memcpy(frustumBuffer->GetMappedMemory(), &frustums_, sizeof(IndirectFrustumData));
+		VulkanBuffer * batchBuffer = batch_buffers_[frame_index_];
+		uint32_t * batchFirst = (uint32_t*)batchBuffer->GetMappedMemory();
+		for (size_t i = 0; i < batches_.size(); i++) batchFirst[i] = batches_[i].firstCommand;
+
+		VulkanDescriptorAllocator * allocator = device_->GetDescriptorAllocator();
+		object_set_ = allocator->AllocateTransient(GetObjectSetLayout(device_));
+		build_set_ = allocator->AllocateTransient(GetBuildSetLayout(device_));
+		VkWriteDescriptorSet writeDescs[6] = {
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 0 , object_set_ , &objectBuffer->GetDesc()),
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 0 , build_set_ , &objectBuffer->GetDesc()),
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 1 , build_set_ , &command_buffer_->GetDesc()),
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 2 , build_set_ , &count_buffer_->GetDesc()),
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 3 , build_set_ , &frustumBuffer->GetDesc()),
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 4 , build_set_ , &batchBuffer->GetDesc())
+		};
+		vkUpdateDescriptorSets(device_->GetDevice(), 6, writeDescs, 0, NULL);
+	}
+
+	// one indirect draw per batch , the pipeline reading the object set at objectSetIndex is bound .
+	// with bindMaterial the material of a batch is bound before its draw , the material sets come from the layout of
+	// the pass without the object set , so the object set is bound again after them .
+	void Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t objectSetIndex, BindMaterial bindMaterial = NULL) const
+	{
+		if (objects_.size() == 0) return;
+		if (bindMaterial == NULL) vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, objectSetIndex, 1, &object_set_, 0, NULL);
+		VkBuffer commands = command_buffer_->GetDesc().buffer;
+		const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+		for (size_t i = 0; i < batches_.size(); i++)
+		{
+			const Batch & batch = batches_[i];
+			if (bindMaterial != NULL && (i == 0 || batches_[i - 1].material != batch.material))
+			{
+				bindMaterial(commandBuffer, batch.material);
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, objectSetIndex, 1, &object_set_, 0, NULL);
+			}
+			if (i == 0 || batches_[i - 1].arena != batch.arena) batch.arena->Bind(commandBuffer);
+			if (IsCompacted())
+			{
+				device_->CmdDrawIndexedIndirectCount(commandBuffer, commands, batch.firstCommand * stride, count_buffer_->GetDesc().buffer, i * sizeof(uint32_t), batch.commandCount, stride);
+			}
+			else
+			{
+				vkCmdDrawIndexedIndirect(commandBuffer, commands, batch.firstCommand * stride, batch.commandCount, stride);
+			}
+		}
+	}
+
+	// the compute passes count the commands of every batch with atomics , they start from zero .
+	void ClearCounts(VkCommandBuffer commandBuffer) const
+	{
+		vkCmdFillBuffer(commandBuffer, count_buffer_->GetDesc().buffer, 0, batches_.size() * sizeof(uint32_t), 0);
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+	}
+
+	bool IsCompacted() const { return device_->HasDrawIndirectCount(); }
+	uint32_t GetObjectCount() const { return (uint32_t)objects_.size(); }
+	const std::vector<Batch> & GetBatches() const { return batches_; }
+	VkDescriptorSet GetBuildSet() const { return build_set_; }
+
+private:
+	// frames in flight may still read the old buffers , they go through the deletion queue .
+	void Reserve(uint32_t capacity)
+	{
+		VulkanDeletionQueue * deletionQueue = device_->GetDeletionQueue();
+		for (auto & buffer : object_buffers_)
+		{
+			deletionQueue->Delete(buffer);
+			buffer = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				capacity * sizeof(IndirectObjectData), MEMORY_CATEGORY_OTHER);
+			buffer->Map();
+		}
+		deletionQueue->Delete(command_buffer_);
+		command_buffer_ = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, capacity * sizeof(VkDrawIndexedIndirectCommand), MEMORY_CATEGORY_OTHER);
+		capacity_ = capacity;
+	}
+
+private:
+	VulkanDevice * device_;
+	int frame_index_ = 0;
+	uint32_t capacity_ = 0;
+	std::vector<IndirectObjectData> objects_;
+	std::vector<Batch> batches_;
+	IndirectFrustumData frustums_ = {};
+	std::vector<VulkanBuffer*> object_buffers_;
+	std::vector<VulkanBuffer*> frustum_buffers_;
+	std::vector<VulkanBuffer*> batch_buffers_;
+	VulkanBuffer * command_buffer_ = NULL;
+	VulkanBuffer * count_buffer_ = NULL;
+	VkDescriptorSet object_set_ = VK_NULL_HANDLE;
+	VkDescriptorSet build_set_ = VK_NULL_HANDLE;
+};
+
+#endif
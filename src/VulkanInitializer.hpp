@@ -15,24 +15,47 @@ public:
 		return commandBufferBeginInfo;
 	}
 
+	static VkCommandBufferInheritanceInfo InitCommandBufferInheritanceInfo( VkRenderPass renderPass , uint32_t subpass , VkFramebuffer frameBuffer )
+	{
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.subpass = subpass;
+		inheritanceInfo.framebuffer = frameBuffer;
+		return inheritanceInfo;
+	}
+
 	static VkRenderPassBeginInfo InitRenderPassBeginInfo( 
 		VkRenderPass renderPass , 
 		VkFramebuffer frameBuffer , 
-		std::vector<VkClearValue> & clearValues , 
+		const VkClearValue * clearValues , 
+		uint32_t clearValueCount , 
 		int width , 
 		int height )
 	{
 		VkRenderPassBeginInfo renderPassBeginInfo = {};
 		renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 		renderPassBeginInfo.framebuffer = frameBuffer;
-		renderPassBeginInfo.pClearValues = clearValues.data();
-		renderPassBeginInfo.clearValueCount = clearValues.size();
+		renderPassBeginInfo.pClearValues = clearValues;
+		renderPassBeginInfo.clearValueCount = clearValueCount;
 		renderPassBeginInfo.renderPass = renderPass;
 		renderPassBeginInfo.renderArea.extent.width = width;
 		renderPassBeginInfo.renderArea.extent.height = height;
 		return renderPassBeginInfo;
 	}
 
+	// the frame path passes fixed arrays , the vector form is left to code running once .
+	template <size_t N>
+	static VkRenderPassBeginInfo InitRenderPassBeginInfo( VkRenderPass renderPass , VkFramebuffer frameBuffer , const VkClearValue ( & clearValues )[N] , int width , int height )
+	{
+		return InitRenderPassBeginInfo(renderPass, frameBuffer, clearValues, N, width, height);
+	}
+
+	static VkRenderPassBeginInfo InitRenderPassBeginInfo( VkRenderPass renderPass , VkFramebuffer frameBuffer , const std::vector<VkClearValue> & clearValues , int width , int height )
+	{
+		return InitRenderPassBeginInfo(renderPass, frameBuffer, clearValues.data(), clearValues.size(), width, height);
+	}
+
 	static VkViewport InitViewport( int x , int y , int width , int height , float minDepth , float maxDepth )
 	{
 		VkViewport view;
@@ -6,16 +6,86 @@
 #include "PbrLightPipeline.h"
 #include "GBufferPipeline.h"
 #include "imgui.h"
-#include <unordered_map>
+#include "VulkanResourceRegistry.h"
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanDeletionQueue.h"
 
+// Descriptor sets come from the shared allocator of the device and are written when the material is created .
+// A change moves the material to freshly written sets instead of rewriting the bound ones , frames in flight may
+// still use them , so recording only binds .
 class IMaterial
 {
 public:
-	virtual ~IMaterial() {};
+	virtual ~IMaterial()
+	{
+		FreeDescriptorSets();
+	};
 	virtual void UpdatePipelineData() = 0;
 	virtual void UpdateImgui() = 0 ;
 	virtual void SetupCommandBuffer( VkCommandBuffer & commandBuffer ) = 0 ;
 	virtual void SetPipeline(IRenderingPipeline * renderingPipeline ) = 0 ;
+
+	// bumped whenever a descriptor input changes , recorded command buffers that use the material are then re-recorded .
+	uint32_t GetVersion() const { return version_; }
+	void MarkDirty() { version_++; UpdateDescriptorSets(); }
+
+	// frames in flight may still record or bind the material , it is deleted once they are done .
+	static void Release(IMaterial * material)
+	{
+		if (material == NULL) return;
+		if (material->device_ == NULL)
+		{
+			delete material;
+			return;
+		}
+		material->device_->GetDeletionQueue()->Delete(material);
+	}
+
+	// the textures the descriptor sets sample , at most MATERIAL_MAX_TEXTURES .
+	virtual int GetTextures(Texture ** textures) const { return 0; }
+
+	// rewrites the descriptor sets when one of the textures was evicted or loaded again since they were written .
+	void UpdateTextureResidency()
+	{
+		if (GetTextureVersion() != texture_version_) MarkDirty();
+	}
+
+protected:
+	virtual void UpdateDescriptorSets() {}
+
+	void AllocateDescriptorSets(const VkDescriptorSetLayout * layouts, size_t count)
+	{
+		FreeDescriptorSets();
+		texture_version_ = GetTextureVersion();
+		VulkanDescriptorAllocator * allocator = device_->GetDescriptorAllocator();
+		desc_set_layout_vec_.assign(layouts, layouts + count);
+		desc_set_vec_.resize(count);
+		for (size_t i = 0; i < count; i++) desc_set_vec_[i] = allocator->Allocate(layouts[i]);
+	}
+
+	void FreeDescriptorSets()
+	{
+		if (desc_set_vec_.size() == 0) return;
+		VulkanDescriptorAllocator * allocator = device_->GetDescriptorAllocator();
+		for (size_t i = 0; i < desc_set_vec_.size(); i++) allocator->Free(desc_set_vec_[i], desc_set_layout_vec_[i]);
+		desc_set_vec_.clear();
+	}
+
+	uint32_t GetTextureVersion() const
+	{
+		Texture * textures[MATERIAL_MAX_TEXTURES];
+		int count = GetTextures(textures);
+		uint32_t version = 0;
+		for (int i = 0; i < count; i++) version += textures[i]->residency_version_;
+		return version;
+	}
+
+protected:
+	uint32_t version_ = 0;
+	uint32_t texture_version_ = 0;
+	VulkanDevice * device_ = NULL;
+	std::vector<VkDescriptorSet> desc_set_vec_;
+	std::vector<VkDescriptorSetLayout> desc_set_layout_vec_;
 };
 
 class EmptyMaterial : public IMaterial
@@ -37,50 +107,19 @@ public:
 		normal_image_ = normal;
 		pipeline_ = pipeline;
 		device_ = device;
-		CreateDescriptorSet(device);
+		UpdateDescriptorSets();
 	}
 
-	void CreateDescriptorSet( VulkanDevice * device  )
+	~ForwardLightPassMaterial()
 	{
-		VkDescriptorSetLayoutBinding matBinding = VulkanInitializer::InitBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT);
-		VkDescriptorSetLayoutBinding samplerBinding[2] = {
-			VulkanInitializer::InitBinding(0 , 1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(1  , 1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , VK_SHADER_STAGE_FRAGMENT_BIT)
-		};
-		VkDescriptorSetLayoutBinding lightBuffer[2] = {
-			VulkanInitializer::InitBinding(0 , 1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(1 , 1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , VK_SHADER_STAGE_FRAGMENT_BIT)
-		};
-		std::vector<VkDescriptorSetLayoutCreateInfo> descSetLayoutCreateInfo = {
-			VulkanInitializer::InitDescSetLayoutCreateInfo(1 , &matBinding),
-			VulkanInitializer::InitDescSetLayoutCreateInfo(2 , samplerBinding),
-			VulkanInitializer::InitDescSetLayoutCreateInfo(2 , lightBuffer)
-		};
-
-		std::vector<VkDescriptorType> descTypeVec =
-		{
-			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER  ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ,
-			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ,
-			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
-		};
-		desc_set_vec_.resize(descSetLayoutCreateInfo.size());
-		std::vector<VkDescriptorPoolSize> descPoolSize = VulkanInitializer::InitDescriptorPoolSizeVec(descTypeVec);
-		VkDescriptorPoolCreateInfo descPoolCreateInfo = VulkanInitializer::InitDescriptorPoolCreateInfo(descPoolSize, descSetLayoutCreateInfo.size());
-		VULKAN_SUCCESS(vkCreateDescriptorPool(device->GetDevice(), &descPoolCreateInfo, NULL, &desc_pool_));
-
-		for (int i = 0; i < descSetLayoutCreateInfo.size(); i++)
-		{
-			VkDescriptorSetAllocateInfo allocateInfo = VulkanInitializer::InitDescriptorSetAllocateInfo(1, desc_pool_, &pipeline_->desc_set_layout_vec_[i]);
-			VULKAN_SUCCESS(vkAllocateDescriptorSets(device->GetDevice(), &allocateInfo, &desc_set_vec_[i]));
-		}
 
 	}
 
-	~ForwardLightPassMaterial()
+	int GetTextures(Texture ** textures) const
 	{
-
+		textures[0] = albedo_image_;
+		textures[1] = normal_image_;
+		return 2;
 	}
 
 	void UpdatePipelineData() 
@@ -96,15 +135,9 @@ public:
 
 	void SetupCommandBuffer(VkCommandBuffer & commandBuffer)
 	{
-		VkWriteDescriptorSet writeDescs[5] = {
-			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , 0 , desc_set_vec_[0] , &pipeline_->transform_mat_uniform_buffer_->GetDesc()),
-			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 0 , desc_set_vec_[1] , &albedo_image_->image_info_),
-			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 1 , desc_set_vec_[1] , &normal_image_->image_info_),
-			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 0 , desc_set_vec_[2] , &pipeline_->light_visible_buffer_->GetDesc()),
-			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , 1 , desc_set_vec_[2] , &pipeline_->pointlight_uniform_buffer_->GetDesc())
-		};
-		vkUpdateDescriptorSets(device_->GetDevice(), 5, writeDescs, 0, NULL);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_->pipeline_layout_, 0, desc_set_vec_.size(), desc_set_vec_.data(), 0, NULL);
+		uint32_t dynamicOffsets[ForwardPlusLightPassPipeline::DYNAMIC_OFFSET_COUNT];
+		pipeline_->GetDynamicOffsets(dynamicOffsets);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_->pipeline_layout_, 0, desc_set_vec_.size(), desc_set_vec_.data(), ForwardPlusLightPassPipeline::DYNAMIC_OFFSET_COUNT, dynamicOffsets);
 	}
 
 	void SetPipeline(IRenderingPipeline * renderingPipeline)
@@ -116,13 +149,24 @@ public:
 		}
 	}
 
+protected:
+	void UpdateDescriptorSets()
+	{
+		AllocateDescriptorSets(pipeline_->desc_set_layout_vec_.data(), 3);
+		VkWriteDescriptorSet writeDescs[5] = {
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , 0 , desc_set_vec_[0] , &pipeline_->transform_uniform_info_),
+			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 0 , desc_set_vec_[1] , &albedo_image_->image_info_),
+			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 1 , desc_set_vec_[1] , &normal_image_->image_info_),
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 0 , desc_set_vec_[2] , &pipeline_->light_visible_buffer_->GetDesc()),
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , 1 , desc_set_vec_[2] , &pipeline_->pointlight_uniform_info_)
+		};
+		vkUpdateDescriptorSets(device_->GetDevice(), 5, writeDescs, 0, NULL);
+	}
+
 private:
 	Texture2D * albedo_image_;
 	Texture2D * normal_image_;
 	ForwardPlusLightPassPipeline * pipeline_;
-	VkDescriptorPool desc_pool_;
-	std::vector<VkDescriptorSet> desc_set_vec_;
-	VulkanDevice * device_;
 };
 
 class PbrLightPassMaterial : public IMaterial
@@ -136,7 +180,7 @@ public:
 
 	PbrLightPassMaterial(Texture2D * albedoTex , Texture2D * normalTex, Texture2D * aoTex ,  Texture2D * metallicTex , 
 	Texture2D * roughnessTex, VulkanImage * irradianceTex, Texture2D * brdfLutTex , VulkanImage * prefilterTex ,
-		VulkanDevice * device , PBRLightPipeline * lightPipeline , std::unordered_map<std::string, Texture*> & textures) : textures_(textures)
+		VulkanDevice * device , PBRLightPipeline * lightPipeline , const VulkanResourcePool<Texture> & textures) : textures_(textures)
 	{
 		albedo_texture_ = albedoTex;
 		normal_texture_ = normalTex;
@@ -155,57 +199,17 @@ public:
 		tex_entry_.roughness_texture_name_ = &roughnessTexName[0];
 		tex_entry_.normal_texture_name_ = &normalTexName[0];
 
-		CreateDescriptorSet(device);
-	}
-
-	void CreateDescriptorSet(VulkanDevice * device)
-	{
-		VkDescriptorSetLayoutBinding binding[9] =
-		{
-			VulkanInitializer::InitBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(1, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(2, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(3, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(4, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(5, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(6, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(7, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(8, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-		};
-		VkDescriptorSetLayoutBinding shadowBinding[2] =
-		{
-			VulkanInitializer::InitBinding(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(1, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
-		};
-		std::vector<VkDescriptorSetLayoutCreateInfo> descSetLayoutCreateInfo = {
-			VulkanInitializer::InitDescSetLayoutCreateInfo(9 , binding),
-			VulkanInitializer::InitDescSetLayoutCreateInfo(2 , shadowBinding)
-		};
-		std::vector<VkDescriptorType> descTypeVec =
+		// the editor choices are resolved once , a texture missing from the texture list can not be selected .
+		for (int n = 0; n < 2; n++)
 		{
-			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER  ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ,
-			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER  ,
-		};
-		desc_set_vec_.resize(2);
-		std::vector<VkDescriptorPoolSize> descPoolSize = VulkanInitializer::InitDescriptorPoolSizeVec(descTypeVec);
-		VkDescriptorPoolCreateInfo descPoolCreateInfo = VulkanInitializer::InitDescriptorPoolCreateInfo(descPoolSize, descSetLayoutCreateInfo.size());
-		VULKAN_SUCCESS(vkCreateDescriptorPool(device->GetDevice(), &descPoolCreateInfo, NULL, &desc_pool_));
-
-		for (int i = 0; i < descSetLayoutCreateInfo.size(); i++)
-		{
-			VkDescriptorSetAllocateInfo allocateInfo = VulkanInitializer::InitDescriptorSetAllocateInfo(1, desc_pool_, &pipeline_->desc_set_layout_vec_[i]);
-			VULKAN_SUCCESS(vkAllocateDescriptorSets(device->GetDevice(), &allocateInfo, &desc_set_vec_[i]));
+			tex_entry_.albedo_handles_[n] = textures.Find(albedoTexName[n]);
+			tex_entry_.ao_handles_[n] = textures.Find(aoTexName[n]);
+			tex_entry_.metallic_handles_[n] = textures.Find(metallicTexName[n]);
+			tex_entry_.roughness_handles_[n] = textures.Find(roughnessTexName[n]);
+			tex_entry_.normal_handles_[n] = textures.Find(normalTexName[n]);
 		}
 
+		UpdateDescriptorSets();
 	}
 
 	~PbrLightPassMaterial()
@@ -213,6 +217,17 @@ public:
 
 	}
 
+	int GetTextures(Texture ** textures) const
+	{
+		textures[0] = brdf_lut_texture_;
+		textures[1] = albedo_texture_;
+		textures[2] = normal_texture_;
+		textures[3] = ao_texture_;
+		textures[4] = metallic_texture_;
+		textures[5] = roughness_texture_;
+		return 6;
+	}
+
 	void UpdatePipelineData()
 	{
 
@@ -222,15 +237,20 @@ public:
 	{
 		if (ImGui::TreeNode("PBR Material"))
 		{
-			auto BuildCombo = [&](const char * paramName , const char **& param ,const char ** paramList , int paramSize  )->void
+			auto BuildCombo = [&](const char * paramName , const char **& param ,const char ** paramList , const TextureHandle * handles , int paramSize , Texture2D *& texture )->void
 			{
 				if (ImGui::BeginCombo( paramName , *param, 0))
 				{
 					for (int n = 0; n < paramSize; n++)
 					{
 						bool is_selected = (param == &paramList[n]);
-						if (ImGui::Selectable(paramList[n], is_selected))
+						Texture * selected = textures_.TryGet(handles[n]);
+						if (ImGui::Selectable(paramList[n], is_selected) && !is_selected && selected != NULL)
+						{
 							param = &paramList[n];
+							texture = dynamic_cast<Texture2D*>(selected);
+							MarkDirty();
+						}
 						if (is_selected)
 							ImGui::SetItemDefaultFocus();
 					}
@@ -238,17 +258,11 @@ public:
 				}
 			};
 
-			BuildCombo(&"Albedo"[0], tex_entry_.albedo_texture_name_, &albedoTexName[0] , sizeof(albedoTexName) / sizeof(albedoTexName[0]));
-			BuildCombo(&"Ao"[0], tex_entry_.ao_texture_name_, &aoTexName[0], sizeof(aoTexName) / sizeof(aoTexName[0]));
-			BuildCombo(&"Normal"[0], tex_entry_.normal_texture_name_, &normalTexName[0], sizeof(normalTexName) / sizeof(normalTexName[0]));
-			BuildCombo(&"Metallic"[0], tex_entry_.metallic_texture_name_, &metallicTexName[0], sizeof(metallicTexName) / sizeof(metallicTexName[0]));
-			BuildCombo(&"Roughness"[0], tex_entry_.roughness_texture_name_, &roughnessTexName[0], sizeof(roughnessTexName) / sizeof(roughnessTexName[0]));
-
-			albedo_texture_ = dynamic_cast<Texture2D*>( (*textures_.find(*tex_entry_.albedo_texture_name_)).second );
-			ao_texture_ = dynamic_cast<Texture2D*>((*textures_.find(*tex_entry_.ao_texture_name_)).second);
-			normal_texture_ = dynamic_cast<Texture2D*>((*textures_.find(*tex_entry_.normal_texture_name_)).second);
-			metallic_texture_ = dynamic_cast<Texture2D*>((*textures_.find(*tex_entry_.metallic_texture_name_)).second);
-			roughness_texture_ = dynamic_cast<Texture2D*>((*textures_.find(*tex_entry_.roughness_texture_name_)).second);
+			BuildCombo(&"Albedo"[0], tex_entry_.albedo_texture_name_, &albedoTexName[0], tex_entry_.albedo_handles_, sizeof(albedoTexName) / sizeof(albedoTexName[0]), albedo_texture_);
+			BuildCombo(&"Ao"[0], tex_entry_.ao_texture_name_, &aoTexName[0], tex_entry_.ao_handles_, sizeof(aoTexName) / sizeof(aoTexName[0]), ao_texture_);
+			BuildCombo(&"Normal"[0], tex_entry_.normal_texture_name_, &normalTexName[0], tex_entry_.normal_handles_, sizeof(normalTexName) / sizeof(normalTexName[0]), normal_texture_);
+			BuildCombo(&"Metallic"[0], tex_entry_.metallic_texture_name_, &metallicTexName[0], tex_entry_.metallic_handles_, sizeof(metallicTexName) / sizeof(metallicTexName[0]), metallic_texture_);
+			BuildCombo(&"Roughness"[0], tex_entry_.roughness_texture_name_, &roughnessTexName[0], tex_entry_.roughness_handles_, sizeof(roughnessTexName) / sizeof(roughnessTexName[0]), roughness_texture_);
 
 			ImGui::TreePop();
 		}
@@ -256,8 +270,26 @@ public:
 
 	void SetupCommandBuffer(VkCommandBuffer & commandBuffer)
 	{
+		uint32_t dynamicOffsets[PBRLightPipeline::DYNAMIC_OFFSET_COUNT];
+		pipeline_->GetDynamicOffsets(dynamicOffsets);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_->pipeline_layout_, 0, desc_set_vec_.size(), desc_set_vec_.data(), PBRLightPipeline::DYNAMIC_OFFSET_COUNT, dynamicOffsets);
+	}
+
+	void SetPipeline(IRenderingPipeline * renderingPipeline)
+	{
+		pipeline_ = dynamic_cast<PBRLightPipeline*>(renderingPipeline);
+		if (pipeline_ == NULL)
+		{
+			throw "Unexpected pipeline . ";
+		}
+	}
+
+protected:
+	void UpdateDescriptorSets()
+	{
+		AllocateDescriptorSets(pipeline_->desc_set_layout_vec_.data(), 2);
 		VkWriteDescriptorSet writeDescs[11] = {
-			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , 0 , desc_set_vec_[0] , &pipeline_->uniform_buffer_->GetDesc()),
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , 0 , desc_set_vec_[0] , &pipeline_->uniform_info_),
 			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 1 , desc_set_vec_[0] , &irradiance_texture_->GetDescriptorImageInfo(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)),
 			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 2 , desc_set_vec_[0] , &brdf_lut_texture_->image_info_),
 			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 3 , desc_set_vec_[0] , &prefileter_texture_->GetDescriptorImageInfo(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)),
@@ -267,19 +299,9 @@ public:
 			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 7 , desc_set_vec_[0] , &metallic_texture_->image_info_),
 			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 8 , desc_set_vec_[0] , &roughness_texture_->image_info_),
 			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 0 , desc_set_vec_[1] , &pipeline_->shadow_map_image_->GetDescriptorImageInfo(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)),
-			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , 1 , desc_set_vec_[1] , &pipeline_->cascade_transform_buffer_->GetDesc())
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , 1 , desc_set_vec_[1] , &pipeline_->cascade_transform_info_)
 		};
 		vkUpdateDescriptorSets(device_->GetDevice(), 11, writeDescs, 0, NULL);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_->pipeline_layout_, 0, desc_set_vec_.size(), desc_set_vec_.data(), 0, NULL);
-	}
-
-	void SetPipeline(IRenderingPipeline * renderingPipeline)
-	{
-		pipeline_ = dynamic_cast<PBRLightPipeline*>(renderingPipeline);
-		if (pipeline_ == NULL)
-		{
-			throw "Unexpected pipeline . ";
-		}
 	}
 
 private:
@@ -293,10 +315,7 @@ private:
 	Texture2D * roughness_texture_;
 
 	PBRLightPipeline * pipeline_;
-	VkDescriptorPool desc_pool_;
-	std::vector<VkDescriptorSet> desc_set_vec_;
-	VulkanDevice * device_;
-	const std::unordered_map<std::string, Texture*> & textures_;
+	const VulkanResourcePool<Texture> & textures_;
 
 	struct PBRTextureEntry
 	{
@@ -305,6 +324,11 @@ private:
 		const char ** ao_texture_name_;
 		const char ** metallic_texture_name_;
 		const char ** roughness_texture_name_;
+		TextureHandle albedo_handles_[2];
+		TextureHandle normal_handles_[2];
+		TextureHandle ao_handles_[2];
+		TextureHandle metallic_handles_[2];
+		TextureHandle roughness_handles_[2];
 	}tex_entry_;
 };
 
@@ -320,47 +344,22 @@ public:
 		roughness_texture_ = roughnessTex;
 		device_ = device;
 		pipeline_ = pipeline;
-		CreateDescriptorSet(device);
+		UpdateDescriptorSets();
 	}
 
-	void CreateDescriptorSet(VulkanDevice * device)
+	~TBDRMaterial()
 	{
-		VkDescriptorSetLayoutBinding binding[5] =
-		{
-			VulkanInitializer::InitBinding(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(1, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(2, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(3, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-			VulkanInitializer::InitBinding(4, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-		};
-
-		std::vector<VkDescriptorSetLayoutCreateInfo> descSetLayoutCreateInfo = {
-			VulkanInitializer::InitDescSetLayoutCreateInfo(5, binding)
-		};
-		std::vector<VkDescriptorType> descTypeVec =
-		{
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER  ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER 
-		};
-		desc_set_vec_.resize(1);
-		std::vector<VkDescriptorPoolSize> descPoolSize = VulkanInitializer::InitDescriptorPoolSizeVec(descTypeVec);
-		VkDescriptorPoolCreateInfo descPoolCreateInfo = VulkanInitializer::InitDescriptorPoolCreateInfo(descPoolSize, descSetLayoutCreateInfo.size());
-		VULKAN_SUCCESS(vkCreateDescriptorPool(device->GetDevice(), &descPoolCreateInfo, NULL, &desc_pool_));
-
-		for (int i = 0; i < descSetLayoutCreateInfo.size(); i++)
-		{
-			VkDescriptorSetAllocateInfo allocateInfo = VulkanInitializer::InitDescriptorSetAllocateInfo(1, desc_pool_, &pipeline_->desc_set_layout_);
-			VULKAN_SUCCESS(vkAllocateDescriptorSets(device->GetDevice(), &allocateInfo, &desc_set_vec_[i]));
-		}
 
 	}
 
-	~TBDRMaterial()
+	int GetTextures(Texture ** textures) const
 	{
-
+		textures[0] = albedo_texture_;
+		textures[1] = normal_texture_;
+		textures[2] = ao_texture_;
+		textures[3] = metallic_texture_;
+		textures[4] = roughness_texture_;
+		return 5;
 	}
 
 	void UpdatePipelineData()
@@ -374,16 +373,9 @@ public:
 
 	void SetupCommandBuffer(VkCommandBuffer & commandBuffer)
 	{
-		VkWriteDescriptorSet writeDescs[5] = {
-			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 0 , desc_set_vec_[0] , &albedo_texture_->image_info_),
-			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 1 , desc_set_vec_[0] , &normal_texture_->image_info_),
-			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 2 , desc_set_vec_[0] , &ao_texture_->image_info_),
-			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 3 , desc_set_vec_[0] , &metallic_texture_->image_info_),
-			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 4 , desc_set_vec_[0] , &roughness_texture_->image_info_)
-		};
-
-		vkUpdateDescriptorSets(device_->GetDevice(), 5, writeDescs, 0, NULL);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_->pipeline_layout_, 0, desc_set_vec_.size(), desc_set_vec_.data(), 0, NULL);
+		uint32_t dynamicOffsets[GBufferPipeline::DYNAMIC_OFFSET_COUNT];
+		pipeline_->GetDynamicOffsets(dynamicOffsets);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_->pipeline_layout_, 0, desc_set_vec_.size(), desc_set_vec_.data(), GBufferPipeline::DYNAMIC_OFFSET_COUNT, dynamicOffsets);
 	}
 
 	void SetPipeline(IRenderingPipeline * renderingPipeline)
@@ -395,6 +387,21 @@ public:
 		}
 	}
 
+protected:
+	void UpdateDescriptorSets()
+	{
+		AllocateDescriptorSets(&pipeline_->desc_set_layout_, 1);
+		VkWriteDescriptorSet writeDescs[6] = {
+			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 0 , desc_set_vec_[0] , &albedo_texture_->image_info_),
+			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 1 , desc_set_vec_[0] , &normal_texture_->image_info_),
+			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 2 , desc_set_vec_[0] , &ao_texture_->image_info_),
+			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 3 , desc_set_vec_[0] , &metallic_texture_->image_info_),
+			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 4 , desc_set_vec_[0] , &roughness_texture_->image_info_),
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , 5 , desc_set_vec_[0] , &pipeline_->camera_uniform_info_)
+		};
+		vkUpdateDescriptorSets(device_->GetDevice(), 6, writeDescs, 0, NULL);
+	}
+
 private:
 	Texture2D * albedo_texture_;
 	Texture2D * normal_texture_;
@@ -403,9 +410,6 @@ private:
 	Texture2D * roughness_texture_;
 
 	GBufferPipeline * pipeline_;
-	VkDescriptorPool desc_pool_;
-	std::vector<VkDescriptorSet> desc_set_vec_;
-	VulkanDevice * device_;
 };
 
 
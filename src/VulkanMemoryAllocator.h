@@ -0,0 +1,664 @@
+#ifndef _VULKAN_MEMORY_ALLOCATOR_H_
+#define _VULKAN_MEMORY_ALLOCATOR_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+
+#define MEMORY_ALLOCATOR_BLOCK_SIZE ( 64ull * 1024 * 1024 )
+#define MEMORY_ALLOCATOR_SL_LOG2 4
+#define MEMORY_ALLOCATOR_SL_COUNT ( 1 << MEMORY_ALLOCATOR_SL_LOG2 )
+#define MEMORY_ALLOCATOR_FL_COUNT 32
+// sizes below are kept in one linear first level class .
+#define MEMORY_ALLOCATOR_SMALL_LOG2 8
+
+// what an allocation is used for , every buffer and image allocation is tagged with one .
+enum MemoryCategory
+{
+	MEMORY_CATEGORY_MESH,
+	MEMORY_CATEGORY_TEXTURE,
+	MEMORY_CATEGORY_RENDER_TARGET,
+	MEMORY_CATEGORY_SHADOW,
+	MEMORY_CATEGORY_IBL,
+	MEMORY_CATEGORY_UI,
+	MEMORY_CATEGORY_STAGING,
+	// uniform and storage buffers written by the renderer itself .
+	MEMORY_CATEGORY_OTHER,
+	MEMORY_CATEGORY_COUNT
+};
+
+inline const char * GetMemoryCategoryName(MemoryCategory category)
+{
+	static const char * names[MEMORY_CATEGORY_COUNT] = { "mesh" , "texture" , "render target" , "shadow" , "ibl" , "ui" , "staging" , "other" };
+	return names[category];
+}
+
+// the default budget of a category , a share of the largest device local heap . the shares add up to the whole heap ,
+// staging counts against it as well since its ranges come from the same process budget .
+inline float GetMemoryCategoryDefaultShare(MemoryCategory category)
+{
+	static const float shares[MEMORY_CATEGORY_COUNT] = { 0.15f , 0.4f , 0.15f , 0.1f , 0.05f , 0.01f , 0.05f , 0.09f };
+	return shares[category];
+}
+
+struct VulkanAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	// start of the allocation in the persistent mapping , NULL when the memory is not host visible .
+	void * mapped = NULL;
+	uint32_t memory_type = 0;
+	MemoryCategory category = MEMORY_CATEGORY_OTHER;
+
+	// owner block and chunk , block is -1 for a dedicated allocation .
+	int pool = -1;
+	int block = -1;
+	int chunk = -1;
+};
+
+struct VulkanMemoryStats
+{
+	uint32_t block_count = 0;
+	uint32_t dedicated_count = 0;
+	uint32_t allocation_count = 0;
+	// memory taken from the driver and the part of it handed out .
+	VkDeviceSize allocated_bytes = 0;
+	VkDeviceSize used_bytes = 0;
+	VkDeviceSize largest_free_range = 0;
+};
+
+// used_bytes includes the alignment padding of the ranges , budget_bytes is 0 when no budget was set .
+struct VulkanCategoryStats
+{
+	uint32_t allocation_count = 0;
+	VkDeviceSize used_bytes = 0;
+	VkDeviceSize budget_bytes = 0;
+};
+
+struct VulkanHeapStats
+{
+	VkDeviceSize heap_size = 0;
+	bool device_local = false;
+	// memory of this allocator , summed over the memory types of the heap .
+	VkDeviceSize allocated_bytes = 0;
+	VkDeviceSize used_bytes = 0;
+	// VK_EXT_memory_budget , the usage of the whole process and what it may use , 0 without the extension .
+	VkDeviceSize budget_usage_bytes = 0;
+	VkDeviceSize budget_bytes = 0;
+};
+
+// Sub allocates device memory out of large blocks , one list of blocks per memory type .
+// Ranges inside a block are managed by a two level segregated fit allocator , the free ranges are bucketed by the
+// log2 of their size and by MEMORY_ALLOCATOR_SL_COUNT linear steps below it , so finding a range and freeing one
+// are constant time , neighbouring free ranges are merged on free .
+// When bufferImageGranularity is larger than one , linear resources and optimal images get separate blocks , so the
+// granularity never has to be checked between neighbours . Requests larger than half a block get their own memory .
+// Host visible blocks stay mapped for their whole life .
+// Usage is kept per memory type and per MemoryCategory , memory allocated outside of the allocator , like the
+// aliased heaps of the transient images , is reported with AddExternal and RemoveExternal .
+class VulkanMemoryAllocator
+{
+public:
+	VulkanMemoryAllocator(VkDevice device, const VkPhysicalDeviceMemoryProperties & memoryProperties, const VkPhysicalDeviceLimits & limits)
+		: device_(device), memory_properties_(memoryProperties)
+	{
+		buffer_image_granularity_ = limits.bufferImageGranularity;
+		non_coherent_atom_size_ = limits.nonCoherentAtomSize;
+		pools_.resize(memory_properties_.memoryTypeCount * 2);
+
+		VkDeviceSize deviceLocalSize = 0;
+		for (uint32_t i = 0; i < memory_properties_.memoryHeapCount; i++)
+		{
+			if ((memory_properties_.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == 0) continue;
+			deviceLocalSize = (std::max)(deviceLocalSize, memory_properties_.memoryHeaps[i].size);
+		}
+		for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+		{
+			category_stats_[i].budget_bytes = (VkDeviceSize)(deviceLocalSize * GetMemoryCategoryDefaultShare((MemoryCategory)i));
+		}
+	}
+
+	~VulkanMemoryAllocator()
+	{
+		for (auto & pool : pools_)
+		{
+			for (auto & block : pool.blocks)
+			{
+				if (block.memory != VK_NULL_HANDLE) vkFreeMemory(device_, block.memory, NULL);
+			}
+		}
+	}
+
+public:
+	// optimal is true for images with optimal tiling .
+	VulkanAllocation Allocate(uint32_t memoryType, const VkMemoryRequirements & requirements, bool optimal, MemoryCategory category)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		VulkanAllocation allocation;
+		allocation.memory_type = memoryType;
+		allocation.size = requirements.size;
+		allocation.category = category;
+
+		VkDeviceSize blockSize = GetBlockSize(memoryType);
+		if (requirements.size > blockSize / 2)
+		{
+			allocation.memory = AllocateDeviceMemory(memoryType, requirements.size, &allocation.mapped);
+			stats_[memoryType].dedicated_count++;
+			stats_[memoryType].allocation_count++;
+			stats_[memoryType].allocated_bytes += requirements.size;
+			stats_[memoryType].used_bytes += requirements.size;
+			category_stats_[category].allocation_count++;
+			category_stats_[category].used_bytes += requirements.size;
+			return allocation;
+		}
+
+		allocation.pool = memoryType * 2 + (optimal && buffer_image_granularity_ > 1 ? 1 : 0);
+		Pool & pool = pools_[allocation.pool];
+		for (size_t b = 0; b < pool.blocks.size() && allocation.chunk < 0; b++)
+		{
+			if (pool.blocks[b].memory == VK_NULL_HANDLE) continue;
+			allocation.chunk = AllocateChunk(pool.blocks[b], requirements.size, requirements.alignment);
+			allocation.block = b;
+		}
+		if (allocation.chunk < 0)
+		{
+			allocation.block = CreateBlock(pool, memoryType, blockSize);
+			allocation.chunk = AllocateChunk(pool.blocks[allocation.block], requirements.size, requirements.alignment);
+			if (allocation.chunk < 0)
+			{
+				throw " sub allocate memory fault . ";
+			}
+		}
+
+		Block & block = pool.blocks[allocation.block];
+		const Chunk & chunk = block.chunks[allocation.chunk];
+		allocation.memory = block.memory;
+		allocation.offset = chunk.offset;
+		allocation.mapped = block.mapped ? (char *)block.mapped + chunk.offset : NULL;
+		block.allocation_count++;
+		stats_[memoryType].allocation_count++;
+		stats_[memoryType].used_bytes += chunk.size;
+		category_stats_[category].allocation_count++;
+		category_stats_[category].used_bytes += chunk.size;
+		return allocation;
+	}
+
+	void Free(VulkanAllocation & allocation)
+	{
+		if (allocation.memory == VK_NULL_HANDLE) return;
+		std::lock_guard<std::mutex> lock(mutex_);
+		VulkanMemoryStats & stats = stats_[allocation.memory_type];
+		VulkanCategoryStats & categoryStats = category_stats_[allocation.category];
+		stats.allocation_count--;
+		categoryStats.allocation_count--;
+		if (allocation.block < 0)
+		{
+			vkFreeMemory(device_, allocation.memory, NULL);
+			stats.dedicated_count--;
+			stats.allocated_bytes -= allocation.size;
+			stats.used_bytes -= allocation.size;
+			categoryStats.used_bytes -= allocation.size;
+		}
+		else
+		{
+			Pool & pool = pools_[allocation.pool];
+			Block & block = pool.blocks[allocation.block];
+			stats.used_bytes -= block.chunks[allocation.chunk].size;
+			categoryStats.used_bytes -= block.chunks[allocation.chunk].size;
+			FreeChunk(block, allocation.chunk);
+			block.allocation_count--;
+			// one empty block per pool is kept , so a resource freed and created again does not go to the driver .
+			if (block.allocation_count == 0)
+			{
+				for (size_t b = 0; b < pool.blocks.size(); b++)
+				{
+					if ((int)b != allocation.block && pool.blocks[b].memory != VK_NULL_HANDLE && pool.blocks[b].allocation_count == 0)
+					{
+						DestroyBlock(pool, allocation.block, allocation.memory_type);
+						break;
+					}
+				}
+			}
+		}
+		allocation = VulkanAllocation();
+	}
+
+	// offset and size are relative to the allocation , the range is widened to nonCoherentAtomSize .
+	void Flush(const VulkanAllocation & allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE)
+	{
+		if (IsCoherent(allocation.memory_type)) return;
+		std::lock_guard<std::mutex> lock(mutex_);
+		VkMappedMemoryRange memoryRange = GetMappedRange(allocation, offset, size);
+		if (vkFlushMappedMemoryRanges(device_, 1, &memoryRange) != VK_SUCCESS)
+		{
+			throw " flush memory fault . ";
+		}
+	}
+
+	void Invalidate(const VulkanAllocation & allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE)
+	{
+		if (IsCoherent(allocation.memory_type)) return;
+		std::lock_guard<std::mutex> lock(mutex_);
+		VkMappedMemoryRange memoryRange = GetMappedRange(allocation, offset, size);
+		if (vkInvalidateMappedMemoryRanges(device_, 1, &memoryRange) != VK_SUCCESS)
+		{
+			throw " invalidate memory fault . ";
+		}
+	}
+
+	VulkanMemoryStats GetStats(uint32_t memoryType)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		VulkanMemoryStats stats = stats_[memoryType];
+		for (int kind = 0; kind < 2; kind++)
+		{
+			for (auto & block : pools_[memoryType * 2 + kind].blocks)
+			{
+				if (block.memory == VK_NULL_HANDLE) continue;
+				for (auto & chunk : block.chunks)
+				{
+					if (chunk.free && chunk.size != 0) stats.largest_free_range = (std::max)(stats.largest_free_range, chunk.size);
+				}
+			}
+		}
+		return stats;
+	}
+
+	VulkanMemoryStats GetTotalStats()
+	{
+		VulkanMemoryStats total;
+		for (uint32_t i = 0; i < memory_properties_.memoryTypeCount; i++)
+		{
+			VulkanMemoryStats stats = GetStats(i);
+			total.block_count += stats.block_count;
+			total.dedicated_count += stats.dedicated_count;
+			total.allocation_count += stats.allocation_count;
+			total.allocated_bytes += stats.allocated_bytes;
+			total.used_bytes += stats.used_bytes;
+			total.largest_free_range = (std::max)(total.largest_free_range, stats.largest_free_range);
+		}
+		return total;
+	}
+
+	// memory the caller allocated itself , counted as a dedicated allocation of the memory type .
+	void AddExternal(uint32_t memoryType, VkDeviceSize size, MemoryCategory category)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stats_[memoryType].dedicated_count++;
+		stats_[memoryType].allocation_count++;
+		stats_[memoryType].allocated_bytes += size;
+		stats_[memoryType].used_bytes += size;
+		category_stats_[category].allocation_count++;
+		category_stats_[category].used_bytes += size;
+	}
+
+	void RemoveExternal(uint32_t memoryType, VkDeviceSize size, MemoryCategory category)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stats_[memoryType].dedicated_count--;
+		stats_[memoryType].allocation_count--;
+		stats_[memoryType].allocated_bytes -= size;
+		stats_[memoryType].used_bytes -= size;
+		category_stats_[category].allocation_count--;
+		category_stats_[category].used_bytes -= size;
+	}
+
+	VulkanCategoryStats GetCategoryStats(MemoryCategory category)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return category_stats_[category];
+	}
+
+	// only reported , allocations over the budget still succeed . the budgets start at their default share and the editor
+	// changes them , 0 disables the budget of the category .
+	void SetCategoryBudget(MemoryCategory category, VkDeviceSize budget)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		category_stats_[category].budget_bytes = budget;
+	}
+
+	bool IsOverBudget(MemoryCategory category)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const VulkanCategoryStats & stats = category_stats_[category];
+		return stats.budget_bytes != 0 && stats.used_bytes > stats.budget_bytes;
+	}
+
+	// the budget fields are filled by the device .
+	VulkanHeapStats GetHeapStats(uint32_t heapIndex)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		VulkanHeapStats stats;
+		stats.heap_size = memory_properties_.memoryHeaps[heapIndex].size;
+		stats.device_local = (memory_properties_.memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		for (uint32_t i = 0; i < memory_properties_.memoryTypeCount; i++)
+		{
+			if (memory_properties_.memoryTypes[i].heapIndex != heapIndex) continue;
+			stats.allocated_bytes += stats_[i].allocated_bytes;
+			stats.used_bytes += stats_[i].used_bytes;
+		}
+		return stats;
+	}
+
+	uint32_t GetMemoryHeapCount() const
+	{
+		return memory_properties_.memoryHeapCount;
+	}
+
+	uint32_t GetMemoryTypeCount() const
+	{
+		return memory_properties_.memoryTypeCount;
+	}
+
+private:
+	struct Chunk
+	{
+		VkDeviceSize offset;
+		VkDeviceSize size;
+		bool free;
+		// neighbours in address order and in the free list of the size class .
+		int prev_physical;
+		int next_physical;
+		int prev_free;
+		int next_free;
+	};
+
+	struct Block
+	{
+		VkDeviceMemory memory;
+		VkDeviceSize size;
+		void * mapped;
+		std::vector<Chunk> chunks;
+		// chunk slots not in use , a split takes one and a merge gives one back .
+		std::vector<int> unused_chunks;
+		uint32_t allocation_count;
+		uint32_t fl_bitmap;
+		uint32_t sl_bitmap[MEMORY_ALLOCATOR_FL_COUNT];
+		int free_heads[MEMORY_ALLOCATOR_FL_COUNT][MEMORY_ALLOCATOR_SL_COUNT];
+	};
+
+	struct Pool
+	{
+		std::vector<Block> blocks;
+	};
+
+	static int Log2(VkDeviceSize value)
+	{
+		int result = 0;
+		while (value >>= 1) result++;
+		return result;
+	}
+
+	static void Mapping(VkDeviceSize size, int & fl, int & sl)
+	{
+		if (size < (1ull << MEMORY_ALLOCATOR_SMALL_LOG2))
+		{
+			fl = 0;
+			sl = (int)(size >> (MEMORY_ALLOCATOR_SMALL_LOG2 - MEMORY_ALLOCATOR_SL_LOG2));
+		}
+		else
+		{
+			int f = Log2(size);
+			sl = (int)(size >> (f - MEMORY_ALLOCATOR_SL_LOG2)) ^ MEMORY_ALLOCATOR_SL_COUNT;
+			fl = f - MEMORY_ALLOCATOR_SMALL_LOG2 + 1;
+		}
+	}
+
+	// rounds the size up to the next class , every range of the found class is large enough .
+	static void MappingSearch(VkDeviceSize size, int & fl, int & sl)
+	{
+		int step = size < (1ull << MEMORY_ALLOCATOR_SMALL_LOG2) ? MEMORY_ALLOCATOR_SMALL_LOG2 : Log2(size);
+		size += (1ull << (step - MEMORY_ALLOCATOR_SL_LOG2)) - 1;
+		Mapping(size, fl, sl);
+	}
+
+	static int LowestBit(uint32_t value)
+	{
+		int result = 0;
+		while ((value & 1) == 0)
+		{
+			value >>= 1;
+			result++;
+		}
+		return result;
+	}
+
+	void InsertFree(Block & block, int index)
+	{
+		Chunk & chunk = block.chunks[index];
+		int fl, sl;
+		Mapping(chunk.size, fl, sl);
+		chunk.free = true;
+		chunk.prev_free = -1;
+		chunk.next_free = block.free_heads[fl][sl];
+		if (chunk.next_free >= 0) block.chunks[chunk.next_free].prev_free = index;
+		block.free_heads[fl][sl] = index;
+		block.fl_bitmap |= 1u << fl;
+		block.sl_bitmap[fl] |= 1u << sl;
+	}
+
+	void RemoveFree(Block & block, int index)
+	{
+		Chunk & chunk = block.chunks[index];
+		int fl, sl;
+		Mapping(chunk.size, fl, sl);
+		if (chunk.prev_free >= 0) block.chunks[chunk.prev_free].next_free = chunk.next_free;
+		else block.free_heads[fl][sl] = chunk.next_free;
+		if (chunk.next_free >= 0) block.chunks[chunk.next_free].prev_free = chunk.prev_free;
+		if (block.free_heads[fl][sl] < 0)
+		{
+			block.sl_bitmap[fl] &= ~(1u << sl);
+			if (block.sl_bitmap[fl] == 0) block.fl_bitmap &= ~(1u << fl);
+		}
+		chunk.free = false;
+	}
+
+	int NewChunk(Block & block)
+	{
+		if (block.unused_chunks.size() != 0)
+		{
+			int index = block.unused_chunks.back();
+			block.unused_chunks.pop_back();
+			return index;
+		}
+		block.chunks.push_back(Chunk());
+		return block.chunks.size() - 1;
+	}
+
+	// cuts the front of a chunk off into a new chunk , the front keeps the index .
+	int Split(Block & block, int index, VkDeviceSize size)
+	{
+		int tail = NewChunk(block);
+		Chunk & chunk = block.chunks[index];
+		Chunk & rest = block.chunks[tail];
+		rest.offset = chunk.offset + size;
+		rest.size = chunk.size - size;
+		rest.prev_physical = index;
+		rest.next_physical = chunk.next_physical;
+		if (rest.next_physical >= 0) block.chunks[rest.next_physical].prev_physical = tail;
+		chunk.next_physical = tail;
+		chunk.size = size;
+		return tail;
+	}
+
+	// merges next into index , next must directly follow index .
+	void Merge(Block & block, int index, int next)
+	{
+		Chunk & chunk = block.chunks[index];
+		Chunk & other = block.chunks[next];
+		chunk.size += other.size;
+		chunk.next_physical = other.next_physical;
+		if (chunk.next_physical >= 0) block.chunks[chunk.next_physical].prev_physical = index;
+		other.size = 0;
+		other.free = false;
+		block.unused_chunks.push_back(next);
+	}
+
+	int AllocateChunk(Block & block, VkDeviceSize size, VkDeviceSize alignment)
+	{
+		// searching with the worst case padding keeps the lookup constant time .
+		int fl, sl;
+		MappingSearch(size + alignment - 1, fl, sl);
+		if (fl >= MEMORY_ALLOCATOR_FL_COUNT) return -1;
+		uint32_t slMap = block.sl_bitmap[fl] & (~0u << sl);
+		if (slMap == 0)
+		{
+			uint32_t flMap = fl + 1 < 32 ? block.fl_bitmap & (~0u << (fl + 1)) : 0;
+			if (flMap == 0) return -1;
+			fl = LowestBit(flMap);
+			slMap = block.sl_bitmap[fl];
+		}
+		sl = LowestBit(slMap);
+		int index = block.free_heads[fl][sl];
+		RemoveFree(block, index);
+
+		VkDeviceSize alignedOffset = (block.chunks[index].offset + alignment - 1) / alignment * alignment;
+		VkDeviceSize padding = alignedOffset - block.chunks[index].offset;
+		if (padding != 0)
+		{
+			int aligned = Split(block, index, padding);
+			InsertFree(block, index);
+			index = aligned;
+		}
+		if (block.chunks[index].size > size)
+		{
+			int tail = Split(block, index, size);
+			InsertFree(block, tail);
+		}
+		block.chunks[index].free = false;
+		return index;
+	}
+
+	void FreeChunk(Block & block, int index)
+	{
+		int next = block.chunks[index].next_physical;
+		if (next >= 0 && block.chunks[next].free)
+		{
+			RemoveFree(block, next);
+			Merge(block, index, next);
+		}
+		int prev = block.chunks[index].prev_physical;
+		if (prev >= 0 && block.chunks[prev].free)
+		{
+			RemoveFree(block, prev);
+			Merge(block, prev, index);
+			index = prev;
+		}
+		InsertFree(block, index);
+	}
+
+	int CreateBlock(Pool & pool, uint32_t memoryType, VkDeviceSize size)
+	{
+		int index = -1;
+		for (size_t b = 0; b < pool.blocks.size(); b++)
+		{
+			if (pool.blocks[b].memory == VK_NULL_HANDLE)
+			{
+				index = b;
+				break;
+			}
+		}
+		if (index < 0)
+		{
+			pool.blocks.push_back(Block());
+			index = pool.blocks.size() - 1;
+		}
+
+		Block & block = pool.blocks[index];
+		block.memory = AllocateDeviceMemory(memoryType, size, &block.mapped);
+		block.size = size;
+		block.chunks.clear();
+		block.unused_chunks.clear();
+		block.allocation_count = 0;
+		block.fl_bitmap = 0;
+		memset(block.sl_bitmap, 0, sizeof(block.sl_bitmap));
+		memset(block.free_heads, -1, sizeof(block.free_heads));
+		Chunk chunk = { 0 , size , false , -1 , -1 , -1 , -1 };
+		block.chunks.push_back(chunk);
+		InsertFree(block, 0);
+
+		stats_[memoryType].block_count++;
+		stats_[memoryType].allocated_bytes += size;
+		return index;
+	}
+
+	// the slot stays in the list , so the block index of other allocations does not change .
+	void DestroyBlock(Pool & pool, int index, uint32_t memoryType)
+	{
+		Block & block = pool.blocks[index];
+		vkFreeMemory(device_, block.memory, NULL);
+		stats_[memoryType].block_count--;
+		stats_[memoryType].allocated_bytes -= block.size;
+		block.memory = VK_NULL_HANDLE;
+		block.mapped = NULL;
+		block.chunks.clear();
+		block.unused_chunks.clear();
+	}
+
+	VkDeviceMemory AllocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, void ** mapped)
+	{
+		VkMemoryAllocateInfo memoryAllocateInfo = {};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocateInfo.allocationSize = size;
+		memoryAllocateInfo.memoryTypeIndex = memoryType;
+		VkDeviceMemory memory;
+		if (vkAllocateMemory(device_, &memoryAllocateInfo, NULL, &memory) != VK_SUCCESS)
+		{
+			throw " allocate memory fault . ";
+		}
+
+		*mapped = NULL;
+		if (memory_properties_.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			if (vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS)
+			{
+				throw " map memory fault . ";
+			}
+		}
+		return memory;
+	}
+
+	// an eighth of the heap for small heaps , like the host visible device local heap of many desktop cards .
+	VkDeviceSize GetBlockSize(uint32_t memoryType) const
+	{
+		VkDeviceSize heapSize = memory_properties_.memoryHeaps[memory_properties_.memoryTypes[memoryType].heapIndex].size;
+		return (std::min)(MEMORY_ALLOCATOR_BLOCK_SIZE, heapSize / 8);
+	}
+
+	bool IsCoherent(uint32_t memoryType) const
+	{
+		return (memory_properties_.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+	}
+
+	VkMappedMemoryRange GetMappedRange(const VulkanAllocation & allocation, VkDeviceSize offset, VkDeviceSize size) const
+	{
+		VkDeviceSize begin = allocation.offset + offset;
+		VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+		begin = begin / non_coherent_atom_size_ * non_coherent_atom_size_;
+		end = (end + non_coherent_atom_size_ - 1) / non_coherent_atom_size_ * non_coherent_atom_size_;
+		VkDeviceSize memorySize = allocation.block < 0 ? allocation.size : pools_[allocation.pool].blocks[allocation.block].size;
+
+		VkMappedMemoryRange memoryRange = {};
+		memoryRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		memoryRange.memory = allocation.memory;
+		memoryRange.offset = begin;
+		memoryRange.size = end < memorySize ? end - begin : VK_WHOLE_SIZE;
+		return memoryRange;
+	}
+
+private:
+	VkDevice device_;
+	VkPhysicalDeviceMemoryProperties memory_properties_;
+	VkDeviceSize buffer_image_granularity_;
+	VkDeviceSize non_coherent_atom_size_;
+	// two pools per memory type , linear resources and optimal images .
+	std::vector<Pool> pools_;
+	VulkanMemoryStats stats_[VK_MAX_MEMORY_TYPES];
+	VulkanCategoryStats category_stats_[MEMORY_CATEGORY_COUNT];
+	std::mutex mutex_;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define _VULKAN_MESH_H_
 
 #include "Utility.h"
+#include "VulkanGeometryArena.h"
 #include <assimp/Importer.hpp> 
 #include <assimp/scene.h>     
 #include <assimp/postprocess.h>
@@ -79,8 +80,11 @@ struct ModelCreateInfo {
 
 struct Model {
 	VkDevice device = nullptr;
-	VulkanBuffer *vertices;
-	VulkanBuffer *indices;
+	// the vertices and indices live in the arena of the vertex layout .
+	GeometryRange geometry;
+	// the batch that copies the vertices and indices .
+	UploadTicket uploadTicket = 0;
+	VulkanUploadManager * uploadManager = nullptr;
 	uint32_t indexCount = 0;
 	uint32_t vertexCount = 0;
 
@@ -95,26 +99,35 @@ struct Model {
 
 	static const int defaultFlags = aiProcess_FlipWindingOrder | aiProcess_Triangulate | aiProcess_PreTransformVertices | aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals;
 
+	// axis aligned bounds of the positions written to the arena .
 	struct Dimension
 	{
 		glm::vec3 min = glm::vec3(FLT_MAX);
 		glm::vec3 max = glm::vec3(-FLT_MAX);
 		glm::vec3 size;
+
+		// the bounds of the box transformed by matrix , still axis aligned .
+		Dimension Transform(const glm::mat4 & matrix) const
+		{
+			glm::vec3 center = glm::vec3(matrix * glm::vec4((min + max) * 0.5f, 1.0f));
+			glm::vec3 extent = (max - min) * 0.5f;
+			glm::vec3 worldExtent = glm::abs(glm::vec3(matrix[0])) * extent.x + glm::abs(glm::vec3(matrix[1])) * extent.y + glm::abs(glm::vec3(matrix[2])) * extent.z;
+			Dimension result;
+			result.min = center - worldExtent;
+			result.max = center + worldExtent;
+			result.size = result.max - result.min;
+			return result;
+		}
 	} dim;
 
 	void destroy()
 	{
 		assert(device);
-		vkDestroyBuffer(device, vertices->GetDesc().buffer, nullptr);
-		vkFreeMemory(device, vertices->GetBufferMemory(), nullptr);
-		if (indices->GetDesc().buffer != VK_NULL_HANDLE)
-		{
-			vkDestroyBuffer(device, indices->GetDesc().buffer, nullptr);
-			vkFreeMemory(device, indices->GetBufferMemory(), nullptr);
-		}
+		if (uploadManager != nullptr) uploadManager->Wait(uploadTicket);
+		if (geometry.arena != NULL) geometry.arena->Free(geometry);
 	}
 
-	bool loadFromFile(const std::string& filename, VertexLayout layout, ModelCreateInfo *createInfo, VulkanDevice *device, VkQueue copyQueue)
+	bool loadFromFile(const std::string& filename, VertexLayout layout, ModelCreateInfo *createInfo, VulkanGeometryArena *arena, VulkanDevice *device, VkQueue copyQueue)
 	{
 		this->device = device->GetDevice();
 
@@ -171,14 +184,15 @@ struct Model {
 					const aiVector3D* pTexCoord = (paiMesh->HasTextureCoords(0)) ? &(paiMesh->mTextureCoords[0][j]) : &Zero3D;
 					const aiVector3D* pTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mTangents[j]) : &Zero3D;
 					const aiVector3D* pBiTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mBitangents[j]) : &Zero3D;
+					glm::vec3 position(pPos->x * scale.x + center.x, -pPos->y * scale.y + center.y, pPos->z * scale.z + center.z);
 
 					for (auto& component : layout.components)
 					{
 						switch (component) {
 						case VERTEX_COMPONENT_POSITION:
-							vertexBuffer.push_back(pPos->x * scale.x + center.x);
-							vertexBuffer.push_back(-pPos->y * scale.y + center.y);
-							vertexBuffer.push_back(pPos->z * scale.z + center.z);
+							vertexBuffer.push_back(position.x);
+							vertexBuffer.push_back(position.y);
+							vertexBuffer.push_back(position.z);
 							break;
 						case VERTEX_COMPONENT_NORMAL:
 							vertexBuffer.push_back(pNormal->x);
@@ -217,13 +231,13 @@ struct Model {
 						};
 					}
 
-					dim.max.x = fmax(pPos->x, dim.max.x);
-					dim.max.y = fmax(pPos->y, dim.max.y);
-					dim.max.z = fmax(pPos->z, dim.max.z);
+					dim.max.x = fmax(position.x, dim.max.x);
+					dim.max.y = fmax(position.y, dim.max.y);
+					dim.max.z = fmax(position.z, dim.max.z);
 
-					dim.min.x = fmin(pPos->x, dim.min.x);
-					dim.min.y = fmin(pPos->y, dim.min.y);
-					dim.min.z = fmin(pPos->z, dim.min.z);
+					dim.min.x = fmin(position.x, dim.min.x);
+					dim.min.y = fmin(position.y, dim.min.y);
+					dim.min.z = fmin(position.z, dim.min.z);
 				}
 
 				dim.size = dim.max - dim.min;
@@ -245,81 +259,15 @@ struct Model {
 			}
 
 
-			uint32_t vBufferSize = static_cast<uint32_t>(vertexBuffer.size()) * sizeof(float);
-			uint32_t iBufferSize = static_cast<uint32_t>(indexBuffer.size()) * sizeof(uint32_t);
-
-			// Use staging buffer to move vertex and index buffer to device local memory
-			// Create staging buffers
-			VulkanBuffer* vertexStaging, *indexStaging;
-
-			// Vertex buffer
-			vertexStaging = device->CreateVulkanBuffer(
-				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				vBufferSize,
-				vertexBuffer.data());
-
-			// Index buffer
-			indexStaging = device->CreateVulkanBuffer(
-				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				iBufferSize,
-				indexBuffer.data());
-
-			// Create device local target buffers
-			// Vertex buffer
-			vertices = device->CreateVulkanBuffer(
-				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | createInfo->memoryPropertyFlags,
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-				vBufferSize);
-
-			// Index buffer
-			indices = device->CreateVulkanBuffer(
-				VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | createInfo->memoryPropertyFlags,
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-				iBufferSize);
-
-			// Copy from staging buffers
-			VkCommandBuffer copyCmd;
-			device->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &copyCmd);
-			VkCommandBufferBeginInfo beginInfo = {};
-			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			vkBeginCommandBuffer(copyCmd, &beginInfo);
-			VkBufferCopy copyRegion{};
-
-			copyRegion.size = vBufferSize;
-			vkCmdCopyBuffer(copyCmd, vertexStaging->GetDesc().buffer, vertices->GetDesc().buffer, 1, &copyRegion);
-
-			copyRegion.size = iBufferSize;
-			vkCmdCopyBuffer(copyCmd, indexStaging->GetDesc().buffer, indices->GetDesc().buffer, 1, &copyRegion);
-
-			vkEndCommandBuffer(copyCmd);
-
-			VkSubmitInfo submitInfo = {};
-			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &copyCmd;
-
-			// Create fence to ensure that the command buffer has finished executing
-			VkFenceCreateInfo fenceInfo = {};
-			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-			fenceInfo.flags = 0;
-			VkFence fence;
-			vkCreateFence(this->device, &fenceInfo, nullptr, &fence);
-
-			// Submit to the queue
-			vkQueueSubmit(copyQueue, 1, &submitInfo, fence);
-			// Wait for the fence to signal that command buffer has finished executing
-			vkWaitForFences(this->device, 1, &fence, VK_TRUE, 1e10);
-
-			vkDestroyFence(this->device, fence, nullptr);
-			device->DestroyCommandBuffer(&copyCmd, 1);
-
-			// Destroy staging resources
-			vkDestroyBuffer(this->device, vertexStaging->GetDesc().buffer, nullptr);
-			vkFreeMemory(this->device, vertexStaging->GetBufferMemory(), nullptr);
-			vkDestroyBuffer(this->device, indexStaging->GetDesc().buffer, nullptr);
-			vkFreeMemory(this->device, indexStaging->GetBufferMemory(), nullptr);
+			if (arena->GetVertexStride() != layout.stride())
+			{
+				throw " the vertex layout does not match the geometry arena . ";
+			}
+
+			// Copy into the arena through the staging ring of the upload manager , nothing waits for the copies here
+			geometry = arena->Allocate(vertexCount, indexCount);
+			uploadManager = device->GetUploadManager();
+			uploadTicket = arena->Upload(geometry, vertexBuffer.data(), indexBuffer.data());
 
 			return true;
 		}
@@ -330,26 +278,29 @@ struct Model {
 		}
 	};
 
-	bool loadFromFile(const std::string& filename, VertexLayout layout, float scale, VulkanDevice *device, VkQueue copyQueue)
+	bool loadFromFile(const std::string& filename, VertexLayout layout, float scale, VulkanGeometryArena *arena, VulkanDevice *device, VkQueue copyQueue)
 	{
 		ModelCreateInfo modelCreateInfo(scale, 1.0f, 0.0f);
-		return loadFromFile(filename, layout, &modelCreateInfo, device, copyQueue);
+		return loadFromFile(filename, layout, &modelCreateInfo, arena, device, copyQueue);
 	}
 
-	void loadFromExitBuffer(VulkanBuffer * vertBuffer , size_t vertSize , VulkanBuffer * indicesBuffer , size_t indicesSize  )
+	// the range was filled by the caller , bounds are the ones of the vertices it wrote .
+	void loadFromRange(const GeometryRange & range, const Dimension & bounds)
 	{
-		vertices = vertBuffer;
-		indices = indicesBuffer;
-		vertexCount = vertSize;
-		indexCount= indicesSize;
+		geometry = range;
+		dim = bounds;
+		vertexCount = range.vertex_count;
+		indexCount = range.index_count;
 	}
 };
 
+// the name points into the mesh , an entry does not outlive it .
 struct MeshEntry
 {
-	std::string name;
-	VulkanBuffer * vertexBuffer;
-	VulkanBuffer * indexBuffer;
+	const char * name;
+	VulkanGeometryArena * arena;
+	uint32_t vertexOffset;
+	uint32_t firstIndex;
 	size_t vertCount;
 	size_t indicesCount;
 };
@@ -357,15 +308,15 @@ struct MeshEntry
 class VulkanMesh
 {
 public:
-	VulkanMesh(const std::string& filename, VertexLayout layout, float scale, VulkanDevice *device, VkQueue copyQueue , std::string name )
+	VulkanMesh(const std::string& filename, VertexLayout layout, float scale, VulkanGeometryArena * arena, VulkanDevice *device, VkQueue copyQueue , std::string name )
 	{
-		model_.loadFromFile(filename, layout, scale, device, copyQueue);
+		model_.loadFromFile(filename, layout, scale, arena, device, copyQueue);
 		name_ = name;
 	}
 
-	VulkanMesh(VulkanBuffer * vertBuffer, size_t vertSize, VulkanBuffer * indicesBuffer, size_t indicesSize , std::string name )
+	VulkanMesh(const GeometryRange & range, const Model::Dimension & bounds, std::string name )
 	{
-		model_.loadFromExitBuffer(vertBuffer, vertSize, indicesBuffer, indicesSize);
+		model_.loadFromRange(range, bounds);
 		name_ = name;
 	}
 
@@ -379,13 +330,48 @@ public:
 	{
 		MeshEntry entry;
 		entry.vertCount = model_.vertexCount;
-		entry.vertexBuffer = model_.vertices;
 		entry.indicesCount = model_.indexCount;
-		entry.indexBuffer = model_.indices;
-		entry.name = name_;
+		entry.arena = model_.geometry.arena;
+		entry.vertexOffset = model_.geometry.vertex_offset;
+		entry.firstIndex = model_.geometry.first_index;
+		entry.name = name_.c_str();
 		return entry;
 	}
 
+	const std::string & GetName() const
+	{
+		return name_;
+	}
+
+	// what the draws read .
+	const GeometryRange & GetGeometry() const
+	{
+		return model_.geometry;
+	}
+
+	VulkanGeometryArena * GetArena() const
+	{
+		return model_.geometry.arena;
+	}
+
+	// in the space of the vertices , before the world matrix of the object .
+	const Model::Dimension & GetBounds() const
+	{
+		return model_.dim;
+	}
+
+	// binds the arena of the mesh , passes drawing many meshes bind once per arena instead .
+	void BindGeometry(VkCommandBuffer commandBuffer) const
+	{
+		model_.geometry.arena->Bind(commandBuffer);
+	}
+
+	void Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1) const
+	{
+		const GeometryRange & geometry = model_.geometry;
+		vkCmdDrawIndexed(commandBuffer, geometry.index_count, instanceCount, geometry.first_index, (int32_t)geometry.vertex_offset, 0);
+	}
+
 private:
 	Model model_;
 	std::string name_;
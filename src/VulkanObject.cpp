@@ -12,7 +12,7 @@ glm::mat4 VulkanObject::GetWorldMatrix() const
 	return 	glm::translate(object_entry_.position) * eularRotation * glm::scale(object_entry_.scale) ;
 }
 
-std::vector<VulkanSceneObjectsGroup::Material> VulkanSceneObjectsGroup::LoadObjectFromFile(std::string & file, std::string & folder, VulkanDevice * device, VkQueue queue)
+std::vector<VulkanSceneObjectsGroup::Material> VulkanSceneObjectsGroup::LoadObjectFromFile(std::string & file, std::string & folder, VulkanGeometryArena * arena, VulkanDevice * device, VkQueue queue)
 {
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
@@ -84,13 +84,13 @@ std::vector<VulkanSceneObjectsGroup::Material> VulkanSceneObjectsGroup::LoadObje
 		}
 	}
 
+	if (arena->GetVertexStride() != sizeof(Vertex))
+	{
+		throw " the geometry arena does not match the obj vertex . ";
+	}
+
 	for (size_t i = 0; i < materials.size() + 1 ; i++)
 	{
-		if (indicesData[i].size() == 0)
-		{
-			groups[i].vertBuffer = NULL;
-			groups[i].indicesBuffer = NULL;
-		}
 		if (i < materials.size())
 		{
 			if (materials[i].diffuse_texname != "")
@@ -111,10 +111,16 @@ std::vector<VulkanSceneObjectsGroup::Material> VulkanSceneObjectsGroup::LoadObje
 			continue;
 		}
 
-		groups[i].vertBuffer = device->CreateVulkanBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, sizeof(Vertex) * verticesData[i].size(), verticesData[i].data());
-		groups[i].indicesBuffer = device->CreateVulkanBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, sizeof(uint32_t) * indicesData[i].size(), indicesData[i].data());
-		groups[i].vertSize = verticesData[i].size();
-		groups[i].indexSize = indicesData[i].size();
+		// the copies go through the upload manager of the loading thread .
+		groups[i].geometry = arena->Allocate((uint32_t)verticesData[i].size(), (uint32_t)indicesData[i].size());
+		arena->Upload(groups[i].geometry, verticesData[i].data(), indicesData[i].data());
+		Model::Dimension & bounds = groups[i].bounds;
+		for (auto & vertex : verticesData[i])
+		{
+			bounds.min = glm::min(bounds.min, vertex.pos);
+			bounds.max = glm::max(bounds.max, vertex.pos);
+		}
+		bounds.size = bounds.max - bounds.min;
 	}
 	
 	material_vec_ = groups;
@@ -128,8 +134,8 @@ std::vector<VulkanObject*> VulkanSceneObjectsGroup::GetObjectsVecFromMaterial(Fo
 	std::string name = "static object ";
 	for (auto material : material_vec_)
 	{
-		if (material.vertBuffer == NULL) continue;
-		VulkanMesh * newMesh = new VulkanMesh(material.vertBuffer, material.vertSize, material.indicesBuffer, material.indexSize, "StaticMesh");
+		if (material.geometry.arena == NULL) continue;
+		VulkanMesh * newMesh = new VulkanMesh(material.geometry, material.bounds, "StaticMesh");
 		VulkanObject * newObj = new VulkanObject(objectsVec.size(), name , newMesh );
 		IMaterial * forwardLightMaterial = new ForwardLightPassMaterial(
 			material.albedoImage == NULL ? dummyImage : material.albedoImage, 
@@ -141,3 +147,14 @@ std::vector<VulkanObject*> VulkanSceneObjectsGroup::GetObjectsVecFromMaterial(Fo
 	}
 	return objectsVec;
 }
+
+std::vector<Texture2D*> VulkanSceneObjectsGroup::GetTextures() const
+{
+	std::vector<Texture2D*> textures;
+	for (auto & material : material_vec_)
+	{
+		if (material.albedoImage != NULL) textures.push_back(material.albedoImage);
+		if (material.normalIamge != NULL) textures.push_back(material.normalIamge);
+	}
+	return textures;
+}
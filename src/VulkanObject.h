@@ -42,6 +42,7 @@ public:
 		static_mesh_ = staticMesh;
 		prev_pipeline_type = PIPELINE_EMPTY;
 		material_ = NULL;
+		version_ = 0;
 	}
 
 	glm::mat4 GetWorldMatrix() const;
@@ -52,21 +53,28 @@ public:
 	}
 	void ResetMaterial(IMaterial * material , PipelineType pipelineType )
 	{
-		if (material_ != NULL) delete material_;
+		IMaterial::Release(material_);
 		material_ = material;
 		prev_pipeline_type = pipelineType;
+		MarkDirty();
 	}
-	void SetPosition(glm::vec3 & position) { object_entry_.position = position; };
-	void SetRotation(glm::vec3 & rotation) { object_entry_.rotation = rotation; };
-	void SetScale(glm::vec3 & scale) { object_entry_.scale = scale; };
+	void SetPosition(glm::vec3 & position) { object_entry_.position = position; MarkDirty(); };
+	void SetRotation(glm::vec3 & rotation) { object_entry_.rotation = rotation; MarkDirty(); };
+	void SetScale(glm::vec3 & scale) { object_entry_.scale = scale; MarkDirty(); };
 	void SetPipelineType(PipelineType pipelineType) { 
 		object_entry_.pipelineType = pipelineType;  
 		if (prev_pipeline_type == PIPELINE_EMPTY)
 		{
 			prev_pipeline_type = pipelineType;
 		}
+		MarkDirty();
 	}
-	void SetMeshIndex(int index) { object_entry_.meshIndex = index;  };
+	void SetMeshIndex(int index) { object_entry_.meshIndex = index; MarkDirty(); };
+	// the version changes whenever the transform , mesh , pipeline or material of the object changes .
+	void MarkDirty() { version_++; }
+	uint32_t GetVersion() const { return version_; }
+	uint32_t GetMaterialVersion() const { return material_->GetVersion(); }
+	IMaterial * GetMaterial() const { return material_; }
 	void SetPipeline(IRenderingPipeline * pipeline) { material_->SetPipeline(pipeline); };
 	bool GetStaticMesh(VulkanMesh *& staticMesh) const { staticMesh = static_mesh_; return object_entry_.isStaticMesh; }
 	void UpdateImguI() { material_->UpdateImgui(); };
@@ -85,27 +93,27 @@ private:
 	IMaterial * material_;
 	VulkanMesh * static_mesh_;
 	PipelineType prev_pipeline_type;
+	uint32_t version_;
 	friend class VulkanEditor;
 };
 
 class VulkanSceneObjectsGroup
 {
 public:
-	VulkanSceneObjectsGroup( std::string & file , std::string & folder , VulkanDevice * device , VkQueue queue ) 
+	VulkanSceneObjectsGroup( std::string & file , std::string & folder , VulkanGeometryArena * arena , VulkanDevice * device , VkQueue queue ) 
 	{
-		LoadObjectFromFile(file, folder, device, queue);
+		LoadObjectFromFile(file, folder, arena, device, queue);
 	};
 	~VulkanSceneObjectsGroup() {} ;
 
 public:
 	struct Material
 	{
-		VulkanBuffer * vertBuffer;
-		VulkanBuffer * indicesBuffer;
+		// empty when no face uses the material .
+		GeometryRange geometry;
+		Model::Dimension bounds;
 		Texture2D * albedoImage = NULL ;
 		Texture2D * normalIamge = NULL ;
-		size_t vertSize;
-		size_t indexSize;
 	};
 
 	struct Vertex
@@ -140,8 +148,10 @@ public:
 
 
 public:
-	std::vector<Material> LoadObjectFromFile(std::string & file, std::string & folder, VulkanDevice * device, VkQueue queue);
+	// the arena has the stride of Vertex .
+	std::vector<Material> LoadObjectFromFile(std::string & file, std::string & folder, VulkanGeometryArena * arena, VulkanDevice * device, VkQueue queue);
 	std::vector<VulkanObject*> GetObjectsVecFromMaterial(ForwardPlusLightPassPipeline * pipeline , Texture2D * dummyImage , VulkanDevice * device);
+	std::vector<Texture2D*> GetTextures() const;
 
 private:
 	std::vector<Material> material_vec_;
@@ -0,0 +1,157 @@
+#ifndef _VULKAN_OBJECT_CACHE_H_
+#define _VULKAN_OBJECT_CACHE_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <mutex>
+#include "Utility.h"
+
+// Samplers , descriptor set layouts and pipeline layouts keyed by the contents of their create info .
+// Asking twice for the same object returns the same handle , so textures share their samplers and pipelines built
+// from the same bindings get layouts that are compatible by handle . The cache owns everything it returns , the
+// handles live as long as the device and are never destroyed by their users .
+// Extension structures are not part of the key , create infos with a pNext chain are rejected .
+// Thread safe , textures are created on the loader threads .
+class VulkanObjectCache
+{
+	// the fields are appended one by one , padding never ends up in a key .
+	class Key
+	{
+	public:
+		template <class T>
+		void Add(const T & value)
+		{
+			data_.append((const char*)&value, sizeof(T));
+		}
+
+		const std::string & Get() const { return data_; }
+
+	private:
+		std::string data_;
+	};
+
+public:
+	VulkanObjectCache(VkDevice device) : device_(device)
+	{
+	}
+
+	~VulkanObjectCache()
+	{
+		for (auto & iter : pipeline_layouts_) vkDestroyPipelineLayout(device_, iter.second, NULL);
+		for (auto & iter : set_layouts_) vkDestroyDescriptorSetLayout(device_, iter.second, NULL);
+		for (auto & iter : samplers_) vkDestroySampler(device_, iter.second, NULL);
+	}
+
+public:
+	VkSampler GetSampler(const VkSamplerCreateInfo & createInfo)
+	{
+		CheckNoExtensions(createInfo.pNext);
+		Key key;
+		key.Add(createInfo.flags);
+		key.Add(createInfo.magFilter);
+		key.Add(createInfo.minFilter);
+		key.Add(createInfo.mipmapMode);
+		key.Add(createInfo.addressModeU);
+		key.Add(createInfo.addressModeV);
+		key.Add(createInfo.addressModeW);
+		key.Add(createInfo.mipLodBias);
+		key.Add(createInfo.anisotropyEnable);
+		key.Add(createInfo.maxAnisotropy);
+		key.Add(createInfo.compareEnable);
+		key.Add(createInfo.compareOp);
+		key.Add(createInfo.minLod);
+		key.Add(createInfo.maxLod);
+		key.Add(createInfo.borderColor);
+		key.Add(createInfo.unnormalizedCoordinates);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto iter = samplers_.find(key.Get());
+		if (iter != samplers_.end()) return iter->second;
+		VkSampler sampler;
+		VULKAN_SUCCESS(vkCreateSampler(device_, &createInfo, NULL, &sampler));
+		samplers_[key.Get()] = sampler;
+		return sampler;
+	}
+
+	// the key does not depend on the order of the bindings .
+	VkDescriptorSetLayout GetDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo & createInfo)
+	{
+		CheckNoExtensions(createInfo.pNext);
+		std::vector<VkDescriptorSetLayoutBinding> bindings(createInfo.pBindings, createInfo.pBindings + createInfo.bindingCount);
+		std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding & a, const VkDescriptorSetLayoutBinding & b)
+		{
+			return a.binding < b.binding;
+		});
+		Key key;
+		key.Add(createInfo.flags);
+		key.Add(createInfo.bindingCount);
+		for (auto & binding : bindings)
+		{
+			key.Add(binding.binding);
+			key.Add(binding.descriptorType);
+			key.Add(binding.descriptorCount);
+			key.Add(binding.stageFlags);
+			bool immutable = binding.pImmutableSamplers != NULL;
+			key.Add(immutable);
+			for (uint32_t i = 0; immutable && i < binding.descriptorCount; i++) key.Add(binding.pImmutableSamplers[i]);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto iter = set_layouts_.find(key.Get());
+		if (iter != set_layouts_.end()) return iter->second;
+		VkDescriptorSetLayout setLayout;
+		VULKAN_SUCCESS(vkCreateDescriptorSetLayout(device_, &createInfo, NULL, &setLayout));
+		set_layouts_[key.Get()] = setLayout;
+		return setLayout;
+	}
+
+	// set layouts from the cache make pipeline layouts built from the same bindings share one handle .
+	VkPipelineLayout GetPipelineLayout(const VkPipelineLayoutCreateInfo & createInfo)
+	{
+		CheckNoExtensions(createInfo.pNext);
+		Key key;
+		key.Add(createInfo.flags);
+		key.Add(createInfo.setLayoutCount);
+		for (uint32_t i = 0; i < createInfo.setLayoutCount; i++) key.Add(createInfo.pSetLayouts[i]);
+		key.Add(createInfo.pushConstantRangeCount);
+		for (uint32_t i = 0; i < createInfo.pushConstantRangeCount; i++)
+		{
+			key.Add(createInfo.pPushConstantRanges[i].stageFlags);
+			key.Add(createInfo.pPushConstantRanges[i].offset);
+			key.Add(createInfo.pPushConstantRanges[i].size);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto iter = pipeline_layouts_.find(key.Get());
+		if (iter != pipeline_layouts_.end()) return iter->second;
+		VkPipelineLayout pipelineLayout;
+		VULKAN_SUCCESS(vkCreatePipelineLayout(device_, &createInfo, NULL, &pipelineLayout));
+		pipeline_layouts_[key.Get()] = pipelineLayout;
+		return pipelineLayout;
+	}
+
+	size_t GetSamplerCount() const { return samplers_.size(); }
+	size_t GetDescriptorSetLayoutCount() const { return set_layouts_.size(); }
+	size_t GetPipelineLayoutCount() const { return pipeline_layouts_.size(); }
+
+private:
+	static void CheckNoExtensions(const void * next)
+	{
+		if (next != NULL)
+		{
+			throw " cached create info must not have a pNext chain . ";
+		}
+	}
+
+private:
+	VkDevice device_;
+	std::unordered_map<std::string, VkSampler> samplers_;
+	std::unordered_map<std::string, VkDescriptorSetLayout> set_layouts_;
+	std::unordered_map<std::string, VkPipelineLayout> pipeline_layouts_;
+	std::mutex mutex_;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef _VULKAN_OFFSCREEN_SWAP_CHAIN_HPP_
+#define _VULKAN_OFFSCREEN_SWAP_CHAIN_HPP_
+
+#include "VulkanSwapChain.hpp"
+#include "VulkanDevice.hpp"
+
+// Headless replacement of the surface swap chain , frames are rendered into a ring of device local images .
+// There is no presentation engine to signal and consume the frame semaphores , so acquiring and presenting
+// are empty submits that keep the binary semaphores balanced and the frame loop of VulkanBase unchanged .
+class VulkanOffscreenSwapChain : public VulkanSwapChain
+{
+public:
+	VulkanOffscreenSwapChain(VulkanDevice * device, VkQueue queue, uint32_t width, uint32_t height, uint32_t imageCount = 3)
+	{
+		device_ = device;
+		queue_ = queue;
+		logical_device_ = device->GetDevice();
+		image_count_ = imageCount;
+		color_format_ = SelectColorFormat();
+
+		images_.resize(image_count_);
+		memories_.resize(image_count_);
+		for (uint32_t i = 0; i < image_count_; i++)
+		{
+			VkImageCreateInfo imageCreateInfo = {};
+			imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageCreateInfo.format = color_format_;
+			imageCreateInfo.extent = { width , height , 1 };
+			imageCreateInfo.mipLevels = 1;
+			imageCreateInfo.arrayLayers = 1;
+			imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			if (vkCreateImage(logical_device_, &imageCreateInfo, NULL, &images_[i]) != VK_SUCCESS)
+			{
+				throw " create offscreen image fault . ";
+			}
+			memories_[i] = device_->AllocateImageMemory(images_[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_CATEGORY_RENDER_TARGET);
+		}
+		CreateImageViews();
+	}
+
+	~VulkanOffscreenSwapChain()
+	{
+		cleanup();
+	}
+
+public:
+	VkResult acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t *imageIndex) override
+	{
+		*imageIndex = next_image_;
+		next_image_ = (next_image_ + 1) % image_count_;
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &presentCompleteSemaphore;
+		return device_->QueueSubmit(queue_, 1, &submitInfo, VK_NULL_HANDLE);
+	}
+
+	// the caller holds the queue mutex of the device , as for a real present .
+	VkResult queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore = VK_NULL_HANDLE) override
+	{
+		if (waitSemaphore == VK_NULL_HANDLE) return VK_SUCCESS;
+
+		VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &waitSemaphore;
+		submitInfo.pWaitDstStageMask = &waitStageMask;
+		return vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+	}
+
+	// the finished frame stays ready to be copied out .
+	VkImageLayout GetPresentLayout() const override
+	{
+		return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	}
+
+	void cleanup() override
+	{
+		for (uint32_t i = 0; i < image_views_.size(); i++)
+		{
+			vkDestroyImageView(logical_device_, image_views_[i], NULL);
+			vkDestroyImage(logical_device_, images_[i], NULL);
+			device_->FreeMemory(memories_[i]);
+		}
+		image_views_.clear();
+		images_.clear();
+		memories_.clear();
+	}
+
+private:
+	VkFormat SelectColorFormat()
+	{
+		VkFormat candidates[] = { VK_FORMAT_B8G8R8A8_UNORM , VK_FORMAT_R8G8B8A8_UNORM };
+		for (VkFormat format : candidates)
+		{
+			VkFormatProperties formatProperties;
+			vkGetPhysicalDeviceFormatProperties(device_->GetPhysicalDevice(), format, &formatProperties);
+			if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)
+			{
+				return format;
+			}
+		}
+		throw " no offscreen color format . ";
+	}
+
+private:
+	VulkanDevice * device_;
+	VkQueue queue_;
+	std::vector<VulkanAllocation> memories_;
+	uint32_t next_image_ = 0;
+};
+
+#endif
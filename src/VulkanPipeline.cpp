@@ -1,18 +1,16 @@
 #include "VulkanPipeline.h"
 #include <glm/gtc/random.hpp>
+#include <algorithm>
 
 VkPipeline CullLightComputePipeline::CreateComputePipeline()
 {
-	InitResources();
-	InitDesc();
-
 	VkPushConstantRange constantRange;
 	constantRange.size = sizeof(PushConstantData);
 	constantRange.offset = 0;
 	constantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
 	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = VulkanInitializer::InitPipelineLayoutCreateInfo(1 , &constantRange , 1, &desc_set_layout_);
-	VULKAN_SUCCESS(vkCreatePipelineLayout(device_->GetDevice(), &pipelineLayoutCreateInfo, NULL, &pipeline_layout_));
+	pipeline_layout_ = device_->GetPipelineLayout(pipelineLayoutCreateInfo);
 
 	VkPipelineShaderStageCreateInfo shaderStageCreateInfo = VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, GetAssetPath() + "shaders/CullLight.spv", device_);
 	VkComputePipelineCreateInfo computePipelineCreateInfo = VulkanInitializer::InitComputePipelineCreateInfo(pipeline_layout_, shaderStageCreateInfo);
@@ -21,39 +19,26 @@ VkPipeline CullLightComputePipeline::CreateComputePipeline()
 	return compute_pipeline_;
 }
 
-VkCommandBuffer CullLightComputePipeline::SetupCommandBuffer()
+void CullLightComputePipeline::SetupCommandBuffer(VkCommandBuffer commandBuffer)
 {
-	VkWriteDescriptorSet writeDescs[3] = {
-		VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 0 , desc_set_ , &tile_light_visible_buffer_->GetDesc()),
-		VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , 1 , desc_set_ , &light_uniform_buffer_->GetDesc()),
-		VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 2 , desc_set_ , &pre_depth_image_->GetDescriptorImageInfo(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)),
-	};
-
-	vkUpdateDescriptorSets(device_->GetDevice(), 3, writeDescs, 0, NULL);
-
-	VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-	vkBeginCommandBuffer(compute_command_buffer_, &commandBufferBeginInfo);
-	vkCmdBindPipeline(compute_command_buffer_, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline_);
-	vkCmdBindDescriptorSets(compute_command_buffer_, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &desc_set_, 0, NULL);
-	vkCmdPushConstants(compute_command_buffer_, pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstantData), &PushConstantData);
-	vkCmdDispatch(compute_command_buffer_, tile_count_x_, tile_count_y_, 1);
-	vkEndCommandBuffer(compute_command_buffer_);
-	return compute_command_buffer_;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline_);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &depth_sets_[depth_input_], 1, &light_uniform_offset_);
+	vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstantData), &PushConstantData);
+	vkCmdDispatch(commandBuffer, tile_count_x_, tile_count_y_, 1);
 }
 
 void CullLightComputePipeline::UpdateData()
 {
-	light_uniform_buffer_->Map();
-	LightUniformData * lightUniformData = (LightUniformData*)(light_uniform_buffer_->GetMappedMemory());
-	for (int i = 0; i < lightUniformData->pointLightCount; i++)
+	// the lights are animated on the cpu copy , the ring memory is only written .
+	for (int i = 0; i < LightUniformBufferData.pointLightCount; i++)
 	{
-		lightUniformData->pointLights[i].pos.y += 0.01f;
-		if (lightUniformData->pointLights[i].pos.y >= light_max_pos_.y)
+		LightUniformBufferData.pointLights[i].pos.y += 0.01f;
+		if (LightUniformBufferData.pointLights[i].pos.y >= light_max_pos_.y)
 		{
-			lightUniformData->pointLights[i].pos.y = light_min_pos_.y;
+			LightUniformBufferData.pointLights[i].pos.y = light_min_pos_.y;
 		}
 	}
-	light_uniform_buffer_->Unmap();
+	light_uniform_offset_ = uniform_ring_->Write(&LightUniformBufferData, light_uniform_info_.range);
 }
 
 void CullLightComputePipeline::SetPushConstantData(int viewportSizeX, int viewportSizeY, float zNear , float zFar ,  glm::mat4 & projMatrix, glm::mat4 & viewMatrix)
@@ -66,9 +51,28 @@ void CullLightComputePipeline::SetPushConstantData(int viewportSizeX, int viewpo
 	PushConstantData.zFar = zFar;
 }
 
-void CullLightComputePipeline::SetPreDepth(VulkanImage * preDepthImage)
+void CullLightComputePipeline::AddDepthInput(VulkanImage * depthImage)
+{
+	if (std::find(depth_inputs_.begin(), depth_inputs_.end(), depthImage) != depth_inputs_.end()) return;
+	VkDescriptorSet set = device_->GetDescriptorAllocator()->Allocate(desc_set_layout_);
+	VkWriteDescriptorSet writeDescs[3] = {
+		VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 0 , set , &tile_light_visible_buffer_->GetDesc()),
+		VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , 1 , set , &light_uniform_info_),
+		VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 2 , set , &depthImage->GetDescriptorImageInfo(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)),
+	};
+	vkUpdateDescriptorSets(device_->GetDevice(), 3, writeDescs, 0, NULL);
+	depth_inputs_.push_back(depthImage);
+	depth_sets_.push_back(set);
+}
+
+void CullLightComputePipeline::SetDepthInput(VulkanImage * depthImage)
 {
-	pre_depth_image_ = preDepthImage;
+	auto it = std::find(depth_inputs_.begin(), depth_inputs_.end(), depthImage);
+	if (it == depth_inputs_.end())
+	{
+		throw " the depth image was not added to the light cull . ";
+	}
+	depth_input_ = it - depth_inputs_.begin();
 }
 
 VulkanBuffer* CullLightComputePipeline::GetTileLightVisibleBuffer() const
@@ -76,9 +80,14 @@ VulkanBuffer* CullLightComputePipeline::GetTileLightVisibleBuffer() const
 	return tile_light_visible_buffer_;
 }
 
-VulkanBuffer * CullLightComputePipeline::GetLightUniformBuffer() const
+VkDescriptorBufferInfo CullLightComputePipeline::GetLightUniformDescriptor() const
+{
+	return light_uniform_info_;
+}
+
+uint32_t CullLightComputePipeline::GetLightUniformOffset() const
 {
-	return light_uniform_buffer_;
+	return light_uniform_offset_;
 }
 
 void CullLightComputePipeline::InitResources( )
@@ -100,12 +109,11 @@ void CullLightComputePipeline::InitResources( )
 	InitLight();
 
 	tile_light_visible_buffer_ = 
-		device_->CreateVulkanBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT , tile_count_x_ * tile_count_y_ *  (sizeof(LightVisible)) );
+		device_->CreateVulkanBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT , tile_count_x_ * tile_count_y_ *  (sizeof(LightVisible)) , MEMORY_CATEGORY_OTHER , NULL , true );
 
 	size_t lightBufferSize = sizeof(PointLight)*light_count_ + sizeof(uint32_t) * 4;
-	light_uniform_buffer_ = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, lightBufferSize, &LightUniformBufferData);
-
-	device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &compute_command_buffer_);
+	light_uniform_info_ = uniform_ring_->GetDescriptorInfo(lightBufferSize);
+	light_uniform_offset_ = uniform_ring_->Write(&LightUniformBufferData, lightBufferSize);
 }
 
 void CullLightComputePipeline::InitDesc()
@@ -118,7 +126,7 @@ void CullLightComputePipeline::InitDesc()
 
 	binding[1].binding = 1;
 	binding[1].descriptorCount = 1;
-	binding[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	binding[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	binding[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
 	binding[2].binding = 2;
@@ -127,28 +135,212 @@ void CullLightComputePipeline::InitDesc()
 	binding[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
 	VkDescriptorSetLayoutCreateInfo descSetLayoutCreateInfo = VulkanInitializer::InitDescSetLayoutCreateInfo(3, binding);
-	VULKAN_SUCCESS(vkCreateDescriptorSetLayout(device_->GetDevice(), &descSetLayoutCreateInfo, NULL, &desc_set_layout_));
+	desc_set_layout_ = device_->GetDescriptorSetLayout(descSetLayoutCreateInfo);
+}
 
-	std::vector<VkDescriptorType> descTypeVec = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER  ,  VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER };
-	std::vector<VkDescriptorPoolSize> descPoolSize = VulkanInitializer::InitDescriptorPoolSizeVec(descTypeVec);
-	VkDescriptorPoolCreateInfo descPoolCreateInfo = VulkanInitializer::InitDescriptorPoolCreateInfo(descPoolSize, 1);
-	VULKAN_SUCCESS(vkCreateDescriptorPool(device_->GetDevice(), &descPoolCreateInfo, NULL, &desc_pool_));
+VkPipeline BuildDrawCommandsPipeline::CreateComputePipeline()
+{
+	VkPushConstantRange constantRange = VulkanInitializer::InitVkPushConstantRange(0, sizeof(PushConstantData), VK_SHADER_STAGE_COMPUTE_BIT);
+	VkDescriptorSetLayout buildSetLayout = VulkanIndirectDrawList::GetBuildSetLayout(device_);
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = VulkanInitializer::InitPipelineLayoutCreateInfo(1, &constantRange, 1, &buildSetLayout);
+	pipeline_layout_ = device_->GetPipelineLayout(pipelineLayoutCreateInfo);
 
-	VkDescriptorSetAllocateInfo allocateInfo = VulkanInitializer::InitDescriptorSetAllocateInfo(1, desc_pool_, &desc_set_layout_);
-	VULKAN_SUCCESS(vkAllocateDescriptorSets(device_->GetDevice(), &allocateInfo , &desc_set_));
+	VkPipelineShaderStageCreateInfo shaderStageCreateInfo = VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, GetAssetPath() + "shaders/BuildDrawCommands.spv", device_);
+	VkComputePipelineCreateInfo computePipelineCreateInfo = VulkanInitializer::InitComputePipelineCreateInfo(pipeline_layout_, shaderStageCreateInfo);
+	VULKAN_SUCCESS(vkCreateComputePipelines(device_->GetDevice(), VK_NULL_HANDLE, 1, &computePipelineCreateInfo, NULL, &compute_pipeline_));
 
-	VkWriteDescriptorSet writeDescs[3] = {
-		VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 0 , desc_set_ , &tile_light_visible_buffer_->GetDesc()),
-		VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , 1 , desc_set_ , &light_uniform_buffer_->GetDesc()),
-		VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 2 , desc_set_ , &pre_depth_image_->GetDescriptorImageInfo( VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)),
+	return compute_pipeline_;
+}
+
+void BuildDrawCommandsPipeline::SetupCommandBuffer(VkCommandBuffer commandBuffer)
+{
+	uint32_t objectCount = draw_list_->GetObjectCount();
+	if (objectCount == 0) return;
+	PushConstantData.objectCount = objectCount;
+	PushConstantData.compact = draw_list_->IsCompacted() ? 1 : 0;
+	if (draw_list_->IsCompacted()) draw_list_->ClearCounts(commandBuffer);
+
+	VkDescriptorSet buildSet = draw_list_->GetBuildSet();
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline_);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &buildSet, 0, NULL);
+	vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstantData), &PushConstantData);
+	vkCmdDispatch(commandBuffer, (objectCount + INDIRECT_DRAW_GROUP_SIZE - 1) / INDIRECT_DRAW_GROUP_SIZE, 1, 1);
+}
+
+HiZBuildPipeline::~HiZBuildPipeline()
+{
+	VulkanDescriptorAllocator * allocator = device_->GetDescriptorAllocator();
+	for (size_t i = 0; i < level_views_.size(); i++)
+	{
+		allocator->Free(level_sets_[i], desc_set_layout_);
+		vkDestroyImageView(device_->GetDevice(), level_views_[i], NULL);
+	}
+	vkDestroyPipeline(device_->GetDevice(), compute_pipeline_, NULL);
+	delete pyramid_image_;
+}
+
+VkPipeline HiZBuildPipeline::CreateComputePipeline()
+{
+	VkPushConstantRange constantRange = VulkanInitializer::InitVkPushConstantRange(0, sizeof(PushConstantData), VK_SHADER_STAGE_COMPUTE_BIT);
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = VulkanInitializer::InitPipelineLayoutCreateInfo(1, &constantRange, 1, &desc_set_layout_);
+	pipeline_layout_ = device_->GetPipelineLayout(pipelineLayoutCreateInfo);
+
+	VkPipelineShaderStageCreateInfo shaderStageCreateInfo = VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, GetAssetPath() + "shaders/HiZBuild.spv", device_);
+	VkComputePipelineCreateInfo computePipelineCreateInfo = VulkanInitializer::InitComputePipelineCreateInfo(pipeline_layout_, shaderStageCreateInfo);
+	VULKAN_SUCCESS(vkCreateComputePipelines(device_->GetDevice(), VK_NULL_HANDLE, 1, &computePipelineCreateInfo, NULL, &compute_pipeline_));
+
+	return compute_pipeline_;
+}
+
+void HiZBuildPipeline::SetupCommandBuffer(VkCommandBuffer commandBuffer)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline_);
+	for (size_t i = 0; i < level_sizes_.size(); i++)
+	{
+		glm::ivec2 srcSize = i == 0 ? depth_size_ : level_sizes_[i - 1];
+		glm::ivec2 dstSize = level_sizes_[i];
+		PushConstantData.srcSize[0] = srcSize.x;
+		PushConstantData.srcSize[1] = srcSize.y;
+		PushConstantData.dstSize[0] = dstSize.x;
+		PushConstantData.dstSize[1] = dstSize.y;
+		// level 0 reads the only level of the depth image .
+		PushConstantData.srcLevel = i == 0 ? 0 : (int)i - 1;
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &level_sets_[i], 0, NULL);
+		vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstantData), &PushConstantData);
+		vkCmdDispatch(commandBuffer, (dstSize.x + HIZ_BUILD_GROUP_SIZE - 1) / HIZ_BUILD_GROUP_SIZE, (dstSize.y + HIZ_BUILD_GROUP_SIZE - 1) / HIZ_BUILD_GROUP_SIZE, 1);
+
+		if (i + 1 < level_sizes_.size())
+		{
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+		}
+	}
+}
+
+void HiZBuildPipeline::SetDepthImage(VulkanImage * depthImage)
+{
+	VkDescriptorImageInfo depthInfo = depthImage->GetDescriptorImageInfo(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	VkWriteDescriptorSet writeDesc = VulkanInitializer::InitWriteImageDescriptorSet(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, level_sets_[0], &depthInfo);
+	vkUpdateDescriptorSets(device_->GetDevice(), 1, &writeDesc, 0, NULL);
+}
+
+void HiZBuildPipeline::InitResources()
+{
+	// every level halves the one below , rounding down , until a single texel is left .
+	glm::ivec2 size = depth_size_;
+	do
+	{
+		size = glm::max(size / 2, glm::ivec2(1));
+		level_sizes_.push_back(size);
+	} while (size.x > 1 || size.y > 1);
+
+	uint32_t levelCount = (uint32_t)level_sizes_.size();
+	pyramid_image_ = new VulkanImage(device_, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+		level_sizes_[0].x, level_sizes_[0].y, VK_IMAGE_ASPECT_COLOR_BIT, 1, levelCount);
+
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = (float)levelCount;
+	samplerCreateInfo.maxAnisotropy = 1.0f;
+	sampler_ = device_->GetSampler(samplerCreateInfo);
+
+	VkDescriptorSetLayoutBinding bindings[2] = {
+		VulkanInitializer::InitBinding(0 , 1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , VK_SHADER_STAGE_COMPUTE_BIT),
+		VulkanInitializer::InitBinding(1 , 1 , VK_DESCRIPTOR_TYPE_STORAGE_IMAGE , VK_SHADER_STAGE_COMPUTE_BIT)
 	};
+	desc_set_layout_ = device_->GetDescriptorSetLayout(VulkanInitializer::InitDescSetLayoutCreateInfo(2, bindings));
 
-	vkUpdateDescriptorSets(device_->GetDevice(), 3, writeDescs, 0, NULL);
+	// the sets only point at the depth image and the pyramid , they are written once and shared by every frame in flight .
+	// the source of level 0 is written by SetDepthImage .
+	VulkanDescriptorAllocator * allocator = device_->GetDescriptorAllocator();
+	VkDescriptorImageInfo pyramidInfo = GetPyramidDescriptor();
+	for (uint32_t i = 0; i < levelCount; i++)
+	{
+		VkImageView view;
+		VkImageViewCreateInfo viewCreateInfo = VulkanInitializer::InitImageViewCreateInfo(VK_FORMAT_R32_SFLOAT, pyramid_image_->image_, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, i, 1);
+		VULKAN_SUCCESS(vkCreateImageView(device_->GetDevice(), &viewCreateInfo, NULL, &view));
+		level_views_.push_back(view);
+
+		VkDescriptorSet set = allocator->Allocate(desc_set_layout_);
+		level_sets_.push_back(set);
+		VkDescriptorImageInfo dstInfo = { VK_NULL_HANDLE , view , VK_IMAGE_LAYOUT_GENERAL };
+		VkWriteDescriptorSet writeDescs[2] = {
+			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_IMAGE , 1 , set , &dstInfo),
+			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 0 , set , &pyramidInfo)
+		};
+		vkUpdateDescriptorSets(device_->GetDevice(), i == 0 ? 1 : 2, writeDescs, 0, NULL);
+	}
+}
+
+VkPipeline OcclusionCullPipeline::CreateComputePipeline()
+{
+	VkDescriptorSetLayoutBinding pyramidBinding = VulkanInitializer::InitBinding(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+	VkDescriptorSetLayout setLayouts[2] = {
+		VulkanIndirectDrawList::GetBuildSetLayout(device_),
+		device_->GetDescriptorSetLayout(VulkanInitializer::InitDescSetLayoutCreateInfo(1, &pyramidBinding))
+	};
+	VkPushConstantRange constantRange = VulkanInitializer::InitVkPushConstantRange(0, sizeof(PushConstantData), VK_SHADER_STAGE_COMPUTE_BIT);
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = VulkanInitializer::InitPipelineLayoutCreateInfo(1, &constantRange, 2, setLayouts);
+	pipeline_layout_ = device_->GetPipelineLayout(pipelineLayoutCreateInfo);
+
+	pyramid_set_ = device_->GetDescriptorAllocator()->Allocate(setLayouts[1]);
+	VkDescriptorImageInfo pyramidInfo = hi_z_->GetPyramidDescriptor();
+	VkWriteDescriptorSet writeDesc = VulkanInitializer::InitWriteImageDescriptorSet(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, pyramid_set_, &pyramidInfo);
+	vkUpdateDescriptorSets(device_->GetDevice(), 1, &writeDesc, 0, NULL);
+
+	VkPipelineShaderStageCreateInfo shaderStageCreateInfo = VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, GetAssetPath() + "shaders/OcclusionCull.spv", device_);
+	VkComputePipelineCreateInfo computePipelineCreateInfo = VulkanInitializer::InitComputePipelineCreateInfo(pipeline_layout_, shaderStageCreateInfo);
+	VULKAN_SUCCESS(vkCreateComputePipelines(device_->GetDevice(), VK_NULL_HANDLE, 1, &computePipelineCreateInfo, NULL, &compute_pipeline_));
+
+	return compute_pipeline_;
+}
 
+void OcclusionCullPipeline::SetPushConstantData(const glm::mat4 & projView, int viewportWidth, int viewportHeight)
+{
+	PushConstantData.projView = projView;
+	PushConstantData.viewportSize[0] = (float)viewportWidth;
+	PushConstantData.viewportSize[1] = (float)viewportHeight;
+}
 
+void OcclusionCullPipeline::SetupCommandBuffer(VkCommandBuffer commandBuffer)
+{
+	uint32_t objectCount = draw_list_->GetObjectCount();
+	if (objectCount == 0) return;
+	glm::ivec2 pyramidSize = hi_z_->GetPyramidSize();
+	PushConstantData.pyramidSize[0] = pyramidSize.x;
+	PushConstantData.pyramidSize[1] = pyramidSize.y;
+	PushConstantData.levelCount = hi_z_->GetLevelCount();
+	PushConstantData.objectCount = objectCount;
+	PushConstantData.compact = draw_list_->IsCompacted() ? 1 : 0;
+	if (draw_list_->IsCompacted()) draw_list_->ClearCounts(commandBuffer);
+
+	VkDescriptorSet sets[2] = { draw_list_->GetBuildSet() , pyramid_set_ };
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline_);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 2, sets, 0, NULL);
+	vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstantData), &PushConstantData);
+	vkCmdDispatch(commandBuffer, (objectCount + OCCLUSION_CULL_GROUP_SIZE - 1) / OCCLUSION_CULL_GROUP_SIZE, 1, 1);
 }
 
 VkPipeline PreDepthRenderingPipeline::CreateGraphicsPipeline()
+{
+	pipeline_ = CreatePipeline(pipeline_layout_, "shaders/preDepth.spv");
+	return pipeline_;
+}
+
+// the indirect variant only differs in its layout and vertex shader .
+VkPipeline PreDepthRenderingPipeline::CreatePipeline(VkPipelineLayout pipelineLayout, const std::string & vertexShader)
 {
 	VkVertexInputBindingDescription binding = VulkanInitializer::InitVertexInputBindingDescription(0, VK_VERTEX_INPUT_RATE_VERTEX, sizeof(Vertex));
 
@@ -173,55 +365,87 @@ VkPipeline PreDepthRenderingPipeline::CreateGraphicsPipeline()
 	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = VulkanInitializer::GetDefaultDynamicState();
 	std::vector<VkPipelineShaderStageCreateInfo> pipelineShaderStageCreateInfo =
 	{
-		VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT , GetAssetPath() + "shaders/preDepth.spv" , device_),
+		VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT , GetAssetPath() + vertexShader , device_),
 	};
 
 	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo =
-		VulkanInitializer::InitGraphicsPipelineCreateInfo(pipeline_layout_, render_pass_,
+		VulkanInitializer::InitGraphicsPipelineCreateInfo(pipelineLayout, render_pass_,
 			&vertexInputStateCreateInfo, &inputAssemblyStateCreateInfo, &rasterizationStateCreateInfo, &colorBlendStateCreateInfo, &multisampleStateCreateInfo, &viewportStateCreateInfo,
 			&depthStencilStateCreateInfo, &dynamicStateCreateInfo, pipelineShaderStageCreateInfo, 0);
 
-	VULKAN_SUCCESS(vkCreateGraphicsPipelines(device_->GetDevice(), VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, NULL, &pipeline_));
+	VkPipeline pipeline;
+	VULKAN_SUCCESS(vkCreateGraphicsPipelines(device_->GetDevice(), VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, NULL, &pipeline));
 
-	return pipeline_;
+	return pipeline;
 }
 
-void PreDepthRenderingPipeline::SetupCommandBuffer(VkCommandBuffer & commandBuffer, bool startRenderPass , bool endRenderPass )
+void PreDepthRenderingPipeline::CreateIndirectPipeline()
 {
-	VkClearValue depthClearValue = {};
-	depthClearValue.depthStencil = { 1 , 0 };
-	std::vector<VkClearValue> clearValues = { depthClearValue };
-	VkBuffer vertBuffer = mesh_->GetMeshEntry().vertexBuffer->GetDesc().buffer;
-	VkBuffer indexBuffer = mesh_->GetMeshEntry().indexBuffer->GetDesc().buffer;
-	size_t vertsCount = mesh_->GetMeshEntry().vertCount;
-	size_t indicesCount = mesh_->GetMeshEntry().indicesCount;
+	if (!VulkanIndirectDrawList::IsSupported(device_) || !AssetExists("shaders/preDepthIndirect.spv")) return;
 
-	VkDeviceSize offset = 0;
+	VkPushConstantRange constRange = VulkanInitializer::InitVkPushConstantRange(0, sizeof(glm::mat4), VK_SHADER_STAGE_VERTEX_BIT);
+	VkDescriptorSetLayout objectSetLayout = VulkanIndirectDrawList::GetObjectSetLayout(device_);
+	VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(1, &constRange, 1, &objectSetLayout);
+	indirect_pipeline_layout_ = device_->GetPipelineLayout(pipelineLayout);
+	indirect_pipeline_ = CreatePipeline(indirect_pipeline_layout_, "shaders/preDepthIndirect.spv");
+}
 
+void PreDepthRenderingPipeline::SetupCommandBuffer(VkCommandBuffer & commandBuffer, bool startRenderPass , bool endRenderPass )
+{
 	if (startRenderPass)
 	{
-		VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_, clearValues, render_width_, render_height);
-		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		BeginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
 	}
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertBuffer, &offset);
-	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, offset, VK_INDEX_TYPE_UINT32);
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
-	vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &mvpMat);
-	vkCmdDrawIndexed(commandBuffer, indicesCount, 1, 0, 0, 0);
+	mesh_->BindGeometry(commandBuffer);
+	BindPipeline(commandBuffer);
+	DrawMesh(commandBuffer, mesh_, model_mat_);
 	if (endRenderPass)
 	{
 		vkCmdEndRenderPass(commandBuffer);
 	}
 }
 
+void PreDepthRenderingPipeline::BeginRenderPass(VkCommandBuffer & commandBuffer, VkSubpassContents subpassContents)
+{
+	VkClearValue depthClearValue = {};
+	depthClearValue.depthStencil = { 1 , 0 };
+	VkClearValue clearValues[] = { depthClearValue };
+	VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_, clearValues, render_width_, render_height);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, subpassContents);
+}
+
+VkCommandBufferInheritanceInfo PreDepthRenderingPipeline::GetInheritanceInfo() const
+{
+	return VulkanInitializer::InitCommandBufferInheritanceInfo(render_pass_, 0, frame_buffer_);
+}
+
+void PreDepthRenderingPipeline::BindPipeline(VkCommandBuffer & commandBuffer)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, &desc_set_, 1, &camera_uniform_offset_);
+}
+
+void PreDepthRenderingPipeline::DrawMesh(VkCommandBuffer & commandBuffer, VulkanMesh * mesh, const glm::mat4 & model)
+{
+	vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &model);
+	mesh->Draw(commandBuffer);
+}
+
+void PreDepthRenderingPipeline::DrawIndirect(VkCommandBuffer & commandBuffer, const VulkanIndirectDrawList * drawList, const glm::mat4 & projView)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, indirect_pipeline_);
+	vkCmdPushConstants(commandBuffer, indirect_pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &projView);
+	drawList->Draw(commandBuffer, indirect_pipeline_layout_, 0);
+}
+
 VkRenderPass PreDepthRenderingPipeline::CreateRenderPass()
 {
 	std::vector<VkPushConstantRange> constRange = {
 	VulkanInitializer::InitVkPushConstantRange(0 , sizeof(glm::mat4) , VK_SHADER_STAGE_VERTEX_BIT) ,
 	};
 
-	VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(constRange.size(), constRange.data(), 0, NULL);
-	VULKAN_SUCCESS(vkCreatePipelineLayout(device_->GetDevice(), &pipelineLayout, NULL, &pipeline_layout_));
+	VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(constRange.size(), constRange.data(), 1, &desc_set_layout_);
+	pipeline_layout_ = device_->GetPipelineLayout(pipelineLayout);
 
 	VkImageView attachments = pre_depth_image_->image_view_;
 	std::vector<VkAttachmentDescription> attachmentsDesc =
@@ -251,19 +475,31 @@ VkRenderPass PreDepthRenderingPipeline::CreateRenderPass()
 
 void PreDepthRenderingPipeline::PrepareResources()
 {
-	pre_depth_image_ = new VulkanImage(
-		device_,
-		VK_FORMAT_D32_SFLOAT_S8_UINT,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		render_width_,
-		render_height,
-		VK_IMAGE_ASPECT_DEPTH_BIT ,1,1,
-		true 
-	);
+	if (pre_depth_image_ == NULL)
+	{
+		pre_depth_image_ = new VulkanImage(
+			device_,
+			VK_FORMAT_D32_SFLOAT_S8_UINT,
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			render_width_,
+			render_height,
+			VK_IMAGE_ASPECT_DEPTH_BIT ,1,1,
+			true 
+		);
+	}
+
+	// the camera set only holds the ring binding , it is written once and bound with the offset of the frame .
+	VkDescriptorSetLayoutBinding binding = VulkanInitializer::InitBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT);
+	desc_set_layout_ = device_->GetDescriptorSetLayout(VulkanInitializer::InitDescSetLayoutCreateInfo(1, &binding));
+	desc_set_ = device_->GetDescriptorAllocator()->Allocate(desc_set_layout_);
+	VkDescriptorBufferInfo cameraInfo = uniform_ring_->GetDescriptorInfo(sizeof(CameraUniformBuffer));
+	VkWriteDescriptorSet writeDesc = VulkanInitializer::InitWriteBufferDescriptorSet(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0, desc_set_, &cameraInfo);
+	vkUpdateDescriptorSets(device_->GetDevice(), 1, &writeDesc, 0, NULL);
 
 	CreateRenderPass();
 	CreateGraphicsPipeline();
+	CreateIndirectPipeline();
 }
 
 VertexLayout PreDepthRenderingPipeline::GetVertexLayout(std::string & layoutName)
@@ -274,6 +510,13 @@ VertexLayout PreDepthRenderingPipeline::GetVertexLayout(std::string & layoutName
 }
 
 VkPipeline ForwardPlusLightPassPipeline::CreateGraphicsPipeline()
+{
+	pipeline_ = CreatePipeline(pipeline_layout_, "shaders/forwardLightPassVert.spv");
+	return pipeline_;
+}
+
+// the indirect variant only differs in its layout and vertex shader .
+VkPipeline ForwardPlusLightPassPipeline::CreatePipeline(VkPipelineLayout pipelineLayout, const std::string & vertexShader)
 {
 	VkVertexInputBindingDescription binding = VulkanInitializer::InitVertexInputBindingDescription(0, VK_VERTEX_INPUT_RATE_VERTEX, sizeof(Vertex));
 
@@ -298,47 +541,89 @@ VkPipeline ForwardPlusLightPassPipeline::CreateGraphicsPipeline()
 	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = VulkanInitializer::GetDefaultDynamicState();
 	std::vector<VkPipelineShaderStageCreateInfo> pipelineShaderStageCreateInfo =
 	{
-		VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT , GetAssetPath() + "shaders/forwardLightPassVert.spv" , device_),
+		VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT , GetAssetPath() + vertexShader , device_),
 		VulkanInitializer::InitShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT , GetAssetPath() + "shaders/forwardLightPassFrag.spv" , device_)
 	};
 
 	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo =
-		VulkanInitializer::InitGraphicsPipelineCreateInfo(pipeline_layout_, render_pass_,
+		VulkanInitializer::InitGraphicsPipelineCreateInfo(pipelineLayout, render_pass_,
 			&vertexInputStateCreateInfo, &inputAssemblyStateCreateInfo, &rasterizationStateCreateInfo, &colorBlendStateCreateInfo, &multisampleStateCreateInfo, &viewportStateCreateInfo,
 			&depthStencilStateCreateInfo, &dynamicStateCreateInfo, pipelineShaderStageCreateInfo, 0);
 
-	VULKAN_SUCCESS(vkCreateGraphicsPipelines(device_->GetDevice(), VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, NULL, &pipeline_));
+	VkPipeline pipeline;
+	VULKAN_SUCCESS(vkCreateGraphicsPipelines(device_->GetDevice(), VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, NULL, &pipeline));
 
-	return pipeline_;
+	return pipeline;
+}
+
+// the sets of the materials and the push constant range stay those of pipeline_layout_ , so the sets the materials
+// bind with it are compatible , the object set comes after them .
+void ForwardPlusLightPassPipeline::CreateIndirectPipeline()
+{
+	if (!VulkanIndirectDrawList::IsSupported(device_) || !AssetExists("shaders/forwardLightPassIndirectVert.spv")) return;
+
+	VkPushConstantRange constRange = VulkanInitializer::InitVkPushConstantRange(0, sizeof(PushConstantData), VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT);
+	std::vector<VkDescriptorSetLayout> setLayouts = desc_set_layout_vec_;
+	setLayouts.push_back(VulkanIndirectDrawList::GetObjectSetLayout(device_));
+	VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(1, &constRange, setLayouts.size(), setLayouts.data());
+	indirect_pipeline_layout_ = device_->GetPipelineLayout(pipelineLayout);
+	indirect_pipeline_ = CreatePipeline(indirect_pipeline_layout_, "shaders/forwardLightPassIndirectVert.spv");
 }
 
 void ForwardPlusLightPassPipeline::SetupCommandBuffer(VkCommandBuffer & commandBuffer, bool startRenderPass, bool endRenderPass)
 {
-	VkClearValue colorClearValue = {};
-	VkClearValue depthClearValue = {};
-	depthClearValue.depthStencil.depth = 1;
-	std::vector<VkClearValue> clearValues = {  colorClearValue , depthClearValue };
-	VkBuffer vertBuffer = mesh_->GetMeshEntry().vertexBuffer->GetDesc().buffer;
-	VkBuffer indexBuffer = mesh_->GetMeshEntry().indexBuffer->GetDesc().buffer;
-	size_t vertsCount = mesh_->GetMeshEntry().vertCount;
-	size_t indicesCount = mesh_->GetMeshEntry().indicesCount;
-	VkDeviceSize offset = 0;
 	if (startRenderPass)
 	{
-		VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_vec_[frame_index_], clearValues, screen_width_, screen_height_);
-		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		BeginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
 	}
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertBuffer, &offset);
-	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, offset, VK_INDEX_TYPE_UINT32);
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
-	vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData) , &PushConstantData);
-	vkCmdDrawIndexed(commandBuffer, indicesCount, 1, 0, 0, 0);
+	mesh_->BindGeometry(commandBuffer);
+	DrawMesh(commandBuffer, mesh_, PushConstantData.model, PushConstantData.viewportOffset[0], PushConstantData.viewportOffset[1]);
 	if (endRenderPass)
 	{
 		vkCmdEndRenderPass(commandBuffer);
 	}
 }
 
+void ForwardPlusLightPassPipeline::BeginRenderPass(VkCommandBuffer & commandBuffer, VkSubpassContents subpassContents)
+{
+	VkClearValue colorClearValue = {};
+	VkClearValue depthClearValue = {};
+	depthClearValue.depthStencil.depth = 1;
+	VkClearValue clearValues[] = { colorClearValue , depthClearValue };
+	VkRenderPassBeginInfo renderPassBeginInfo = VulkanInitializer::InitRenderPassBeginInfo(render_pass_, frame_buffer_vec_[frame_index_], clearValues, screen_width_, screen_height_);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, subpassContents);
+}
+
+VkCommandBufferInheritanceInfo ForwardPlusLightPassPipeline::GetInheritanceInfo() const
+{
+	// the swap chain framebuffer is left unknown , so recorded draws can be executed for any image .
+	return VulkanInitializer::InitCommandBufferInheritanceInfo(render_pass_, 0, VK_NULL_HANDLE);
+}
+
+void ForwardPlusLightPassPipeline::DrawMesh(VkCommandBuffer & commandBuffer, VulkanMesh * mesh, const glm::mat4 & model, int viewportOffsetX, int viewportOffsetY)
+{
+	auto pushConstantData = PushConstantData;
+	pushConstantData.model = model;
+	pushConstantData.viewportOffset[0] = viewportOffsetX;
+	pushConstantData.viewportOffset[1] = viewportOffsetY;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+	vkCmdPushConstants(commandBuffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstantData) , &pushConstantData);
+	mesh->Draw(commandBuffer);
+}
+
+void ForwardPlusLightPassPipeline::DrawIndirect(VkCommandBuffer & commandBuffer, const VulkanIndirectDrawList * drawList, int viewportOffsetX, int viewportOffsetY,
+	VulkanIndirectDrawList::BindMaterial bindMaterial)
+{
+	auto pushConstantData = PushConstantData;
+	pushConstantData.viewportOffset[0] = viewportOffsetX;
+	pushConstantData.viewportOffset[1] = viewportOffsetY;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, indirect_pipeline_);
+	vkCmdPushConstants(commandBuffer, indirect_pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstantData), &pushConstantData);
+	drawList->Draw(commandBuffer, indirect_pipeline_layout_, (uint32_t)desc_set_layout_vec_.size(), bindMaterial);
+}
+
 VkRenderPass ForwardPlusLightPassPipeline::CreateRenderPass()
 {
 	// Layout 
@@ -346,7 +631,7 @@ VkRenderPass ForwardPlusLightPassPipeline::CreateRenderPass()
 			VulkanInitializer::InitVkPushConstantRange(0 , sizeof(PushConstantData) , VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT )
 	};
 	VkPipelineLayoutCreateInfo pipelineLayout = VulkanInitializer::InitPipelineLayoutCreateInfo(constRange.size(), constRange.data(),desc_set_layout_vec_.size() , desc_set_layout_vec_.data() );
-	VULKAN_SUCCESS(vkCreatePipelineLayout(device_->GetDevice(), &pipelineLayout, NULL, &pipeline_layout_));
+	pipeline_layout_ = device_->GetPipelineLayout(pipelineLayout);
 
 	//Render Pass
 	std::vector<VkAttachmentDescription> attachmentsDesc =
@@ -386,15 +671,12 @@ VkRenderPass ForwardPlusLightPassPipeline::CreateRenderPass()
 
 void ForwardPlusLightPassPipeline::PrepareResources()
 {
-	transform_mat_uniform_buffer_ = device_->CreateVulkanBuffer(
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-		sizeof(TransformUniformBuffer) , 
-		&TransformUniformBuffer
-	);
+	transform_uniform_info_ = uniform_ring_->GetDescriptorInfo(sizeof(TransformUniformBuffer));
+	transform_uniform_offset_ = uniform_ring_->Write(&TransformUniformBuffer, sizeof(TransformUniformBuffer));
 	InitDesc();
 	CreateRenderPass();
 	CreateGraphicsPipeline();
+	CreateIndirectPipeline();
 }
 
 VertexLayout ForwardPlusLightPassPipeline::GetVertexLayout(std::string & layoutName)
@@ -413,14 +695,14 @@ VertexLayout ForwardPlusLightPassPipeline::GetVertexLayout(std::string & layoutN
 
 void ForwardPlusLightPassPipeline::InitDesc()
 {
-	VkDescriptorSetLayoutBinding matBinding = VulkanInitializer::InitBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT );
+	VkDescriptorSetLayoutBinding matBinding = VulkanInitializer::InitBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT );
 	VkDescriptorSetLayoutBinding samplerBinding[2] = {
 		VulkanInitializer::InitBinding(0 , 1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , VK_SHADER_STAGE_FRAGMENT_BIT),
 		VulkanInitializer::InitBinding(1  , 1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , VK_SHADER_STAGE_FRAGMENT_BIT)
 	};
 	VkDescriptorSetLayoutBinding lightBuffer[2] = {
 		VulkanInitializer::InitBinding(0 , 1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , VK_SHADER_STAGE_FRAGMENT_BIT),
-		VulkanInitializer::InitBinding(1 , 1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , VK_SHADER_STAGE_FRAGMENT_BIT)
+		VulkanInitializer::InitBinding(1 , 1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , VK_SHADER_STAGE_FRAGMENT_BIT)
 	};
 	std::vector<VkDescriptorSetLayoutCreateInfo> descSetLayoutCreateInfo = {
 		VulkanInitializer::InitDescSetLayoutCreateInfo(1 , &matBinding),
@@ -431,16 +713,16 @@ void ForwardPlusLightPassPipeline::InitDesc()
 	desc_set_vec_.resize(descSetLayoutCreateInfo.size());
 	for (int i = 0; i < descSetLayoutCreateInfo.size(); i++)
 	{
-		VULKAN_SUCCESS(vkCreateDescriptorSetLayout(device_->GetDevice(), &descSetLayoutCreateInfo[i], NULL, &desc_set_layout_vec_[i]));
+		desc_set_layout_vec_[i] = device_->GetDescriptorSetLayout(descSetLayoutCreateInfo[i]);
 	}
 
 	std::vector<VkDescriptorType> descTypeVec =
 	{ 
-		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , 
+		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , 
 		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER  ,
 		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ,
 		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ,
-		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
 	};
 
 	std::vector<VkDescriptorPoolSize> descPoolSize = VulkanInitializer::InitDescriptorPoolSizeVec(descTypeVec);
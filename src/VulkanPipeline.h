@@ -6,6 +6,8 @@
 #include "VulkanMesh.h"
 #include "VulkanSwapChain.hpp"
 #include "VulkanCamera.h"
+#include "VulkanUniformRing.h"
+#include "VulkanIndirectDraws.h"
 
 class IRenderingPipeline
 {
@@ -25,15 +27,16 @@ class IComputePipeline
 public:
 	virtual ~IComputePipeline() {};
 	virtual VkPipeline CreateComputePipeline() = 0 ;
-	virtual VkCommandBuffer SetupCommandBuffer() = 0 ;
+	virtual void SetupCommandBuffer(VkCommandBuffer commandBuffer) = 0 ;
 	virtual void UpdateData() = 0;
 };
 
 class PreDepthRenderingPipeline : public IRenderingPipeline
 {
 public:
-	PreDepthRenderingPipeline(int renderWidth, int renderHeight, VulkanDevice * device_ ) :
-		render_width_(renderWidth), render_height(renderHeight), device_(device_) 
+	// depthImage is owned by the caller , the pipeline creates its own when it is NULL .
+	PreDepthRenderingPipeline(int renderWidth, int renderHeight, VulkanDevice * device_ , VulkanCamera * camera , VulkanUniformRing * uniformRing , VulkanImage * depthImage = NULL ) :
+		render_width_(renderWidth), render_height(renderHeight), device_(device_) , camera_(camera) , uniform_ring_(uniformRing) , pre_depth_image_(depthImage)
 	{
 		PrepareResources();
 	}
@@ -45,6 +48,20 @@ public:
 	void PrepareResources();
 	VertexLayout GetVertexLayout(std::string & layoutName);
 
+	void BeginRenderPass(VkCommandBuffer & commandBuffer, VkSubpassContents subpassContents);
+	VkCommandBufferInheritanceInfo GetInheritanceInfo() const;
+	// binds the pipeline and the camera set , once per command buffer before the DrawMesh calls .
+	void BindPipeline(VkCommandBuffer & commandBuffer);
+	// the view projection matrix is read from the uniform ring , only the world matrix is pushed .
+	void DrawMesh(VkCommandBuffer & commandBuffer, VulkanMesh * mesh, const glm::mat4 & model);
+	// draws every object of drawList , the world matrices come from its object data .
+	void DrawIndirect(VkCommandBuffer & commandBuffer, const VulkanIndirectDrawList * drawList, const glm::mat4 & projView);
+	// false when the device or the shaders do not support indirect draws .
+	bool HasIndirect() const
+	{
+		return indirect_pipeline_ != VK_NULL_HANDLE;
+	}
+
 	VulkanImage* GetDepthImage() const
 	{
 		return pre_depth_image_;
@@ -53,26 +70,43 @@ public:
 	{
 		mesh_ = mesh;
 	}
-	void SetMVP(glm::mat4 mvp)
+	void SetModel(glm::mat4 model)
 	{
-		mvpMat = mvp;
+		model_mat_ = model;
 	}
 
 	void UpdateData()
 	{
+		CameraUniformBuffer.projView = camera_->matrices.perspective * camera_->matrices.view;
+		camera_uniform_offset_ = uniform_ring_->Write(&CameraUniformBuffer, sizeof(CameraUniformBuffer));
+	}
 
+	// the offset of the camera data of this frame slot , secondaries recorded with it stay valid while it is unchanged .
+	uint32_t GetCameraUniformOffset() const
+	{
+		return camera_uniform_offset_;
 	}
 
+private:
+	VkPipeline CreatePipeline(VkPipelineLayout pipelineLayout, const std::string & vertexShader);
+	void CreateIndirectPipeline();
+
 private:
 	VkPipeline pipeline_;
 	VkPipelineLayout pipeline_layout_;
+	VkPipeline indirect_pipeline_ = VK_NULL_HANDLE;
+	VkPipelineLayout indirect_pipeline_layout_ = VK_NULL_HANDLE;
+	VkDescriptorSetLayout desc_set_layout_;
+	VkDescriptorSet desc_set_;
 	VulkanMesh * mesh_;
 	VkRenderPass render_pass_;
 	VkFramebuffer frame_buffer_;
 	VulkanCamera * camera_;
 private:
-	glm::mat4 mvpMat;
+	glm::mat4 model_mat_;
 	VulkanDevice * device_;
+	VulkanUniformRing * uniform_ring_;
+	uint32_t camera_uniform_offset_ = 0;
 	VulkanImage * pre_depth_image_;
 	int render_width_;
 	int render_height;
@@ -86,22 +120,28 @@ private:
 		glm::vec3 world;
 	};
 
+	struct CameraData
+	{
+		glm::mat4 projView;
+	}CameraUniformBuffer;
+
 };
 
 class CullLightComputePipeline : public IComputePipeline 
 {
 public:
 	VkPipeline CreateComputePipeline();
-	VkCommandBuffer SetupCommandBuffer();
+	void SetupCommandBuffer(VkCommandBuffer commandBuffer);
 	void UpdateData();
 
 public:
-	CullLightComputePipeline(int tileSizeX, int tileSizeY, int tileCountX, int tileCountY, int lightCount, glm::vec3 & lightMinPos, glm::vec3 & lightMaxPos, float lightRadius , VulkanImage * preDepthImage , VulkanDevice * device  )
+	CullLightComputePipeline(int tileSizeX, int tileSizeY, int tileCountX, int tileCountY, int lightCount, glm::vec3 & lightMinPos, glm::vec3 & lightMaxPos, float lightRadius , VulkanImage * preDepthImage , VulkanDevice * device , VulkanUniformRing * uniformRing )
 		: tile_size_x_(tileSizeX), tile_size_y_(tileSizeY), tile_count_x_(tileCountX), tile_count_y_(tileCountY), light_count_(lightCount), light_min_pos_(lightMinPos), light_max_pos_(lightMaxPos), light_radius_(lightRadius) , 
-		pre_depth_image_(preDepthImage) , device_(device)
+		device_(device) , uniform_ring_(uniformRing)
 	{
 		InitResources();
 		InitDesc();
+		AddDepthInput(preDepthImage);
 		CreateComputePipeline();
 		light_radius_ = lightRadius;
 		PushConstantData.tileNum[0] = tileCountX;
@@ -109,10 +149,16 @@ public:
 	}
 
 	void SetPushConstantData( int viewportSizeX , int viewportSizeY  , float zNear , float zFar , glm::mat4 & projMatrix , glm::mat4 & viewMatrix );
-	void SetPreDepth(VulkanImage * preDepthImage );
+	// every depth image the light cull reads has its own descriptor set , written once when it is added .
+	// passes of one frame read different depth images , so the sets are never rewritten while frames in flight bind them .
+	void AddDepthInput(VulkanImage * depthImage);
+	// selects the set SetupCommandBuffer binds , depthImage has to be added before .
+	void SetDepthInput(VulkanImage * depthImage);
 
 	VulkanBuffer* GetTileLightVisibleBuffer() const ;
-	VulkanBuffer* GetLightUniformBuffer() const ;
+	// the light data is written to the uniform ring every frame , bound with GetLightUniformOffset as dynamic offset .
+	VkDescriptorBufferInfo GetLightUniformDescriptor() const ;
+	uint32_t GetLightUniformOffset() const ;
 
 private:
 	void InitResources( );
@@ -120,14 +166,15 @@ private:
 
 private:
 	VulkanBuffer * tile_light_visible_buffer_;
-	VulkanBuffer * light_uniform_buffer_;
-	VulkanImage * pre_depth_image_;
-	VkDescriptorPool desc_pool_;
-	VkDescriptorSet desc_set_;
+	VulkanUniformRing * uniform_ring_;
+	VkDescriptorBufferInfo light_uniform_info_;
+	uint32_t light_uniform_offset_ = 0;
+	std::vector<VulkanImage*> depth_inputs_;
+	std::vector<VkDescriptorSet> depth_sets_;
+	size_t depth_input_ = 0;
 	VkDescriptorSetLayout desc_set_layout_;
 	VkPipelineLayout pipeline_layout_;
 	VkPipeline compute_pipeline_;
-	VkCommandBuffer compute_command_buffer_;
 
 private:
 	int tile_size_x_;
@@ -158,6 +205,150 @@ private:
 	} PushConstantData;
 };
 
+// builds the draw commands of a VulkanIndirectDrawList from its object data , one thread per object .
+class BuildDrawCommandsPipeline : public IComputePipeline
+{
+public:
+	BuildDrawCommandsPipeline(VulkanDevice * device) : device_(device)
+	{
+		CreateComputePipeline();
+	}
+
+public:
+	VkPipeline CreateComputePipeline();
+	// clears the batch counts and dispatches , the pass writes the command and count buffers of the list .
+	void SetupCommandBuffer(VkCommandBuffer commandBuffer);
+	void UpdateData() {}
+
+	void SetDrawList(const VulkanIndirectDrawList * drawList)
+	{
+		draw_list_ = drawList;
+	}
+
+private:
+	VulkanDevice * device_;
+	VkPipelineLayout pipeline_layout_;
+	VkPipeline compute_pipeline_;
+	const VulkanIndirectDrawList * draw_list_ = NULL;
+
+	struct
+	{
+		uint32_t objectCount;
+		uint32_t compact;
+	} PushConstantData;
+};
+
+// max depth mip chain of the pre depth , a texel of level 0 covers 2x2 depth pixels and the last row and column of a
+// level also cover the odd pixels left by the level below , so every level is conservative for the whole screen .
+// the pyramid stays in the general layout , written as storage image and read with texelFetch .
+class HiZBuildPipeline : public IComputePipeline
+{
+public:
+	// the pyramid is created with the pipeline , so the render graph can import it before the depth image exists .
+	HiZBuildPipeline(VulkanDevice * device, int depthWidth, int depthHeight) : device_(device), depth_size_(depthWidth, depthHeight)
+	{
+		InitResources();
+		CreateComputePipeline();
+	}
+	~HiZBuildPipeline();
+
+public:
+	VkPipeline CreateComputePipeline();
+	// one dispatch per level , each level waits for the one it reads .
+	void SetupCommandBuffer(VkCommandBuffer commandBuffer);
+	void UpdateData() {}
+	// the depth image of depthWidth x depthHeight read by level 0 , set before the first frame .
+	void SetDepthImage(VulkanImage * depthImage);
+
+	VulkanImage * GetPyramidImage() const
+	{
+		return pyramid_image_;
+	}
+	uint32_t GetLevelCount() const
+	{
+		return (uint32_t)level_sizes_.size();
+	}
+	// every level with a nearest sampler , in the general layout .
+	VkDescriptorImageInfo GetPyramidDescriptor() const
+	{
+		return { sampler_ , pyramid_image_->image_view_ , VK_IMAGE_LAYOUT_GENERAL };
+	}
+	glm::ivec2 GetPyramidSize() const
+	{
+		return level_sizes_[0];
+	}
+
+private:
+	void InitResources();
+
+private:
+	VulkanDevice * device_;
+	glm::ivec2 depth_size_;
+	VulkanImage * pyramid_image_;
+	VkSampler sampler_;
+	std::vector<glm::ivec2> level_sizes_;
+	std::vector<VkImageView> level_views_;
+	std::vector<VkDescriptorSet> level_sets_;
+	VkDescriptorSetLayout desc_set_layout_;
+	VkPipelineLayout pipeline_layout_;
+	VkPipeline compute_pipeline_;
+
+	struct
+	{
+		int srcSize[2];
+		int dstSize[2];
+		int srcLevel;
+	} PushConstantData;
+};
+
+// builds the draw commands of a VulkanIndirectDrawList like BuildDrawCommandsPipeline , an object is visible when its
+// world bounds are not hidden in the hi-z pyramid instead of intersecting the frustums of the list , one thread per object .
+class OcclusionCullPipeline : public IComputePipeline
+{
+public:
+	OcclusionCullPipeline(VulkanDevice * device, const HiZBuildPipeline * hiZ) : device_(device), hi_z_(hiZ)
+	{
+		CreateComputePipeline();
+	}
+
+	// needs the indirect draws and the spir-v of the pyramid and of the cull pass .
+	static bool IsSupported(VulkanDevice * device)
+	{
+		return VulkanIndirectDrawList::IsSupported(device) && AssetExists("shaders/HiZBuild.spv") && AssetExists("shaders/OcclusionCull.spv");
+	}
+
+public:
+	VkPipeline CreateComputePipeline();
+	// clears the batch counts and dispatches , the pass writes the command and count buffers of the list .
+	void SetupCommandBuffer(VkCommandBuffer commandBuffer);
+	void UpdateData() {}
+
+	void SetDrawList(const VulkanIndirectDrawList * drawList)
+	{
+		draw_list_ = drawList;
+	}
+	// projView has to be the matrix the pre depth was drawn with , viewport the size of the pre depth .
+	void SetPushConstantData(const glm::mat4 & projView, int viewportWidth, int viewportHeight);
+
+private:
+	VulkanDevice * device_;
+	const HiZBuildPipeline * hi_z_;
+	const VulkanIndirectDrawList * draw_list_ = NULL;
+	VkDescriptorSet pyramid_set_;
+	VkPipelineLayout pipeline_layout_;
+	VkPipeline compute_pipeline_;
+
+	struct
+	{
+		glm::mat4 projView;
+		float viewportSize[2];
+		int pyramidSize[2];
+		uint32_t levelCount;
+		uint32_t objectCount;
+		uint32_t compact;
+	} PushConstantData;
+};
+
 class ForwardPlusLightPassPipeline : public IRenderingPipeline 
 {
 public:
@@ -167,13 +358,28 @@ public:
 	void PrepareResources();
 	VertexLayout GetVertexLayout(std::string & layoutName);
 
+	void BeginRenderPass(VkCommandBuffer & commandBuffer, VkSubpassContents subpassContents);
+	VkCommandBufferInheritanceInfo GetInheritanceInfo() const;
+	// the view projection matrix is read from the transform uniform , only the world matrix is pushed .
+	void DrawMesh(VkCommandBuffer & commandBuffer, VulkanMesh * mesh, const glm::mat4 & model, int viewportOffsetX, int viewportOffsetY);
+	// draws every object of drawList , the world matrices come from its object data and bindMaterial binds the
+	// material of every batch .
+	void DrawIndirect(VkCommandBuffer & commandBuffer, const VulkanIndirectDrawList * drawList, int viewportOffsetX, int viewportOffsetY,
+		VulkanIndirectDrawList::BindMaterial bindMaterial);
+	// false when the device or the shaders do not support indirect draws .
+	bool HasIndirect() const
+	{
+		return indirect_pipeline_ != VK_NULL_HANDLE;
+	}
+
 	void InitDesc();
 
 	ForwardPlusLightPassPipeline(
 		VulkanDevice * device,
 		VulkanSwapChain * swapChain,
 		VulkanBuffer * lightVisibleBuffer,
-		VulkanBuffer * pointLightUniformBuffer,
+		VkDescriptorBufferInfo pointLightUniform,
+		VulkanUniformRing * uniformRing,
 		int screenWidth,
 		int screenHeight , 
 		int tileNumX , 
@@ -182,7 +388,7 @@ public:
 		VkImageView depthStencilImage , 
 		VulkanCamera * camera ) :
 		device_(device), swap_chain_(swapChain), light_visible_buffer_(lightVisibleBuffer),
-		pointlight_uniform_buffer_(pointLightUniformBuffer), screen_width_(screenWidth), screen_height_(screenHeight) , 
+		pointlight_uniform_info_(pointLightUniform), uniform_ring_(uniformRing), screen_width_(screenWidth), screen_height_(screenHeight) , 
 		depth_stencil_image_( depthStencilImage  ) , camera_(camera)
 	{
 		PushConstantData.tileNum[0] = tileNumX;
@@ -212,23 +418,28 @@ public:
 		frame_index_ = ind;
 	}
 
-	void SetPushConstantValue( glm::mat4 model , glm::mat4 mvp , int viewportOffsetX , int viewportOffsetY  )
+	void SetPushConstantValue( glm::mat4 model , int viewportOffsetX , int viewportOffsetY  )
 	{
 		PushConstantData.model = model;
-		PushConstantData.mvp = mvp;
 		PushConstantData.viewportOffset[0] = viewportOffsetX;
 		PushConstantData.viewportOffset[1] = viewportOffsetY;
 
 	}
 
+	// the light data lives in the uniform ring , its offset changes with the frame slot .
+	void SetLightUniformOffset(uint32_t offset)
+	{
+		pointlight_uniform_offset_ = offset;
+	}
+
 	void UpdateDescriptorSet()
 	{
 		VkWriteDescriptorSet writeDescs[5] = {
-			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , 0 , desc_set_vec_[0] , &transform_mat_uniform_buffer_->GetDesc()),
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , 0 , desc_set_vec_[0] , &transform_uniform_info_),
 			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 0 , desc_set_vec_[1] , &albedo_image_->image_info_),
 			VulkanInitializer::InitWriteImageDescriptorSet(1 , VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER , 1 , desc_set_vec_[1] , &normal_sampler_->image_info_),
 			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_STORAGE_BUFFER , 0 , desc_set_vec_[2] , &light_visible_buffer_->GetDesc()),
-			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , 1 , desc_set_vec_[2] , &pointlight_uniform_buffer_->GetDesc())
+			VulkanInitializer::InitWriteBufferDescriptorSet(1 , VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC , 1 , desc_set_vec_[2] , &pointlight_uniform_info_)
 		};
 
 		vkUpdateDescriptorSets(device_->GetDevice(), 5, writeDescs, 0, NULL);
@@ -236,16 +447,30 @@ public:
 
 	void UpdateData()
 	{
-		transform_mat_uniform_buffer_->Map();
-		TransformData * data = (TransformData * )(transform_mat_uniform_buffer_->GetMappedMemory());
-		data->cameraPosition = camera_->position;
-		transform_mat_uniform_buffer_->Unmap();
+		TransformUniformBuffer.cameraPosition = camera_->position;
+		TransformUniformBuffer.projView = camera_->matrices.perspective * camera_->matrices.view;
+		transform_uniform_offset_ = uniform_ring_->Write(&TransformUniformBuffer, sizeof(TransformUniformBuffer));
 	}
 
+	static const uint32_t DYNAMIC_OFFSET_COUNT = 2;
+
+	// dynamic offsets in the order of the dynamic bindings , set 0 binding 0 then set 2 binding 1 .
+	void GetDynamicOffsets(uint32_t (&offsets)[DYNAMIC_OFFSET_COUNT]) const
+	{
+		offsets[0] = transform_uniform_offset_;
+		offsets[1] = pointlight_uniform_offset_;
+	}
+
+private:
+	VkPipeline CreatePipeline(VkPipelineLayout pipelineLayout, const std::string & vertexShader);
+	void CreateIndirectPipeline();
+
 private:
 	VkRenderPass render_pass_;
 	VkPipeline pipeline_;
 	VkPipelineLayout pipeline_layout_;
+	VkPipeline indirect_pipeline_ = VK_NULL_HANDLE;
+	VkPipelineLayout indirect_pipeline_layout_ = VK_NULL_HANDLE;
 	VulkanCamera * camera_;
 	VkDescriptorPool desc_pool_;
 	std::vector<VkFramebuffer> frame_buffer_vec_;
@@ -254,6 +479,8 @@ private:
 	
 	struct TransformData{
 		glm::vec3 cameraPosition;
+		float padding;
+		glm::mat4 projView;
 	}TransformUniformBuffer;
 
 	struct {
@@ -268,7 +495,6 @@ private:
 		int tileNum[2];
 		int viewportOffset[2];
 		glm::mat4 model;
-		glm::mat4 mvp;
 	} PushConstantData;
 
 private:
@@ -277,8 +503,11 @@ private:
 	Texture2D * albedo_image_;
 	Texture2D * normal_sampler_;
 	VulkanBuffer * light_visible_buffer_;
-	VulkanBuffer * pointlight_uniform_buffer_;
-	VulkanBuffer * transform_mat_uniform_buffer_;
+	VulkanUniformRing * uniform_ring_;
+	VkDescriptorBufferInfo pointlight_uniform_info_;
+	VkDescriptorBufferInfo transform_uniform_info_;
+	uint32_t pointlight_uniform_offset_ = 0;
+	uint32_t transform_uniform_offset_ = 0;
 	VkImageView depth_stencil_image_;
 	VulkanMesh * mesh_;
 	uint32_t screen_width_;
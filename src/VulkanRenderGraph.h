@@ -0,0 +1,797 @@
+#ifndef _VULKAN_RENDER_GRAPH_H_
+#define _VULKAN_RENDER_GRAPH_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <functional>
+#include "Utility.h"
+#include "VulkanDevice.hpp"
+#include "VulkanGpuProfiler.h"
+#include "VulkanCpuTracer.h"
+#include "VulkanTransientImagePool.h"
+
+#define RENDER_GRAPH_WRITE_ACCESS ( VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | \
+	VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT )
+
+// How a pass touches a resource .
+// layout is the layout the pass needs on entry , UNDEFINED when the render pass of the pass does its own transition .
+// finalLayout is the layout the pass leaves the image in , UNDEFINED when the pass does not change it .
+struct RenderGraphAccess
+{
+	VkPipelineStageFlags stage;
+	VkAccessFlags access;
+	VkImageLayout layout;
+	VkImageLayout finalLayout;
+
+	static RenderGraphAccess ColorAttachment(VkImageLayout finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+	{
+		return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT , VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT , VK_IMAGE_LAYOUT_UNDEFINED , finalLayout };
+	}
+
+	static RenderGraphAccess DepthAttachment(VkImageLayout finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+	{
+		return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT ,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT , VK_IMAGE_LAYOUT_UNDEFINED , finalLayout };
+	}
+
+	static RenderGraphAccess Sampled(VkPipelineStageFlags stage)
+	{
+		return { stage , VK_ACCESS_SHADER_READ_BIT , VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL , VK_IMAGE_LAYOUT_UNDEFINED };
+	}
+
+	static RenderGraphAccess StorageRead(VkPipelineStageFlags stage)
+	{
+		return { stage , VK_ACCESS_SHADER_READ_BIT , VK_IMAGE_LAYOUT_UNDEFINED , VK_IMAGE_LAYOUT_UNDEFINED };
+	}
+
+	static RenderGraphAccess StorageWrite(VkPipelineStageFlags stage)
+	{
+		return { stage , VK_ACCESS_SHADER_WRITE_BIT , VK_IMAGE_LAYOUT_UNDEFINED , VK_IMAGE_LAYOUT_UNDEFINED };
+	}
+
+	// storage images stay in the general layout , the shaders of a writing pass may also read what they wrote .
+	static RenderGraphAccess StorageImageRead(VkPipelineStageFlags stage)
+	{
+		return { stage , VK_ACCESS_SHADER_READ_BIT , VK_IMAGE_LAYOUT_GENERAL , VK_IMAGE_LAYOUT_UNDEFINED };
+	}
+
+	static RenderGraphAccess StorageImageWrite(VkPipelineStageFlags stage)
+	{
+		return { stage , VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT , VK_IMAGE_LAYOUT_GENERAL , VK_IMAGE_LAYOUT_UNDEFINED };
+	}
+
+	// a buffer cleared with vkCmdFillBuffer before the shaders of the pass write it .
+	static RenderGraphAccess ClearStorageWrite(VkPipelineStageFlags stage)
+	{
+		return { stage | VK_PIPELINE_STAGE_TRANSFER_BIT , VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT , VK_IMAGE_LAYOUT_UNDEFINED , VK_IMAGE_LAYOUT_UNDEFINED };
+	}
+
+	static RenderGraphAccess IndirectCommandRead()
+	{
+		return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT , VK_ACCESS_INDIRECT_COMMAND_READ_BIT , VK_IMAGE_LAYOUT_UNDEFINED , VK_IMAGE_LAYOUT_UNDEFINED };
+	}
+};
+
+enum RenderGraphQueue
+{
+	RENDER_GRAPH_QUEUE_GRAPHICS = 0,
+	RENDER_GRAPH_QUEUE_COMPUTE,
+	RENDER_GRAPH_QUEUE_COUNT
+};
+
+// One VkSubmitInfo of the frame , the submits have to reach their queues in the order of the list .
+struct RenderGraphSubmit
+{
+	RenderGraphQueue queue;
+	std::vector<VkCommandBuffer> command_buffers;
+	std::vector<VkSemaphore> wait_semaphores;
+	std::vector<VkPipelineStageFlags> wait_stages;
+	std::vector<VkSemaphore> signal_semaphores;
+};
+
+// The submits of a frame in queue order . Clear keeps the submits and the capacity of their vectors ,
+// so a frame built the same way as the one before does not allocate .
+class RenderGraphSubmitList
+{
+public:
+	void Clear()
+	{
+		count_ = 0;
+	}
+
+	// references to earlier submits are invalidated .
+	RenderGraphSubmit & Add(RenderGraphQueue queue)
+	{
+		if (count_ == submits_.size()) submits_.push_back(RenderGraphSubmit());
+		RenderGraphSubmit & submit = submits_[count_++];
+		submit.queue = queue;
+		submit.command_buffers.clear();
+		submit.wait_semaphores.clear();
+		submit.wait_stages.clear();
+		submit.signal_semaphores.clear();
+		return submit;
+	}
+
+	size_t Size() const { return count_; }
+	bool Empty() const { return count_ == 0; }
+	RenderGraphSubmit & operator[](size_t i) { return submits_[i]; }
+	const RenderGraphSubmit & operator[](size_t i) const { return submits_[i]; }
+	RenderGraphSubmit & Front() { return submits_[0]; }
+	RenderGraphSubmit & Back() { return submits_[count_ - 1]; }
+
+private:
+	std::vector<RenderGraphSubmit> submits_;
+	size_t count_ = 0;
+};
+
+// Passes declare the resources they read and write , the graph orders them and records the barriers in between .
+// Every enabled pass gets its own primary frame command buffer of the device , the barriers a pass needs are recorded
+// at its beginning . Hazards are tracked per resource while recording , in submit order , and the tracked state carries
+// over to the next frame , so the first access of a frame also waits for the last access of the frame before it .
+// Buffers and attachments whose layout is owned by render passes only get execution and memory dependencies ,
+// which are merged into one global memory barrier per pass , image barriers are only used for layout transitions .
+// Images created by the graph are transient , images whose lifetimes within the frame do not overlap share memory .
+// The first pass touching such an image in a frame waits for every earlier access to the memory it aliases .
+//
+// Compute passes can run on the async compute queue when the device has a compute family without graphics .
+// The frame is then split into submits , a submit only waits on the other queue when one of its passes depends on it ,
+// so graphics passes that do not need the compute result overlap with it . Images read across families are released
+// and acquired , a write from the other family discards the contents instead . Buffers get no ownership transfer ,
+// they have to be created with concurrent sharing . Without a separate family every pass runs on the graphics queue .
+class VulkanRenderGraph
+{
+public:
+	typedef int Resource;
+	typedef int Pass;
+	typedef std::function<void(VkCommandBuffer)> RecordFunc;
+
+	VulkanRenderGraph(VulkanDevice * device, int framesInFlight) : device_(device), frames_in_flight_(framesInFlight)
+	{
+		transient_pool_ = new VulkanTransientImagePool(device_);
+		queue_family_[RENDER_GRAPH_QUEUE_GRAPHICS] = device_->QueueFamilyIndices.graphics;
+		queue_family_[RENDER_GRAPH_QUEUE_COMPUTE] = device_->QueueFamilyIndices.compute;
+		async_compute_ = queue_family_[RENDER_GRAPH_QUEUE_COMPUTE] != (uint32_t)-1 &&
+			queue_family_[RENDER_GRAPH_QUEUE_COMPUTE] != queue_family_[RENDER_GRAPH_QUEUE_GRAPHICS];
+		frames_.resize(frames_in_flight_);
+	}
+
+	~VulkanRenderGraph()
+	{
+		for (auto & frame : frames_)
+		{
+			for (auto semaphore : frame.semaphores) vkDestroySemaphore(device_->GetDevice(), semaphore, NULL);
+		}
+		delete transient_pool_;
+	}
+
+public:
+	// images the graph may have to transition , every access of the image needs to name its layout .
+	Resource ImportImage(const char * name, VkImage image, VkImageAspectFlags aspectMask, uint32_t layerCount = 1, uint32_t levelCount = 1)
+	{
+		ResourceData resource = {};
+		resource.name = name;
+		resource.image = image;
+		resource.aspect_mask = aspectMask;
+		resource.layer_count = layerCount;
+		resource.level_count = levelCount;
+		resource.transient = -1;
+		resources_.push_back(resource);
+		return resources_.size() - 1;
+	}
+
+	// the image is created by Compile , its contents do not survive from one frame to the next .
+	Resource CreateImage(const char * name, const TransientImageDesc & desc)
+	{
+		ResourceData resource = {};
+		resource.name = name;
+		resource.image = VK_NULL_HANDLE;
+		resource.aspect_mask = GetBarrierAspect(desc);
+		resource.layer_count = desc.layerCount;
+		resource.level_count = 1;
+		resource.transient = -1;
+		resource.desc = desc;
+		resource.created = true;
+		resources_.push_back(resource);
+		compiled_ = false;
+		return resources_.size() - 1;
+	}
+
+	// valid once the graph is compiled .
+	VulkanImage * GetImage(Resource resource) const
+	{
+		return transient_pool_->GetImage(resources_[resource].transient);
+	}
+
+	const VulkanTransientImagePool * GetTransientPool() const
+	{
+		return transient_pool_;
+	}
+
+	// buffers and attachments only transitioned by render passes .
+	// an external resource is handed over by a semaphore every frame , its state starts over at each Execute .
+	Resource ImportResource(const char * name, bool external = false)
+	{
+		ResourceData resource = {};
+		resource.name = name;
+		resource.image = VK_NULL_HANDLE;
+		resource.external = external;
+		resource.transient = -1;
+		resources_.push_back(resource);
+		return resources_.size() - 1;
+	}
+
+	// passes asking for the compute queue fall back to the graphics queue when there is no async compute family .
+	Pass AddPass(const char * name, RecordFunc record, RenderGraphQueue queue = RENDER_GRAPH_QUEUE_GRAPHICS)
+	{
+		PassData pass;
+		pass.name = name;
+		pass.record = record;
+		pass.queue = async_compute_ ? queue : RENDER_GRAPH_QUEUE_GRAPHICS;
+		passes_.push_back(pass);
+		compiled_ = false;
+		return passes_.size() - 1;
+	}
+
+	// one access per resource and pass , a pass that loads and stores an attachment declares a single write .
+	void Read(Pass pass, Resource resource, const RenderGraphAccess & access)
+	{
+		passes_[pass].accesses.push_back({ resource , access , false });
+		compiled_ = false;
+	}
+
+	void Write(Pass pass, Resource resource, const RenderGraphAccess & access)
+	{
+		passes_[pass].accesses.push_back({ resource , access , true });
+		compiled_ = false;
+	}
+
+	void SetPassEnabled(Pass pass, bool enabled)
+	{
+		passes_[pass].enabled = enabled;
+	}
+
+	void SetGpuProfiler(VulkanGpuProfiler * profiler)
+	{
+		gpu_profiler_ = profiler;
+	}
+
+	bool HasAsyncCompute() const
+	{
+		return async_compute_;
+	}
+
+	// orders the passes so that every pass comes after the passes it depends on , ties keep the declaration order .
+	void Compile()
+	{
+		size_t passCount = passes_.size();
+		edges_.assign(passCount, std::vector<Pass>());
+		std::vector<int> inDegree(passCount, 0);
+		auto addEdge = [&](Pass from, Pass to)
+		{
+			if (from < 0 || from == to) return;
+			edges_[from].push_back(to);
+			inDegree[to]++;
+		};
+
+		for (size_t r = 0; r < resources_.size(); r++)
+		{
+			Pass lastWriter = -1;
+			std::vector<Pass> readers;
+			for (size_t p = 0; p < passCount; p++)
+			{
+				for (auto & access : passes_[p].accesses)
+				{
+					if (access.resource != (Resource)r) continue;
+					addEdge(lastWriter, p);
+					if (access.write)
+					{
+						for (Pass reader : readers) addEdge(reader, p);
+						readers.clear();
+						lastWriter = p;
+					}
+					else
+					{
+						readers.push_back(p);
+					}
+				}
+			}
+		}
+
+		order_.clear();
+		std::vector<bool> emitted(passCount, false);
+		while (order_.size() < passCount)
+		{
+			Pass next = -1;
+			for (size_t p = 0; p < passCount; p++)
+			{
+				if (!emitted[p] && inDegree[p] == 0)
+				{
+					next = p;
+					break;
+				}
+			}
+			if (next < 0)
+			{
+				throw " render graph has a cycle . ";
+			}
+			emitted[next] = true;
+			order_.push_back(next);
+			for (Pass to : edges_[next]) inDegree[to]--;
+		}
+		if (!transient_pool_->IsAllocated()) AllocateTransientImages();
+		compiled_ = true;
+	}
+
+	// records every enabled pass and appends the submits of the frame .
+	// the command buffers come from the frame pools of the calling thread , the frame pools of frameIndex must have been reset .
+	// graphics passes continue the last submit of the list when it is a graphics submit , the list always ends
+	// with a graphics submit that is ordered after all compute work of the frame .
+	void Execute(RenderGraphSubmitList & submits, int frameIndex)
+	{
+		CPU_TRACE_SCOPE("VulkanRenderGraph::Execute");
+		if (!compiled_) Compile();
+
+		FrameData & frame = frames_[frameIndex];
+		frame_index_ = frameIndex;
+		frame.semaphore_count = 0;
+		releases_.clear();
+
+		submits_ = &submits;
+		for (int q = 0; q < RENDER_GRAPH_QUEUE_COUNT; q++)
+		{
+			open_submit_[q] = -1;
+			synced_submit_[q] = -1;
+		}
+		if (!submits.Empty() && submits.Back().queue == RENDER_GRAPH_QUEUE_GRAPHICS)
+		{
+			open_submit_[RENDER_GRAPH_QUEUE_GRAPHICS] = submits.Size() - 1;
+		}
+
+		for (auto & resource : resources_)
+		{
+			if (resource.external)
+			{
+				resource.state = ResourceState();
+				resource.queue = -1;
+			}
+			resource.acquired = false;
+			resource.last_submit = -1;
+		}
+
+		for (Pass p : order_)
+		{
+			PassData & pass = passes_[p];
+			if (!pass.enabled) continue;
+
+			int submit = SyncQueues(pass);
+			VkCommandBuffer commandBuffer = device_->AllocateFrameCommandBuffer(queue_family_[pass.queue], frameIndex);
+			VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+			vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+			RecordBarriers(commandBuffer, pass);
+			bool profile = gpu_profiler_ && gpu_profiler_->IsTimestampSupported(queue_family_[pass.queue]);
+			if (profile && pass.profile_scope < 0) pass.profile_scope = gpu_profiler_->RegisterScope(pass.name);
+			int scope = profile ? gpu_profiler_->BeginScope(commandBuffer, pass.profile_scope) : -1;
+			pass.record(commandBuffer);
+			if (profile) gpu_profiler_->EndScope(commandBuffer, scope);
+			vkEndCommandBuffer(commandBuffer);
+			submits[submit].command_buffers.push_back(commandBuffer);
+			for (auto & access : pass.accesses) resources_[access.resource].last_submit = submit;
+		}
+
+		RecordReleases();
+
+		// compute work no graphics submit waited for is joined at the end , so the frame fence covers it .
+		int lastCompute = -1;
+		for (size_t i = 0; i < submits.Size(); i++)
+		{
+			if (submits[i].queue == RENDER_GRAPH_QUEUE_COMPUTE) lastCompute = i;
+		}
+		bool join = lastCompute > synced_submit_[RENDER_GRAPH_QUEUE_GRAPHICS];
+		if (join || submits.Empty() || submits.Back().queue != RENDER_GRAPH_QUEUE_GRAPHICS)
+		{
+			int submit = OpenSubmit(RENDER_GRAPH_QUEUE_GRAPHICS);
+			if (join) AddWait(lastCompute, submit, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		}
+		submits_ = NULL;
+	}
+
+private:
+	struct ResourceState
+	{
+		VkPipelineStageFlags write_stage = 0;
+		VkAccessFlags write_access = 0;
+		VkPipelineStageFlags read_stage = 0;
+		// read stages that already waited for the last write .
+		VkPipelineStageFlags visible_stage = 0;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	struct ResourceData
+	{
+		const char * name;
+		VkImage image;
+		VkImageAspectFlags aspect_mask;
+		uint32_t layer_count;
+		uint32_t level_count;
+		bool external;
+		ResourceState state;
+		// queue of the last access , -1 before the first one .
+		int queue = -1;
+		// submit of the last access in the frame being recorded .
+		int last_submit = -1;
+
+		// transient images .
+		bool created;
+		TransientImageDesc desc;
+		VulkanTransientImagePool::Handle transient;
+		std::vector<Resource> aliases;
+		bool acquired;
+	};
+
+	struct PassAccess
+	{
+		Resource resource;
+		RenderGraphAccess access;
+		bool write;
+	};
+
+	struct PassData
+	{
+		const char * name;
+		RecordFunc record;
+		RenderGraphQueue queue;
+		std::vector<PassAccess> accesses;
+		// ownership acquires recorded in front of the pass this frame .
+		std::vector<VkImageMemoryBarrier> acquires;
+		bool enabled = true;
+		// the gpu profiler scope of the pass , registered the first time the pass is profiled .
+		int profile_scope = -1;
+	};
+
+	struct FrameData
+	{
+		std::vector<VkSemaphore> semaphores;
+		size_t semaphore_count = 0;
+	};
+
+	struct PendingRelease
+	{
+		int submit;
+		VkPipelineStageFlags stage;
+		VkImageMemoryBarrier barrier;
+	};
+
+	int OpenSubmit(RenderGraphQueue queue)
+	{
+		submits_->Add(queue);
+		open_submit_[queue] = submits_->Size() - 1;
+		return open_submit_[queue];
+	}
+
+	// the last submit of a queue in this frame , created when the queue has none yet .
+	int LatestSubmit(RenderGraphQueue queue)
+	{
+		for (int i = (int)submits_->Size() - 1; i >= 0; i--)
+		{
+			if ((*submits_)[i].queue == queue) return i;
+		}
+		return OpenSubmit(queue);
+	}
+
+	void AddWait(int signalSubmit, int waitSubmit, VkPipelineStageFlags stage)
+	{
+		FrameData & frame = frames_[frame_index_];
+		if (frame.semaphore_count == frame.semaphores.size())
+		{
+			VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+			semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			VkSemaphore semaphore;
+			VULKAN_SUCCESS(vkCreateSemaphore(device_->GetDevice(), &semaphoreCreateInfo, NULL, &semaphore));
+			frame.semaphores.push_back(semaphore);
+		}
+		VkSemaphore semaphore = frame.semaphores[frame.semaphore_count++];
+
+		RenderGraphSubmit & signal = (*submits_)[signalSubmit];
+		RenderGraphSubmit & wait = (*submits_)[waitSubmit];
+		signal.signal_semaphores.push_back(semaphore);
+		wait.wait_semaphores.push_back(semaphore);
+		wait.wait_stages.push_back(stage);
+		synced_submit_[wait.queue] = (std::max)(synced_submit_[wait.queue], signalSubmit);
+		// nothing may be recorded behind the signal any more .
+		if (open_submit_[signal.queue] == signalSubmit) open_submit_[signal.queue] = -1;
+	}
+
+	// picks the submit of the pass , a new one waiting for the other queue when the pass depends on work recorded there .
+	int SyncQueues(PassData & pass)
+	{
+		RenderGraphQueue queue = pass.queue;
+		RenderGraphQueue other = queue == RENDER_GRAPH_QUEUE_GRAPHICS ? RENDER_GRAPH_QUEUE_COMPUTE : RENDER_GRAPH_QUEUE_GRAPHICS;
+		int signalSubmit = -1;
+		VkPipelineStageFlags waitStage = 0;
+		pass.acquires.clear();
+
+		auto dependOn = [&](int submit, VkPipelineStageFlags stage)
+		{
+			if (submit <= synced_submit_[queue]) return;
+			signalSubmit = (std::max)(signalSubmit, submit);
+			waitStage |= stage;
+		};
+
+		// the first compute submit of a frame waits for the graphics queue , that covers the frame before and
+		// the reset of the timestamp queries .
+		if (queue == RENDER_GRAPH_QUEUE_COMPUTE && synced_submit_[queue] < 0)
+		{
+			dependOn(LatestSubmit(other), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		}
+
+		for (auto & passAccess : pass.accesses)
+		{
+			ResourceData & resource = resources_[passAccess.resource];
+			const RenderGraphAccess & access = passAccess.access;
+
+			// memory shared with an image last used on the other queue .
+			if (!resource.acquired)
+			{
+				for (Resource alias : resource.aliases)
+				{
+					ResourceData & aliasData = resources_[alias];
+					if (aliasData.queue == other && aliasData.last_submit >= 0) dependOn(aliasData.last_submit, access.stage);
+				}
+			}
+
+			if (resource.queue == other)
+			{
+				VkImageLayout layout = resource.state.layout;
+				if (resource.last_submit < 0 && queue == RENDER_GRAPH_QUEUE_GRAPHICS)
+				{
+					// last used by the compute queue in the frame before , whose work was joined at its end .
+					// the image is not transferred back , its contents are gone .
+					resource.state = ResourceState();
+					resource.state.write_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+					resource.queue = queue;
+					continue;
+				}
+				int source = resource.last_submit >= 0 ? resource.last_submit : LatestSubmit(other);
+				dependOn(source, access.stage);
+
+				if (resource.image != VK_NULL_HANDLE && !passAccess.write)
+				{
+					VkImageLayout newLayout = access.layout != VK_IMAGE_LAYOUT_UNDEFINED ? access.layout : layout;
+					VkImageMemoryBarrier barrier = VulkanInitializer::InitImageMemoryBarrier(resource.state.write_access, 0, layout, newLayout,
+						resource.aspect_mask, 0, resource.layer_count, 0, resource.level_count, resource.image, queue_family_[other], queue_family_[queue]);
+					PendingRelease release = { source , resource.state.write_stage | resource.state.read_stage , barrier };
+					releases_.push_back(release);
+
+					barrier.srcAccessMask = 0;
+					barrier.dstAccessMask = access.access;
+					pass.acquires.push_back(barrier);
+					layout = newLayout;
+				}
+				else if (resource.image != VK_NULL_HANDLE)
+				{
+					layout = VK_IMAGE_LAYOUT_UNDEFINED;
+				}
+				// the semaphore covers every earlier access of the other queue .
+				resource.state = ResourceState();
+				resource.state.layout = layout;
+			}
+			resource.queue = queue;
+		}
+
+		if (signalSubmit >= 0)
+		{
+			int submit = OpenSubmit(queue);
+			AddWait(signalSubmit, submit, waitStage);
+			return submit;
+		}
+		return open_submit_[queue] >= 0 ? open_submit_[queue] : OpenSubmit(queue);
+	}
+
+	// the release half of every ownership transfer goes behind the last access on the old queue .
+	void RecordReleases()
+	{
+		for (size_t i = 0; i < releases_.size(); i++)
+		{
+			int submit = releases_[i].submit;
+			if (submit < 0) continue;
+			RenderGraphQueue queue = (*submits_)[submit].queue;
+			VkCommandBuffer commandBuffer = device_->AllocateFrameCommandBuffer(queue_family_[queue], frame_index_);
+
+			VkPipelineStageFlags srcStage = 0;
+			image_barriers_.clear();
+			for (size_t j = i; j < releases_.size(); j++)
+			{
+				if (releases_[j].submit != submit) continue;
+				srcStage |= releases_[j].stage;
+				image_barriers_.push_back(releases_[j].barrier);
+				releases_[j].submit = -1;
+			}
+
+			VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+			vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+			vkCmdPipelineBarrier(commandBuffer, srcStage != 0 ? srcStage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+				0, NULL, 0, NULL, image_barriers_.size(), image_barriers_.data());
+			vkEndCommandBuffer(commandBuffer);
+			(*submits_)[submit].command_buffers.push_back(commandBuffer);
+		}
+	}
+
+	void RecordBarriers(VkCommandBuffer commandBuffer, PassData & pass)
+	{
+		VkPipelineStageFlags srcStage = 0;
+		VkPipelineStageFlags dstStage = 0;
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		bool needMemoryBarrier = false;
+		image_barriers_ = pass.acquires;
+		for (auto & acquire : pass.acquires)
+		{
+			for (auto & passAccess : pass.accesses)
+			{
+				if (resources_[passAccess.resource].image == acquire.image) dstStage |= passAccess.access.stage;
+			}
+		}
+
+		for (auto & passAccess : pass.accesses)
+		{
+			ResourceData & resource = resources_[passAccess.resource];
+			ResourceState & state = resource.state;
+			const RenderGraphAccess & access = passAccess.access;
+
+			// the memory was used by other images since the last frame , their accesses have to finish first .
+			if (!resource.acquired && resource.aliases.size() != 0)
+			{
+				for (Resource alias : resource.aliases)
+				{
+					ResourceState & aliasState = resources_[alias].state;
+					VkPipelineStageFlags aliasStage = aliasState.write_stage | aliasState.read_stage;
+					if (aliasStage == 0 || resources_[alias].queue != pass.queue) continue;
+					srcStage |= aliasStage;
+					dstStage |= access.stage;
+					memoryBarrier.srcAccessMask |= aliasState.write_access;
+					memoryBarrier.dstAccessMask |= access.access;
+					needMemoryBarrier |= aliasState.write_access != 0;
+				}
+				state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+			resource.acquired = true;
+			VkPipelineStageFlags prevStage = state.write_stage | state.read_stage;
+
+			if (access.layout != VK_IMAGE_LAYOUT_UNDEFINED && access.layout != state.layout)
+			{
+				// the transition itself is a write , it has to wait for every earlier access .
+				image_barriers_.push_back(VulkanInitializer::InitImageMemoryBarrier(state.write_access, access.access, state.layout, access.layout,
+					resource.aspect_mask, 0, resource.layer_count, 0, resource.level_count, resource.image, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED));
+				srcStage |= prevStage;
+				dstStage |= access.stage;
+				state.layout = access.layout;
+				state.write_stage = access.stage;
+				state.write_access = 0;
+				state.read_stage = 0;
+				state.visible_stage = access.stage;
+			}
+
+			if (passAccess.write)
+			{
+				// write after write needs the memory dependency , write after read only the execution dependency .
+				if (prevStage != 0)
+				{
+					srcStage |= prevStage;
+					dstStage |= access.stage;
+					memoryBarrier.srcAccessMask |= state.write_access;
+					memoryBarrier.dstAccessMask |= access.access;
+					needMemoryBarrier |= state.write_access != 0;
+				}
+				state.write_stage = access.stage;
+				state.write_access = access.access & RENDER_GRAPH_WRITE_ACCESS;
+				state.read_stage = 0;
+				state.visible_stage = 0;
+			}
+			else
+			{
+				if (state.write_stage != 0 && (access.stage & ~state.visible_stage) != 0)
+				{
+					srcStage |= state.write_stage;
+					dstStage |= access.stage;
+					memoryBarrier.srcAccessMask |= state.write_access;
+					memoryBarrier.dstAccessMask |= access.access;
+					needMemoryBarrier |= state.write_access != 0;
+					state.visible_stage |= access.stage;
+				}
+				state.read_stage |= access.stage;
+			}
+
+			if (access.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED)
+			{
+				state.layout = access.finalLayout;
+			}
+		}
+
+		if (srcStage == 0 && image_barriers_.size() == 0) return;
+		vkCmdPipelineBarrier(commandBuffer, srcStage != 0 ? srcStage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0,
+			needMemoryBarrier ? 1 : 0, &memoryBarrier, 0, NULL, image_barriers_.size(), image_barriers_.data());
+	}
+
+	// lifetimes are the first and last position in the execution order , disabled passes included ,
+	// so images that alias stay apart whatever passes are enabled . An access on the compute queue lasts until the
+	// first graphics pass depending on it , the compute work may run alongside everything in between .
+	void AllocateTransientImages()
+	{
+		std::vector<int> position(passes_.size());
+		for (size_t i = 0; i < order_.size(); i++) position[order_[i]] = i;
+
+		std::vector<Resource> created;
+		for (size_t r = 0; r < resources_.size(); r++)
+		{
+			if (!resources_[r].created) continue;
+			int first = -1;
+			int last = -1;
+			for (size_t i = 0; i < order_.size(); i++)
+			{
+				PassData & pass = passes_[order_[i]];
+				for (auto & access : pass.accesses)
+				{
+					if (access.resource != (Resource)r) continue;
+					if (first < 0) first = i;
+					last = (std::max)(last, (int)i);
+					if (pass.queue == RENDER_GRAPH_QUEUE_COMPUTE)
+					{
+						int join = order_.size() - 1;
+						for (Pass to : edges_[order_[i]])
+						{
+							if (passes_[to].queue == RENDER_GRAPH_QUEUE_GRAPHICS) join = (std::min)(join, position[to]);
+						}
+						last = (std::max)(last, join);
+					}
+				}
+			}
+			resources_[r].transient = transient_pool_->AddImage(resources_[r].desc, first, last);
+			created.push_back(r);
+		}
+		if (created.size() == 0) return;
+
+		transient_pool_->Allocate();
+		for (Resource r : created)
+		{
+			ResourceData & resource = resources_[r];
+			resource.image = transient_pool_->GetImage(resource.transient)->image_;
+			for (Resource other : created)
+			{
+				if (transient_pool_->IsAliased(resource.transient, resources_[other].transient)) resource.aliases.push_back(other);
+			}
+		}
+	}
+
+	static VkImageAspectFlags GetBarrierAspect(const TransientImageDesc & desc)
+	{
+		bool hasStencil = desc.format == VK_FORMAT_D16_UNORM_S8_UINT || desc.format == VK_FORMAT_D24_UNORM_S8_UINT || desc.format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+		return (desc.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) && hasStencil ? desc.aspect | VK_IMAGE_ASPECT_STENCIL_BIT : desc.aspect;
+	}
+
+private:
+	VulkanDevice * device_;
+	int frames_in_flight_;
+	VulkanTransientImagePool * transient_pool_;
+	VulkanGpuProfiler * gpu_profiler_ = NULL;
+	std::vector<ResourceData> resources_;
+	std::vector<PassData> passes_;
+	std::vector<std::vector<Pass>> edges_;
+	std::vector<Pass> order_;
+	std::vector<VkImageMemoryBarrier> image_barriers_;
+	bool compiled_ = false;
+
+	bool async_compute_;
+	uint32_t queue_family_[RENDER_GRAPH_QUEUE_COUNT];
+	std::vector<FrameData> frames_;
+
+	// the frame being recorded .
+	int frame_index_ = 0;
+	RenderGraphSubmitList * submits_ = NULL;
+	int open_submit_[RENDER_GRAPH_QUEUE_COUNT];
+	// the latest submit of the other queue each queue has waited for .
+	int synced_submit_[RENDER_GRAPH_QUEUE_COUNT];
+	std::vector<PendingRelease> releases_;
+};
+
+#endif
@@ -13,13 +13,46 @@
 #include "GBufferPipeline.h"
 #include "TBDRLightPipeline.h"
 #include "ShadowDepthPipeline.h"
+#include "VulkanObject.h"
+#include "VulkanThreadPool.h"
+#include "VulkanGpuProfiler.h"
+#include "VulkanCpuTracer.h"
+#include "VulkanRenderGraph.h"
+#include "VulkanResourceRegistry.h"
+#include "VulkanTextureResidency.h"
+#include "VulkanFrustumCulling.h"
+#include <algorithm>
+#include <thread>
+#include <atomic>
 
 class VulkanRenderScene
 {
+	// per object data resolved on the main thread and read by the recording workers .
+	struct DrawItem
+	{
+		VulkanObject * object;
+		VulkanMesh * mesh;
+		glm::mat4 model;
+	};
+
+	// passes whose draws are recorded on the workers , each one keeps its secondaries per frame in flight
+	// and is only re-recorded when its key changes .
+	enum RecordPass
+	{
+		RECORD_PASS_PRE_DEPTH,
+		RECORD_PASS_FORWARD_PLUS_LIGHT,
+		// one pass per cascade , a cascade keeps its secondaries while its visible casters stay the same .
+		RECORD_PASS_SHADOW_DEPTH,
+		RECORD_PASS_PBR_LIGHT = RECORD_PASS_SHADOW_DEPTH + SHADOW_CASCADE_COUNT,
+		RECORD_PASS_GBUFFER,
+		RECORD_PASS_COUNT
+	};
+
 public:
 	VulkanRenderScene(
 		VulkanDevice * device, 
 		VkQueue queue , 
+		VulkanUploadManager * streamUploadManager ,
 		VulkanSwapChain * swapChain , 
 		VkImageView depthStencilImage , 
 		int renderWidth ,
@@ -32,6 +65,7 @@ public:
 	{
 		device_ = device;
 		queue_ = queue;
+		stream_upload_manager_ = streamUploadManager;
 		render_width_ = renderWidth;
 		render_height_ = renderHeight;
 		render_x_ = renderX;
@@ -40,27 +74,66 @@ public:
 		screen_height_ = screenHeight;
 		swapChain_ = swapChain;
 		depth_stencil_image_ = depthStencilImage;
+		frames_in_flight_ = renderGlobalState.framesInFlight;
+		uniform_ring_ = new VulkanUniformRing(device_, UNIFORM_RING_FRAME_SIZE, frames_in_flight_);
 		InitResources( renderGlobalState );
 
+		int threadCount = renderGlobalState.recordThreadCount;
+		if (threadCount <= 0)
+		{
+			threadCount = (std::max)( (int)std::thread::hardware_concurrency() - 1 , 1 );
+		}
+		thread_pool_ = new VulkanThreadPool(device_, threadCount, frames_in_flight_, RECORD_PASS_COUNT);
+		secondary_command_buffers_.resize(frames_in_flight_);
+
+		// the first frame is rendered before the first Update , fill its ring partition now .
+		UpdateUniformData(0);
 	}
 
 	~VulkanRenderScene()
 	{
+		if (stream_thread_.joinable()) stream_thread_.join();
+		delete thread_pool_;
+		delete render_graph_;
+		delete uniform_ring_;
 		for (auto obj : objects_) delete obj;
-		for (auto mesh : global_mesh_) delete mesh.second;
+		meshes_.ForEach([](VulkanMesh * mesh) { delete mesh; });
+		delete texture_residency_;
+		delete indirect_draws_.preDepth;
+		delete indirect_draws_.shadowDepth;
+		delete indirect_draws_.forwardPlusLight;
+		delete indirect_draws_.gbuffer;
+		delete hiZBuildPipeline;
+		for (auto & layout : vertex_layouts_) delete layout.arena;
 	}
 
 public:
-	void Update( float deltaTime )
+	// frameIndex is the frame slot rendered next , the caller waited on its fence .
+	void Update( float deltaTime , int frameIndex )
 	{
+		CPU_TRACE_SCOPE("VulkanRenderScene::Update");
+		UpdateSceneStreaming();
 		DistributeObjectToPipeline();
+		UpdateTextureResidency();
 		camera_->Update(deltaTime);
+		UpdateUniformData(frameIndex);
+	}
 
+	void UpdateUniformData(int frameIndex)
+	{
+		// the pipelines always allocate in the same order , so a frame slot gets the same offsets every frame .
+		// the camera matrices are written here too , the recorded secondaries only push world matrices .
+		uniform_ring_->BeginFrame(frameIndex);
 		lightCullComputePipeline->UpdateData();
 		preDepthPipeline->UpdateData();
 		forwardPlusLightPipeline->UpdateData();
 		pbrLightPipeline->UpdateData();
 		shadowDepthPipeline->UpdateData();
+		gbufferPipeline->UpdateData();
+
+		forwardPlusLightPipeline->SetLightUniformOffset(lightCullComputePipeline->GetLightUniformOffset());
+		tbdrPipeline->SetLightUniformOffset(lightCullComputePipeline->GetLightUniformOffset());
+		pbrLightPipeline->SetCascadeTransformOffset(shadowDepthPipeline->GetCascadeTransformOffset());
 	}
 
 	void MouseEvent(const MouseStateType & mouseState)
@@ -129,13 +202,24 @@ public:
 					else {
 						newTex = new Texture2D(texFiles, VK_FORMAT_R8G8B8A8_UNORM, device_, queue_, 4, false, ktxTex);
 					}
-					texture_.insert(std::pair<std::string , Texture2D*>( texNames , newTex ) );
+					textures_.Add(newTex, texNames);
 				}
 				latePos++;
 			}
 
 			texFile.close();
 			delete buffer;
+
+			default_textures_.dummy = dynamic_cast<Texture2D*>(textures_.Get(textures_.Resolve("dummy")));
+			default_textures_.lut = dynamic_cast<Texture2D*>(textures_.Get(textures_.Resolve("LUT")));
+
+			// the defaults are the fallback of evicted textures and sampled by every material , they stay resident .
+			texture_residency_ = new VulkanTextureResidency(device_, default_textures_.dummy, renderGlobalState.textureBudget);
+			textures_.ForEach([this](Texture * texture)
+			{
+				Texture2D * texture2D = dynamic_cast<Texture2D*>(texture);
+				if (texture2D != NULL && texture2D != default_textures_.dummy && texture2D != default_textures_.lut) texture_residency_->Register(texture2D);
+			});
 		};
 		auto InitForwardPlusPipeline = [&]() -> void
 		{
@@ -146,88 +230,72 @@ public:
 			glm::vec3 lightMin = glm::vec3(-15.0f, -5.0f, -5.0f);
 			glm::vec3 lightMax = glm::vec3(15.0f, 20.0f, 5.0f);
 
-			preDepthPipeline = new PreDepthRenderingPipeline(render_width_, render_height_, device_ );
-			lightCullComputePipeline = new CullLightComputePipeline(tileSize, tileSize, tileCountX, tileCountY, lightCount, lightMin, lightMax, 3.0f, preDepthPipeline->GetDepthImage(), device_);
-			forwardPlusLightPipeline = new ForwardPlusLightPassPipeline(device_, swapChain_, lightCullComputePipeline->GetTileLightVisibleBuffer(), lightCullComputePipeline->GetLightUniformBuffer(), screen_width_, screen_height_, tileCountX, tileCountY, camera_->position, depth_stencil_image_ , camera_);
-			forwardPlusNewCommandBufferVec.resize(2);
-			device_->CreateCommandBuffer(forwardPlusNewCommandBufferVec.size(), VK_COMMAND_BUFFER_LEVEL_PRIMARY, forwardPlusNewCommandBufferVec.data());
-		};
-		auto InitSponzaScene = [&]() -> void
-		{
-			std::string file = "sponza.obj";
-			std::string folder = GetAssetPath() + "models/sponza_full/";
-			sceneObjects = new VulkanSceneObjectsGroup(file, folder, device_, queue_);
-			std::vector<VulkanObject*> objs = sceneObjects->GetObjectsVecFromMaterial(forwardPlusLightPipeline, dynamic_cast<Texture2D*>((*texture_.find("dummy")).second), device_);
-			for (auto obj : objs)
-			{
-				obj->SetPipelineType(renderGlobalState.sponzaPipelineType);
-				glm::vec3 scaleV(0.01f, 0.01f, 0.01f);
-				obj->SetScale(scaleV);
-				objects_.push_back(obj);
-			}
+			preDepthPipeline = new PreDepthRenderingPipeline(render_width_, render_height_, device_, camera_, uniform_ring_, render_graph_->GetImage(graph_images_.preDepth));
+			pipeline_handles_.preDepth = RegisterPipeline(preDepthPipeline, "pre depth");
+			lightCullComputePipeline = new CullLightComputePipeline(tileSize, tileSize, tileCountX, tileCountY, lightCount, lightMin, lightMax, 3.0f, preDepthPipeline->GetDepthImage(), device_, uniform_ring_);
+			forwardPlusLightPipeline = new ForwardPlusLightPassPipeline(device_, swapChain_, lightCullComputePipeline->GetTileLightVisibleBuffer(), lightCullComputePipeline->GetLightUniformDescriptor(), uniform_ring_, screen_width_, screen_height_, tileCountX, tileCountY, camera_->position, depth_stencil_image_ , camera_);
+			pipeline_handles_.forwardPlusLight = RegisterPipeline(forwardPlusLightPipeline, "forward plus light");
 		};
 		auto InitSkyBoxPipeline = [&]() -> void 
 		{
 			TextureCube * skyBoxCube = new TextureCube(GetAssetPath() + "textures/skybox/iceflats", ".tga", device_, queue_, VK_FORMAT_R8G8B8A8_UNORM);
-			texture_.insert(std::pair<std::string , Texture*>("iceflats" , skyBoxCube));
+			default_textures_.skyBox = skyBoxCube;
+			textures_.Add(skyBoxCube, "iceflats");
 			skyboxPipeline = new SkyBoxPipeline(skyBoxCube , device_ , swapChain_ , screen_width_, screen_height_ );
-			std::string meshFile = global_mesh_file_string_vec_[2];
-			std::string layoutName;
-			VertexLayout vertLayout = skyboxPipeline->GetVertexLayout(layoutName);
-			skyboxPipeline->SetMesh(GetMesh(meshFile, vertLayout, layoutName));
-			device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &skyboxCommandBuffer);
+			pipeline_handles_.skybox = RegisterPipeline(skyboxPipeline, "skybox");
+			skyboxPipeline->SetMesh(GetMesh(2, GetPipelineLayoutSlot(pipeline_handles_.skybox)));
 		};
 		auto InitIrradiancePipeline = [&]()->void
 		{
 			device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &irradianceMapCommandBuffer);
-			TextureCube * skyBoxCube = dynamic_cast<TextureCube*>( (*(texture_.find("iceflats"))).second );
-			std::string meshFile = global_mesh_file_string_vec_[2];
-			std::string layoutName;
-			VertexLayout vertLayout = skyboxPipeline->GetVertexLayout(layoutName);
-			irradianceMapPipeline = new IrradianceMapPipeline(device_, queue_, GetMesh(global_mesh_file_string_vec_[2], vertLayout, layoutName), skyBoxCube);
+			TextureCube * skyBoxCube = default_textures_.skyBox;
+			irradianceMapPipeline = new IrradianceMapPipeline(device_, queue_, GetMesh(2, GetPipelineLayoutSlot(pipeline_handles_.skybox)), skyBoxCube);
 			
 			VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 			vkBeginCommandBuffer(irradianceMapCommandBuffer, &commandBufferBeginInfo);
 			irradianceMapPipeline->SetupCommandBuffer(irradianceMapCommandBuffer, false, false);
 			vkEndCommandBuffer(irradianceMapCommandBuffer);
 			SubmitPrecomputeCommand(irradianceMapCommandBuffer);
+			irradianceMapPipeline->ReleaseOffscreenResources();
 		};
 		auto InitPrefilterEnvirPipeline = [&]()->void
 		{
 			device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &prefilterEnvirCommandBuffer);
-			TextureCube * skyBoxCube = dynamic_cast<TextureCube*>((*(texture_.find("iceflats"))).second);
-			std::string meshFile = global_mesh_file_string_vec_[2];
-			std::string layoutName;
-			VertexLayout vertLayout = skyboxPipeline->GetVertexLayout(layoutName);
-			prefilterEnvirPipeline = new PrefilterEnvironmentPipeline(device_, queue_, GetMesh(global_mesh_file_string_vec_[2], vertLayout, layoutName), skyBoxCube);
+			TextureCube * skyBoxCube = default_textures_.skyBox;
+			prefilterEnvirPipeline = new PrefilterEnvironmentPipeline(device_, queue_, GetMesh(2, GetPipelineLayoutSlot(pipeline_handles_.skybox)), skyBoxCube);
 
 			VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 			vkBeginCommandBuffer(prefilterEnvirCommandBuffer, &commandBufferBeginInfo);
 			prefilterEnvirPipeline->SetupCommandBuffer(prefilterEnvirCommandBuffer, false, false);
 			vkEndCommandBuffer(prefilterEnvirCommandBuffer);
 			SubmitPrecomputeCommand(prefilterEnvirCommandBuffer);
+			prefilterEnvirPipeline->ReleaseOffscreenResources();
 
 		};
 		auto InitPBRLightPipeline = [&]()->void
 		{
-			shadowDepthPipeline = new ShadowDepthPipeline(device_, camera_, glm::vec3(1.0f, 1.0f, 1.0f));
-			device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &shadowDepthCommandBuffer);
-			device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &pbrLightCommandBuffer);
-			pbrLightPipeline = new PBRLightPipeline(device_, swapChain_, camera_, screen_width_, screen_height_, depth_stencil_image_,shadowDepthPipeline->GetCascadeTransform(), shadowDepthPipeline->GetShadowMapImage());
-			std::string meshFile = global_mesh_file_string_vec_[0];
-			std::string layoutName;
-			VertexLayout vertLayout = pbrLightPipeline->GetVertexLayout(layoutName);
-			pbrLightPipeline->SetMesh(GetMesh(meshFile, vertLayout, layoutName));
+			shadowDepthPipeline = new ShadowDepthPipeline(device_, camera_, glm::vec3(1.0f, 1.0f, 1.0f), uniform_ring_);
+			pbrLightPipeline = new PBRLightPipeline(device_, swapChain_, camera_, screen_width_, screen_height_, depth_stencil_image_,shadowDepthPipeline->GetCascadeTransform(), shadowDepthPipeline->GetShadowMapImage(), uniform_ring_);
+			pipeline_handles_.shadowDepth = RegisterPipeline(shadowDepthPipeline, "shadow depth");
+			pipeline_handles_.pbrLight = RegisterPipeline(pbrLightPipeline, "pbr light");
+			pbrLightPipeline->SetMesh(GetMesh(0, GetPipelineLayoutSlot(pipeline_handles_.pbrLight)));
 		};
 		auto InitTBDRPipeline = [&]()->void
 		{
-			device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &gbufferCommandBuffer);
-			device_->CreateCommandBuffer(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &tbdrlightCommandBuffer);
-			gbufferPipeline = new GBufferPipeline( render_width_ , render_height_ , device_  );
+			GBufferPipeline::RenderTargets gbufferTargets = {
+				render_graph_->GetImage(graph_images_.gbufferAlbedo),
+				render_graph_->GetImage(graph_images_.gbufferPosition),
+				render_graph_->GetImage(graph_images_.gbufferNormal),
+				render_graph_->GetImage(graph_images_.gbufferPBR),
+				render_graph_->GetImage(graph_images_.gbufferDepth)
+			};
+			gbufferPipeline = new GBufferPipeline( render_width_ , render_height_ , device_ , camera_ , uniform_ring_ , &gbufferTargets );
+			pipeline_handles_.gbuffer = RegisterPipeline(gbufferPipeline, "gbuffer");
+			lightCullComputePipeline->AddDepthInput(gbufferPipeline->GetDepthImage());
 
 			tbdrPipeline = new TBDRLightPipeline(
 				lightCullComputePipeline->GetTileLightVisibleBuffer(),
-				lightCullComputePipeline->GetLightUniformBuffer(),
+				lightCullComputePipeline->GetLightUniformDescriptor(),
 				depth_stencil_image_,
 				gbufferPipeline->GetAlbedoImage(),
 				gbufferPipeline->GetPositionImage(),
@@ -235,51 +303,83 @@ public:
 				gbufferPipeline->GetPBRImage(),
 				irradianceMapPipeline->GetIrradianceMapImage(),
 				prefilterEnvirPipeline->GetPrefilterEnvirMapImage(),
-				dynamic_cast<Texture2D*>((*(texture_.find("LUT"))).second),
+				default_textures_.lut,
 				device_,
 				swapChain_,
 				screen_width_,
 				screen_height_
 				);
 		};
+		// without the device features or the spir-v the passes keep recording a draw per object .
+		// with occlusion culling the commands of the forward plus light and gbuffer lists are built by the cull passes .
+		auto InitIndirectDraws = [&]()->void
+		{
+			if (!VulkanIndirectDrawList::IsSupported(device_)) return;
+			buildDrawCommandsPipeline = new BuildDrawCommandsPipeline(device_);
+			if (preDepthPipeline->HasIndirect()) indirect_draws_.preDepth = new VulkanIndirectDrawList(device_, frames_in_flight_);
+			if (shadowDepthPipeline->HasIndirect()) indirect_draws_.shadowDepth = new VulkanIndirectDrawList(device_, frames_in_flight_);
+			if (forwardPlusLightPipeline->HasIndirect()) indirect_draws_.forwardPlusLight = new VulkanIndirectDrawList(device_, frames_in_flight_);
+			if (gbufferPipeline->HasIndirect()) indirect_draws_.gbuffer = new VulkanIndirectDrawList(device_, frames_in_flight_);
+		};
+		// the render graph imports the pyramid , it is created before the graph and reads the pre depth once the graph is compiled .
+		// without the spir-v or the indirect draws the forward plus light and gbuffer passes draw every object in the frustum .
+		auto InitHiZPipeline = [&]()->void
+		{
+			if (!OcclusionCullPipeline::IsSupported(device_)) return;
+			hiZBuildPipeline = new HiZBuildPipeline(device_, render_width_, render_height_);
+		};
+		auto InitOcclusionCulling = [&]()->void
+		{
+			if (hiZBuildPipeline == NULL) return;
+			hiZBuildPipeline->SetDepthImage(preDepthPipeline->GetDepthImage());
+			occlusionCullPipeline = new OcclusionCullPipeline(device_, hiZBuildPipeline);
+		};
 
 		InitCamera();
 		LoadDefaultResources();
 		InitSkyBoxPipeline();
-		InitForwardPlusPipeline();
 		InitIrradiancePipeline();
 		InitPrefilterEnvirPipeline();
 		InitPBRLightPipeline();
+		InitHiZPipeline();
+		BuildRenderGraph();
+		InitForwardPlusPipeline();
 		InitTBDRPipeline();
+		InitIndirectDraws();
+		InitOcclusionCulling();
 		if (renderGlobalState.usingSponzaScene)
 		{
-			InitSponzaScene();
+			StartSceneStreaming(renderGlobalState.sponzaPipelineType);
 		}
+		auto ResolveTexture2D = [&](const char * name) -> Texture2D *
+		{
+			return dynamic_cast<Texture2D*>(textures_.Get(textures_.Resolve(name)));
+		};
 		IMaterial *forwardPBRMat = new PbrLightPassMaterial(
-			dynamic_cast<Texture2D*>((*texture_.find("treeAlbedo")).second),
-			dynamic_cast<Texture2D*>((*texture_.find("treeNormal")).second),
-			dynamic_cast<Texture2D*>((*texture_.find("treeAo")).second),
-			dynamic_cast<Texture2D*>((*texture_.find("treeMetallic")).second),
-			dynamic_cast<Texture2D*>((*texture_.find("treeRoughness")).second),
+			ResolveTexture2D("treeAlbedo"),
+			ResolveTexture2D("treeNormal"),
+			ResolveTexture2D("treeAo"),
+			ResolveTexture2D("treeMetallic"),
+			ResolveTexture2D("treeRoughness"),
 			irradianceMapPipeline->GetIrradianceMapImage(),
-			dynamic_cast<Texture2D*>((*texture_.find("LUT")).second),
+			default_textures_.lut,
 			prefilterEnvirPipeline->GetPrefilterEnvirMapImage(),
 			device_,
 			pbrLightPipeline,
-			texture_
+			textures_
 		);
 		IMaterial *forwardPBRMat2 = new PbrLightPassMaterial(
-			dynamic_cast<Texture2D*>((*texture_.find("treeAlbedo")).second),
-			dynamic_cast<Texture2D*>((*texture_.find("treeNormal")).second),
-			dynamic_cast<Texture2D*>((*texture_.find("treeAo")).second),
-			dynamic_cast<Texture2D*>((*texture_.find("treeMetallic")).second),
-			dynamic_cast<Texture2D*>((*texture_.find("treeRoughness")).second),
+			ResolveTexture2D("treeAlbedo"),
+			ResolveTexture2D("treeNormal"),
+			ResolveTexture2D("treeAo"),
+			ResolveTexture2D("treeMetallic"),
+			ResolveTexture2D("treeRoughness"),
 			irradianceMapPipeline->GetIrradianceMapImage(),
-			dynamic_cast<Texture2D*>((*texture_.find("LUT")).second),
+			default_textures_.lut,
 			prefilterEnvirPipeline->GetPrefilterEnvirMapImage(),
 			device_,
 			pbrLightPipeline,
-			texture_
+			textures_
 		);
 		AddObject({ 0.0f , 0.0f , 0.0f }, { 0.0f , 0.0f ,0.0f }, { 0.1f , 0.1f , 0.1f }, 0, PIPELINE_FORWARD_PBR, forwardPBRMat);
 		AddObject({ -0.98f , -2.83f , -0.18f }, { 0.1f , 0.0f ,1.2f }, { 0.1f , 0.66f , 0.84f }, 2, PIPELINE_FORWARD_PBR, forwardPBRMat2);
@@ -287,199 +387,654 @@ public:
 		DistributeObjectToPipeline();
 	}
 
-	void SetupCommandBuffers( std::vector<VkCommandBuffer> & commandBuffer , int imageIndex  )
+	void SetGpuProfiler(VulkanGpuProfiler * profiler)
+	{
+		gpu_profiler_ = profiler;
+		render_graph_->SetGpuProfiler(profiler);
+		// one render pass per cascade , each is timed on its own .
+		static const char * cascadeScopeNames[] = { "shadow cascade 0" , "shadow cascade 1" , "shadow cascade 2" , "shadow cascade 3" };
+		static_assert(sizeof(cascadeScopeNames) / sizeof(cascadeScopeNames[0]) == SHADOW_CASCADE_COUNT, "one scope name per shadow cascade .");
+		for (uint32_t j = 0; j < SHADOW_CASCADE_COUNT; j++)
+		{
+			cascade_scopes_[j] = profiler ? profiler->RegisterScope(cascadeScopeNames[j]) : -1;
+		}
+	}
+
+	// true until the streamed objects were added to the scene .
+	bool IsSceneStreaming() const
 	{
-		SetupSkyboxPass(commandBuffer, imageIndex);
-		if( forward_plus_objects_.size() != 0 ) 	SetupForwardPlusPass( commandBuffer, imageIndex );
-		if( forward_pbr_light_objects_.size() != 0 ) SetupForwardPBRLightPass( commandBuffer , imageIndex );
-		if (tbdr_objects_.size() != 0) SetupTBDRPass(commandBuffer, imageIndex);
+		return stream_thread_.joinable();
 	}
 
-	void SetupForwardPlusPass(std::vector<VkCommandBuffer> & commandBuffer , int imageIndex )
+	void SetupCommandBuffers( RenderGraphSubmitList & submits , int imageIndex , int frameIndex )
 	{
-		// preDepthPass
-		VkCommandBuffer newCommandBuffer = forwardPlusNewCommandBufferVec[0];
+		CPU_TRACE_SCOPE("SetupCommandBuffers");
+		frame_index_ = frameIndex;
+		image_index_ = imageIndex;
+
+		// the camera passes only draw the objects whose world bounds intersect the view frustum .
+		camera_frustum_ = VulkanFrustum::FromMatrix(camera_->matrices.perspective * camera_->matrices.view);
 
-		VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(0);
-		vkBeginCommandBuffer(newCommandBuffer, &commandBufferBeginInfo);
-		VkViewport viewport = VulkanInitializer::InitViewport( 0, 0 , render_width_, render_height_, 0.0f, 1.0f);
-		VkRect2D scissor = { 0 , 0 , screen_width_ , screen_height_ }; 
-		vkCmdSetViewport(newCommandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(newCommandBuffer, 0, 1, &scissor);
-		glm::mat4 projView = camera_->matrices.perspective * camera_->matrices.view;
-		for ( int i = 0 ; i < forward_plus_objects_.size() ; i ++ )
+		bool forwardPlus = forward_plus_objects_.size() != 0;
+		bool forwardPBR = forward_pbr_light_objects_.size() != 0;
+		bool tbdr = tbdr_objects_.size() != 0;
+		// with occlusion culling the gbuffer objects are drawn into the pre depth too , the pyramid needs every occluder .
+		bool occlusionCull = hiZBuildPipeline != NULL;
+		pre_depth_objects_ = forward_plus_objects_;
+		if (occlusionCull) pre_depth_objects_.insert(pre_depth_objects_.end(), tbdr_objects_.begin(), tbdr_objects_.end());
+		bool preDepth = pre_depth_objects_.size() != 0;
+
+		// object passes are recorded into secondary command buffers on the worker threads ,
+		// then the render graph builds the primaries that execute them .
+		// a pass whose key did not change since it was recorded for this frame slot keeps its secondaries .
+		if (preDepth) RecordPreDepthSecondaries();
+		if (forwardPlus) RecordForwardPlusSecondaries();
+		if (forwardPBR) RecordForwardPBRSecondaries();
+		if (tbdr) RecordTBDRSecondaries();
 		{
-			VulkanObject * obj = forward_plus_objects_[i];
-			SetObjectMeshToPipeline(preDepthPipeline, obj);
-			glm::mat4 model =  obj->GetWorldMatrix();
-			glm::mat4 mvp = projView * model;
-			preDepthPipeline->SetMVP(mvp);
-			if( i == 0 ) preDepthPipeline->SetupCommandBuffer(newCommandBuffer , true , false );
-			else if( i == forward_plus_objects_.size() - 1 ) preDepthPipeline->SetupCommandBuffer(newCommandBuffer, false, true);
-			else preDepthPipeline->SetupCommandBuffer(newCommandBuffer, false, false);
+			CPU_TRACE_SCOPE("WaitRecordJobs");
+			thread_pool_->Wait();
 		}
-		
-		VkImageMemoryBarrier imageBarrier = VulkanInitializer::InitImageMemoryBarrier(
-			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, 
-			VK_ACCESS_SHADER_READ_BIT, 
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 
-			VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT , 0, 1, 0, 1, 
-			preDepthPipeline->GetDepthImage()->image_
-		);
-		vkCmdPipelineBarrier(newCommandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_DEPENDENCY_BY_REGION_BIT, 0, NULL, 0 , NULL  , 1 , &imageBarrier);
-		vkEndCommandBuffer(newCommandBuffer);
-		commandBuffer.push_back(newCommandBuffer);
-
-		// lightCullPass
-		lightCullComputePipeline->SetPushConstantData(render_width_, render_height_, camera_->getNearClip() , camera_->getFarClip() , camera_->matrices.perspective, camera_->matrices.view);
-		commandBuffer.push_back(lightCullComputePipeline->SetupCommandBuffer());
-
-		// lightPass
-		forwardPlusLightPipeline->SetFramebufferIndex(imageIndex);
-
-		VkCommandBuffer lightPassCommandBuffer = forwardPlusNewCommandBufferVec[1];
-		VkCommandBufferBeginInfo ncommandBufferBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(0);
-		vkBeginCommandBuffer(lightPassCommandBuffer, &ncommandBufferBeginInfo);
-
-		VkViewport nviewport = VulkanInitializer::InitViewport( render_x_ , render_y_ , render_width_ , render_height_ , 0.0f , 1.0f );
-		VkRect2D nscissor = { 0 , 0 , screen_width_ , screen_height_ };
-		vkCmdSetViewport(lightPassCommandBuffer, 0, 1, &nviewport);
-		vkCmdSetScissor(lightPassCommandBuffer, 0, 1, &nscissor);
-
-		for (int i = 0; i < forward_plus_objects_.size(); i++)
-		{
-			VulkanObject * obj = forward_plus_objects_[i];
-			SetObjectMeshToPipeline(forwardPlusLightPipeline, obj);
-			obj->UpdatePipeline();
-			obj->SetupCommandBuffer(lightPassCommandBuffer);
-			glm::mat4 model = obj->GetWorldMatrix();
-			glm::mat4 mvp = projView * model;
-			forwardPlusLightPipeline->SetPushConstantValue(obj->GetWorldMatrix(), mvp , render_x_ , render_y_ );
-			if (i == 0) forwardPlusLightPipeline->SetupCommandBuffer(lightPassCommandBuffer, true, false);
-			else if (i == forward_plus_objects_.size() - 1) forwardPlusLightPipeline->SetupCommandBuffer(lightPassCommandBuffer, false, true);
-			else forwardPlusLightPipeline->SetupCommandBuffer(lightPassCommandBuffer, false, false);
+
+		render_graph_->SetPassEnabled(graph_passes_.buildPreDepthDraws, preDepth && indirect_draws_.preDepth != NULL);
+		render_graph_->SetPassEnabled(graph_passes_.buildShadowDraws, forwardPBR && indirect_draws_.shadowDepth != NULL);
+		render_graph_->SetPassEnabled(graph_passes_.buildForwardPlusDraws, forwardPlus && indirect_draws_.forwardPlusLight != NULL && !occlusionCull);
+		render_graph_->SetPassEnabled(graph_passes_.buildGBufferDraws, tbdr && indirect_draws_.gbuffer != NULL && !occlusionCull);
+		render_graph_->SetPassEnabled(graph_passes_.preDepth, preDepth);
+		render_graph_->SetPassEnabled(graph_passes_.hiZBuild, preDepth && occlusionCull);
+		render_graph_->SetPassEnabled(graph_passes_.cullForwardPlusDraws, forwardPlus && indirect_draws_.forwardPlusLight != NULL && occlusionCull);
+		render_graph_->SetPassEnabled(graph_passes_.cullGBufferDraws, tbdr && indirect_draws_.gbuffer != NULL && occlusionCull);
+		render_graph_->SetPassEnabled(graph_passes_.forwardPlusLightCull, forwardPlus);
+		render_graph_->SetPassEnabled(graph_passes_.forwardPlusLight, forwardPlus);
+		render_graph_->SetPassEnabled(graph_passes_.shadowDepth, forwardPBR);
+		render_graph_->SetPassEnabled(graph_passes_.pbrLight, forwardPBR);
+		render_graph_->SetPassEnabled(graph_passes_.gbuffer, tbdr);
+		render_graph_->SetPassEnabled(graph_passes_.tbdrLightCull, tbdr);
+		render_graph_->SetPassEnabled(graph_passes_.tbdrLight, tbdr);
+		render_graph_->Execute(submits, frame_index_);
+	}
+
+	// the forward plus objects , and the gbuffer objects when they are culled against the pyramid built from it .
+	void RecordPreDepthSecondaries()
+	{
+		CPU_TRACE_SCOPE("RecordPreDepthSecondaries");
+		if (indirect_draws_.preDepth != NULL)
+		{
+			BuildIndirectDrawList(pre_depth_objects_, pipeline_handles_.preDepth, draw_lists_.preDepth, indirect_draws_.preDepth, &camera_frustum_, 1);
+			return;
+		}
+		// the view projection matrix is read from the uniform ring , the pass only changes with the visible draws .
+		BuildDrawList(pre_depth_objects_, pipeline_handles_.preDepth, false, draw_lists_.preDepth, &camera_frustum_, 1);
+		if (!BeginPassRecording(RECORD_PASS_PRE_DEPTH, ComputePassKey(draw_lists_.preDepth, preDepthPipeline->GetCameraUniformOffset()))) return;
+
+		VkViewport viewport = VulkanInitializer::InitViewport(0, 0, render_width_, render_height_, 0.0f, 1.0f);
+		VkRect2D scissor = { 0 , 0 , (uint32_t)screen_width_ , (uint32_t)screen_height_ };
+		std::vector<DrawItem> * preDepthDraws = &draw_lists_.preDepth;
+		RecordSecondaryChunks(RECORD_PASS_PRE_DEPTH, secondary_command_buffers_[frame_index_].preDepth, preDepthDraws, preDepthPipeline->GetInheritanceInfo(), viewport, scissor,
+			[this](VkCommandBuffer & cmd)
+		{
+			preDepthPipeline->BindPipeline(cmd);
+		},
+			[this](VkCommandBuffer & cmd, const DrawItem & draw)
+		{
+			preDepthPipeline->DrawMesh(cmd, draw.mesh, draw.model);
+		});
+	}
+
+	void RecordForwardPlusSecondaries()
+	{
+		CPU_TRACE_SCOPE("RecordForwardPlusSecondaries");
+		if (indirect_draws_.forwardPlusLight != NULL)
+		{
+			BuildMaterialDrawList(forward_plus_objects_, pipeline_handles_.forwardPlusLight, draw_lists_.forwardPlusLight, indirect_draws_.forwardPlusLight, &camera_frustum_, 1);
+			return;
+		}
+		SecondaryCommandBuffers & secondaries = secondary_command_buffers_[frame_index_];
+		VkRect2D scissor = { 0 , 0 , (uint32_t)screen_width_ , (uint32_t)screen_height_ };
+
+		BuildDrawList(forward_plus_objects_, pipeline_handles_.forwardPlusLight, true, draw_lists_.forwardPlusLight, &camera_frustum_, 1);
+
+		// the camera lives in the transform uniform , the materials bind the uniform ring with the dynamic offsets of this frame slot .
+		size_t lightKey = ComputePassKey(draw_lists_.forwardPlusLight, 0);
+		uint32_t lightOffsets[ForwardPlusLightPassPipeline::DYNAMIC_OFFSET_COUNT];
+		forwardPlusLightPipeline->GetDynamicOffsets(lightOffsets);
+		for (uint32_t offset : lightOffsets) hash_combine(lightKey, offset);
+
+		if (BeginPassRecording(RECORD_PASS_FORWARD_PLUS_LIGHT, lightKey))
+		{
+			VkViewport viewport = VulkanInitializer::InitViewport(render_x_, render_y_, render_width_, render_height_, 0.0f, 1.0f);
+			std::vector<DrawItem> * lightDraws = &draw_lists_.forwardPlusLight;
+			RecordSecondaryChunks(RECORD_PASS_FORWARD_PLUS_LIGHT, secondaries.forwardPlusLight, lightDraws, forwardPlusLightPipeline->GetInheritanceInfo(), viewport, scissor,
+				[this](VkCommandBuffer & cmd, const DrawItem & draw)
+			{
+				draw.object->SetupCommandBuffer(cmd);
+				forwardPlusLightPipeline->DrawMesh(cmd, draw.mesh, draw.model, render_x_, render_y_);
+			});
+		}
+	}
+
+	void RecordForwardPBRSecondaries()
+	{
+		CPU_TRACE_SCOPE("RecordForwardPBRSecondaries");
+		SecondaryCommandBuffers & secondaries = secondary_command_buffers_[frame_index_];
+
+		VulkanFrustum cascadeFrustums[SHADOW_CASCADE_COUNT];
+		for (uint32_t j = 0; j < SHADOW_CASCADE_COUNT; j++)
+		{
+			cascadeFrustums[j] = VulkanFrustum::FromMatrix(shadowDepthPipeline->GetCascadeViewProj(j));
+		}
+
+		// the indirect draws share one list for every cascade , it keeps the objects visible to any of them .
+		if (indirect_draws_.shadowDepth != NULL)
+		{
+			BuildIndirectDrawList(forward_pbr_light_objects_, pipeline_handles_.shadowDepth, draw_lists_.shadowDepth, indirect_draws_.shadowDepth, cascadeFrustums, SHADOW_CASCADE_COUNT);
+		}
+		else
+		{
+			// the secondaries draw the objects visible to their cascade , the cascade matrices are read from the uniform ring ,
+			// so a cascade is only re-recorded when its visible casters or the offset of its matrix change .
+			BuildDrawList(forward_pbr_light_objects_, pipeline_handles_.shadowDepth, false, draw_lists_.shadowDepth, NULL, 0);
+			UpdateCullBounds(draw_lists_.shadowDepth);
+			VkViewport viewport = VulkanInitializer::InitViewport(0, 0, 4096, 4096, 0.0f, 1.0f);
+			VkRect2D scissor = { 0 , 0 , 4096 , 4096 };
+			for (uint32_t j = 0; j < SHADOW_CASCADE_COUNT; j++)
+			{
+				std::vector<DrawItem> * shadowDraws = &draw_lists_.shadowCascades[j];
+				SelectVisibleDraws(draw_lists_.shadowDepth, &cascadeFrustums[j], 1, *shadowDraws);
+				size_t cascadeKey = ComputePassKey(*shadowDraws, j);
+				hash_combine(cascadeKey, shadowDepthPipeline->GetCascadeTransformOffset());
+				RecordPass cascadePass = (RecordPass)(RECORD_PASS_SHADOW_DEPTH + j);
+				if (!BeginPassRecording(cascadePass, cascadeKey)) continue;
+				RecordSecondaryChunks(cascadePass, secondaries.shadowDepth[j], shadowDraws, shadowDepthPipeline->GetInheritanceInfo(j), viewport, scissor,
+					[this](VkCommandBuffer & cmd)
+				{
+					shadowDepthPipeline->BindPipeline(cmd);
+				},
+					[this, j](VkCommandBuffer & cmd, const DrawItem & draw)
+				{
+					shadowDepthPipeline->DrawMesh(cmd, draw.mesh, draw.model, j);
+				});
+			}
+		}
+
+		// the camera lives in the uniform block of the pipeline , bound with the dynamic offsets of this frame slot .
+		BuildDrawList(forward_pbr_light_objects_, pipeline_handles_.pbrLight, true, draw_lists_.pbrLight, &camera_frustum_, 1);
+		size_t pbrKey = ComputePassKey(draw_lists_.pbrLight, 0);
+		uint32_t pbrOffsets[PBRLightPipeline::DYNAMIC_OFFSET_COUNT];
+		pbrLightPipeline->GetDynamicOffsets(pbrOffsets);
+		for (uint32_t offset : pbrOffsets) hash_combine(pbrKey, offset);
+		if (BeginPassRecording(RECORD_PASS_PBR_LIGHT, pbrKey))
+		{
+			VkViewport viewport = VulkanInitializer::InitViewport(render_x_, render_y_, render_width_, render_height_, 0.0f, 1.0f);
+			VkRect2D scissor = { 0 , 0 , (uint32_t)screen_width_ , (uint32_t)screen_height_ };
+			std::vector<DrawItem> * pbrDraws = &draw_lists_.pbrLight;
+			RecordSecondaryChunks(RECORD_PASS_PBR_LIGHT, secondaries.pbrLight, pbrDraws, pbrLightPipeline->GetInheritanceInfo(), viewport, scissor,
+				[this](VkCommandBuffer & cmd, const DrawItem & draw)
+			{
+				draw.object->SetupCommandBuffer(cmd);
+				pbrLightPipeline->DrawMesh(cmd, draw.mesh, draw.model);
+			});
+		}
+	}
+
+	void RecordTBDRSecondaries()
+	{
+		CPU_TRACE_SCOPE("RecordTBDRSecondaries");
+		if (indirect_draws_.gbuffer != NULL)
+		{
+			BuildMaterialDrawList(tbdr_objects_, pipeline_handles_.gbuffer, draw_lists_.gbuffer, indirect_draws_.gbuffer, &camera_frustum_, 1);
+			return;
+		}
+		SecondaryCommandBuffers & secondaries = secondary_command_buffers_[frame_index_];
+		BuildDrawList(tbdr_objects_, pipeline_handles_.gbuffer, true, draw_lists_.gbuffer, &camera_frustum_, 1);
+
+		// the view projection matrix is read from the uniform ring , the materials bind it with the offset of this frame slot .
+		size_t gbufferKey = ComputePassKey(draw_lists_.gbuffer, 0);
+		uint32_t gbufferOffsets[GBufferPipeline::DYNAMIC_OFFSET_COUNT];
+		gbufferPipeline->GetDynamicOffsets(gbufferOffsets);
+		for (uint32_t offset : gbufferOffsets) hash_combine(gbufferKey, offset);
+		if (!BeginPassRecording(RECORD_PASS_GBUFFER, gbufferKey)) return;
+
+		VkViewport viewport = VulkanInitializer::InitViewport(0, 0, render_width_, render_height_, 0.0f, 1.0f);
+		VkRect2D scissor = { 0 , 0 , (uint32_t)screen_width_ , (uint32_t)screen_height_ };
+		std::vector<DrawItem> * gbufferDraws = &draw_lists_.gbuffer;
+		RecordSecondaryChunks(RECORD_PASS_GBUFFER, secondaries.gbuffer, gbufferDraws, gbufferPipeline->GetInheritanceInfo(), viewport, scissor,
+			[this](VkCommandBuffer & cmd, const DrawItem & draw)
+		{
+			draw.object->SetupCommandBuffer(cmd);
+			gbufferPipeline->DrawMesh(cmd, draw.mesh, draw.model);
+		});
+	}
+
+	// hashes everything a pass records from its culled draw list , the object versions cover transform , mesh and pipeline changes .
+	// the camera is not part of it , the passes read it from the uniform ring and add the offsets to seed .
+	size_t ComputePassKey(const std::vector<DrawItem> & draws, size_t seed)
+	{
+		hash_combine(seed, draws.size());
+		for (auto & draw : draws)
+		{
+			hash_combine(seed, draw.object);
+			hash_combine(seed, draw.mesh);
+			hash_combine(seed, draw.object->GetVersion());
+			hash_combine(seed, draw.object->GetMaterialVersion());
+		}
+		return seed;
+	}
+
+	// returns false when the secondaries recorded for this frame slot are still valid for key ,
+	// otherwise releases them and the caller records the pass again .
+	bool BeginPassRecording(RecordPass pass, size_t key)
+	{
+		if (pass_recorded_[frame_index_][pass] && pass_keys_[frame_index_][pass] == key) return false;
+		pass_recorded_[frame_index_][pass] = true;
+		pass_keys_[frame_index_][pass] = key;
+		thread_pool_->ResetPass(frame_index_, pass);
+		return true;
+	}
+
+	// resolves the mesh and world matrix of every object on the main thread , so the workers only read them .
+	// with frustums only the objects intersecting one of them are kept , the culling is deterministic , so the list
+	// only changes with the frustums or the objects .
+	// the draws are grouped by geometry arena , a chunk rebinds the vertex and index buffers only between groups .
+	void BuildDrawList(const std::vector<VulkanObject*> & objects, PipelineHandle pipeline, bool updatePipeline, std::vector<DrawItem> & drawList,
+		const VulkanFrustum * frustums, uint32_t frustumCount)
+	{
+		drawList.clear();
+		int layoutSlot = GetPipelineLayoutSlot(pipeline);
+		for (auto obj : objects)
+		{
+			VulkanMesh * mesh = GetObjectMesh(layoutSlot, obj);
+			if (mesh == NULL) continue;
+			if (updatePipeline) obj->UpdatePipeline();
+			drawList.push_back({ obj , mesh , obj->GetWorldMatrix() });
+		}
+		if (frustumCount != 0)
+		{
+			UpdateCullBounds(drawList);
+			SelectVisibleDraws(drawList, frustums, frustumCount, drawList);
+		}
+		// stable_sort takes a temporary buffer , the common case of a list already grouped by arena skips it .
+		auto arenaLess = [](const DrawItem & a, const DrawItem & b)
+		{
+			return a.mesh->GetArena() < b.mesh->GetArena();
+		};
+		if (!std::is_sorted(drawList.begin(), drawList.end(), arenaLess))
+		{
+			std::stable_sort(drawList.begin(), drawList.end(), arenaLess);
+		}
+	}
+
+	// the object data is written every frame , it goes to the buffer of the frame slot .
+	// every object is added , the compute pass building the commands tests them against the frustums .
+	void BuildIndirectDrawList(const std::vector<VulkanObject*> & objects, PipelineHandle pipeline, std::vector<DrawItem> & drawList, VulkanIndirectDrawList * indirectDraws,
+		const VulkanFrustum * frustums, uint32_t frustumCount)
+	{
+		BuildDrawList(objects, pipeline, false, drawList, NULL, 0);
+		indirectDraws->Begin(frame_index_);
+		indirectDraws->SetFrustums(frustums, frustumCount);
+		for (auto & draw : drawList) indirectDraws->Add(draw.mesh, draw.model);
+		indirectDraws->End();
+	}
+
+	// the light passes bind the material of every batch , the draws are grouped by arena then material so objects
+	// sharing both end in the same batch . the materials bind their own sets , the pipeline data is not updated .
+	void BuildMaterialDrawList(const std::vector<VulkanObject*> & objects, PipelineHandle pipeline, std::vector<DrawItem> & drawList, VulkanIndirectDrawList * indirectDraws,
+		const VulkanFrustum * frustums, uint32_t frustumCount)
+	{
+		BuildDrawList(objects, pipeline, false, drawList, NULL, 0);
+		auto materialLess = [](const DrawItem & a, const DrawItem & b)
+		{
+			if (a.mesh->GetArena() != b.mesh->GetArena()) return a.mesh->GetArena() < b.mesh->GetArena();
+			return a.object->GetMaterial() < b.object->GetMaterial();
+		};
+		if (!std::is_sorted(drawList.begin(), drawList.end(), materialLess))
+		{
+			std::stable_sort(drawList.begin(), drawList.end(), materialLess);
+		}
+		indirectDraws->Begin(frame_index_);
+		indirectDraws->SetFrustums(frustums, frustumCount);
+		for (auto & draw : drawList) indirectDraws->Add(draw.mesh, draw.model, draw.object->GetMaterial());
+		indirectDraws->End();
+	}
+
+	static void BindObjectMaterial(VkCommandBuffer & commandBuffer, IMaterial * material)
+	{
+		material->SetupCommandBuffer(commandBuffer);
+	}
+
+	// the world bounds of the draws , in their order , for SelectVisibleDraws .
+	void UpdateCullBounds(const std::vector<DrawItem> & draws)
+	{
+		CPU_TRACE_SCOPE("UpdateCullBounds");
+		cull_bounds_.Clear();
+		for (auto & draw : draws) cull_bounds_.Add(draw.mesh->GetBounds(), draw.model);
+	}
+
+	// copies the draws intersecting one of the frustums into visibleDraws , which may be draws itself .
+	void SelectVisibleDraws(const std::vector<DrawItem> & draws, const VulkanFrustum * frustums, uint32_t frustumCount, std::vector<DrawItem> & visibleDraws)
+	{
+		CPU_TRACE_SCOPE("SelectVisibleDraws");
+		cull_bounds_.Cull(frustums, frustumCount, cull_visible_);
+		if (&visibleDraws == &draws)
+		{
+			// the indices increase , an in place copy never overwrites a draw it still reads .
+			for (size_t i = 0; i < cull_visible_.size(); i++) visibleDraws[i] = visibleDraws[cull_visible_[i]];
+			visibleDraws.resize(cull_visible_.size());
+			return;
+		}
+		visibleDraws.clear();
+		for (uint32_t index : cull_visible_) visibleDraws.push_back(draws[index]);
+	}
+
+	template <class RecordFunc>
+	void RecordSecondaryChunks(RecordPass pass, std::vector<VkCommandBuffer> & secondaries, const std::vector<DrawItem> * draws, VkCommandBufferInheritanceInfo inheritanceInfo, VkViewport viewport, VkRect2D scissor, RecordFunc recordFunc)
+	{
+		RecordSecondaryChunks(pass, secondaries, draws, inheritanceInfo, viewport, scissor, [](VkCommandBuffer & cmd) {}, recordFunc);
+	}
+
+	// splits the draws into chunks , each chunk is recorded by one worker into its own secondary command buffer .
+	// beginFunc records the state shared by the draws of a chunk , it runs once per secondary before recordFunc .
+	// secondaries is sized here and filled by the jobs , it is only valid after thread_pool_->Wait() .
+	template <class BeginFunc, class RecordFunc>
+	void RecordSecondaryChunks(RecordPass pass, std::vector<VkCommandBuffer> & secondaries, const std::vector<DrawItem> * draws, VkCommandBufferInheritanceInfo inheritanceInfo, VkViewport viewport, VkRect2D scissor, BeginFunc beginFunc, RecordFunc recordFunc)
+	{
+		size_t drawCount = draws->size();
+		size_t threadCount = thread_pool_->GetThreadCount();
+		size_t chunkSize = (std::max<size_t>)(MIN_RECORD_CHUNK_SIZE, (drawCount + threadCount - 1) / threadCount);
+		size_t chunkCount = (drawCount + chunkSize - 1) / chunkSize;
+		secondaries.resize(chunkCount);
+		for (size_t c = 0; c < chunkCount; c++)
+		{
+			size_t first = c * chunkSize;
+			size_t last = (std::min)(drawCount, first + chunkSize);
+			VkCommandBuffer * dst = &secondaries[c];
+			int frameIndex = frame_index_;
+			thread_pool_->AddJob([this, pass, frameIndex, dst, draws, first, last, inheritanceInfo, viewport, scissor, beginFunc, recordFunc](int threadIndex)
+			{
+				CPU_TRACE_SCOPE("RecordSecondaryChunk");
+				VkCommandBuffer cmd = thread_pool_->GetSecondaryCommandBuffer(threadIndex, frameIndex, pass);
+				VkCommandBufferInheritanceInfo chunkInheritanceInfo = inheritanceInfo;
+				VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(
+					VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &chunkInheritanceInfo);
+				vkBeginCommandBuffer(cmd, &commandBufferBeginInfo);
+				vkCmdSetViewport(cmd, 0, 1, &viewport);
+				vkCmdSetScissor(cmd, 0, 1, &scissor);
+				beginFunc(cmd);
+				VulkanGeometryArena * boundArena = NULL;
+				for (size_t i = first; i < last; i++)
+				{
+					const DrawItem & draw = (*draws)[i];
+					if (draw.mesh->GetArena() != boundArena)
+					{
+						boundArena = draw.mesh->GetArena();
+						boundArena->Bind(cmd);
+					}
+					recordFunc(cmd, draw);
+				}
+				vkEndCommandBuffer(cmd);
+				*dst = cmd;
+			});
+		}
+	}
+
+	int BeginScope(VkCommandBuffer commandBuffer, int scopeId)
+	{
+		return gpu_profiler_ ? gpu_profiler_->BeginScope(commandBuffer, scopeId) : -1;
+	}
+
+	void EndScope(VkCommandBuffer commandBuffer, int scope)
+	{
+		if (gpu_profiler_) gpu_profiler_->EndScope(commandBuffer, scope);
+	}
+
+	void ExecuteSecondaries(VkCommandBuffer & commandBuffer, const std::vector<VkCommandBuffer> & secondaries)
+	{
+		if (secondaries.size() == 0) return;
+		vkCmdExecuteCommands(commandBuffer, secondaries.size(), secondaries.data());
+	}
+
+	// the frame is declared once , the graph orders the passes , places the barriers between them and creates the transient
+	// render targets , so it is built before the pipelines rendering into those targets .
+	void BuildRenderGraph()
+	{
+		render_graph_ = new VulkanRenderGraph(device_, frames_in_flight_);
+		VulkanRenderGraph & graph = *render_graph_;
+		const VkPipelineStageFlags fragmentStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		const VkPipelineStageFlags computeStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		const VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		const VkImageLayout shaderRead = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		// the swap chain image is handed over by the acquire semaphore every frame .
+		VulkanRenderGraph::Resource color = graph.ImportResource("swap chain color", true);
+		VulkanRenderGraph::Resource sceneDepth = graph.ImportResource("scene depth");
+		VulkanRenderGraph::Resource tileLights = graph.ImportResource("tile light visible");
+		VulkanRenderGraph::Resource shadowMap = graph.ImportImage("shadow map", shadowDepthPipeline->GetShadowMapImage()->image_, depthAspect, SHADOW_CASCADE_COUNT);
+		VulkanRenderGraph::Resource hiZ = hiZBuildPipeline != NULL ?
+			graph.ImportImage("hi-z pyramid", hiZBuildPipeline->GetPyramidImage()->image_, VK_IMAGE_ASPECT_COLOR_BIT, 1, hiZBuildPipeline->GetLevelCount()) :
+			graph.ImportResource("hi-z pyramid");
+
+		// the pre depth is dead once the lights are culled , it shares memory with the gbuffer .
+		const VkImageUsageFlags colorUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		const VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		VulkanRenderGraph::Resource preDepth = graph_images_.preDepth = graph.CreateImage("pre depth",
+			{ VK_FORMAT_D32_SFLOAT_S8_UINT , depthUsage , render_width_ , render_height_ , VK_IMAGE_ASPECT_DEPTH_BIT , 1 , true });
+		VulkanRenderGraph::Resource gbufferDepth = graph_images_.gbufferDepth = graph.CreateImage("gbuffer depth",
+			{ VK_FORMAT_D32_SFLOAT_S8_UINT , depthUsage , render_width_ , render_height_ , VK_IMAGE_ASPECT_DEPTH_BIT , 1 , true });
+		VulkanRenderGraph::Resource gbufferImages[] = {
+			graph_images_.gbufferAlbedo = graph.CreateImage("gbuffer albedo", { VK_FORMAT_R8G8B8A8_UNORM , colorUsage , render_width_ , render_height_ , VK_IMAGE_ASPECT_COLOR_BIT , 1 , true }),
+			graph_images_.gbufferPosition = graph.CreateImage("gbuffer position", { VK_FORMAT_R32G32B32A32_SFLOAT , colorUsage , render_width_ , render_height_ , VK_IMAGE_ASPECT_COLOR_BIT , 1 , true }),
+			graph_images_.gbufferNormal = graph.CreateImage("gbuffer normal", { VK_FORMAT_R32G32B32A32_SFLOAT , colorUsage , render_width_ , render_height_ , VK_IMAGE_ASPECT_COLOR_BIT , 1 , true }),
+			graph_images_.gbufferPBR = graph.CreateImage("gbuffer pbr", { VK_FORMAT_R8G8B8A8_UNORM , colorUsage , render_width_ , render_height_ , VK_IMAGE_ASPECT_COLOR_BIT , 1 , true })
+		};
+
+		// the skybox stays the first pass , the first submit of the frame waits for the swap chain image .
+		graph_passes_.skybox = graph.AddPass("skybox", [this](VkCommandBuffer cmd) { RecordSkyboxPass(cmd); });
+		graph.Write(graph_passes_.skybox, color, RenderGraphAccess::ColorAttachment());
+
+		// the draw commands of the passes drawing indirectly are built on the gpu , the forward plus light and gbuffer
+		// draws are written by these passes or by the occlusion cull passes below .
+		VulkanRenderGraph::Resource preDepthDraws = graph.ImportResource("pre depth draws");
+		VulkanRenderGraph::Resource shadowDraws = graph.ImportResource("shadow draws");
+		VulkanRenderGraph::Resource forwardPlusLightDraws = graph.ImportResource("forward plus light draws");
+		VulkanRenderGraph::Resource gbufferDraws = graph.ImportResource("gbuffer draws");
+		graph_passes_.buildPreDepthDraws = graph.AddPass("build pre depth draws", [this](VkCommandBuffer cmd) { RecordBuildDrawsPass(cmd, indirect_draws_.preDepth); });
+		graph.Write(graph_passes_.buildPreDepthDraws, preDepthDraws, RenderGraphAccess::ClearStorageWrite(computeStage));
+		graph_passes_.buildShadowDraws = graph.AddPass("build shadow draws", [this](VkCommandBuffer cmd) { RecordBuildDrawsPass(cmd, indirect_draws_.shadowDepth); });
+		graph.Write(graph_passes_.buildShadowDraws, shadowDraws, RenderGraphAccess::ClearStorageWrite(computeStage));
+		graph_passes_.buildForwardPlusDraws = graph.AddPass("build forward plus draws", [this](VkCommandBuffer cmd) { RecordBuildDrawsPass(cmd, indirect_draws_.forwardPlusLight); });
+		graph.Write(graph_passes_.buildForwardPlusDraws, forwardPlusLightDraws, RenderGraphAccess::ClearStorageWrite(computeStage));
+		graph_passes_.buildGBufferDraws = graph.AddPass("build gbuffer draws", [this](VkCommandBuffer cmd) { RecordBuildDrawsPass(cmd, indirect_draws_.gbuffer); });
+		graph.Write(graph_passes_.buildGBufferDraws, gbufferDraws, RenderGraphAccess::ClearStorageWrite(computeStage));
+
+		// forward plus , the lights are culled on the async compute queue while the shadow cascades are drawn .
+		graph_passes_.preDepth = graph.AddPass("pre depth", [this](VkCommandBuffer cmd) { RecordPreDepthPass(cmd); });
+		graph.Read(graph_passes_.preDepth, preDepthDraws, RenderGraphAccess::IndirectCommandRead());
+		graph.Write(graph_passes_.preDepth, preDepth, RenderGraphAccess::DepthAttachment(shaderRead));
+
+		// occlusion culling , the pyramid is built on the graphics queue before the light cull takes the pre depth to
+		// the compute queue , then the draws of the forward plus light and gbuffer passes are tested against it .
+		graph_passes_.hiZBuild = graph.AddPass("hi-z build", [this](VkCommandBuffer cmd) { hiZBuildPipeline->SetupCommandBuffer(cmd); });
+		graph.Read(graph_passes_.hiZBuild, preDepth, RenderGraphAccess::Sampled(computeStage));
+		graph.Write(graph_passes_.hiZBuild, hiZ, RenderGraphAccess::StorageImageWrite(computeStage));
+		graph_passes_.cullForwardPlusDraws = graph.AddPass("cull forward plus draws", [this](VkCommandBuffer cmd) { RecordOcclusionCullPass(cmd, indirect_draws_.forwardPlusLight); });
+		graph.Read(graph_passes_.cullForwardPlusDraws, hiZ, RenderGraphAccess::StorageImageRead(computeStage));
+		graph.Write(graph_passes_.cullForwardPlusDraws, forwardPlusLightDraws, RenderGraphAccess::ClearStorageWrite(computeStage));
+		graph_passes_.cullGBufferDraws = graph.AddPass("cull gbuffer draws", [this](VkCommandBuffer cmd) { RecordOcclusionCullPass(cmd, indirect_draws_.gbuffer); });
+		graph.Read(graph_passes_.cullGBufferDraws, hiZ, RenderGraphAccess::StorageImageRead(computeStage));
+		graph.Write(graph_passes_.cullGBufferDraws, gbufferDraws, RenderGraphAccess::ClearStorageWrite(computeStage));
+
+		graph_passes_.forwardPlusLightCull = graph.AddPass("light cull", [this](VkCommandBuffer cmd) { RecordLightCullPass(cmd, preDepthPipeline->GetDepthImage()); },
+			RENDER_GRAPH_QUEUE_COMPUTE);
+		graph.Read(graph_passes_.forwardPlusLightCull, preDepth, RenderGraphAccess::Sampled(computeStage));
+		graph.Write(graph_passes_.forwardPlusLightCull, tileLights, RenderGraphAccess::StorageWrite(computeStage));
+
+		graph_passes_.shadowDepth = graph.AddPass("shadow depth", [this](VkCommandBuffer cmd) { RecordShadowDepthPass(cmd); });
+		graph.Read(graph_passes_.shadowDepth, shadowDraws, RenderGraphAccess::IndirectCommandRead());
+		graph.Write(graph_passes_.shadowDepth, shadowMap, RenderGraphAccess::DepthAttachment(shaderRead));
+
+		graph_passes_.forwardPlusLight = graph.AddPass("forward plus light", [this](VkCommandBuffer cmd) { RecordForwardPlusLightPass(cmd); });
+		graph.Read(graph_passes_.forwardPlusLight, tileLights, RenderGraphAccess::StorageRead(fragmentStage));
+		graph.Read(graph_passes_.forwardPlusLight, forwardPlusLightDraws, RenderGraphAccess::IndirectCommandRead());
+		graph.Write(graph_passes_.forwardPlusLight, color, RenderGraphAccess::ColorAttachment());
+		graph.Write(graph_passes_.forwardPlusLight, sceneDepth, RenderGraphAccess::DepthAttachment());
+
+		// forward pbr
+		graph_passes_.pbrLight = graph.AddPass("forward pbr", [this](VkCommandBuffer cmd) { RecordPBRLightPass(cmd); });
+		graph.Read(graph_passes_.pbrLight, shadowMap, RenderGraphAccess::Sampled(fragmentStage));
+		graph.Write(graph_passes_.pbrLight, color, RenderGraphAccess::ColorAttachment());
+		graph.Write(graph_passes_.pbrLight, sceneDepth, RenderGraphAccess::DepthAttachment());
+
+		// tbdr
+		graph_passes_.gbuffer = graph.AddPass("gbuffer", [this](VkCommandBuffer cmd) { RecordGBufferPass(cmd); });
+		graph.Read(graph_passes_.gbuffer, gbufferDraws, RenderGraphAccess::IndirectCommandRead());
+		for (auto image : gbufferImages) graph.Write(graph_passes_.gbuffer, image, RenderGraphAccess::ColorAttachment(shaderRead));
+		graph.Write(graph_passes_.gbuffer, gbufferDepth, RenderGraphAccess::DepthAttachment(shaderRead));
+
+		graph_passes_.tbdrLightCull = graph.AddPass("tbdr light cull", [this](VkCommandBuffer cmd) { RecordLightCullPass(cmd, gbufferPipeline->GetDepthImage()); },
+			RENDER_GRAPH_QUEUE_COMPUTE);
+		graph.Read(graph_passes_.tbdrLightCull, gbufferDepth, RenderGraphAccess::Sampled(computeStage));
+		graph.Write(graph_passes_.tbdrLightCull, tileLights, RenderGraphAccess::StorageWrite(computeStage));
+
+		graph_passes_.tbdrLight = graph.AddPass("tbdr light", [this](VkCommandBuffer cmd) { RecordTBDRLightPass(cmd); });
+		for (auto image : gbufferImages) graph.Read(graph_passes_.tbdrLight, image, RenderGraphAccess::Sampled(fragmentStage));
+		graph.Read(graph_passes_.tbdrLight, tileLights, RenderGraphAccess::StorageRead(fragmentStage));
+		graph.Write(graph_passes_.tbdrLight, color, RenderGraphAccess::ColorAttachment());
+		graph.Write(graph_passes_.tbdrLight, sceneDepth, RenderGraphAccess::DepthAttachment());
+
+		graph.Compile();
+	}
+
+	void RecordBuildDrawsPass(VkCommandBuffer commandBuffer, VulkanIndirectDrawList * indirectDraws)
+	{
+		buildDrawCommandsPipeline->SetDrawList(indirectDraws);
+		buildDrawCommandsPipeline->SetupCommandBuffer(commandBuffer);
+	}
+
+	void RecordPreDepthPass(VkCommandBuffer commandBuffer)
+	{
+		if (indirect_draws_.preDepth != NULL)
+		{
+			// a constant number of commands whatever the number of objects , so they are recorded inline .
+			VkViewport viewport = VulkanInitializer::InitViewport(0, 0, render_width_, render_height_, 0.0f, 1.0f);
+			VkRect2D scissor = { 0 , 0 , (uint32_t)screen_width_ , (uint32_t)screen_height_ };
+			preDepthPipeline->BeginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			preDepthPipeline->DrawIndirect(commandBuffer, indirect_draws_.preDepth, camera_->matrices.perspective * camera_->matrices.view);
+			vkCmdEndRenderPass(commandBuffer);
+			return;
 		}
+		preDepthPipeline->BeginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		ExecuteSecondaries(commandBuffer, secondary_command_buffers_[frame_index_].preDepth);
+		vkCmdEndRenderPass(commandBuffer);
+	}
 
-		vkEndCommandBuffer(lightPassCommandBuffer);
-		commandBuffer.push_back(lightPassCommandBuffer);
+	// the pre depth was drawn with the same view projection matrix .
+	void RecordOcclusionCullPass(VkCommandBuffer commandBuffer, const VulkanIndirectDrawList * drawList)
+	{
+		occlusionCullPipeline->SetDrawList(drawList);
+		occlusionCullPipeline->SetPushConstantData(camera_->matrices.perspective * camera_->matrices.view, render_width_, render_height_);
+		occlusionCullPipeline->SetupCommandBuffer(commandBuffer);
+	}
+
+	void RecordLightCullPass(VkCommandBuffer commandBuffer, VulkanImage * depthImage)
+	{
+		lightCullComputePipeline->SetDepthInput(depthImage);
+		lightCullComputePipeline->SetPushConstantData(render_width_, render_height_, camera_->getNearClip(), camera_->getFarClip(), camera_->matrices.perspective, camera_->matrices.view);
+		lightCullComputePipeline->SetupCommandBuffer(commandBuffer);
+	}
 
+	void RecordForwardPlusLightPass(VkCommandBuffer commandBuffer)
+	{
+		forwardPlusLightPipeline->SetFramebufferIndex(image_index_);
+		if (indirect_draws_.forwardPlusLight != NULL)
+		{
+			VkViewport viewport = VulkanInitializer::InitViewport(render_x_, render_y_, render_width_, render_height_, 0.0f, 1.0f);
+			VkRect2D scissor = { 0 , 0 , (uint32_t)screen_width_ , (uint32_t)screen_height_ };
+			forwardPlusLightPipeline->BeginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			forwardPlusLightPipeline->DrawIndirect(commandBuffer, indirect_draws_.forwardPlusLight, render_x_, render_y_, BindObjectMaterial);
+			vkCmdEndRenderPass(commandBuffer);
+			return;
+		}
+		forwardPlusLightPipeline->BeginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		ExecuteSecondaries(commandBuffer, secondary_command_buffers_[frame_index_].forwardPlusLight);
+		vkCmdEndRenderPass(commandBuffer);
 	}
 
-	void SetupSkyboxPass(std::vector<VkCommandBuffer> & commandBuffer, int imageIndex)
+	void RecordSkyboxPass(VkCommandBuffer commandBuffer)
 	{
-		VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(0);
-		vkBeginCommandBuffer(skyboxCommandBuffer, &commandBufferBeginInfo);
 		VkViewport viewport = VulkanInitializer::InitViewport(render_x_, render_y_, render_width_, render_height_, 0.0f, 1.0f);
 		VkRect2D scissor = { 0 , 0 , screen_width_ , screen_height_ };
-		vkCmdSetViewport(skyboxCommandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(skyboxCommandBuffer, 0, 1, &scissor);
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 		glm::mat4 mvp = camera_->matrices.perspective * camera_->matrices.viewRotation ;
 		skyboxPipeline->SetPushConstantData(mvp);
-		skyboxPipeline->SetFrameBufferIndex(imageIndex);
-		skyboxPipeline->SetupCommandBuffer(skyboxCommandBuffer, true, true);
-		vkEndCommandBuffer(skyboxCommandBuffer);
-		commandBuffer.push_back(skyboxCommandBuffer);
+		skyboxPipeline->SetFrameBufferIndex(image_index_);
+		skyboxPipeline->SetupCommandBuffer(commandBuffer, true, true);
 	}
 
-	void SetupForwardPBRLightPass(std::vector<VkCommandBuffer> & commandBuffer , int imageIndex )
+	void RecordShadowDepthPass(VkCommandBuffer commandBuffer)
 	{
-		VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(0);
-		vkBeginCommandBuffer(shadowDepthCommandBuffer, &commandBufferBeginInfo);
+		// one render pass per cascade , so each cascade is cleared once instead of once per object .
 		VkViewport viewport = VulkanInitializer::InitViewport(0, 0, 4096, 4096, 0.0f, 1.0f);
 		VkRect2D scissor = { 0 , 0 , 4096 , 4096 };
-		vkCmdSetViewport(shadowDepthCommandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(shadowDepthCommandBuffer, 0, 1, &scissor);
-
-		for (int j = 0; j < 4; j++)
+		for (uint32_t j = 0; j < SHADOW_CASCADE_COUNT; j++)
 		{
-			for (int i = 0; i < forward_pbr_light_objects_.size(); i++)
+			int scope = BeginScope(commandBuffer, cascade_scopes_[j]);
+			if (indirect_draws_.shadowDepth != NULL)
 			{
-				VulkanObject * obj = forward_pbr_light_objects_[i];
-				SetObjectMeshToPipeline(shadowDepthPipeline, obj);			
-				glm::mat4 model = obj->GetWorldMatrix();
-				shadowDepthPipeline->SetPushConstantData(model, j);
-				shadowDepthPipeline->SetupCommandBuffer(shadowDepthCommandBuffer, true, true);
+				shadowDepthPipeline->BeginRenderPass(commandBuffer, j, VK_SUBPASS_CONTENTS_INLINE);
+				vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+				vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+				shadowDepthPipeline->DrawIndirect(commandBuffer, indirect_draws_.shadowDepth, j);
 			}
+			else
+			{
+				shadowDepthPipeline->BeginRenderPass(commandBuffer, j, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+				ExecuteSecondaries(commandBuffer, secondary_command_buffers_[frame_index_].shadowDepth[j]);
+			}
+			vkCmdEndRenderPass(commandBuffer);
+			EndScope(commandBuffer, scope);
 		}
-		vkEndCommandBuffer(shadowDepthCommandBuffer);
-		commandBuffer.push_back(shadowDepthCommandBuffer);
-
-		vkBeginCommandBuffer(pbrLightCommandBuffer, &commandBufferBeginInfo);
-		viewport = VulkanInitializer::InitViewport(render_x_, render_y_, render_width_, render_height_, 0.0f, 1.0f);
-		scissor = { 0 , 0 , (uint32_t)screen_width_ , (uint32_t)screen_height_ };
-		vkCmdSetViewport(pbrLightCommandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(pbrLightCommandBuffer, 0, 1, &scissor);
-		pbrLightPipeline->SetFrameBufferIndex(imageIndex);
-		for (int i = 0; i < forward_pbr_light_objects_.size(); i++)
-		{
-			VulkanObject * obj = forward_pbr_light_objects_[i];
-			SetObjectMeshToPipeline(pbrLightPipeline, obj);
-			obj->UpdatePipeline();
-			obj->SetupCommandBuffer(pbrLightCommandBuffer);
-			glm::mat4 model = obj->GetWorldMatrix();
-			pbrLightPipeline->SetPushConstantData(model, camera_->matrices.view, camera_->matrices.perspective, camera_->position , glm::vec3(1.0f , 1.0f ,1.0f));
-			if (i == 0) pbrLightPipeline->SetupCommandBuffer(pbrLightCommandBuffer, true, forward_pbr_light_objects_.size() == 1 ? true : false);
-			else if (i == forward_plus_objects_.size() - 1) pbrLightPipeline->SetupCommandBuffer(pbrLightCommandBuffer, false, true);
-			else pbrLightPipeline->SetupCommandBuffer(pbrLightCommandBuffer, false, false);
-		}
-		vkEndCommandBuffer(pbrLightCommandBuffer);
-		commandBuffer.push_back(pbrLightCommandBuffer);
+	}
 
+	void RecordPBRLightPass(VkCommandBuffer commandBuffer)
+	{
+		pbrLightPipeline->SetFrameBufferIndex(image_index_);
+		pbrLightPipeline->BeginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		ExecuteSecondaries(commandBuffer, secondary_command_buffers_[frame_index_].pbrLight);
+		vkCmdEndRenderPass(commandBuffer);
 	}
 
-	void SetupTBDRPass(std::vector<VkCommandBuffer> & commandBuffer, int imageIndex)
+	void RecordGBufferPass(VkCommandBuffer commandBuffer)
 	{
-		// GBuffer Pass 
-		VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializer::InitCommandBufferBeginInfo(0);
-		vkBeginCommandBuffer(gbufferCommandBuffer, &commandBufferBeginInfo);
-		VkViewport viewport = VulkanInitializer::InitViewport(0, 0, render_width_, render_height_, 0.0f, 1.0f);
-		VkRect2D scissor = { 0 , 0 , screen_width_ , screen_height_ };
-		vkCmdSetViewport(gbufferCommandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(gbufferCommandBuffer, 0, 1, &scissor);
-		for (int i = 0; i < tbdr_objects_.size(); i++)
-		{
-			VulkanObject * obj = tbdr_objects_[i];
-			SetObjectMeshToPipeline(gbufferPipeline, obj);
-			obj->UpdatePipeline();
-			obj->SetupCommandBuffer(gbufferCommandBuffer);
-			glm::mat4 model = obj->GetWorldMatrix();
-			gbufferPipeline->SetPushConstantData(model ,camera_->matrices.perspective * camera_->matrices.view * model );
-
-			if (i == 0) gbufferPipeline->SetupCommandBuffer(gbufferCommandBuffer, true, tbdr_objects_.size() == 1 ? true : false);
-			else if (i == tbdr_objects_.size() - 1) gbufferPipeline->SetupCommandBuffer(gbufferCommandBuffer, false, true);
-			else gbufferPipeline->SetupCommandBuffer(gbufferCommandBuffer, false, false);
+		if (indirect_draws_.gbuffer != NULL)
+		{
+			VkViewport viewport = VulkanInitializer::InitViewport(0, 0, render_width_, render_height_, 0.0f, 1.0f);
+			VkRect2D scissor = { 0 , 0 , (uint32_t)screen_width_ , (uint32_t)screen_height_ };
+			gbufferPipeline->BeginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			gbufferPipeline->DrawIndirect(commandBuffer, indirect_draws_.gbuffer, BindObjectMaterial);
+			vkCmdEndRenderPass(commandBuffer);
+			return;
 		}
+		gbufferPipeline->BeginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		ExecuteSecondaries(commandBuffer, secondary_command_buffers_[frame_index_].gbuffer);
+		vkCmdEndRenderPass(commandBuffer);
+	}
 
-		VkImageMemoryBarrier imageBarrier = VulkanInitializer::InitImageMemoryBarrier(
-			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-			VK_ACCESS_SHADER_READ_BIT,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT, 0, 1, 0, 1,
-			gbufferPipeline->GetPredepthImage()->image_
-		);
-		vkCmdPipelineBarrier(gbufferCommandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_DEPENDENCY_BY_REGION_BIT, 0, NULL, 0, NULL, 1, &imageBarrier);
-		vkEndCommandBuffer(gbufferCommandBuffer);
-		commandBuffer.push_back(gbufferCommandBuffer);
-
-		// lightCullPass
-		lightCullComputePipeline->SetPreDepth(gbufferPipeline->GetDepthImage());
-		lightCullComputePipeline->SetPushConstantData(render_width_, render_height_, camera_->getNearClip(), camera_->getFarClip(), camera_->matrices.perspective, camera_->matrices.view);
-		commandBuffer.push_back(lightCullComputePipeline->SetupCommandBuffer());
-
-		// lightPass 
-		vkBeginCommandBuffer(tbdrlightCommandBuffer, &commandBufferBeginInfo);
-		vkCmdPipelineBarrier(tbdrlightCommandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_DEPENDENCY_BY_REGION_BIT, 0, NULL, 0, NULL, 1, &imageBarrier);
-		viewport = VulkanInitializer::InitViewport(render_x_, render_y_, render_width_, render_height_, 0.0f, 1.0f);
-		scissor = { 0 , 0 , (uint32_t)screen_width_ , (uint32_t)screen_height_ };
-		vkCmdSetViewport(tbdrlightCommandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(tbdrlightCommandBuffer, 0, 1, &scissor);
-		tbdrPipeline->SetFrameIndex(imageIndex);
+	void RecordTBDRLightPass(VkCommandBuffer commandBuffer)
+	{
+		VkViewport viewport = VulkanInitializer::InitViewport(render_x_, render_y_, render_width_, render_height_, 0.0f, 1.0f);
+		VkRect2D scissor = { 0 , 0 , (uint32_t)screen_width_ , (uint32_t)screen_height_ };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		tbdrPipeline->SetFrameIndex(image_index_);
 		tbdrPipeline->SetPushConstantData(glm::mat4(1.0f), camera_->matrices.view, camera_->matrices.perspective, camera_->position, render_x_, render_y_, render_width_ / 16, render_height_ / 16);
-		tbdrPipeline->SetupCommandBuffer(tbdrlightCommandBuffer, true , true );
-		vkEndCommandBuffer(tbdrlightCommandBuffer);
-		commandBuffer.push_back(tbdrlightCommandBuffer);
+		tbdrPipeline->SetupCommandBuffer(commandBuffer, true , true );
 	}
 
 public:
@@ -508,42 +1063,96 @@ public:
 		DistributeObjectToPipeline();
 	}
 
-	VulkanMesh* GetMesh(std::string & meshFileName , VertexLayout vertLayout, std::string & layoutName )
+	// the mesh file meshIndex of global_mesh_file_string_vec_ in the vertex layout of layoutSlot , loaded on first use .
+	VulkanMesh* GetMesh(int meshIndex , int layoutSlot )
 	{
+		VertexLayoutSlot & layout = vertex_layouts_[layoutSlot];
+		MeshHandle & handle = layout.meshes[meshIndex];
+		if (handle.IsValid())
+		{
+			return meshes_.Get(handle);
+		}
+		const std::string & meshFileName = global_mesh_file_string_vec_[meshIndex];
 		size_t position = meshFileName.find('/');
-		std::string meshName = meshFileName.substr(position + 1, meshFileName.length() - position - 1) + layoutName ;
-		auto resIter = global_mesh_.find(meshName);
-		if (resIter != global_mesh_.end())
+		std::string meshName = meshFileName.substr(position + 1, meshFileName.length() - position - 1) + layout.name ;
+		VulkanMesh * mesh = new VulkanMesh(meshFileName, layout.layout, 1.0f, layout.arena, device_, queue_ , meshName );
+		handle = meshes_.Add(mesh, meshName);
+		return mesh;
+	}
+
+	// the vertex layout is asked for once here , the draw lists only index vertex_layouts_ with the slot of the pipeline .
+	PipelineHandle RegisterPipeline(IRenderingPipeline * pipeline, const std::string & name)
+	{
+		PipelineHandle handle = pipelines_.Add(pipeline, name);
+		std::string layoutName;
+		VertexLayout layout = pipeline->GetVertexLayout(layoutName);
+		if (pipeline_layout_slots_.size() <= handle.index)
 		{
-			return (*resIter).second;
+			pipeline_layout_slots_.resize(handle.index + 1, -1);
 		}
-		return AddMesh(meshFileName, vertLayout, meshName);
+		pipeline_layout_slots_[handle.index] = GetVertexLayoutSlot(layoutName, layout);
+		return handle;
 	}
 
-	VulkanMesh* AddMesh(std::string & meshFileName , VertexLayout vertLayout, std::string & name  )
+	int GetPipelineLayoutSlot(PipelineHandle pipeline) const
 	{
-		VulkanMesh * mesh = new VulkanMesh(meshFileName, vertLayout, 1.0f, device_, queue_ , name );
-		global_mesh_.insert( std::pair<std::string , VulkanMesh*>(name, mesh));
-		return mesh;
+		pipelines_.Get(pipeline);
+		return pipeline_layout_slots_[pipeline.index];
+	}
+
+	// every mesh of a vertex layout lives in the arena created with the slot or in one it chained when full .
+	int GetVertexLayoutSlot(const std::string & layoutName, VertexLayout & vertLayout)
+	{
+		for (size_t i = 0; i < vertex_layouts_.size(); i++)
+		{
+			if (vertex_layouts_[i].name == layoutName) return (int)i;
+		}
+		VertexLayoutSlot slot = { layoutName , vertLayout , NULL };
+		slot.arena = new VulkanGeometryArena(device_, vertLayout.stride(), GEOMETRY_ARENA_VERTEX_COUNT, GEOMETRY_ARENA_INDEX_COUNT);
+		slot.meshes.resize(global_mesh_file_string_vec_.size());
+		vertex_layouts_.push_back(slot);
+		return (int)vertex_layouts_.size() - 1;
 	}
 
-	void SetObjectMeshToPipeline(IRenderingPipeline * pipeline , VulkanObject * obj  )
+	VulkanMesh * GetObjectMesh(int layoutSlot, VulkanObject * obj)
 	{
-		VulkanMesh * staticMesh; 
+		VulkanMesh * staticMesh;
 		if (obj->GetStaticMesh(staticMesh))
 		{
-			pipeline->SetMesh(staticMesh);
-			return;
+			return staticMesh;
 		}
-		std::string layoutName;
-		VertexLayout layout = pipeline->GetVertexLayout(layoutName);
 		int meshInd = obj->GetMeshIndex();
-		if (meshInd == -1) return;
-		pipeline->SetMesh(GetMesh(global_mesh_file_string_vec_[meshInd], layout, layoutName));
+		if (meshInd == -1) return NULL;
+		return GetMesh(meshInd, layoutSlot);
+	}
+
+	// the textures of every drawn material are marked before the passes are recorded , evicted ones are loaded
+	// again and the materials sampling them rewrite their descriptor sets , which changes the pass keys .
+	void UpdateTextureResidency()
+	{
+		CPU_TRACE_SCOPE("UpdateTextureResidency");
+		texture_residency_->BeginFrame();
+		MarkObjectTextures(forward_plus_objects_);
+		MarkObjectTextures(forward_pbr_light_objects_);
+		MarkObjectTextures(tbdr_objects_);
+		texture_residency_->EvictOverBudget();
+	}
+
+	void MarkObjectTextures(const std::vector<VulkanObject*> & objects)
+	{
+		Texture * textures[MATERIAL_MAX_TEXTURES];
+		for (auto obj : objects)
+		{
+			IMaterial * material = obj->GetMaterial();
+			int count = material->GetTextures(textures);
+			for (int i = 0; i < count; i++) texture_residency_->MarkUsed(textures[i]);
+			material->UpdateTextureResidency();
+		}
 	}
 
 	void DistributeObjectToPipeline()
 	{
+		CPU_TRACE_SCOPE("DistributeObjectToPipeline");
 		forward_plus_objects_.clear();
 		forward_pbr_light_objects_.clear();
 		tbdr_objects_.clear();
@@ -562,7 +1171,7 @@ public:
 				forward_plus_objects_.push_back(obj);
 				if (obj->GetPrevPipelineType() != PIPELINE_FORWARD_PLUS)
 				{
-					IMaterial * newMaterial = new ForwardLightPassMaterial(dynamic_cast<Texture2D*>((*texture_.find("dummy")).second), dynamic_cast<Texture2D*>((*texture_.find("dummy")).second), forwardPlusLightPipeline , device_);
+					IMaterial * newMaterial = new ForwardLightPassMaterial(default_textures_.dummy, default_textures_.dummy, forwardPlusLightPipeline , device_);
 					obj->ResetMaterial(newMaterial, PIPELINE_FORWARD_PLUS);
 				}
 			}
@@ -571,18 +1180,19 @@ public:
 				tbdr_objects_.push_back(obj);
 				if (obj->GetPrevPipelineType() != PIPELINE_TBDR)
 				{
-					Texture2D* dummyTexture = dynamic_cast<Texture2D*>((*texture_.find("dummy")).second);
+					Texture2D* dummyTexture = default_textures_.dummy;
 					IMaterial * tbdrMaterial = new TBDRMaterial(dummyTexture, dummyTexture, dummyTexture, dummyTexture, dummyTexture, device_ , gbufferPipeline);
+					obj->ResetMaterial(tbdrMaterial, PIPELINE_TBDR);
 				}
 			}
 
 			if (obj->GetPipelineType() == PIPELINE_FORWARD_PBR)
 			{
 				forward_pbr_light_objects_.push_back(obj);
-				Texture2D* dummyTex = dynamic_cast<Texture2D*>((*texture_.find("dummy")).second);
-				Texture2D* lutTex = dynamic_cast<Texture2D*>((*texture_.find("LUT")).second);
 				if (obj->GetPrevPipelineType() != PIPELINE_FORWARD_PBR)
 				{
+					Texture2D* dummyTex = default_textures_.dummy;
+					Texture2D* lutTex = default_textures_.lut;
 					IMaterial * newMaterial = new PbrLightPassMaterial(
 						dummyTex,
 						dummyTex,
@@ -593,7 +1203,7 @@ public:
 						lutTex,
 						prefilterEnvirPipeline->GetPrefilterEnvirMapImage(),
 						device_,
-						pbrLightPipeline , texture_);
+						pbrLightPipeline , textures_);
 					obj->ResetMaterial(newMaterial, PIPELINE_FORWARD_PBR);
 				}
 			}
@@ -601,23 +1211,97 @@ public:
 	}
 
 private:
+	// the sponza scene is parsed and uploaded on a loader thread through the transfer queue , the frames keep
+	// rendering the rest of the scene until its uploads are handed over to the graphics queue .
+	void StartSceneStreaming(PipelineType pipelineType)
+	{
+		stream_pipeline_type_ = pipelineType;
+		// the obj vertex matches the layout of the forward plus light pass .
+		VulkanGeometryArena * arena = vertex_layouts_[GetPipelineLayoutSlot(pipeline_handles_.forwardPlusLight)].arena;
+		stream_thread_ = std::thread([this, arena]()
+		{
+			VulkanCpuTracer::Get().SetThreadName("scene loader");
+			device_->BindThreadUploadManager(stream_upload_manager_);
+			std::string file = "sponza.obj";
+			std::string folder = GetAssetPath() + "models/sponza_full/";
+			sceneObjects = new VulkanSceneObjectsGroup(file, folder, arena, device_, queue_);
+			stream_ticket_ = stream_upload_manager_->Flush();
+			stream_loaded_ = true;
+		});
+	}
+
+	// materials allocate descriptor sets , the objects are built on the main thread once the uploads completed .
+	void UpdateSceneStreaming()
+	{
+		if (!stream_thread_.joinable() || !stream_loaded_) return;
+		if (!stream_upload_manager_->IsComplete(stream_ticket_)) return;
+		stream_thread_.join();
+		for (auto texture : sceneObjects->GetTextures()) texture_residency_->Register(texture);
+
+		std::vector<VulkanObject*> objs = sceneObjects->GetObjectsVecFromMaterial(forwardPlusLightPipeline, default_textures_.dummy, device_);
+		for (auto obj : objs)
+		{
+			obj->SetPipelineType(stream_pipeline_type_);
+			glm::vec3 scaleV(0.01f, 0.01f, 0.01f);
+			obj->SetScale(scaleV);
+			objects_.push_back(obj);
+		}
+	}
+
 	void SubmitPrecomputeCommand(VkCommandBuffer commandBuffer )
 	{
 		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffer;
-		vkQueueSubmit(queue_, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(queue_);
+		device_->GetUploadManager()->Flush();
+		device_->QueueSubmit(queue_, 1, &submitInfo, VK_NULL_HANDLE);
+		device_->QueueWaitIdle(queue_);
 	}
 
 private:
 	VulkanCamera * camera_;
 	std::vector<VulkanObject*> objects_;
-	std::unordered_map<std::string , VulkanMesh*> global_mesh_;
 	std::vector<std::string> global_mesh_file_string_vec_;
-	std::unordered_map<std::string, Texture*> texture_;
+
+	// names are resolved while loading , the frame path only holds handles and slots .
+	VulkanResourcePool<Texture> textures_;
+	VulkanResourcePool<VulkanMesh> meshes_;
+	VulkanResourcePool<IRenderingPipeline> pipelines_;
+	struct VertexLayoutSlot
+	{
+		std::string name;
+		VertexLayout layout;
+		VulkanGeometryArena * arena;
+		// indexed like global_mesh_file_string_vec_ , invalid until the mesh is used with the layout .
+		std::vector<MeshHandle> meshes;
+	};
+	std::vector<VertexLayoutSlot> vertex_layouts_;
+	std::vector<int> pipeline_layout_slots_;
+	struct
+	{
+		PipelineHandle skybox;
+		PipelineHandle preDepth;
+		PipelineHandle forwardPlusLight;
+		PipelineHandle shadowDepth;
+		PipelineHandle pbrLight;
+		PipelineHandle gbuffer;
+	} pipeline_handles_;
+	struct
+	{
+		Texture2D * dummy;
+		Texture2D * lut;
+		TextureCube * skyBox;
+	} default_textures_;
 	VulkanSceneObjectsGroup * sceneObjects;
+	VulkanTextureResidency * texture_residency_ = NULL;
+
+	// background loading .
+	VulkanUploadManager * stream_upload_manager_;
+	std::thread stream_thread_;
+	std::atomic<bool> stream_loaded_{ false };
+	UploadTicket stream_ticket_ = 0;
+	PipelineType stream_pipeline_type_;
 
 private:
 	VulkanDevice * device_;
@@ -630,12 +1314,13 @@ private:
 	PreDepthRenderingPipeline * preDepthPipeline;
 	CullLightComputePipeline * lightCullComputePipeline;
 	ForwardPlusLightPassPipeline* forwardPlusLightPipeline;
-	std::vector<VkCommandBuffer> forwardPlusNewCommandBufferVec;
+
+	// per frame uniform data of all pipelines .
+	VulkanUniformRing * uniform_ring_;
 
 private:
 	//SkyBox Pipeline 
 	SkyBoxPipeline * skyboxPipeline;
-	VkCommandBuffer skyboxCommandBuffer;
 
 	//Irradiance map Pipeline 
 	IrradianceMapPipeline * irradianceMapPipeline;
@@ -649,16 +1334,59 @@ private:
 	std::vector<VulkanObject*> forward_pbr_light_objects_;
 	PBRLightPipeline *pbrLightPipeline;
 	ShadowDepthPipeline *shadowDepthPipeline;
-	VkCommandBuffer shadowDepthCommandBuffer;
-	VkCommandBuffer pbrLightCommandBuffer;
 
 	//TBDR Pipeline
 	std::vector<VulkanObject*> tbdr_objects_;
 	std::vector<VulkanObject*> tbdr_transparent_objects_;
 	GBufferPipeline *gbufferPipeline;
 	TBDRLightPipeline * tbdrPipeline;
-	VkCommandBuffer gbufferCommandBuffer;
-	VkCommandBuffer tbdrlightCommandBuffer;
+
+	// indirect passes , NULL when the pass records a draw per object .
+	BuildDrawCommandsPipeline * buildDrawCommandsPipeline = NULL;
+	struct
+	{
+		VulkanIndirectDrawList * preDepth = NULL;
+		VulkanIndirectDrawList * shadowDepth = NULL;
+		VulkanIndirectDrawList * forwardPlusLight = NULL;
+		VulkanIndirectDrawList * gbuffer = NULL;
+	} indirect_draws_;
+
+	// occlusion culling against the hi-z pyramid of the pre depth , NULL without the spir-v or the indirect draws .
+	HiZBuildPipeline * hiZBuildPipeline = NULL;
+	OcclusionCullPipeline * occlusionCullPipeline = NULL;
+	// the occluders drawn into the pre depth .
+	std::vector<VulkanObject*> pre_depth_objects_;
+
+	// frame passes .
+	VulkanRenderGraph * render_graph_;
+	struct
+	{
+		VulkanRenderGraph::Pass skybox;
+		VulkanRenderGraph::Pass buildPreDepthDraws;
+		VulkanRenderGraph::Pass buildShadowDraws;
+		VulkanRenderGraph::Pass buildForwardPlusDraws;
+		VulkanRenderGraph::Pass buildGBufferDraws;
+		VulkanRenderGraph::Pass preDepth;
+		VulkanRenderGraph::Pass hiZBuild;
+		VulkanRenderGraph::Pass cullForwardPlusDraws;
+		VulkanRenderGraph::Pass cullGBufferDraws;
+		VulkanRenderGraph::Pass forwardPlusLightCull;
+		VulkanRenderGraph::Pass forwardPlusLight;
+		VulkanRenderGraph::Pass shadowDepth;
+		VulkanRenderGraph::Pass pbrLight;
+		VulkanRenderGraph::Pass gbuffer;
+		VulkanRenderGraph::Pass tbdrLightCull;
+		VulkanRenderGraph::Pass tbdrLight;
+	} graph_passes_;
+	struct
+	{
+		VulkanRenderGraph::Resource preDepth;
+		VulkanRenderGraph::Resource gbufferAlbedo;
+		VulkanRenderGraph::Resource gbufferPosition;
+		VulkanRenderGraph::Resource gbufferNormal;
+		VulkanRenderGraph::Resource gbufferPBR;
+		VulkanRenderGraph::Resource gbufferDepth;
+	} graph_images_;
 private:
 	int render_width_;
 	int render_height_;
@@ -669,6 +1397,44 @@ private:
 
 	VkImageView depth_stencil_image_ ;
 
+private:
+	// multithreaded recording .
+	VulkanThreadPool * thread_pool_;
+	VulkanGpuProfiler * gpu_profiler_ = NULL;
+	int cascade_scopes_[SHADOW_CASCADE_COUNT] = {};
+	struct
+	{
+		std::vector<DrawItem> preDepth;
+		std::vector<DrawItem> forwardPlusLight;
+		std::vector<DrawItem> shadowDepth;
+		std::vector<DrawItem> shadowCascades[SHADOW_CASCADE_COUNT];
+		std::vector<DrawItem> pbrLight;
+		std::vector<DrawItem> gbuffer;
+	} draw_lists_;
+	struct SecondaryCommandBuffers
+	{
+		std::vector<VkCommandBuffer> preDepth;
+		std::vector<VkCommandBuffer> forwardPlusLight;
+		std::vector<VkCommandBuffer> shadowDepth[SHADOW_CASCADE_COUNT];
+		std::vector<VkCommandBuffer> pbrLight;
+		std::vector<VkCommandBuffer> gbuffer;
+	};
+	std::vector<SecondaryCommandBuffers> secondary_command_buffers_;
+
+	// record-once caching , the key a pass was last recorded with for every frame slot .
+	size_t pass_keys_[MAX_FRAMES_IN_FLIGHT][RECORD_PASS_COUNT];
+	bool pass_recorded_[MAX_FRAMES_IN_FLIGHT][RECORD_PASS_COUNT] = {};
+
+	// frustum culling of the draw lists , the bounds and indices keep their storage between frames .
+	VulkanFrustum camera_frustum_;
+	VulkanCullBounds cull_bounds_;
+	std::vector<uint32_t> cull_visible_;
+
+	// pass command buffers are duplicated per frame in flight and indexed by frame_index_ .
+	int frames_in_flight_;
+	int frame_index_ = 0;
+	int image_index_ = 0;
+
 	friend class VulkanBase;
 };
 
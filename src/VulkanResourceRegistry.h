@@ -0,0 +1,150 @@
+#ifndef _VULKAN_RESOURCE_REGISTRY_H_
+#define _VULKAN_RESOURCE_REGISTRY_H_
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+class Texture;
+class VulkanMesh;
+class IRenderingPipeline;
+
+// a slot of a pool and the generation the slot had when the handle was made , the type keeps handles of
+// different pools apart . a removed resource bumps the generation , so old handles are detected instead of
+// silently naming whatever reuses the slot .
+template <class T>
+struct ResourceHandle
+{
+	static const uint32_t INVALID_INDEX = 0xffffffff;
+	uint32_t index = INVALID_INDEX;
+	uint32_t generation = 0;
+
+	bool IsValid() const { return index != INVALID_INDEX; }
+	bool operator==(const ResourceHandle & other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const ResourceHandle & other) const { return !(*this == other); }
+};
+
+typedef ResourceHandle<Texture> TextureHandle;
+typedef ResourceHandle<VulkanMesh> MeshHandle;
+typedef ResourceHandle<IRenderingPipeline> PipelineHandle;
+
+// Dense array of resources addressed by ResourceHandle . Names are only resolved with Find or Resolve while
+// loading , the frame path keeps the handles and Get is an index and a generation compare .
+// The pool does not own the resources , whoever adds a resource deletes it after removing it .
+// Not thread safe , resources are added and removed on the main thread .
+template <class T>
+class VulkanResourcePool
+{
+	struct Slot
+	{
+		T * resource;
+		uint32_t generation;
+		std::string name;
+	};
+
+public:
+	typedef ResourceHandle<T> Handle;
+
+	// an empty name keeps the resource out of the name lookup .
+	Handle Add(T * resource, const std::string & name)
+	{
+		if (name.size() != 0 && names_.count(name) != 0)
+		{
+			throw " resource name is already registered . ";
+		}
+		Handle handle;
+		if (free_slots_.size() != 0)
+		{
+			handle.index = free_slots_.back();
+			free_slots_.pop_back();
+		}
+		else
+		{
+			handle.index = (uint32_t)slots_.size();
+			slots_.push_back({ NULL , 0 , "" });
+		}
+		Slot & slot = slots_[handle.index];
+		slot.resource = resource;
+		slot.name = name;
+		handle.generation = slot.generation;
+		if (name.size() != 0) names_[name] = handle.index;
+		return handle;
+	}
+
+	// returns the resource so the caller can delete it , every handle to it is stale from now on .
+	T * Remove(Handle handle)
+	{
+		T * resource = Get(handle);
+		Slot & slot = slots_[handle.index];
+		if (slot.name.size() != 0) names_.erase(slot.name);
+		slot.resource = NULL;
+		slot.name.clear();
+		slot.generation++;
+		free_slots_.push_back(handle.index);
+		return resource;
+	}
+
+	bool IsAlive(Handle handle) const
+	{
+		return handle.index < slots_.size() && slots_[handle.index].generation == handle.generation && slots_[handle.index].resource != NULL;
+	}
+
+	T * Get(Handle handle) const
+	{
+		if (!IsAlive(handle))
+		{
+			throw " stale resource handle . ";
+		}
+		return slots_[handle.index].resource;
+	}
+
+	// NULL for invalid and stale handles .
+	T * TryGet(Handle handle) const
+	{
+		return IsAlive(handle) ? slots_[handle.index].resource : NULL;
+	}
+
+	// load time only , returns an invalid handle for unknown names .
+	Handle Find(const std::string & name) const
+	{
+		Handle handle;
+		auto resIter = names_.find(name);
+		if (resIter == names_.end()) return handle;
+		handle.index = resIter->second;
+		handle.generation = slots_[handle.index].generation;
+		return handle;
+	}
+
+	Handle Resolve(const std::string & name) const
+	{
+		Handle handle = Find(name);
+		if (!handle.IsValid())
+		{
+			throw " unknown resource name . ";
+		}
+		return handle;
+	}
+
+	const std::string & GetName(Handle handle) const
+	{
+		Get(handle);
+		return slots_[handle.index].name;
+	}
+
+	template <class Func>
+	void ForEach(Func func) const
+	{
+		for (const Slot & slot : slots_)
+		{
+			if (slot.resource != NULL) func(slot.resource);
+		}
+	}
+
+private:
+	std::vector<Slot> slots_;
+	std::vector<uint32_t> free_slots_;
+	std::unordered_map<std::string, uint32_t> names_;
+};
+
+#endif
@@ -3,8 +3,10 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#if defined(_WIN32)
 #include <Windows.h>
 #include <vulkan/vulkan_win32.h>
+#endif
 
 #define GET_INSTANCE_PROC_ADDR(inst, entrypoint)                        \
 {                                                                       \
@@ -25,10 +27,85 @@
 	}                                                                   \
 }
 
+// The ring of images a frame is rendered into .
+// Pipelines only build framebuffers from the image views , acquiring and presenting is left to the backend .
 class VulkanSwapChain
 {
 public:
-	VulkanSwapChain(VkInstance instance,
+	virtual ~VulkanSwapChain()
+	{
+	}
+
+	virtual VkResult acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t *imageIndex) = 0;
+	virtual VkResult queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore = VK_NULL_HANDLE) = 0;
+	virtual void cleanup() = 0;
+
+	// the layout the last pass of a frame has to leave the image in .
+	virtual VkImageLayout GetPresentLayout() const
+	{
+		return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	}
+
+public:
+	uint32_t GetImageCount() const
+	{
+		return image_count_;
+	}
+	VkFormat GetColorFormat() const
+	{
+		return color_format_;
+	}
+	VkImageView GetImageView(int index) const
+	{
+		return image_views_[index];
+	}
+	VkImage GetImage(int index) const
+	{
+		return images_[index];
+	}
+
+protected:
+	void CreateImageViews()
+	{
+		image_views_.resize(image_count_);
+		for (uint32_t i = 0; i < image_count_; i++)
+		{
+			VkImageViewCreateInfo colorAttachmentView = {};
+			colorAttachmentView.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			colorAttachmentView.pNext = NULL;
+			colorAttachmentView.format = color_format_;
+			colorAttachmentView.components = {
+				VK_COMPONENT_SWIZZLE_R,
+				VK_COMPONENT_SWIZZLE_G,
+				VK_COMPONENT_SWIZZLE_B,
+				VK_COMPONENT_SWIZZLE_A
+			};
+			colorAttachmentView.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			colorAttachmentView.subresourceRange.baseMipLevel = 0;
+			colorAttachmentView.subresourceRange.levelCount = 1;
+			colorAttachmentView.subresourceRange.baseArrayLayer = 0;
+			colorAttachmentView.subresourceRange.layerCount = 1;
+			colorAttachmentView.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			colorAttachmentView.flags = 0;
+			colorAttachmentView.image = images_[i];
+
+			vkCreateImageView(logical_device_, &colorAttachmentView, nullptr, &image_views_[i]);
+		}
+	}
+
+protected:
+	VkDevice logical_device_;
+	std::vector<VkImage> images_;
+	std::vector<VkImageView> image_views_;
+	VkFormat color_format_;
+	uint32_t image_count_ = 0;
+};
+
+#if defined(_WIN32)
+class VulkanSurfaceSwapChain : public VulkanSwapChain
+{
+public:
+	VulkanSurfaceSwapChain(VkInstance instance,
 		VkPhysicalDevice physical_device,
 		VkDevice device,
 		HINSTANCE platform_handle,
@@ -53,20 +130,13 @@ public:
 		CreateSwapChain(width, height);
 	}
 
-	~VulkanSwapChain();
-
 private:
 	VkInstance instance_;
-	VkDevice logical_device_;
 	VkPhysicalDevice physical_device_;
 	VkSurfaceKHR surface_;
 
-	std::vector<VkImage> images_;
-	std::vector<VkImageView> image_views_;
-	VkFormat color_format_;
 	VkColorSpaceKHR color_space_;
 	VkSwapchainKHR swap_chain_;
-	uint32_t image_count_;
 
 	// Function pointers
 	PFN_vkGetPhysicalDeviceSurfaceSupportKHR fpGetPhysicalDeviceSurfaceSupportKHR;
@@ -248,41 +318,17 @@ public:
 		fpGetSwapchainImagesKHR(logical_device_, swap_chain_, &image_count_, NULL);
 		images_.resize(image_count_);
 		fpGetSwapchainImagesKHR(logical_device_, swap_chain_, &image_count_, images_.data());
-		image_views_.resize(image_count_);
-
-		for (uint32_t i = 0; i < image_count_; i++)
-		{
-			VkImageViewCreateInfo colorAttachmentView = {};
-			colorAttachmentView.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-			colorAttachmentView.pNext = NULL;
-			colorAttachmentView.format = color_format_;
-			colorAttachmentView.components = {
-				VK_COMPONENT_SWIZZLE_R,
-				VK_COMPONENT_SWIZZLE_G,
-				VK_COMPONENT_SWIZZLE_B,
-				VK_COMPONENT_SWIZZLE_A
-			};
-			colorAttachmentView.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			colorAttachmentView.subresourceRange.baseMipLevel = 0;
-			colorAttachmentView.subresourceRange.levelCount = 1;
-			colorAttachmentView.subresourceRange.baseArrayLayer = 0;
-			colorAttachmentView.subresourceRange.layerCount = 1;
-			colorAttachmentView.viewType = VK_IMAGE_VIEW_TYPE_2D;
-			colorAttachmentView.flags = 0;
-			colorAttachmentView.image = images_[i];
-
-			vkCreateImageView(logical_device_, &colorAttachmentView, nullptr, &image_views_[i]);
-		}
+		CreateImageViews();
 	}
 
-	VkResult acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t *imageIndex)
+	VkResult acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t *imageIndex) override
 	{
 		// By setting timeout to UINT64_MAX we will always wait until the next image has been acquired or an actual error is thrown
 		// With that we don't have to handle VK_NOT_READY
 		return fpAcquireNextImageKHR(logical_device_, swap_chain_, UINT64_MAX, presentCompleteSemaphore, (VkFence)nullptr, imageIndex);
 	}
 
-	VkResult queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore = VK_NULL_HANDLE)
+	VkResult queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore = VK_NULL_HANDLE) override
 	{
 		VkPresentInfoKHR presentInfo = {};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -299,7 +345,7 @@ public:
 		return fpQueuePresentKHR(queue, &presentInfo);
 	}
 
-	void cleanup()
+	void cleanup() override
 	{
 		if (swap_chain_ != VK_NULL_HANDLE)
 		{
@@ -317,20 +363,7 @@ public:
 		swap_chain_ = VK_NULL_HANDLE;
 	}
 
-public:
-	uint32_t GetImageCount() const
-	{
-		return image_count_;
-	}
-	VkFormat GetColorFormat() const
-	{
-		return color_format_;
-	}
-	VkImageView GetImageView(int index) const
-	{
-		return image_views_[index];
-	}
 };
-
+#endif
 
 #endif
\ No newline at end of file
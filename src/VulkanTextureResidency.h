@@ -0,0 +1,153 @@
+#ifndef _VULKAN_TEXTURE_RESIDENCY_H_
+#define _VULKAN_TEXTURE_RESIDENCY_H_
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include "Utility.h"
+#include "VulkanDevice.hpp"
+#include "VulkanImage.h"
+#include "VulkanDeletionQueue.h"
+
+// Keeps the registered textures under a memory budget . Every frame the scene marks the textures of the materials it
+// draws , when the resident textures exceed the budget the least recently drawn ones are evicted until they are below
+// TEXTURE_EVICTION_LOW_WATER_PERCENT of it , and only textures not drawn for TEXTURE_EVICTION_MIN_UNUSED_FRAMES frames
+// are evicted , so a texture leaving the view for a moment is not evicted and reloaded over and over .
+// An evicted texture gives its image back through the deletion queue and samples the fallback texture . When it is drawn
+// again its reload is queued , at most TEXTURE_RELOADS_PER_FRAME are started a frame , a started reload records its
+// upload into the upload manager and keeps sampling the fallback until the ticket completed , then the materials
+// sampling it rewrite their descriptor sets .
+// Textures drawn in the current frame are never evicted , the budget is exceeded when one frame needs more .
+// Not thread safe , used by the frame loop .
+class VulkanTextureResidency
+{
+public:
+	VulkanTextureResidency(VulkanDevice * device, Texture * fallback, VkDeviceSize budget) : device_(device), fallback_(fallback), budget_(budget)
+	{
+	}
+
+public:
+	// the texture has to be loaded by the calling thread or its uploads have to be complete .
+	void Register(Texture2D * texture)
+	{
+		textures_.push_back(texture);
+		if (texture->resident_) resident_size_ += texture->memory_.size;
+	}
+
+	// swaps in the reloads whose upload completed and starts the queued ones .
+	void BeginFrame()
+	{
+		frame_++;
+		for (size_t i = 0; i < loading_.size(); )
+		{
+			Texture2D * texture = loading_[i];
+			if (texture->upload_manager_->IsComplete(texture->upload_ticket_))
+			{
+				FinishReload(texture);
+				loading_[i] = loading_.back();
+				loading_.pop_back();
+			}
+			else i++;
+		}
+		uint32_t started = 0;
+		while (!reload_queue_.empty() && started < TEXTURE_RELOADS_PER_FRAME)
+		{
+			StartReload(reload_queue_.front());
+			reload_queue_.pop_front();
+			started++;
+		}
+	}
+
+	// the texture is sampled by the frame , an evicted texture is queued for a reload .
+	void MarkUsed(Texture * texture)
+	{
+		texture->last_used_frame_ = frame_;
+		if (texture->resident_ || texture->loading_) return;
+		Texture2D * texture2D = static_cast<Texture2D*>(texture);
+		if (std::find(reload_queue_.begin(), reload_queue_.end(), texture2D) == reload_queue_.end()) reload_queue_.push_back(texture2D);
+	}
+
+	// called once the frame marked its textures .
+	void EvictOverBudget()
+	{
+		if (budget_ == 0 || resident_size_ <= budget_) return;
+		candidates_.clear();
+		for (auto texture : textures_)
+		{
+			if (!texture->resident_ || texture->last_used_frame_ + TEXTURE_EVICTION_MIN_UNUSED_FRAMES > frame_) continue;
+			// the image may still be written by its upload .
+			if (texture->upload_manager_ != NULL && !texture->upload_manager_->IsComplete(texture->upload_ticket_)) continue;
+			candidates_.push_back(texture);
+		}
+		std::sort(candidates_.begin(), candidates_.end(), [](const Texture2D * a, const Texture2D * b)
+		{
+			return a->last_used_frame_ < b->last_used_frame_;
+		});
+		VkDeviceSize lowWater = budget_ / 100 * TEXTURE_EVICTION_LOW_WATER_PERCENT;
+		for (size_t i = 0; i < candidates_.size() && resident_size_ > lowWater; i++)
+		{
+			Evict(candidates_[i]);
+		}
+	}
+
+	VkDeviceSize GetResidentSize() const { return resident_size_; }
+	VkDeviceSize GetBudget() const { return budget_; }
+	uint64_t GetEvictionCount() const { return eviction_count_; }
+	uint64_t GetReloadCount() const { return reload_count_; }
+	size_t GetPendingReloadCount() const { return reload_queue_.size() + loading_.size(); }
+
+private:
+	// frames in flight may still sample the image , the deletion queue releases it once they are done .
+	void Evict(Texture2D * texture)
+	{
+		VulkanDeletionQueue * deletionQueue = device_->GetDeletionQueue();
+		deletionQueue->Destroy(texture->image_view_);
+		deletionQueue->Destroy(texture->image_);
+		deletionQueue->Free(texture->memory_);
+		resident_size_ -= texture->memory_.size;
+
+		texture->image_ = VK_NULL_HANDLE;
+		texture->memory_ = VulkanAllocation();
+		texture->image_view_ = fallback_->image_view_;
+		texture->image_layout_ = fallback_->image_layout_;
+		texture->upload_manager_ = NULL;
+		texture->resident_ = false;
+		texture->residency_version_++;
+		texture->UpdateDescriptor();
+		eviction_count_++;
+	}
+
+	// the descriptor keeps the fallback , materials rewriting their sets meanwhile do not sample the uploading image .
+	void StartReload(Texture2D * texture)
+	{
+		texture->Load();
+		texture->image_info_.imageView = fallback_->image_view_;
+		texture->image_info_.imageLayout = fallback_->image_layout_;
+		texture->loading_ = true;
+		resident_size_ += texture->memory_.size;
+	}
+
+	void FinishReload(Texture2D * texture)
+	{
+		texture->UpdateDescriptor();
+		texture->loading_ = false;
+		texture->resident_ = true;
+		texture->residency_version_++;
+		reload_count_++;
+	}
+
+private:
+	VulkanDevice * device_;
+	Texture * fallback_;
+	VkDeviceSize budget_;
+	VkDeviceSize resident_size_ = 0;
+	uint64_t frame_ = 0;
+	uint64_t eviction_count_ = 0;
+	uint64_t reload_count_ = 0;
+	std::vector<Texture2D*> textures_;
+	std::vector<Texture2D*> candidates_;
+	std::deque<Texture2D*> reload_queue_;
+	std::vector<Texture2D*> loading_;
+};
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef _VULKAN_THREAD_POOL_H_
+#define _VULKAN_THREAD_POOL_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+#include "VulkanDevice.hpp"
+#include "Utility.h"
+#include "VulkanCpuTracer.h"
+#include "VulkanFrameArena.h"
+
+// Worker threads used to record secondary command buffers .
+// Every worker owns one command pool per frame in flight and per pass , the pool of a pass is reset as a whole in ResetPass
+// once the fence of that frame has been waited on , so workers never share a pool and never free buffers one by one .
+// Keeping the passes in separate pools lets a pass keep its recorded buffers while another one is re-recorded .
+// Jobs are added from a single thread , their closures live in a frame arena and the job list keeps its capacity ,
+// both are recycled by Wait , so queueing the same jobs every frame does not touch the heap .
+class VulkanThreadPool
+{
+public:
+	VulkanThreadPool(VulkanDevice * device, int threadCount, int framesInFlight, int passCount) : job_arena_(JOB_ARENA_BLOCK_SIZE)
+	{
+		device_ = device;
+		frames_in_flight_ = framesInFlight;
+		pass_count_ = passCount;
+		thread_data_.resize(threadCount);
+		for (auto & threadData : thread_data_)
+		{
+			threadData.command_pools.resize(framesInFlight * passCount);
+			threadData.secondary_command_buffers.resize(framesInFlight * passCount);
+			threadData.used_count.resize(framesInFlight * passCount, 0);
+			for (auto & pool : threadData.command_pools)
+			{
+				pool = device_->CreateCommandPool(device_->GetGraphicsQueue(), 0);
+			}
+		}
+
+		for (int i = 0; i < threadCount; i++)
+		{
+			workers_.push_back(std::thread(&VulkanThreadPool::WorkerLoop, this, i));
+		}
+	}
+
+	~VulkanThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		job_condition_.notify_all();
+		for (auto & worker : workers_) worker.join();
+
+		for (auto & threadData : thread_data_)
+		{
+			for (auto pool : threadData.command_pools)
+			{
+				vkDestroyCommandPool(device_->GetDevice(), pool, NULL);
+			}
+		}
+	}
+
+public:
+	int GetThreadCount() const
+	{
+		return thread_data_.size();
+	}
+
+	// must be called from the recording thread while no job is pending .
+	void ResetPass(int frameIndex, int passIndex)
+	{
+		int slot = frameIndex * pass_count_ + passIndex;
+		for (auto & threadData : thread_data_)
+		{
+			VULKAN_SUCCESS(vkResetCommandPool(device_->GetDevice(), threadData.command_pools[slot], 0));
+			threadData.used_count[slot] = 0;
+		}
+	}
+
+	// job is called with the index of the worker running it .
+	template <class Func>
+	void AddJob(Func && job)
+	{
+		typedef typename std::decay<Func>::type Closure;
+		Closure * closure = job_arena_.New<Closure>(std::forward<Func>(job));
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			jobs_.push_back({ &RunJob<Closure> , closure });
+			pending_jobs_++;
+		}
+		job_condition_.notify_one();
+	}
+
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		done_condition_.wait(lock, [this]() { return pending_jobs_ == 0; });
+		jobs_.clear();
+		next_job_ = 0;
+		job_arena_.Reset();
+	}
+
+	// only valid on the worker thread identified by threadIndex .
+	VkCommandBuffer GetSecondaryCommandBuffer(int threadIndex, int frameIndex, int passIndex)
+	{
+		int slot = frameIndex * pass_count_ + passIndex;
+		ThreadData & threadData = thread_data_[threadIndex];
+		std::vector<VkCommandBuffer> & commandBuffers = threadData.secondary_command_buffers[slot];
+		size_t & used = threadData.used_count[slot];
+		if (used == commandBuffers.size())
+		{
+			VkCommandBuffer commandBuffer;
+			device_->CreateCommandBuffer(threadData.command_pools[slot], 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY, &commandBuffer);
+			commandBuffers.push_back(commandBuffer);
+		}
+		return commandBuffers[used++];
+	}
+
+private:
+	struct Job
+	{
+		void (*run)(void * closure, int threadIndex);
+		void * closure;
+	};
+
+	template <class Closure>
+	static void RunJob(void * closure, int threadIndex)
+	{
+		Closure * func = (Closure*)closure;
+		(*func)(threadIndex);
+		func->~Closure();
+	}
+
+	void WorkerLoop(int threadIndex)
+	{
+		std::string threadName = "record worker " + std::to_string(threadIndex);
+		VulkanCpuTracer::Get().SetThreadName(threadName.c_str());
+		while (true)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				job_condition_.wait(lock, [this]() { return stop_ || next_job_ < jobs_.size(); });
+				if (stop_ && next_job_ == jobs_.size()) return;
+				job = jobs_[next_job_++];
+			}
+
+			job.run(job.closure, threadIndex);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				pending_jobs_--;
+				if (pending_jobs_ == 0) done_condition_.notify_all();
+			}
+		}
+	}
+
+private:
+	struct ThreadData
+	{
+		std::vector<VkCommandPool> command_pools;
+		std::vector<std::vector<VkCommandBuffer>> secondary_command_buffers;
+		std::vector<size_t> used_count;
+	};
+
+	VulkanDevice * device_;
+	int frames_in_flight_;
+	int pass_count_;
+	std::vector<ThreadData> thread_data_;
+	std::vector<std::thread> workers_;
+
+	static const size_t JOB_ARENA_BLOCK_SIZE = 16 * 1024;
+	VulkanFrameArena job_arena_;
+	std::vector<Job> jobs_;
+	size_t next_job_ = 0;
+	int pending_jobs_ = 0;
+	bool stop_ = false;
+	std::mutex mutex_;
+	std::condition_variable job_condition_;
+	std::condition_variable done_condition_;
+};
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef _VULKAN_TRANSIENT_IMAGE_POOL_H_
+#define _VULKAN_TRANSIENT_IMAGE_POOL_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <algorithm>
+#include "Utility.h"
+#include "VulkanDevice.hpp"
+#include "VulkanImage.h"
+
+struct TransientImageDesc
+{
+	VkFormat format;
+	VkImageUsageFlags usage;
+	int width;
+	int height;
+	VkImageAspectFlags aspect;
+	int layerCount;
+	bool haveSampler;
+};
+
+// Render targets that only live for a part of the frame .
+// Every image declares the first and the last pass that touches it , images whose pass ranges do not overlap
+// are placed at overlapping offsets of one allocation per memory type . The user has to make sure the aliased
+// images are not accessed concurrently , VulkanRenderGraph does that for the images it creates .
+// Images used with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT never leave the tile memory , they get their own
+// lazily allocated memory when the device has such a memory type .
+class VulkanTransientImagePool
+{
+public:
+	typedef int Handle;
+
+	VulkanTransientImagePool(VulkanDevice * device) : device_(device)
+	{
+	}
+
+	~VulkanTransientImagePool()
+	{
+		for (auto & entry : entries_)
+		{
+			delete entry.image;
+		}
+		for (size_t i = 0; i < memories_.size(); i++)
+		{
+			vkFreeMemory(device_->GetDevice(), memories_[i], NULL);
+			device_->GetMemoryAllocator()->RemoveExternal(heaps_[i].memory_type, heaps_[i].size, MEMORY_CATEGORY_RENDER_TARGET);
+		}
+	}
+
+public:
+	Handle AddImage(const TransientImageDesc & desc, int firstPass, int lastPass)
+	{
+		if (allocated_)
+		{
+			throw " transient images are already allocated . ";
+		}
+		Entry entry = {};
+		entry.desc = desc;
+		entry.first_pass = firstPass;
+		entry.last_pass = lastPass;
+		entries_.push_back(entry);
+		return entries_.size() - 1;
+	}
+
+	void Allocate()
+	{
+		uint32_t queueIndex = device_->GetQueueFamilyIndex(VK_QUEUE_GRAPHICS_BIT);
+		std::vector<Handle> placeOrder;
+		for (size_t i = 0; i < entries_.size(); i++)
+		{
+			Entry & entry = entries_[i];
+			VkImageCreateInfo imageCreateInfo = VulkanInitializer::InitImageCreateInfo(entry.desc.format, VK_IMAGE_TILING_OPTIMAL,
+				entry.desc.width, entry.desc.height, 1, entry.desc.layerCount, 1, &queueIndex, VK_IMAGE_LAYOUT_UNDEFINED, entry.desc.usage);
+			VULKAN_SUCCESS(vkCreateImage(device_->GetDevice(), &imageCreateInfo, NULL, &entry.vk_image));
+			vkGetImageMemoryRequirements(device_->GetDevice(), entry.vk_image, &entry.requirements);
+			requested_size_ += entry.requirements.size;
+
+			VkBool32 lazyFound = VK_FALSE;
+			if (entry.desc.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+			{
+				entry.memory_type = device_->GetMemoryType(entry.requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &lazyFound);
+			}
+			if (lazyFound)
+			{
+				entry.heap = AddHeap(entry.memory_type, true);
+				heaps_[entry.heap].size = entry.requirements.size;
+				entry.offset = 0;
+			}
+			else
+			{
+				entry.memory_type = device_->GetMemoryType(entry.requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+				placeOrder.push_back(i);
+			}
+		}
+
+		// largest first , each image goes to the lowest offset that does not collide with an image alive at the same time .
+		std::sort(placeOrder.begin(), placeOrder.end(), [this](Handle a, Handle b)
+		{
+			return entries_[a].requirements.size > entries_[b].requirements.size;
+		});
+		for (Handle h : placeOrder)
+		{
+			Place(h);
+		}
+
+		for (auto & heap : heaps_)
+		{
+			VkMemoryAllocateInfo memoryAllocateInfo = {};
+			memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			memoryAllocateInfo.allocationSize = heap.size;
+			memoryAllocateInfo.memoryTypeIndex = heap.memory_type;
+			VkDeviceMemory memory;
+			VULKAN_SUCCESS(vkAllocateMemory(device_->GetDevice(), &memoryAllocateInfo, NULL, &memory));
+			device_->GetMemoryAllocator()->AddExternal(heap.memory_type, heap.size, MEMORY_CATEGORY_RENDER_TARGET);
+			memories_.push_back(memory);
+			allocated_size_ += heap.size;
+		}
+
+		for (auto & entry : entries_)
+		{
+			VULKAN_SUCCESS(vkBindImageMemory(device_->GetDevice(), entry.vk_image, memories_[entry.heap], entry.offset));
+			entry.image = new VulkanImage(device_, entry.vk_image, entry.requirements.size, entry.desc.format, VK_IMAGE_LAYOUT_UNDEFINED,
+				entry.desc.width, entry.desc.height, entry.desc.aspect, entry.desc.layerCount, 1, entry.desc.haveSampler);
+		}
+		allocated_ = true;
+	}
+
+	VulkanImage * GetImage(Handle handle) const
+	{
+		return entries_[handle].image;
+	}
+
+	// true when the two images share memory , they must not be alive at the same time .
+	bool IsAliased(Handle a, Handle b) const
+	{
+		const Entry & ea = entries_[a];
+		const Entry & eb = entries_[b];
+		return a != b && ea.heap == eb.heap &&
+			ea.offset < eb.offset + eb.requirements.size && eb.offset < ea.offset + ea.requirements.size;
+	}
+
+	bool IsAllocated() const
+	{
+		return allocated_;
+	}
+
+	// memory the images would take without aliasing .
+	VkDeviceSize GetRequestedSize() const
+	{
+		return requested_size_;
+	}
+
+	VkDeviceSize GetAllocatedSize() const
+	{
+		return allocated_size_;
+	}
+
+private:
+	struct Entry
+	{
+		TransientImageDesc desc;
+		int first_pass;
+		int last_pass;
+		VkImage vk_image;
+		VkMemoryRequirements requirements;
+		uint32_t memory_type;
+		int heap;
+		VkDeviceSize offset;
+		VulkanImage * image;
+	};
+
+	struct Heap
+	{
+		uint32_t memory_type;
+		bool lazy;
+		VkDeviceSize size;
+	};
+
+	int AddHeap(uint32_t memoryType, bool lazy)
+	{
+		Heap heap = { memoryType , lazy , 0 };
+		heaps_.push_back(heap);
+		return heaps_.size() - 1;
+	}
+
+	void Place(Handle h)
+	{
+		Entry & entry = entries_[h];
+		int heapIndex = -1;
+		for (size_t i = 0; i < heaps_.size(); i++)
+		{
+			if (heaps_[i].memory_type == entry.memory_type && !heaps_[i].lazy)
+			{
+				heapIndex = i;
+				break;
+			}
+		}
+		if (heapIndex < 0) heapIndex = AddHeap(entry.memory_type, false);
+
+		// the candidates are the start of the heap and the ends of the images alive at the same time .
+		std::vector<Handle> alive;
+		for (Handle other : placed_)
+		{
+			const Entry & o = entries_[other];
+			if (o.heap == heapIndex && o.first_pass <= entry.last_pass && entry.first_pass <= o.last_pass)
+			{
+				alive.push_back(other);
+			}
+		}
+		VkDeviceSize alignment = entry.requirements.alignment;
+		VkDeviceSize best = ~0ull;
+		std::vector<VkDeviceSize> candidates(1, 0);
+		for (Handle other : alive)
+		{
+			const Entry & o = entries_[other];
+			candidates.push_back((o.offset + o.requirements.size + alignment - 1) / alignment * alignment);
+		}
+		for (VkDeviceSize offset : candidates)
+		{
+			bool fits = true;
+			for (Handle other : alive)
+			{
+				const Entry & o = entries_[other];
+				if (offset < o.offset + o.requirements.size && o.offset < offset + entry.requirements.size)
+				{
+					fits = false;
+					break;
+				}
+			}
+			if (fits) best = (std::min)(best, offset);
+		}
+
+		entry.heap = heapIndex;
+		entry.offset = best;
+		heaps_[heapIndex].size = (std::max)(heaps_[heapIndex].size, best + entry.requirements.size);
+		placed_.push_back(h);
+	}
+
+private:
+	VulkanDevice * device_;
+	std::vector<Entry> entries_;
+	std::vector<Heap> heaps_;
+	std::vector<Handle> placed_;
+	std::vector<VkDeviceMemory> memories_;
+	VkDeviceSize requested_size_ = 0;
+	VkDeviceSize allocated_size_ = 0;
+	bool allocated_ = false;
+};
+
+#endif
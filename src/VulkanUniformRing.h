@@ -0,0 +1,94 @@
+#ifndef _VULKAN_UNIFORM_RING_H_
+#define _VULKAN_UNIFORM_RING_H_
+
+#include <vulkan/vulkan.h>
+#include <cstring>
+#include <algorithm>
+#include "VulkanDevice.hpp"
+
+// Uniform data written by the cpu every frame .
+// One persistently mapped buffer is split into a partition per frame in flight , a frame only writes its own
+// partition after the fence of that slot was waited on , so the gpu never reads data that is being overwritten .
+// Allocations are handed out linearly and bound with dynamic offsets , BeginFrame throws the partition away .
+// The offsets only depend on the order and the sizes of the allocations , a frame slot doing the same
+// allocations as last time gets the same offsets back , so recorded command buffers stay valid .
+class VulkanUniformRing
+{
+public:
+	VulkanUniformRing(VulkanDevice * device, VkDeviceSize frameSize, int framesInFlight) : device_(device)
+	{
+		alignment_ = (std::max<VkDeviceSize>)(device->GetProperties().limits.minUniformBufferOffsetAlignment, 16);
+		frame_size_ = (frameSize + alignment_ - 1) / alignment_ * alignment_;
+		frames_in_flight_ = framesInFlight;
+		// the compute queue reads the light data , the buffer is shared without ownership transfers .
+		buffer_ = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame_size_ * framesInFlight, MEMORY_CATEGORY_OTHER, NULL, true);
+		buffer_->Map();
+		mapped_ = (char*)buffer_->GetMappedMemory();
+		BeginFrame(0);
+	}
+
+	~VulkanUniformRing()
+	{
+		delete buffer_;
+	}
+
+public:
+	void BeginFrame(int frameIndex)
+	{
+		// a slot past the partitions would alias the partition of a frame the gpu may still read .
+		if (frameIndex < 0 || frameIndex >= frames_in_flight_)
+		{
+			throw " uniform ring frame index out of range . ";
+		}
+		frame_begin_ = frame_size_ * frameIndex;
+		head_ = frame_begin_;
+	}
+
+	// the returned memory is write only , it is uncached on most devices .
+	void * Allocate(VkDeviceSize size, uint32_t & offset)
+	{
+		VkDeviceSize begin = (head_ + alignment_ - 1) / alignment_ * alignment_;
+		if (begin + size > frame_begin_ + frame_size_)
+		{
+			throw " uniform ring frame overflow . ";
+		}
+		head_ = begin + size;
+		offset = (uint32_t)begin;
+		return mapped_ + begin;
+	}
+
+	uint32_t Write(const void * data, VkDeviceSize size)
+	{
+		uint32_t offset;
+		memcpy(Allocate(size, offset), data, size);
+		return offset;
+	}
+
+	// descriptor of a dynamic uniform buffer binding , range is the size read by the shader .
+	VkDescriptorBufferInfo GetDescriptorInfo(VkDeviceSize range) const
+	{
+		VkDescriptorBufferInfo bufferInfo = {};
+		bufferInfo.buffer = buffer_->GetDesc().buffer;
+		bufferInfo.offset = 0;
+		bufferInfo.range = range;
+		return bufferInfo;
+	}
+
+	VkDeviceSize GetFrameUsedSize() const
+	{
+		return head_ - frame_begin_;
+	}
+
+private:
+	VulkanDevice * device_;
+	VulkanBuffer * buffer_;
+	char * mapped_;
+	VkDeviceSize alignment_;
+	VkDeviceSize frame_size_;
+	VkDeviceSize frame_begin_;
+	VkDeviceSize head_;
+	int frames_in_flight_;
+};
+
+#endif
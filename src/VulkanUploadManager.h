@@ -0,0 +1,465 @@
+#ifndef _VULKAN_UPLOAD_MANAGER_H_
+#define _VULKAN_UPLOAD_MANAGER_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <cstring>
+#include "VulkanDevice.hpp"
+#include "VulkanInitializer.hpp"
+
+// the batch an upload was recorded into , 0 never has to be waited on .
+typedef uint64_t UploadTicket;
+
+// Uploads record their copies into the open batch , a batch is one command buffer submitted with one fence .
+// Source data goes into a persistently mapped staging ring , the range of a batch is reused once its fence signaled .
+// A batch is submitted when it holds half of the ring or by Flush . Every upload hands its destination over to the
+// graphics queue with HandOverBuffer or HandOverImage , that barrier and the queue order make the upload visible to
+// everything submitted after it , so the cpu only waits on a ticket when it needs the upload finished itself ,
+// e.g. before the destination is destroyed .
+// When the upload queue is not in the graphics family the hand over is a queue family ownership transfer . The release
+// is recorded into the upload command buffer , the acquire into a second command buffer of the batch which is submitted
+// to the graphics queue once the upload fence signaled , so the graphics queue never waits on the transfer queue .
+class VulkanUploadManager
+{
+public:
+	// staging memory and the command buffers of the open batch , only valid between BeginUpload and EndUpload .
+	// graphics_command_buffer runs on the graphics queue after the hand overs , e.g. for mip map blits , it is the
+	// upload command buffer itself when the upload queue is in the graphics family .
+	struct UploadContext
+	{
+		VkCommandBuffer command_buffer;
+		VkCommandBuffer graphics_command_buffer;
+		VkBuffer staging_buffer;
+		VkDeviceSize staging_offset;
+		void * staging_data;
+	};
+
+	VulkanUploadManager(VulkanDevice * device, VkQueue queue, uint32_t queueFamily, VkQueue graphicsQueue, uint32_t graphicsFamily, VkDeviceSize stagingSize) :
+		device_(device), queue_(queue), queue_family_(queueFamily), graphics_queue_(graphicsQueue), graphics_family_(graphicsFamily), ring_size_(stagingSize)
+	{
+		command_pool_ = device_->CreateCommandPool(queueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+		graphics_command_pool_ = command_pool_;
+		if (IsOwnershipTransfer())
+		{
+			graphics_command_pool_ = device_->CreateCommandPool(graphicsFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+		}
+		staging_buffer_ = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ring_size_, MEMORY_CATEGORY_STAGING);
+		staging_buffer_->Map();
+		staging_data_ = (char*)staging_buffer_->GetMappedMemory();
+	}
+
+	~VulkanUploadManager()
+	{
+		WaitIdle();
+		for (Batch * batch : free_batches_)
+		{
+			vkDestroyFence(device_->GetDevice(), batch->fence, NULL);
+			delete batch;
+		}
+		if (open_batch_ != NULL)
+		{
+			vkDestroyFence(device_->GetDevice(), open_batch_->fence, NULL);
+			delete open_batch_;
+		}
+		vkDestroyCommandPool(device_->GetDevice(), command_pool_, NULL);
+		if (graphics_command_pool_ != command_pool_)
+		{
+			vkDestroyCommandPool(device_->GetDevice(), graphics_command_pool_, NULL);
+		}
+		delete staging_buffer_;
+	}
+
+public:
+	// locks the manager until EndUpload , stagingSize may be 0 for uploads that only record commands .
+	UploadContext BeginUpload(VkDeviceSize stagingSize, VkDeviceSize alignment = 16)
+	{
+		// released by a throw below , handed to upload_lock_ once the context is ready .
+		std::unique_lock<std::mutex> lock(mutex_);
+		UploadContext context = {};
+		if (stagingSize > 0)
+		{
+			if (stagingSize * 2 > ring_size_)
+			{
+				// too large to share the ring , the buffer lives until the batch retired .
+				VulkanBuffer * dedicated = device_->CreateVulkanBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingSize, MEMORY_CATEGORY_STAGING);
+				dedicated->Map();
+				GetOpenBatch()->dedicated_buffers.push_back(dedicated);
+				context.staging_buffer = dedicated->GetDesc().buffer;
+				context.staging_offset = 0;
+				context.staging_data = dedicated->GetMappedMemory();
+			}
+			else
+			{
+				context.staging_buffer = staging_buffer_->GetDesc().buffer;
+				context.staging_offset = AllocateStaging(stagingSize, alignment);
+				context.staging_data = staging_data_ + context.staging_offset;
+				open_staging_size_ += stagingSize;
+			}
+		}
+		Batch * batch = GetOpenBatch();
+		context.command_buffer = batch->command_buffer;
+		context.graphics_command_buffer = batch->graphics_command_buffer;
+		upload_lock_ = std::move(lock);
+		return context;
+	}
+
+	UploadTicket EndUpload()
+	{
+		std::unique_lock<std::mutex> lock(std::move(upload_lock_));
+		UploadTicket ticket = open_batch_->ticket;
+		if (open_staging_size_ * 2 >= ring_size_)
+		{
+			SubmitOpenBatch();
+		}
+		return ticket;
+	}
+
+	UploadTicket UploadBuffer(VulkanBuffer * dst, const void * data, VkDeviceSize size, VkDeviceSize dstOffset = 0,
+		VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VkAccessFlags dstAccess = VK_ACCESS_MEMORY_READ_BIT)
+	{
+		UploadContext context = BeginUpload(size);
+		memcpy(context.staging_data, data, size);
+		VkBufferCopy copyRegion = {};
+		copyRegion.srcOffset = context.staging_offset;
+		copyRegion.dstOffset = dstOffset;
+		copyRegion.size = size;
+		vkCmdCopyBuffer(context.command_buffer, context.staging_buffer, dst->GetDesc().buffer, 1, &copyRegion);
+		HandOverBuffer(context, dst->GetDesc().buffer, dstOffset, size, dstStage, dstAccess, dst->IsConcurrent());
+		return EndUpload();
+	}
+
+	// recorded after the transfer writes of the range , dstStage and dstAccess are the first use on the graphics queue .
+	// a concurrent buffer keeps the two barriers but has no ownership to transfer , exclusive ownership is per buffer
+	// so a range of an exclusive buffer must not be written while the graphics queue reads other ranges of it .
+	void HandOverBuffer(const UploadContext & context, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess,
+		bool concurrent = false)
+	{
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.buffer = buffer;
+		barrier.offset = offset;
+		barrier.size = size;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = dstAccess;
+		if (!IsOwnershipTransfer())
+		{
+			vkCmdPipelineBarrier(context.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, NULL, 1, &barrier, 0, NULL);
+			return;
+		}
+		if (!concurrent)
+		{
+			barrier.srcQueueFamilyIndex = queue_family_;
+			barrier.dstQueueFamilyIndex = graphics_family_;
+		}
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(context.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 1, &barrier, 0, NULL);
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = dstAccess;
+		vkCmdPipelineBarrier(context.graphics_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, NULL, 1, &barrier, 0, NULL);
+	}
+
+	// the layout transition is part of the hand over , release and acquire name the same layouts .
+	void HandOverImage(const UploadContext & context, VkImage image, const VkImageSubresourceRange & range, VkImageLayout oldLayout, VkImageLayout newLayout,
+		VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+	{
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.image = image;
+		barrier.subresourceRange = range;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = dstAccess;
+		if (!IsOwnershipTransfer())
+		{
+			vkCmdPipelineBarrier(context.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, NULL, 0, NULL, 1, &barrier);
+			return;
+		}
+		barrier.srcQueueFamilyIndex = queue_family_;
+		barrier.dstQueueFamilyIndex = graphics_family_;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(context.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = dstAccess;
+		vkCmdPipelineBarrier(context.graphics_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, NULL, 0, NULL, 1, &barrier);
+	}
+
+	// submits the open batch and hands over the batches whose upload finished , never blocks .
+	// the returned ticket covers every upload recorded before the call .
+	UploadTicket Flush()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		SubmitOpenBatch();
+		RetireCompleted();
+		return next_ticket_ - 1;
+	}
+
+	bool IsComplete(UploadTicket ticket)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		RetireCompleted();
+		return ticket <= completed_ticket_;
+	}
+
+	void Wait(UploadTicket ticket)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (open_batch_ != NULL && ticket >= open_batch_->ticket)
+		{
+			SubmitOpenBatch();
+		}
+		WaitUntil(ticket);
+	}
+
+	void WaitIdle()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		SubmitOpenBatch();
+		WaitUntil(next_ticket_ - 1);
+	}
+
+	bool IsOwnershipTransfer() const
+	{
+		return queue_family_ != graphics_family_;
+	}
+
+private:
+	struct Batch
+	{
+		UploadTicket ticket;
+		VkCommandBuffer command_buffer;
+		VkCommandBuffer graphics_command_buffer;
+		// signaled by the upload submit , then reused by the acquire submit on the graphics queue .
+		VkFence fence;
+		// the ring head when the batch was submitted , everything before it is free once the upload finished .
+		VkDeviceSize ring_end;
+		std::vector<VulkanBuffer*> dedicated_buffers;
+	};
+
+	Batch * GetOpenBatch()
+	{
+		if (open_batch_ != NULL)
+		{
+			return open_batch_;
+		}
+		if (!free_batches_.empty())
+		{
+			open_batch_ = free_batches_.back();
+			free_batches_.pop_back();
+			vkResetCommandBuffer(open_batch_->command_buffer, 0);
+			if (IsOwnershipTransfer())
+			{
+				vkResetCommandBuffer(open_batch_->graphics_command_buffer, 0);
+			}
+		}
+		else
+		{
+			open_batch_ = new Batch();
+			device_->CreateCommandBuffer(command_pool_, 1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &open_batch_->command_buffer);
+			open_batch_->graphics_command_buffer = open_batch_->command_buffer;
+			if (IsOwnershipTransfer())
+			{
+				device_->CreateCommandBuffer(graphics_command_pool_, 1, VK_COMMAND_BUFFER_LEVEL_PRIMARY, &open_batch_->graphics_command_buffer);
+			}
+			VkFenceCreateInfo fenceCreateInfo = {};
+			fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			if (vkCreateFence(device_->GetDevice(), &fenceCreateInfo, NULL, &open_batch_->fence) != VK_SUCCESS)
+			{
+				throw " create upload fence fault . ";
+			}
+		}
+		open_batch_->ticket = next_ticket_++;
+		VkCommandBufferBeginInfo beginInfo = VulkanInitializer::InitCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		vkBeginCommandBuffer(open_batch_->command_buffer, &beginInfo);
+		if (IsOwnershipTransfer())
+		{
+			vkBeginCommandBuffer(open_batch_->graphics_command_buffer, &beginInfo);
+		}
+		return open_batch_;
+	}
+
+	void SubmitOpenBatch()
+	{
+		if (open_batch_ == NULL)
+		{
+			return;
+		}
+		vkEndCommandBuffer(open_batch_->command_buffer);
+		if (IsOwnershipTransfer())
+		{
+			vkEndCommandBuffer(open_batch_->graphics_command_buffer);
+		}
+		Submit(queue_, open_batch_->command_buffer, open_batch_->fence);
+		open_batch_->ring_end = ring_head_;
+		uploading_batches_.push_back(open_batch_);
+		open_batch_ = NULL;
+		open_staging_size_ = 0;
+	}
+
+	void Submit(VkQueue queue, VkCommandBuffer commandBuffer, VkFence fence)
+	{
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		if (device_->QueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS)
+		{
+			throw " submit upload batch fault . ";
+		}
+	}
+
+	bool IsSignaled(Batch * batch)
+	{
+		return vkGetFenceStatus(device_->GetDevice(), batch->fence) == VK_SUCCESS;
+	}
+
+	void WaitFence(Batch * batch)
+	{
+		vkWaitForFences(device_->GetDevice(), 1, &batch->fence, VK_TRUE, UINT64_MAX);
+	}
+
+	void RetireCompleted()
+	{
+		while (!uploading_batches_.empty() && IsSignaled(uploading_batches_.front()))
+		{
+			FinishUpload(uploading_batches_.front());
+		}
+		while (!acquiring_batches_.empty() && IsSignaled(acquiring_batches_.front()))
+		{
+			Retire(acquiring_batches_.front());
+		}
+	}
+
+	// batches leave both lists in ticket order , the acquiring ones are always older than the uploading ones .
+	void WaitUntil(UploadTicket ticket)
+	{
+		while (ticket > completed_ticket_)
+		{
+			if (!acquiring_batches_.empty())
+			{
+				WaitFence(acquiring_batches_.front());
+				Retire(acquiring_batches_.front());
+			}
+			else if (!uploading_batches_.empty())
+			{
+				WaitFence(uploading_batches_.front());
+				FinishUpload(uploading_batches_.front());
+			}
+			else
+			{
+				break;
+			}
+		}
+	}
+
+	// the upload fence signaled , the staging range is free and the destinations can be acquired .
+	void FinishUpload(Batch * batch)
+	{
+		uploading_batches_.pop_front();
+		vkResetFences(device_->GetDevice(), 1, &batch->fence);
+		for (VulkanBuffer * buffer : batch->dedicated_buffers)
+		{
+			delete buffer;
+		}
+		batch->dedicated_buffers.clear();
+		ring_tail_ = batch->ring_end;
+		if (!IsOwnershipTransfer())
+		{
+			completed_ticket_ = batch->ticket;
+			free_batches_.push_back(batch);
+			return;
+		}
+		Submit(graphics_queue_, batch->graphics_command_buffer, batch->fence);
+		acquiring_batches_.push_back(batch);
+	}
+
+	void Retire(Batch * batch)
+	{
+		acquiring_batches_.pop_front();
+		vkResetFences(device_->GetDevice(), 1, &batch->fence);
+		completed_ticket_ = batch->ticket;
+		free_batches_.push_back(batch);
+	}
+
+	// the live range of the ring runs from tail to head , head equals tail only when the ring is empty .
+	VkDeviceSize AllocateStaging(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		while (true)
+		{
+			if (ring_head_ == ring_tail_)
+			{
+				ring_head_ = ring_tail_ = 0;
+			}
+			VkDeviceSize begin = (ring_head_ + alignment - 1) / alignment * alignment;
+			bool fits = false;
+			if (ring_head_ >= ring_tail_)
+			{
+				if (begin + size <= ring_size_)
+				{
+					fits = true;
+				}
+				else if (size < ring_tail_)
+				{
+					begin = 0;
+					fits = true;
+				}
+			}
+			else
+			{
+				fits = begin + size < ring_tail_;
+			}
+
+			if (fits)
+			{
+				ring_head_ = begin + size;
+				return begin;
+			}
+
+			// only the open batch holds the space , it has to be in flight before it can be waited on .
+			if (uploading_batches_.empty())
+			{
+				SubmitOpenBatch();
+			}
+			if (uploading_batches_.empty())
+			{
+				throw " upload staging ring exhausted . ";
+			}
+			WaitFence(uploading_batches_.front());
+			FinishUpload(uploading_batches_.front());
+		}
+	}
+
+private:
+	VulkanDevice * device_;
+	VkQueue queue_;
+	uint32_t queue_family_;
+	VkQueue graphics_queue_;
+	uint32_t graphics_family_;
+	VkCommandPool command_pool_;
+	VkCommandPool graphics_command_pool_;
+	std::mutex mutex_;
+	// held from BeginUpload to EndUpload .
+	std::unique_lock<std::mutex> upload_lock_;
+
+	VulkanBuffer * staging_buffer_;
+	char * staging_data_;
+	VkDeviceSize ring_size_;
+	VkDeviceSize ring_head_ = 0;
+	VkDeviceSize ring_tail_ = 0;
+	VkDeviceSize open_staging_size_ = 0;
+
+	Batch * open_batch_ = NULL;
+	std::deque<Batch*> uploading_batches_;
+	std::deque<Batch*> acquiring_batches_;
+	std::vector<Batch*> free_batches_;
+	UploadTicket next_ticket_ = 1;
+	UploadTicket completed_ticket_ = 0;
+};
+
+#endif
@@ -1,5 +1,10 @@
+#if defined(_WIN32)
 #include <Windows.h>
+#endif
+#include <cstring>
+#include <cstdlib>
 #include "VulkanBase.h"
+#include "VulkanBenchmark.h"
 #include "VulkanEditor.h"
 #include "SkyBoxPipeline.h"
 
@@ -101,6 +106,7 @@ public:
 	{
 	}
 };
+#if defined(_WIN32)
 LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
 	if (base != NULL)
@@ -118,4 +124,87 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLin
 	base->Init();
 	base->Loop();
 	return 0;
-}
\ No newline at end of file
+}
+#else
+// headless benchmark runner :
+// VulkanRender [--scene sponza|skybox] [--frames N] [--warmup N] [--width W] [--height H] [--device I] [--csv file] [--max-frame-allocs N] [--texture-budget-mb N]
+// VulkanRender --cull-bench N [--frames N] times the cpu frustum culling of N boxes over the given iterations instead .
+// a measured frame may make --max-frame-allocs heap allocations , 0 by default , -1 disables the check .
+int main(int argc, char ** argv)
+{
+	std::string scene = "sponza";
+	int width = 1440;
+	int height = 880;
+	int device = 0;
+	int textureBudgetMB = 0;
+	int cullBenchObjects = 0;
+	BenchmarkOptions options;
+	for (int i = 1; i < argc; i += 2)
+	{
+		// every option takes a value , a missing one would silently run with the defaults .
+		if (i + 1 == argc)
+		{
+			fprintf(stderr, "option %s needs a value\n", argv[i]);
+			return 1;
+		}
+		if (strcmp(argv[i], "--scene") == 0) scene = argv[i + 1];
+		else if (strcmp(argv[i], "--frames") == 0) options.frames = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--warmup") == 0) options.warmupFrames = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--width") == 0) width = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--height") == 0) height = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--device") == 0) device = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--csv") == 0) options.csvFile = argv[i + 1];
+		else if (strcmp(argv[i], "--max-frame-allocs") == 0) options.maxFrameAllocations = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--texture-budget-mb") == 0) textureBudgetMB = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--cull-bench") == 0) cullBenchObjects = atoi(argv[i + 1]);
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (cullBenchObjects > 0)
+	{
+		FrustumCullBenchmark cullBenchmark(cullBenchObjects, options.frames);
+		cullBenchmark.Run();
+		cullBenchmark.PrintReport();
+		return 0;
+	}
+
+	try
+	{
+		if (scene == "sponza") base = new ForwardSponzaTest();
+		else if (scene == "skybox") base = new SkyboxTest();
+		else
+		{
+			fprintf(stderr, "unknown scene %s\n", scene.c_str());
+			return 1;
+		}
+		base->SetupHeadless(width, height);
+		base->SetPhysicalDeviceIndex(device);
+		base->SetTextureBudget((VkDeviceSize)textureBudgetMB * 1024 * 1024);
+		base->Init();
+
+		VulkanBenchmark benchmark(base, options);
+		benchmark.Run();
+		benchmark.PrintReport();
+		if (options.csvFile.size() != 0 && !benchmark.WriteCSV(options.csvFile))
+		{
+			fprintf(stderr, "can not write %s\n", options.csvFile.c_str());
+			return 1;
+		}
+		if (!benchmark.IsAllocationBudgetMet())
+		{
+			fprintf(stderr, "a frame made %llu heap allocations , the limit is %d\n", (unsigned long long)benchmark.GetMaxFrameAllocations(), options.maxFrameAllocations);
+			return 1;
+		}
+	}
+	catch (const char * error)
+	{
+		fprintf(stderr, "%s\n", error);
+		return 1;
+	}
+	return 0;
+}
+#endif